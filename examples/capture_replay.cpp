@@ -0,0 +1,92 @@
+#include "../include/Capture.h"
+#include "../include/Memory.h"
+#include "../include/Processor.h"
+#include "../include/Disk.h"
+#include "../include/Network.h"
+#include "../include/Process.h"
+#include "../include/Cgroup.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <string>
+
+using namespace kuserspace;
+
+// capture_replay capture <dir> [frames] [interval ms]
+// capture_replay replay <dir>
+//
+// Capture snapshots this host; replay runs the collectors over the capture
+// at the captured pace, so parse paths can be benchmarked on any machine.
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " capture <dir> [frames] [interval ms]\n"
+                  << "       " << argv[0] << " replay <dir>" << std::endl;
+        return 1;
+    }
+    std::string mode = argv[1];
+    std::string directory = argv[2];
+
+    try {
+        if (mode == "capture") {
+            Capture::Options options;
+            options.frames = argc > 3 ? std::stoul(argv[3]) : 5;
+            options.interval = std::chrono::milliseconds(argc > 4 ? std::stoul(argv[4]) : 1000);
+
+            auto start = std::chrono::steady_clock::now();
+            Capture::Result result = Capture::capture(directory, options);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Captured " << result.frames << " frames, " << result.files << " files, "
+                      << result.bytes / 1024 << " KB in " << ms << " ms" << std::endl;
+            return 0;
+        }
+
+        // Collectors constructed over the replay root read the capture only
+        Replay replay(directory);
+        const Root& root = replay.getRoot();
+        Memory memory(root);
+        Processor processor(root);
+        Disk disk(root);
+        Network network(root);
+        ProcessTree processes(root);
+        Cgroup cgroups(Cgroup::getMountPoint(root));
+
+        std::cout << replay.getFrameCount() << " frames, " << processor.getNumCores() << " cores, "
+                  << memory.getStats().total / (1024 * 1024) << " MB" << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        do {
+            std::this_thread::sleep_until(start + replay.getFrameOffset());
+
+            auto parseStart = std::chrono::steady_clock::now();
+            Memory::Stats mem = memory.getStatsAsync().get();
+            Processor::Stats cpu = processor.getStats();
+            disk.refresh();
+            network.refresh();
+            processes.refresh();
+            cgroups.refresh();
+            double parseUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - parseStart).count();
+
+            double diskRead = 0, netRx = 0;
+            for (const auto& device : disk.getStats(Disk::Filter::WholeDisks)) diskRead += device.readBytesPerSec;
+            for (const auto& interface : network.getStats()) netRx += interface.rxBytesPerSec;
+
+            std::cout << "frame " << std::setw(4) << replay.getFrame()
+                      << " +" << std::setw(6) << replay.getFrameOffset().count() << "ms"
+                      << std::fixed << std::setprecision(1)
+                      << " cpu " << std::setw(5) << cpu.totalUtilization << "%"
+                      << " free " << std::setw(7) << mem.free / (1024 * 1024) << "MB"
+                      << " disk " << std::setw(8) << diskRead / 1024 << "KB/s"
+                      << " rx " << std::setw(8) << netRx / 1024 << "KB/s"
+                      << " procs " << std::setw(5) << processes.size()
+                      << " cgroups " << std::setw(4) << cgroups.size()
+                      << " parse " << parseUs << "us" << std::endl;
+        } while (replay.next());
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
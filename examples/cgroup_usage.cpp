@@ -0,0 +1,56 @@
+#include "../include/Cgroup.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <string>
+
+using namespace kuserspace;
+
+int main() {
+    try {
+        Cgroup& cgroups = Cgroup::getInstance();
+        if (cgroups.getRoot().empty()) {
+            std::cerr << "No cgroup v2 hierarchy is mounted" << std::endl;
+            return 1;
+        }
+
+        // Example 1: The hierarchy and where this process lives in it
+        std::cout << "Hierarchy: " << cgroups.getRoot() << " (" << cgroups.size() << " cgroups)" << std::endl;
+        std::cout << "This process: " << Cgroup::getSelfPath() << std::endl;
+        std::cout << "Walk took " << std::chrono::duration<double, std::milli>(cgroups.getRefreshDuration()).count()
+                  << " ms" << std::endl;
+
+        // Example 2: Top-level cgroups with their recursive memory usage
+        for (const auto& child : cgroups.getChildren("/")) {
+            Cgroup::Stats stats = cgroups.getCgroupStats(child);
+            std::cout << child << ": " << stats.descendants << " descendants, "
+                      << stats.usage.memoryCurrent / (1024 * 1024) << " MB, "
+                      << stats.self.memoryCurrent / (1024 * 1024) << " MB outside children" << std::endl;
+        }
+
+        // Example 3: Per-cgroup CPU, memory and I/O rates every second for 5 seconds
+        cgroups.startContinuousMonitoring([](const std::vector<Cgroup::Stats>& all) {
+            for (const auto& stats : all) {
+                if (stats.depth > 2 || stats.cpuUsage < 0.01) continue;
+                std::cout << std::string(stats.depth * 2, ' ') << std::left << std::setw(40) << stats.path
+                          << std::fixed << std::setprecision(2)
+                          << " cpu " << std::setw(6) << stats.cpuUsage
+                          << " throttled " << std::setw(6) << stats.cpuThrottledPercent << "%"
+                          << " mem " << std::setw(10) << stats.usage.memoryCurrent / 1024 << "KB"
+                          << " rMB/s " << std::setw(8) << stats.ioReadBytesPerSec / (1024 * 1024)
+                          << " wMB/s " << stats.ioWriteBytesPerSec / (1024 * 1024) << std::endl;
+            }
+            std::cout << std::endl;
+        }, std::chrono::milliseconds(1000));
+
+        std::this_thread::sleep_for(std::chrono::seconds(5));
+        cgroups.stopContinuousMonitoring();
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
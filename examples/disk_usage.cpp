@@ -0,0 +1,98 @@
+#include "../include/Disk.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+
+using namespace kuserspace;
+
+int main(int argc, char* argv[]) {
+    try {
+        Disk& disk = Disk::getInstance();
+
+        // Example 1: List whole disks and their lifetime counters
+        for (const auto& device : disk.getStats(Disk::Filter::WholeDisks)) {
+            std::cout << device.name << " (" << device.major << ":" << device.minor << "): "
+                      << device.counters.readsCompleted << " reads, "
+                      << device.counters.writesCompleted << " writes" << std::endl;
+        }
+
+        // Example 2: Queue topology and blk-mq NUMA placement
+        for (const auto& queue : disk.getQueueTopology()) {
+            std::cout << queue.name << ": " << (queue.rotational ? "rotational" : "non-rotational")
+                      << ", scheduler " << queue.scheduler
+                      << ", nr_requests " << queue.nrRequests
+                      << ", " << queue.nrHwQueues << " hw queues"
+                      << ", NUMA node " << queue.numaNode;
+            if (queue.crossNodeQueues > 0) {
+                std::cout << " (" << queue.crossNodeQueues << " queues serve CPUs on other nodes)";
+            }
+            std::cout << std::endl;
+        }
+
+        // Example 3: Filesystem capacity served from the mount cache
+        disk.startFilesystemMonitoring(std::chrono::milliseconds(1000));
+        for (const auto& fs : disk.getFilesystems()) {
+            if (fs.totalBytes == 0) continue;
+            std::cout << fs.mountPoint << " (" << fs.fsType << "): "
+                      << fs.availableBytes / (1024 * 1024) << " MB available of "
+                      << fs.totalBytes / (1024 * 1024) << " MB, "
+                      << fs.availableInodes << " inodes available" << std::endl;
+        }
+        std::cout << "Available on /: " << disk.getAvailableBytes("/") << " bytes" << std::endl;
+        disk.stopFilesystemMonitoring();
+
+        // Example 4: Latency distribution. Kernel figures need io.latency or
+        // debugfs; the active probe reads a test file given as argv[1].
+        for (const auto& device : disk.getStats(Disk::Filter::WholeDisks)) {
+            Disk::LatencyStats latency = disk.getKernelLatency(device.name);
+            if (latency.source != Disk::LatencySource::None) {
+                std::cout << device.name << " kernel mean latency " << latency.meanUs << "us";
+                if (!latency.meanOnly) {
+                    std::cout << " (min " << latency.minUs << "us, max " << latency.maxUs << "us)";
+                }
+                std::cout << std::endl;
+            }
+        }
+        if (argc > 1) {
+            Disk::LatencyProbe probe;
+            probe.testFile = argv[1];
+            probe.queueDepth = 4;
+            probe.duration = std::chrono::milliseconds(2000);
+
+            Disk::LatencyStats latency = disk.probeLatency(probe);
+            std::cout << "\nLatency on " << latency.device << " (" << latency.samples << " reads): "
+                      << std::fixed << std::setprecision(1)
+                      << "mean " << latency.meanUs << "us"
+                      << " p50 " << latency.p50Us << "us"
+                      << " p99 " << latency.p99Us << "us"
+                      << " p99.9 " << latency.p999Us << "us"
+                      << " max " << latency.maxUs << "us" << std::endl;
+        }
+
+        // Example 5: Monitor per-device rates for 5 seconds
+        disk.startContinuousMonitoring([](const std::vector<Disk::DeviceStats>& devices) {
+            for (const auto& device : devices) {
+                std::cout << std::left << std::setw(10) << device.name << std::fixed << std::setprecision(1)
+                          << " r/s " << std::setw(8) << device.readIops
+                          << " w/s " << std::setw(8) << device.writeIops
+                          << " rMB/s " << std::setw(8) << device.readBytesPerSec / (1024 * 1024)
+                          << " wMB/s " << std::setw(8) << device.writeBytesPerSec / (1024 * 1024)
+                          << " r_await " << std::setw(6) << device.readAwaitMs
+                          << " w_await " << std::setw(6) << device.writeAwaitMs
+                          << " aqu-sz " << std::setw(6) << device.avgQueueDepth
+                          << " util " << device.utilization << "%" << std::endl;
+            }
+            std::cout << std::endl;
+        }, std::chrono::milliseconds(1000), Disk::Filter::WholeDisks);
+
+        std::this_thread::sleep_for(std::chrono::seconds(5));
+        disk.stopContinuousMonitoring();
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include "../include/Exporter.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+
+using namespace kuserspace;
+
+// exporter_bench [cpus] [scrapes]
+//
+// Builds a /proc fixture with many CPUs, disks and interfaces, then reports
+// render time and end-to-end scrape latency over loopback TCP and a Unix
+// socket, so the numbers do not depend on the size of the host.
+namespace {
+
+void writeFile(const std::filesystem::path& path, const std::string& content) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+void writeStat(const std::filesystem::path& proc, std::size_t cpus, uint64_t tick) {
+    std::string stat;
+    auto line = [&stat](const std::string& name, uint64_t user, uint64_t idle) {
+        stat += name + " " + std::to_string(user) + " 0 " + std::to_string(user / 4) + " " + std::to_string(idle) +
+                " 0 0 0 0 0 0\n";
+    };
+    line("cpu", cpus * tick * 3, cpus * tick * 7);
+    for (std::size_t cpu = 0; cpu < cpus; ++cpu) {
+        line("cpu" + std::to_string(cpu), tick * (1 + cpu % 8), tick * (10 - cpu % 8));
+    }
+    stat += "ctxt 1\nbtime 1\nprocesses 1\nprocs_running 1\nprocs_blocked 0\n";
+    writeFile(proc / "stat", stat);
+}
+
+void writeFixture(const std::filesystem::path& proc, std::size_t cpus, std::size_t devices, std::size_t interfaces) {
+    std::ifstream meminfo("/proc/meminfo");
+    writeFile(proc / "meminfo", std::string(std::istreambuf_iterator<char>(meminfo), {}));
+    writeFile(proc / "swaps", "Filename Type Size Used Priority\n");
+    for (const char* resource : {"cpu", "memory", "io"}) {
+        writeFile(proc / "pressure" / resource, "some avg10=1.25 avg60=0.50 avg300=0.10 total=123456\n"
+                                                "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n");
+    }
+
+    std::string diskstats;
+    for (std::size_t d = 0; d < devices; ++d) {
+        diskstats += "259 " + std::to_string(d) + " nvme" + std::to_string(d) + "n1 " +
+                     "1000 0 8000 100 2000 0 16000 200 0 300 300 0 0 0 0 0 0\n";
+    }
+    writeFile(proc / "diskstats", diskstats);
+
+    std::string netdev = "Inter-|   Receive                                                |  Transmit\n"
+                         " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n";
+    for (std::size_t i = 0; i < interfaces; ++i) {
+        netdev += "  veth" + std::to_string(i) + ": 123456 100 0 0 0 0 0 0 654321 200 0 0 0 0 0 0\n";
+    }
+    writeFile(proc / "net" / "dev", netdev);
+    writeStat(proc, cpus, 100);
+}
+
+struct Latency {
+    double p50, p99, max;
+};
+
+Latency summarize(std::vector<double>& micros) {
+    std::sort(micros.begin(), micros.end());
+    return {micros[micros.size() / 2], micros[micros.size() * 99 / 100], micros.back()};
+}
+
+void print(const std::string& what, Latency latency) {
+    std::cout << std::left << std::setw(26) << what << std::right << std::fixed << std::setprecision(1)
+              << " p50 " << std::setw(7) << latency.p50 << " us  p99 " << std::setw(7) << latency.p99
+              << " us  max " << std::setw(7) << latency.max << " us" << std::endl;
+}
+
+// One blocking HTTP/1.1 scrape; returns the response size
+std::size_t scrape(int family, const sockaddr* address, socklen_t length, std::string& response) {
+    int fd = ::socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1 || ::connect(fd, address, length) == -1) {
+        throw std::runtime_error(std::string("Could not connect: ") + std::strerror(errno));
+    }
+    const char request[] = "GET /metrics HTTP/1.1\r\nHost: localhost\r\nAccept: application/openmetrics-text; version=1.0.0\r\n\r\n";
+    if (::write(fd, request, sizeof(request) - 1) < 0) throw std::runtime_error("Could not send request");
+    response.clear();
+    char buffer[65536];
+    ssize_t n;
+    while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        response.append(buffer, static_cast<std::size_t>(n));
+    }
+    ::close(fd);
+    return response.size();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t cpus = argc > 1 ? std::stoul(argv[1]) : 512;
+    std::size_t scrapes = argc > 2 ? std::stoul(argv[2]) : 2000;
+
+    char pattern[] = "/tmp/kuserspace-exporter-XXXXXX";
+    if (!mkdtemp(pattern)) {
+        std::cerr << "Error: could not create fixture directory" << std::endl;
+        return 1;
+    }
+    std::filesystem::path fixture(pattern);
+
+    try {
+        writeFixture(fixture / "proc", cpus, 64, 64);
+        SystemSnapshot snapshot(Root::at(fixture.string()));
+        snapshot.enable(SystemSnapshot::Source::Pressure);
+        writeStat(fixture / "proc", cpus, 200);
+        snapshot.refresh();
+        SystemSnapshot::Snapshot s = snapshot.getSnapshot();
+        std::cout << "Fixture: " << s.processor.perCoreUtilization.size() << " CPUs, " << s.disks.size()
+                  << " disks, " << s.interfaces.size() << " interfaces" << std::endl;
+
+        Exporter exporter(snapshot);
+
+        // Render alone, both formats
+        std::string out;
+        for (bool openMetrics : {true, false}) {
+            std::vector<double> micros;
+            for (std::size_t i = 0; i < scrapes; ++i) {
+                auto start = std::chrono::steady_clock::now();
+                exporter.render(s, out, openMetrics);
+                micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            }
+            std::cout << (openMetrics ? "OpenMetrics: " : "Prometheus text: ") << out.size() << " bytes" << std::endl;
+            print(openMetrics ? "render (openmetrics)" : "render (text 0.0.4)", summarize(micros));
+        }
+
+        // End to end over loopback TCP, then a Unix socket
+        std::string response;
+        exporter.listen(0);
+        sockaddr_in tcp{};
+        tcp.sin_family = AF_INET;
+        tcp.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        tcp.sin_port = htons(exporter.getPort());
+        std::vector<double> micros;
+        for (std::size_t i = 0; i < scrapes; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            scrape(AF_INET, reinterpret_cast<sockaddr*>(&tcp), sizeof(tcp), response);
+            micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::cout << "First line: " << response.substr(0, response.find('\r')) << ", " << response.size() << " bytes" << std::endl;
+        print("scrape (loopback tcp)", summarize(micros));
+
+        std::string path = (fixture / "metrics.sock").string();
+        exporter.listen(path);
+        sockaddr_un local{};
+        local.sun_family = AF_UNIX;
+        std::strncpy(local.sun_path, path.c_str(), sizeof(local.sun_path) - 1);
+        micros.clear();
+        for (std::size_t i = 0; i < scrapes; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            scrape(AF_UNIX, reinterpret_cast<sockaddr*>(&local), sizeof(local), response);
+            micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        print("scrape (unix socket)", summarize(micros));
+        exporter.stop();
+
+        Exporter::Stats stats = exporter.getStats();
+        std::cout << stats.scrapes << " scrapes, " << stats.errors << " errors, last render "
+                  << stats.lastRender.count() / 1000.0 << " us" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::filesystem::remove_all(fixture);
+        return 1;
+    }
+
+    std::filesystem::remove_all(fixture);
+    return 0;
+}
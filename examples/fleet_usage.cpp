@@ -0,0 +1,157 @@
+#include "../include/Fleet.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+
+using namespace kuserspace;
+
+// fleet_usage [agents] [rounds]
+//
+// Simulates a fleet in one process: every agent is a StreamSender with its
+// own connection to the aggregator's Unix socket and a synthetic host of
+// 8 to 64 CPUs. Reports fleet-wide percentiles, the busiest hosts and how
+// fast samples are ingested.
+namespace {
+
+struct Agent {
+    std::unique_ptr<StreamSender> sender;
+    SystemSnapshot::Snapshot snapshot;
+    uint64_t state;
+};
+
+uint64_t next(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+double uniform(uint64_t& state) {
+    return static_cast<double>(next(state) >> 11) / 9007199254740992.0;
+}
+
+void initialize(Agent& agent, std::size_t id) {
+    using Source = SystemSnapshot::Source;
+    SystemSnapshot::Snapshot& s = agent.snapshot;
+    s = SystemSnapshot::Snapshot{};
+    for (Source source : {Source::Memory, Source::Processor, Source::Disk, Source::Network, Source::Protocols,
+                          Source::Pressure}) {
+        s.timings[static_cast<std::size_t>(source)].sampled = true;
+    }
+    s.processor.perCoreUtilization.assign(8u << (id % 4), 0.0f);
+    s.memory.total = 64ull << 30;
+    s.disks.resize(2);
+    s.disks[0].name = "nvme0n1";
+    s.disks[1].name = "nvme1n1";
+    s.interfaces.resize(2);
+    s.interfaces[0].name = "lo";
+    s.interfaces[1].name = "eth0";
+    agent.state = 0x9e3779b97f4a7c15ull * (id + 1);
+}
+
+// One sampling pass: every 97th host runs hot
+void advance(Agent& agent, std::size_t id) {
+    SystemSnapshot::Snapshot& s = agent.snapshot;
+    ++s.sequence;
+    s.wallTime = std::chrono::system_clock::now();
+    double base = id % 97 == 0 ? 90.0 : 10.0 + 50.0 * uniform(agent.state);
+    double total = 0;
+    for (float& core : s.processor.perCoreUtilization) {
+        core = static_cast<float>(std::min(100.0, base + 10.0 * uniform(agent.state)));
+        total += core;
+    }
+    s.processor.totalUtilization = static_cast<float>(total / static_cast<double>(s.processor.perCoreUtilization.size()));
+    s.processor.userTime += static_cast<uint64_t>(total);
+    s.memory.available = s.memory.total / 100 * (20 + next(agent.state) % 60);
+    s.memory.free = s.memory.available / 2;
+    s.pressure.memory.some.avg10 = id % 97 == 0 ? 25.0 : uniform(agent.state);
+    for (Disk::DeviceStats& disk : s.disks) {
+        disk.readBytesPerSec = 1e8 * uniform(agent.state);
+        disk.utilization = 100.0 * uniform(agent.state);
+    }
+    s.interfaces[1].rxBytesPerSec = 1.25e8 * uniform(agent.state);
+    s.interfaces[1].txBytesPerSec = 1.25e8 * uniform(agent.state);
+}
+
+void print(const std::string& what, const Quantiles::Summary& s) {
+    std::cout << std::left << std::setw(28) << what << std::right << std::fixed << std::setprecision(1)
+              << " n " << std::setw(6) << s.count << "  p50 " << std::setw(6) << s.p50 << "  p95 " << std::setw(6)
+              << s.p95 << "  p99 " << std::setw(6) << s.p99 << "  max " << std::setw(6) << s.max << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t count = argc > 1 ? std::stoul(argv[1]) : 2000;
+    std::size_t rounds = argc > 2 ? std::stoul(argv[2]) : 10;
+    std::string socketPath = "/tmp/kuserspace-fleet-" + std::to_string(getpid()) + ".sock";
+
+    try {
+        Fleet fleet;
+        fleet.listen(socketPath);
+
+        std::vector<Agent> agents(count);
+        for (std::size_t id = 0; id < count; ++id) {
+            initialize(agents[id], id);
+            char name[32];
+            std::snprintf(name, sizeof(name), "node-%04zu", id);
+            agents[id].sender = std::make_unique<StreamSender>(name);
+            agents[id].sender->connect(socketPath);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t sent = 0;
+        for (std::size_t round = 0; round < rounds; ++round) {
+            for (std::size_t id = 0; id < count; ++id) {
+                advance(agents[id], id);
+                sent += agents[id].sender->send(agents[id].snapshot);
+            }
+        }
+        while (fleet.getStats().samples < sent &&
+               std::chrono::steady_clock::now() - start < std::chrono::seconds(30)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fleet.publish();
+
+        Fleet::Stats stats = fleet.getStats();
+        StreamReceiver::Stats received = fleet.getReceiverStats();
+        std::cout << std::fixed << stats.hosts << " hosts, " << stats.samples << " samples in " << std::setprecision(2)
+                  << seconds << " s (" << std::setprecision(0) << static_cast<double>(stats.samples) / seconds
+                  << " samples/s), " << received.bytes / std::max<uint64_t>(stats.samples, 1) << " bytes per sample, "
+                  << received.errors << " errors" << std::endl;
+        std::cout << "Rollup of " << stats.hosts << " hosts: " << std::setprecision(1)
+                  << stats.lastPublish.count() / 1000.0 << " us" << std::endl;
+
+        print("cpu.utilization (hosts)", fleet.getAggregate(fleet.findMetric("cpu.utilization")).summary);
+        print("cpu.utilization (window)", fleet.getWindow(fleet.findMetric("cpu.utilization")));
+        print("cpu.maxCoreUtilization", fleet.getAggregate(fleet.findMetric("cpu.maxCoreUtilization")).summary);
+        print("memory.availablePercent", fleet.getAggregate(fleet.findMetric("memory.availablePercent")).summary);
+        print("pressure.memory.some.avg10", fleet.getAggregate(fleet.findMetric("pressure.memory.some.avg10")).summary);
+
+        Fleet::Aggregate rx = fleet.getAggregate(fleet.findMetric("net.rxMiBPerSec"));
+        std::cout << "Fleet receive: " << std::setprecision(1) << rx.sum * 8 * 1048576 / 1e9 << " Gbit/s over "
+                  << rx.summary.count << " hosts" << std::endl;
+
+        std::cout << "Busiest:";
+        for (const auto& [host, value] : fleet.getTop(fleet.findMetric("cpu.utilization"), 3)) {
+            std::cout << " " << host << " (" << value << "%)";
+        }
+        std::cout << std::endl;
+        std::cout << "cpu.utilization sketch for the next tier: "
+                  << fleet.getSketch(fleet.findMetric("cpu.utilization")).serialize().size() << " bytes" << std::endl;
+
+        agents.clear();
+        fleet.stop();
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
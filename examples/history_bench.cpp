@@ -0,0 +1,94 @@
+#include "../include/History.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cmath>
+
+using namespace kuserspace;
+
+// history_bench [metrics] [hours]
+//
+// Fills a History with a day of one-second samples shaped like real
+// metrics (utilization percentages, bursty rates, page-granular gauges),
+// then reports bytes per sample, append cost, decode throughput and how
+// much of a range aggregation the block summaries answered.
+int main(int argc, char* argv[]) {
+    std::size_t metrics = argc > 1 ? std::stoul(argv[1]) : 200;
+    std::size_t hours = argc > 2 ? std::stoul(argv[2]) : 24;
+    std::size_t seconds = hours * 3600;
+
+    try {
+        History history(std::chrono::hours(hours), 1024);
+        std::vector<History::SeriesId> ids;
+        for (std::size_t m = 0; m < metrics; ++m) {
+            History::Type type = m % 3 == 2 ? History::Type::Integer : History::Type::Double;
+            ids.push_back(history.getSeries("metric" + std::to_string(m), type));
+        }
+
+        std::mt19937_64 random(42);
+        std::normal_distribution<double> step(0.0, 1.0);
+        std::uniform_int_distribution<int> jitter(-2, 2);
+        std::vector<double> state(metrics, 0.0);
+
+        auto start = History::Clock::time_point(std::chrono::hours(24 * 365 * 50));
+        auto appendStart = std::chrono::steady_clock::now();
+        for (std::size_t s = 0; s < seconds; ++s) {
+            // Scheduling jitter of a few milliseconds on some samples
+            auto time = start + std::chrono::seconds(s) + std::chrono::milliseconds(s % 10 == 0 ? jitter(random) : 0);
+            for (std::size_t m = 0; m < metrics; ++m) {
+                double& value = state[m];
+                switch (m % 3) {
+                case 0:     // utilization: random walk in [0, 100], one decimal
+                    value = std::round(std::min(100.0, std::max(0.0, value + step(random))) * 10) / 10;
+                    break;
+                case 1:     // rate: mostly idle with bursts
+                    value = random() % 20 == 0 ? std::abs(step(random)) * 1e6 : 0.0;
+                    break;
+                default:    // gauge: changes in whole pages
+                    value = 8e9 + std::round(step(random) * 4) * 4096;
+                    break;
+                }
+                history.append(ids[m], time, value);
+            }
+        }
+        double appendNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - appendStart).count();
+
+        History::Stats stats = history.getStats();
+        std::cout << stats.series << " series, " << stats.samples << " samples in " << stats.blocks << " blocks" << std::endl;
+        std::cout << std::fixed << std::setprecision(2)
+                  << "Memory: " << stats.bytes / (1024.0 * 1024.0) << " MB, "
+                  << stats.bytesPerSample() << " bytes/sample ("
+                  << static_cast<double>(stats.encodedBytes) / stats.samples << " encoded, 16 raw)" << std::endl;
+        std::cout << "Append: " << appendNs / stats.samples << " ns/sample" << std::endl;
+
+        // Decode every sample of every series
+        std::vector<History::Sample> samples;
+        std::size_t decoded = 0;
+        auto end = start + std::chrono::seconds(seconds);
+        auto decodeStart = std::chrono::steady_clock::now();
+        for (History::SeriesId id : ids) {
+            history.query(id, start, end, samples);
+            decoded += samples.size();
+        }
+        double decodeSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - decodeStart).count();
+        std::cout << "Decode: " << decoded / decodeSec / 1e6 << " M samples/s" << std::endl;
+
+        // An hour-aligned range: whole blocks come from their summaries
+        auto from = start + std::chrono::minutes(90);
+        auto to = end - std::chrono::minutes(90);
+        auto aggregateStart = std::chrono::steady_clock::now();
+        History::Aggregate aggregate = history.aggregate(ids[0], from, to);
+        double aggregateUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - aggregateStart).count();
+        std::cout << "Aggregate: " << aggregate.count << " samples, mean " << aggregate.mean()
+                  << ", " << aggregate.blocksSummarized << " blocks summarized, " << aggregate.blocksDecoded
+                  << " decoded, " << aggregateUs << " us" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -81,7 +81,7 @@ void processor_example() {
     monitor_cpu(proc);
     
     // Print detailed core information
-    for (size_t i = 0; i < proc.getNumCores(); ++i) {
+    for (std::size_t i = 0; i < proc.getNumCores(); ++i) {
         std::cout << "Core " << i << ":\n";
         std::cout << "  Temperature: " << proc.getCoreTemperature(i) << "°C\n";
         std::cout << "  Frequency: " << proc.getCoreFrequency(i) / 1000 << " MHz\n";
@@ -89,7 +89,7 @@ void processor_example() {
     }
     
     // Print package information
-    for (size_t i = 0; i < proc.getNumPackages(); ++i) {
+    for (std::size_t i = 0; i < proc.getNumPackages(); ++i) {
         std::cout << "Package " << i << ":\n";
         std::cout << "  Temperature: " << proc.getPackageTemperature(i) << "°C\n";
     }
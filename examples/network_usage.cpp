@@ -0,0 +1,90 @@
+#include "../include/Network.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+
+using namespace kuserspace;
+
+int main() {
+    try {
+        Network& network = Network::getInstance();
+
+        // Example 1: List interfaces and their lifetime counters
+        for (const auto& interface : network.getStats()) {
+            std::cout << interface.name << ": "
+                      << interface.counters.rxBytes << " bytes in, "
+                      << interface.counters.txBytes << " bytes out, "
+                      << interface.counters.rxDropped + interface.counters.txDropped << " drops" << std::endl;
+        }
+
+        // Example 2: Error breakdown from sysfs
+        network.setDetailedStats(true);
+        network.refresh();
+        for (const auto& interface : network.getStats()) {
+            std::cout << interface.name << ": crc " << interface.detail.rxCrcErrors
+                      << ", missed " << interface.detail.rxMissedErrors
+                      << ", no handler " << interface.detail.rxNoHandler << std::endl;
+        }
+
+        // Example 3: NIC queues, their IRQ and steering CPUs, and NUMA placement
+        for (const auto& info : network.getQueueTopology()) {
+            std::cout << info.name << ": NUMA node " << info.numaNode << ", "
+                      << info.irqs.size() << " MSI-X vectors";
+            if (info.crossNodeQueues > 0) {
+                std::cout << ", " << info.crossNodeQueues << " queues serviced from other nodes";
+            }
+            std::cout << std::endl;
+
+            for (const auto& queue : info.queues) {
+                std::cout << "  " << (queue.receive ? "rx-" : "tx-") << queue.index << " irqs";
+                for (int irq : queue.irqs) std::cout << " " << irq;
+                std::cout << " irq cpus";
+                for (int cpu : queue.irqCpus) std::cout << " " << cpu;
+                std::cout << (queue.receive ? " rps" : " xps");
+                for (int cpu : queue.steeringCpus) std::cout << " " << cpu;
+                std::cout << (queue.crossNode ? " [cross-node]" : "") << std::endl;
+            }
+        }
+
+        // Example 4: TCP/UDP protocol counters with threshold alerts
+        network.setProtocolThreshold(Network::ProtocolCounter::RetransSegs, 10.0,
+            [](Network::ProtocolCounter, double rate, double threshold) {
+                std::cout << "Retransmits at " << rate << "/s (threshold " << threshold << "/s)" << std::endl;
+            });
+        network.setProtocolThreshold(Network::ProtocolCounter::ListenOverflows, 1.0,
+            [](Network::ProtocolCounter, double rate, double) {
+                std::cout << "Listen queue overflowing at " << rate << "/s" << std::endl;
+            });
+        network.startProtocolMonitoring(std::chrono::milliseconds(1000));
+
+        Network::ProtocolCounters protocol = network.getProtocolStats().counters;
+        std::cout << "TCP: " << protocol.tcpOutSegs << " segments out, "
+                  << protocol.tcpRetransSegs << " retransmitted, "
+                  << protocol.tcpListenOverflows << " listen overflows" << std::endl;
+
+        // Example 5: Monitor per-interface rates for 5 seconds
+        network.startContinuousMonitoring([](const std::vector<Network::InterfaceStats>& interfaces) {
+            for (const auto& interface : interfaces) {
+                std::cout << std::left << std::setw(10) << interface.name << std::fixed << std::setprecision(1)
+                          << " rxKB/s " << std::setw(8) << interface.rxBytesPerSec / 1024
+                          << " txKB/s " << std::setw(8) << interface.txBytesPerSec / 1024
+                          << " rxpck/s " << std::setw(8) << interface.rxPacketsPerSec
+                          << " txpck/s " << std::setw(8) << interface.txPacketsPerSec
+                          << " drop/s " << interface.rxDropsPerSec + interface.txDropsPerSec
+                          << " err/s " << interface.rxErrorsPerSec + interface.txErrorsPerSec << std::endl;
+            }
+            std::cout << std::endl;
+        }, std::chrono::milliseconds(1000));
+
+        std::this_thread::sleep_for(std::chrono::seconds(5));
+        network.stopContinuousMonitoring();
+        network.stopProtocolMonitoring();
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "../include/Process.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <unordered_map>
+
+using namespace kuserspace;
+
+// Synthetic process table with churn, so the benchmark does not depend on
+// how many processes the host happens to run
+class SyntheticScan {
+public:
+    SyntheticScan(std::size_t count, double churn) : churn(churn), rng(42) {
+        processes.push_back({1, 0, "init", 'S', 0, 0, 4096});
+        for (std::size_t i = 1; i < count; ++i) {
+            spawn();
+        }
+    }
+
+    // Advance one tick: some processes exit, others are born, all accrue CPU
+    void tick() {
+        std::size_t changes = static_cast<std::size_t>(processes.size() * churn);
+        for (std::size_t i = 0; i < changes; ++i) {
+            std::size_t victim = 1 + rng() % (processes.size() - 1);
+            pid_t pid = processes[victim].pid;
+            processes[victim] = processes.back();
+            processes.pop_back();
+            // Orphans are reparented to init
+            for (auto& process : processes) {
+                if (process.ppid == pid) process.ppid = 1;
+            }
+        }
+        for (std::size_t i = 0; i < changes; ++i) {
+            spawn();
+        }
+        for (auto& process : processes) {
+            process.cpuTime += rng() % 3;
+            process.rss += (rng() % 3) * 4096;
+        }
+        ++now;
+    }
+
+    std::vector<Process::Info> processes;
+
+private:
+    void spawn() {
+        const auto& parent = processes[rng() % processes.size()];
+        processes.push_back({nextPid++, parent.pid, "worker", 'S', rng() % 100, now, 4096 * (1 + rng() % 64)});
+    }
+
+    double churn;
+    std::mt19937_64 rng;
+    pid_t nextPid = 2;
+    uint64_t now = 1;
+};
+
+int main(int argc, char* argv[]) {
+    std::size_t count = argc > 1 ? std::stoul(argv[1]) : 50000;
+    const int ticks = 20;
+
+    SyntheticScan scan(count, 0.02);
+    ProcessTree incremental;
+    incremental.update(scan.processes);
+
+    double incrementalTime = 0.0;
+    double rebuildTime = 0.0;
+
+    for (int i = 0; i < ticks; ++i) {
+        scan.tick();
+
+        auto start = std::chrono::steady_clock::now();
+        incremental.update(scan.processes);
+        auto middle = std::chrono::steady_clock::now();
+        {
+            ProcessTree rebuilt;
+            rebuilt.update(scan.processes);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        incrementalTime += std::chrono::duration<double, std::milli>(middle - start).count();
+        rebuildTime += std::chrono::duration<double, std::milli>(end - middle).count();
+    }
+
+    // Sanity check: the root subtree must account for every live process
+    std::size_t rss = 0;
+    for (const auto& process : scan.processes) rss += process.rss;
+    auto totals = incremental.getSubtreeTotals(1);
+
+    std::cout << "Processes: " << scan.processes.size() << ", churn 2% per tick, " << ticks << " ticks" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Incremental update: " << incrementalTime / ticks << " ms/tick" << std::endl;
+    std::cout << "Full rebuild:       " << rebuildTime / ticks << " ms/tick" << std::endl;
+    std::cout << "Root subtree: " << totals.processes << " processes, "
+              << (totals.processes == scan.processes.size() && totals.rss == rss ? "consistent" : "INCONSISTENT")
+              << std::endl;
+
+    // Subtree queries are O(1)
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sum = 0;
+    for (const auto& process : scan.processes) {
+        sum += incremental.getSubtreeTotals(process.pid).rss;
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Subtree query: " << elapsed / scan.processes.size() << " ns (checksum " << sum % 1000 << ")" << std::endl;
+
+    return 0;
+}
@@ -36,7 +36,7 @@ void printCoreInfo(const Processor::CoreInfo& core) {
         std::cout << cache.size / 1024 << " KB";
         if (cache.shared) {
             std::cout << " (Shared with cores: ";
-            for (size_t i = 0; i < cache.sharedCores.size(); ++i) {
+            for (std::size_t i = 0; i < cache.sharedCores.size(); ++i) {
                 if (i > 0) std::cout << ", ";
                 std::cout << cache.sharedCores[i];
             }
@@ -97,6 +97,23 @@ int main() {
             std::cout << std::endl;
         }
         
+        // Example of container CPU budget
+        std::cout << "CPU Budget:" << std::endl;
+        auto budget = processor.getCpuBudget();
+        std::cout << "Host cores: " << processor.getNumCores() << std::endl;
+        std::cout << "cgroup: " << (budget.cgroupV2 ? budget.cgroupPath : "none (cgroup v2 not mounted)") << std::endl;
+        if (budget.quotaUs >= 0) {
+            std::cout << "Quota: " << budget.quotaUs << "us per " << budget.periodUs << "us" << std::endl;
+        }
+        std::cout << "Weight: " << budget.weight << ", cpuset: " << budget.cpus.size() << " CPUs" << std::endl;
+        std::cout << "Effective CPUs: " << std::fixed << std::setprecision(2) << budget.effectiveCpus
+                  << ", recommended threads: " << budget.recommendedThreads << std::endl;
+        processor.getThrottling();
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        auto throttling = processor.getThrottling();
+        std::cout << "Usage: " << throttling.usageCpus << " CPUs, throttled "
+                  << throttling.throttledPercent << "% of periods" << std::endl << std::endl;
+
         // Example of frequency management
         std::cout << "Available Frequencies:" << std::endl;
         auto freqs = processor.getAvailableFrequencies();
@@ -108,7 +125,7 @@ int main() {
         // Example of thermal management
         std::cout << "Thermal Information:" << std::endl;
         auto temps = processor.getTemperatures();
-        for (size_t i = 0; i < temps.size(); ++i) {
+        for (std::size_t i = 0; i < temps.size(); ++i) {
             std::cout << "Core " << i << ": " << std::fixed << std::setprecision(1) 
                       << temps[i] << "°C" << std::endl;
         }
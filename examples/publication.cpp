@@ -0,0 +1,122 @@
+#include "../include/Publication.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <optional>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace kuserspace;
+
+// publication [readers] [seconds]
+//
+// Publishes a snapshot every 100 ms from this process and forks readers
+// that attach to the segment read-only. Each reader reports the cost of a
+// consistent read next to the cost of sampling procfs itself.
+namespace {
+
+const char* SEGMENT = "kuserspace-example";
+
+double percentile(std::vector<double>& nanos, std::size_t percent) {
+    std::sort(nanos.begin(), nanos.end());
+    return nanos[std::min(nanos.size() - 1, nanos.size() * percent / 100)];
+}
+
+int runReader(int id, std::chrono::seconds duration) {
+    try {
+        Publication publication(SEGMENT);
+        Processor::Stats processor;
+        Memory::Stats memory;
+        std::vector<Disk::DeviceStats> disks;
+        std::vector<Network::InterfaceStats> interfaces;
+        std::vector<double> nanos;
+        nanos.reserve(1 << 20);
+
+        uint64_t firstSequence = publication.getSequence();
+        auto end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end && nanos.size() < nanos.capacity()) {
+            auto start = std::chrono::steady_clock::now();
+            publication.getStats(processor);
+            publication.getStats(memory);
+            publication.getStats(disks);
+            publication.getStats(interfaces);
+            nanos.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        }
+        uint64_t passes = publication.getSequence() - firstSequence;
+
+        std::cout << "reader " << id << ": " << nanos.size() << " reads over " << passes << " passes, p50 "
+                  << std::fixed << std::setprecision(0) << percentile(nanos, 50) << " ns, p99 "
+                  << percentile(nanos, 99) << " ns; cpu " << std::setprecision(1) << processor.totalUtilization
+                  << "%, " << processor.perCoreUtilization.size() << " cores, " << memory.available / (1024 * 1024)
+                  << " MiB available, " << disks.size() << " disks, " << interfaces.size() << " interfaces"
+                  << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "reader " << id << ": " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int readers = argc > 1 ? std::stoi(argv[1]) : 4;
+    std::chrono::seconds duration(argc > 2 ? std::stoi(argv[2]) : 2);
+
+    try {
+        SystemSnapshot snapshot;
+        snapshot.enable(SystemSnapshot::Source::Protocols);
+        snapshot.enable(SystemSnapshot::Source::Pressure);
+
+        // What each reader would pay without the daemon
+        std::vector<double> sampling;
+        for (int i = 0; i < 20; ++i) {
+            snapshot.refresh();
+            sampling.push_back(std::chrono::duration<double, std::nano>(snapshot.getSnapshot().duration).count());
+        }
+
+        std::optional<Publisher> publisher(std::in_place, SEGMENT);
+        std::cout << "Segment /dev/shm/" << publisher->getName() << ": " << publisher->getSize() / 1024 << " KiB"
+                  << std::endl;
+        std::cout << "Sampling procfs directly: p50 " << std::fixed << std::setprecision(0)
+                  << percentile(sampling, 50) << " ns per pass" << std::endl;
+
+        snapshot.startContinuousMonitoring([&publisher](const SystemSnapshot::Snapshot& s) { publisher->publish(s); },
+                                           std::chrono::milliseconds(100));
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+        std::vector<pid_t> children;
+        for (int id = 0; id < readers; ++id) {
+            pid_t pid = fork();
+            if (pid == 0) _exit(runReader(id, duration));
+            if (pid > 0) children.push_back(pid);
+        }
+        int failed = 0;
+        for (pid_t pid : children) {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        }
+        snapshot.stopContinuousMonitoring();
+
+        // A reader that outlives the publisher keeps the last pass and can tell
+        Publication late(SEGMENT);
+        bool alive = late.isPublisherAlive();
+        publisher.reset();
+        SystemSnapshot::Snapshot last;
+        late.getSnapshot(last);
+        std::cout << "Last pass " << last.sequence << ", pressure "
+                  << (last.timing(SystemSnapshot::Source::Pressure).sampled ? "published" : "missing")
+                  << ", publisher alive: " << std::boolalpha << alive << " -> " << late.isPublisherAlive()
+                  << std::endl;
+        return failed ? 1 : 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
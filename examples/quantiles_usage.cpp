@@ -0,0 +1,72 @@
+#include "../include/Quantiles.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <random>
+
+using namespace kuserspace;
+
+namespace {
+
+void print(const std::string& name, const Quantiles::Summary& summary) {
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+              << " n " << std::setw(6) << summary.count
+              << " p50 " << std::setw(8) << summary.p50
+              << " p95 " << std::setw(8) << summary.p95
+              << " p99 " << std::setw(8) << summary.p99
+              << " max " << std::setw(8) << summary.max << std::endl;
+}
+
+} // namespace
+
+int main() {
+    try {
+        // Example 1: A synthetic latency metric, one minute window in 6 slots
+        Quantiles latency(std::chrono::seconds(10), 6, 1000.0, 1e4);
+        Quantiles::MetricId id = latency.getMetric("request.ms");
+        std::mt19937_64 random(7);
+        std::lognormal_distribution<double> distribution(0.0, 0.75);
+        auto now = Quantiles::Clock::now();
+        for (int i = 0; i < 100000; ++i) {
+            latency.record(id, now, distribution(random));
+        }
+        latency.publish(now);
+        print("request.ms (lognormal)", latency.getSummary(id));
+
+        // Example 2: Sketches from another host arrive serialized and merge exactly
+        Histogram local = latency.getSketch(id);
+        std::string wire = local.serialize();
+        Histogram merged = Histogram::deserialize(wire);
+        merged.merge(local);
+        std::cout << "Serialized sketch: " << wire.size() << " bytes for " << local.getCount() << " samples" << std::endl;
+        print("request.ms (two hosts)", latency.summarize(merged));
+
+        // Example 3: Live per-core utilization, disk await and memory use, with a
+        // reader polling while the sampler records
+        Quantiles quantiles;
+        SystemSnapshot snapshot;
+        snapshot.startContinuousMonitoring([&quantiles](const SystemSnapshot::Snapshot& s) {
+            quantiles.record(s);
+        }, std::chrono::milliseconds(200));
+
+        for (int round = 0; round < 3; ++round) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            std::vector<Quantiles::MetricId> cores;
+            for (const auto& name : quantiles.getMetricNames()) {
+                Quantiles::MetricId metric = quantiles.findMetric(name);
+                if (name.compare(0, 3, "cpu") == 0) cores.push_back(metric);
+                Quantiles::Summary summary = quantiles.getSummary(metric);
+                if (round == 2 && summary.count) print(name, summary);
+            }
+            print("all cores", quantiles.summarize(quantiles.getSketch(cores)));
+        }
+        snapshot.stopContinuousMonitoring();
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "../include/Recording.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+using namespace kuserspace;
+
+// recording record <file> [samples] [interval ms]
+// recording bench <file> [rows]
+// recording read <file> [column]
+//
+// record appends Memory and Processor samples; bench measures the append
+// path alone; read scans one column straight out of the mapping.
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " record <file> [samples] [interval ms]\n"
+                  << "       " << argv[0] << " bench <file> [rows]\n"
+                  << "       " << argv[0] << " read <file> [column]" << std::endl;
+        return 1;
+    }
+    std::string mode = argv[1];
+    std::string file = argv[2];
+
+    try {
+        Recording::Schema schema = Recording::memorySchema();
+        Recording::Schema processorColumns = Recording::processorSchema();
+        schema.insert(schema.end(), processorColumns.begin(), processorColumns.end());
+        const std::size_t memoryFirst = 1;
+        const std::size_t processorFirst = 1 + Recording::memorySchema().size();
+
+        if (mode == "record" || mode == "bench") {
+            Recorder recorder(file, schema);
+            Memory memory;
+            Processor processor;
+            Memory::Stats mem = memory.getStats();
+            Processor::Stats cpu = processor.getStats();
+
+            if (mode == "bench") {
+                std::size_t rows = argc > 3 ? std::stoul(argv[3]) : 1000000;
+                auto start = std::chrono::steady_clock::now();
+                for (std::size_t i = 0; i < rows; ++i) {
+                    recorder.set(memoryFirst, mem);
+                    recorder.set(processorFirst, cpu);
+                    recorder.commit(std::chrono::system_clock::time_point(std::chrono::nanoseconds(i)));
+                }
+                double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                std::cout << rows << " rows of " << recorder.getColumnCount() << " columns, "
+                          << ns / rows << " ns per row" << std::endl;
+
+                // The same again row by row: most rows only store into the
+                // staging area, every 128th also writes out a block
+                double stagedNs = 0, sealNs = 0, sealMax = 0;
+                std::size_t seals = 0;
+                for (std::size_t i = 0; i < rows; ++i) {
+                    auto rowStart = std::chrono::steady_clock::now();
+                    recorder.set(memoryFirst, mem);
+                    recorder.set(processorFirst, cpu);
+                    recorder.commit(std::chrono::system_clock::time_point(std::chrono::nanoseconds(rows + i)));
+                    double rowNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - rowStart).count();
+                    if (recorder.size() % 128 == 0) {
+                        sealNs += rowNs;
+                        sealMax = std::max(sealMax, rowNs);
+                        ++seals;
+                    } else {
+                        stagedNs += rowNs;
+                    }
+                }
+                std::cout << std::fixed << std::setprecision(1) << "staged rows " << stagedNs / (rows - seals)
+                          << " ns, sealing rows " << (seals ? sealNs / seals : 0) << " ns (max " << sealMax
+                          << " ns) over " << seals << " blocks" << std::endl;
+                return 0;
+            }
+
+            std::size_t samples = argc > 3 ? std::stoul(argv[3]) : 10;
+            std::chrono::milliseconds interval(argc > 4 ? std::stoul(argv[4]) : 1000);
+            for (std::size_t i = 0; i < samples; ++i) {
+                memory.refresh();
+                mem = memory.getStats();
+                processor.getStats(cpu);
+
+                auto start = std::chrono::steady_clock::now();
+                recorder.set(memoryFirst, mem);
+                recorder.set(processorFirst, cpu);
+                recorder.commit();
+                double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+                std::cout << "row " << recorder.size() << " cpu " << std::fixed << std::setprecision(1)
+                          << cpu.totalUtilization << "% free " << mem.free / (1024 * 1024) << "MB"
+                          << " append " << ns << " ns" << std::endl;
+                std::this_thread::sleep_for(interval);
+            }
+            recorder.sync();
+            return 0;
+        }
+
+        Recording recording(file);
+        std::string column = argc > 3 ? argv[3] : "cpu.utilization";
+        std::size_t index = recording.getColumnIndex(column);
+        Recording::Type type = recording.getSchema()[index].type;
+
+        double sum = 0, min = 0, max = 0;
+        std::size_t count = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& segment : recording.getColumn(index)) {
+            for (std::size_t i = 0; i < segment.count; ++i) {
+                const Recording::Value& value = segment.values[i];
+                double v = type == Recording::Type::Double ? value.d
+                         : type == Recording::Type::Signed ? static_cast<double>(value.i)
+                         : static_cast<double>(value.u);
+                if (count == 0 || v < min) min = v;
+                if (count == 0 || v > max) max = v;
+                sum += v;
+                ++count;
+            }
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << recording.size() << " rows, " << recording.getSchema().size() << " columns" << std::endl;
+        std::cout << column << ": min " << min << " max " << max << " mean " << (count ? sum / count : 0)
+                  << " (scanned in " << us << " us)" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "../include/Rules.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+
+using namespace kuserspace;
+
+int main() {
+    try {
+        Rules rules;
+        auto report = [&rules](const Rules::Event& event) {
+            std::cout << (event.firing ? "FIRING   " : "resolved ") << rules.getName(event.rule)
+                      << " after " << event.status.samples << " samples" << std::endl;
+        };
+
+        // Example 1: A compiled rule and its program
+        Rules::RuleId memory = rules.add("memory-pressure",
+            "memory.availablePercent < 5% and pressure.memory.some.avg10 > 20 for 3 samples", report);
+        std::cout << "memory-pressure compiles to:" << std::endl << rules.disassemble(memory);
+
+        // Example 2: Custom metrics, consecutive samples and constant folding
+        Rules::RuleId queue = rules.add("queue-backlog", "queue.depth > 2 * 1000 for 3 samples", report);
+        std::cout << "queue-backlog compiles to:" << std::endl << rules.disassemble(queue);
+        Rules::MetricId depth = rules.getMetric("queue.depth");
+        auto now = Rules::Clock::now();
+        for (double value : {500.0, 2500.0, 2600.0, 2700.0, 2800.0, 100.0}) {
+            rules.set(depth, value);
+            rules.evaluate(now);
+            now += std::chrono::seconds(1);
+        }
+
+        // Example 3: Syntax errors name the column
+        try {
+            rules.add("broken", "cpu.utilization > and 5", report);
+        } catch (const std::invalid_argument& e) {
+            std::cout << "Rejected: " << e.what() << std::endl;
+        }
+
+        // Example 4: A missing metric fails != and stays missing under not;
+        // both rules fire only once the metric is set
+        rules.add("nonzero", "link.errors != 0", report);
+        rules.add("not-above", "not (link.errors > 5)", report);
+        std::cout << "link.errors missing:" << std::endl;
+        rules.evaluate(now);
+        std::cout << "link.errors = 1:" << std::endl;
+        rules.set(rules.getMetric("link.errors"), 1.0);
+        rules.evaluate(now);
+
+        // Example 5: Live rules evaluated on every snapshot
+        SystemSnapshot snapshot;
+        snapshot.enable(SystemSnapshot::Source::Pressure);
+        rules.add("busy-cpu", "cpu.utilization > 50 for 2s", report);
+        rules.add("any-cpu-stall", "pressure.cpu.some.avg10 > 0 or pressure.io.some.avg10 > 0", report);
+        snapshot.startContinuousMonitoring([&rules](const SystemSnapshot::Snapshot& s) {
+            rules.evaluate(s);
+        }, std::chrono::milliseconds(250));
+
+        // Burn a core for a while so busy-cpu fires, then let it resolve
+        auto until = std::chrono::steady_clock::now() + std::chrono::seconds(4);
+        volatile uint64_t spin = 0;
+        while (std::chrono::steady_clock::now() < until) ++spin;
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        snapshot.stopContinuousMonitoring();
+
+        // Example 6: Per-tick cost with many rules over one snapshot
+        snapshot.refresh();
+        SystemSnapshot::Snapshot last = snapshot.getSnapshot();
+        Rules many;
+        for (int i = 0; i < 1000; ++i) {
+            many.add("rule" + std::to_string(i), "memory.usedPercent > " + std::to_string(50 + i % 50) +
+                     " and (cpu.utilization + cpu0.utilization) / 2 > 90 or pressure.io.full.avg60 > 10 for 5s", nullptr);
+        }
+        const int ticks = 10000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ticks; ++i) {
+            many.evaluate(last);
+        }
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::fixed << std::setprecision(2) << "1000 rules: " << micros / ticks << " us per snapshot" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
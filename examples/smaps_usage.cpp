@@ -0,0 +1,55 @@
+#include "../include/Smaps.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace kuserspace;
+
+int main(int argc, char* argv[]) {
+    try {
+        pid_t pid = argc > 1 ? std::atoi(argv[1]) : getpid();
+
+        Smaps smaps;
+        auto start = std::chrono::steady_clock::now();
+        auto report = smaps.analyze(pid);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+
+        std::cout << "Process " << pid << ": " << report.total.mappings << " mappings, "
+                  << "RSS " << report.total.rss / 1024 << " KB, "
+                  << "PSS " << report.total.pss / 1024 << " KB, "
+                  << "Swap " << report.total.swap / 1024 << " KB"
+                  << " (analyzed in " << elapsed.count() << " us)" << std::endl;
+
+        // Example 1: Breakdown by mapping category
+        std::cout << "\nBy category:" << std::endl;
+        for (const auto& [category, usage] : report.byCategory) {
+            std::cout << "  " << std::left << std::setw(14) << Smaps::categoryToString(category)
+                      << " PSS " << std::setw(10) << usage.pss / 1024 << " KB"
+                      << " Private_Dirty " << std::setw(10) << usage.privateDirty / 1024 << " KB"
+                      << " AnonHugePages " << usage.anonHugePages / 1024 << " KB" << std::endl;
+        }
+
+        // Example 2: Top backing files by PSS
+        std::vector<std::pair<std::string, Smaps::Usage>> files(report.byFile.begin(), report.byFile.end());
+        std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+            return a.second.pss > b.second.pss;
+        });
+
+        std::cout << "\nTop files by PSS:" << std::endl;
+        for (std::size_t i = 0; i < files.size() && i < 10; ++i) {
+            std::cout << "  " << std::setw(10) << files[i].second.pss / 1024 << " KB  "
+                      << files[i].first << std::endl;
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
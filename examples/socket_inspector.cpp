@@ -0,0 +1,99 @@
+#include "../include/Network.h"
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+using namespace kuserspace;
+
+// Creates its own loopback connections and checks that the inspector sees
+// exactly those sockets through kernel-side state and port filters.
+int main(int argc, char* argv[]) {
+    std::size_t connections = argc > 1 ? std::stoul(argv[1]) : 100;
+
+    try {
+        // Listener on an ephemeral loopback port
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener, static_cast<int>(connections)) != 0 ||
+            getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            std::cerr << "Could not create listener: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        uint16_t port = ntohs(address.sin_port);
+
+        std::vector<int> clients;
+        std::vector<int> accepted;
+        for (std::size_t i = 0; i < connections; ++i) {
+            int client = socket(AF_INET, SOCK_STREAM, 0);
+            if (connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+                std::cerr << "Could not connect: " << strerror(errno) << std::endl;
+                return 1;
+            }
+            clients.push_back(client);
+            accepted.push_back(accept(listener, nullptr, nullptr));
+
+            // Move some data so tcp_info has RTT and delivery figures
+            char payload[4096] = {};
+            if (write(client, payload, sizeof(payload)) > 0) {
+                ssize_t n = read(accepted.back(), payload, sizeof(payload));
+                (void)n;
+            }
+        }
+
+        SocketInspector inspector;
+
+        // Example 1: the listener only
+        SocketInspector::Filter listening;
+        listening.only(SocketInspector::State::Listen);
+        listening.family = SocketInspector::Family::IPv4;
+        listening.localPortMin = listening.localPortMax = port;
+        std::size_t listeners = inspector.dump(listening, [](const SocketInspector::Socket& socket) {
+            std::cout << "listening on " << socket.localAddress << ":" << socket.localPort
+                      << " backlog " << socket.receiveQueue << std::endl;
+        });
+
+        // Example 2: established server-side sockets with tcp_info
+        SocketInspector::Filter established;
+        established.only(SocketInspector::State::Established);
+        established.localPortMin = established.localPortMax = port;
+        std::vector<SocketInspector::Socket> servers = inspector.dump(established);
+        for (std::size_t i = 0; i < servers.size() && i < 3; ++i) {
+            const auto& socket = servers[i];
+            std::cout << socket.localAddress << ":" << socket.localPort << " <- "
+                      << socket.remoteAddress << ":" << socket.remotePort
+                      << " rtt " << socket.tcp.rttUs << "us"
+                      << " rttvar " << socket.tcp.rttVarUs << "us"
+                      << " cwnd " << socket.tcp.sendCwnd
+                      << " retrans " << socket.tcp.totalRetrans
+                      << " received " << socket.tcp.bytesReceived << " bytes" << std::endl;
+        }
+
+        // Example 3: client side, filtered on the remote port
+        SocketInspector::Filter outgoing;
+        outgoing.only(SocketInspector::State::Established);
+        outgoing.remotePortMin = outgoing.remotePortMax = port;
+        std::size_t clientsSeen = inspector.dump(outgoing, [](const SocketInspector::Socket&) {});
+
+        bool ok = listeners == 1 && servers.size() == connections && clientsSeen == connections;
+        std::cout << "listeners " << listeners << ", server sockets " << servers.size()
+                  << ", client sockets " << clientsSeen << " (expected 1, " << connections << ", "
+                  << connections << "): " << (ok ? "OK" : "MISMATCH") << std::endl;
+
+        for (int fd : clients) close(fd);
+        for (int fd : accepted) close(fd);
+        close(listener);
+        return ok ? 0 : 1;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
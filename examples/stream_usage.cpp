@@ -0,0 +1,204 @@
+#include "../include/Stream.h"
+#include "../include/Exporter.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <thread>
+
+using namespace kuserspace;
+
+// stream_usage [cpus] [samples] [agents]
+//
+// Samples a /proc fixture whose counters move every pass, then reports the
+// size of each delta frame next to the OpenMetrics text of the same
+// snapshot, checks that the decoder rebuilds it exactly, and streams from
+// several agents to a receiver over loopback TCP.
+namespace {
+
+void writeFile(const std::filesystem::path& path, const std::string& content) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path) << content;
+}
+
+void writePass(const std::filesystem::path& proc, std::size_t cpus, uint64_t pass) {
+    std::string stat;
+    auto line = [&stat](const std::string& name, uint64_t user, uint64_t idle) {
+        stat += name + " " + std::to_string(user) + " 0 " + std::to_string(user / 4) + " " + std::to_string(idle) +
+                " 0 0 0 0 0 0\n";
+    };
+    uint64_t tick = 100 * pass;
+    line("cpu", cpus * tick * 3, cpus * tick * 7);
+    for (std::size_t cpu = 0; cpu < cpus; ++cpu) {
+        uint64_t busy = tick * (1 + (cpu + pass) % 8);
+        line("cpu" + std::to_string(cpu), busy, 100 * pass * 10 - busy);
+    }
+    stat += "ctxt 1\nbtime 1\nprocesses 1\nprocs_running 1\nprocs_blocked 0\n";
+    writeFile(proc / "stat", stat);
+
+    // A third of the devices and interfaces see traffic
+    std::string diskstats;
+    for (std::size_t d = 0; d < 64; ++d) {
+        uint64_t io = d % 3 ? 1000 : 1000 + pass * (d + 1) * 10;
+        diskstats += "259 " + std::to_string(d) + " nvme" + std::to_string(d) + "n1 " + std::to_string(io) +
+                     " 0 " + std::to_string(io * 8) + " 100 2000 0 16000 200 0 " + std::to_string(io / 4) +
+                     " 300 0 0 0 0 0 0\n";
+    }
+    writeFile(proc / "diskstats", diskstats);
+
+    std::string netdev = "Inter-|   Receive                                                |  Transmit\n"
+                         " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n";
+    for (std::size_t i = 0; i < 64; ++i) {
+        uint64_t bytes = i % 3 ? 123456 : 123456 + pass * (i + 1) * 1500;
+        netdev += "  veth" + std::to_string(i) + ": " + std::to_string(bytes) + " " + std::to_string(bytes / 1500) +
+                  " 0 0 0 0 0 0 654321 200 0 0 0 0 0 0\n";
+    }
+    writeFile(proc / "net" / "dev", netdev);
+}
+
+void writeFixture(const std::filesystem::path& proc, std::size_t cpus) {
+    std::ifstream meminfo("/proc/meminfo");
+    writeFile(proc / "meminfo", std::string(std::istreambuf_iterator<char>(meminfo), {}));
+    writeFile(proc / "swaps", "Filename Type Size Used Priority\n");
+    for (const char* resource : {"cpu", "memory", "io"}) {
+        writeFile(proc / "pressure" / resource, "some avg10=1.25 avg60=0.50 avg300=0.10 total=123456\n"
+                                                "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n");
+    }
+    writePass(proc, cpus, 1);
+}
+
+bool same(const SystemSnapshot::Snapshot& a, const SystemSnapshot::Snapshot& b) {
+    if (a.sequence != b.sequence || a.processor.perCoreUtilization != b.processor.perCoreUtilization ||
+        a.processor.userTime != b.processor.userTime || a.memory.available != b.memory.available ||
+        a.disks.size() != b.disks.size() || a.interfaces.size() != b.interfaces.size() ||
+        a.pressure.cpu.some.avg10 != b.pressure.cpu.some.avg10) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.disks.size(); ++i) {
+        if (a.disks[i].name != b.disks[i].name || a.disks[i].readIops != b.disks[i].readIops ||
+            a.disks[i].counters.sectorsRead != b.disks[i].counters.sectorsRead) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < a.interfaces.size(); ++i) {
+        if (a.interfaces[i].name != b.interfaces[i].name ||
+            a.interfaces[i].rxBytesPerSec != b.interfaces[i].rxBytesPerSec) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t cpus = argc > 1 ? std::stoul(argv[1]) : 512;
+    std::size_t samples = argc > 2 ? std::stoul(argv[2]) : 50;
+    std::size_t agents = argc > 3 ? std::stoul(argv[3]) : 16;
+
+    char pattern[] = "/tmp/kuserspace-stream-XXXXXX";
+    if (!mkdtemp(pattern)) {
+        std::cerr << "Error: could not create fixture directory" << std::endl;
+        return 1;
+    }
+    std::filesystem::path fixture(pattern);
+
+    try {
+        writeFixture(fixture / "proc", cpus);
+        SystemSnapshot snapshot(Root::at(fixture.string()));
+        snapshot.enable(SystemSnapshot::Source::Pressure);
+        snapshot.refresh();
+
+        // Record the passes first, so the stream and the baseline see the same data
+        std::vector<SystemSnapshot::Snapshot> passes;
+        for (std::size_t pass = 2; pass < samples + 2; ++pass) {
+            writePass(fixture / "proc", cpus, pass);
+            snapshot.refresh();
+            passes.push_back(snapshot.getSnapshot());
+        }
+
+        Exporter exporter(snapshot);
+        std::string text;
+        exporter.render(passes.back(), text, true);
+
+        StreamEncoder encoder("node-0");
+        StreamDecoder decoder;
+        std::string wire;
+        std::size_t firstBytes = 0, deltaBytes = 0;
+        double encodeMicros = 0, decodeMicros = 0;
+        bool exact = true;
+        for (std::size_t i = 0; i < passes.size(); ++i) {
+            wire.clear();
+            auto start = std::chrono::steady_clock::now();
+            encoder.encode(passes[i], wire);
+            auto encoded = std::chrono::steady_clock::now();
+            std::string_view data(wire);
+            while (decoder.decode(data) != StreamDecoder::Frame::None) {}
+            auto decoded = std::chrono::steady_clock::now();
+            encodeMicros += std::chrono::duration<double, std::micro>(encoded - start).count();
+            decodeMicros += std::chrono::duration<double, std::micro>(decoded - encoded).count();
+            (i == 0 ? firstBytes : deltaBytes) += wire.size();
+            exact = exact && same(passes[i], decoder.getSnapshot());
+        }
+
+        std::size_t deltas = std::max<std::size_t>(passes.size() - 1, 1);
+        std::cout << "Fixture: " << cpus << " CPUs, 64 disks, 64 interfaces; " << encoder.getFieldCount()
+                  << " fields" << std::endl;
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "OpenMetrics text:     " << std::setw(8) << text.size() << " bytes per sample" << std::endl;
+        std::cout << "Hello, schema, first: " << std::setw(8) << firstBytes << " bytes once" << std::endl;
+        std::cout << "Delta frame:          " << std::setw(8) << deltaBytes / deltas << " bytes per sample ("
+                  << 100.0 * static_cast<double>(deltaBytes / deltas) / static_cast<double>(text.size())
+                  << "% of text)" << std::endl;
+        std::cout << "Encode " << encodeMicros / passes.size() << " us, decode " << decodeMicros / passes.size()
+                  << " us per sample; round trip " << (exact ? "exact" : "MISMATCH") << std::endl;
+
+        // Many agents, one receiver, loopback TCP
+        std::mutex mutex;
+        std::map<std::string, uint64_t> latest;
+        StreamReceiver receiver([&](const std::string& source, const SystemSnapshot::Snapshot& s) {
+            std::lock_guard<std::mutex> lock(mutex);
+            latest[source] = s.sequence;
+        });
+        receiver.listen(0);
+
+        std::vector<std::thread> threads;
+        std::vector<uint64_t> sent(agents);
+        for (std::size_t a = 0; a < agents; ++a) {
+            threads.emplace_back([&, a]() {
+                StreamSender sender("node-" + std::to_string(a));
+                sender.connect("127.0.0.1", receiver.getPort());
+                for (const SystemSnapshot::Snapshot& pass : passes) sender.send(pass);
+                sent[a] = sender.getStats().bytes;
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+
+        uint64_t total = 0;
+        for (uint64_t bytes : sent) total += bytes;
+        for (int wait = 0; wait < 200 && receiver.getStats().bytes < total; ++wait) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        receiver.stop();
+
+        StreamReceiver::Stats stats = receiver.getStats();
+        std::size_t complete = 0;
+        for (const auto& [source, sequence] : latest) complete += sequence == passes.back().sequence;
+        std::cout << "Receiver: " << stats.connections << " agents, " << stats.samples << " samples, " << stats.bytes
+                  << " bytes, " << stats.errors << " errors; " << complete << " agents fully received" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::filesystem::remove_all(fixture);
+        return 1;
+    }
+
+    std::filesystem::remove_all(fixture);
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "../include/SystemSnapshot.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+
+using namespace kuserspace;
+
+namespace {
+
+const char* SOURCE_NAMES[SystemSnapshot::NUM_SOURCES] = {
+    "memory", "processor", "disk", "network", "protocols", "cgroups", "pressure"
+};
+
+double micros(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+} // namespace
+
+int main() {
+    try {
+        SystemSnapshot snapshot;
+        snapshot.enable(SystemSnapshot::Source::Protocols);
+        snapshot.enable(SystemSnapshot::Source::Cgroups);
+        snapshot.enable(SystemSnapshot::Source::Pressure);
+
+        // Example 1: One pass and where its time went
+        snapshot.refresh();
+        SystemSnapshot::Snapshot first = snapshot.getSnapshot();
+        std::cout << "Pass " << first.sequence << " took " << micros(first.duration) << " us" << std::endl;
+        for (std::size_t i = 0; i < SystemSnapshot::NUM_SOURCES; ++i) {
+            const auto& timing = first.timings[i];
+            if (!timing.sampled) continue;
+            std::cout << "  " << std::left << std::setw(10) << SOURCE_NAMES[i] << std::right
+                      << " +" << std::setw(8) << micros(timing.readAt - first.timestamp) << " us"
+                      << "  read " << std::setw(8) << micros(timing.readDuration) << " us" << std::endl;
+        }
+
+        // Example 2: Every source under one timestamp, once a second for 5 seconds
+        snapshot.startContinuousMonitoring([](const SystemSnapshot::Snapshot& s) {
+            double diskRead = 0, netRx = 0, cgroupCpu = 0;
+            for (const auto& device : s.disks) diskRead += device.readBytesPerSec;
+            for (const auto& interface : s.interfaces) netRx += interface.rxBytesPerSec;
+            if (!s.cgroups.empty()) cgroupCpu = s.cgroups.front().cpuUsage;
+
+            std::cout << "#" << std::setw(3) << s.sequence << std::fixed << std::setprecision(1)
+                      << " cpu " << std::setw(5) << s.processor.totalUtilization << "%"
+                      << " free " << std::setw(7) << s.memory.free / (1024 * 1024) << "MB"
+                      << " disk " << std::setw(8) << diskRead / 1024 << "KB/s"
+                      << " rx " << std::setw(8) << netRx / 1024 << "KB/s"
+                      << " retrans " << std::setw(5) << s.protocols.retransSegsPerSec << "/s"
+                      << " cgroup cpu " << std::setw(5) << cgroupCpu
+                      << " psi mem " << std::setw(5) << s.pressure.memory.some.avg10 << "%"
+                      << " pass " << std::setw(7) << micros(s.duration) << "us" << std::endl;
+        }, std::chrono::milliseconds(1000));
+
+        std::this_thread::sleep_for(std::chrono::seconds(5));
+        snapshot.stopContinuousMonitoring();
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "../include/Trace.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <pthread.h>
+
+using namespace kuserspace;
+
+// trace_usage [json|perfetto] [path] [seconds]
+//
+// Samples the system every 50 ms into counter tracks while a few worker
+// threads record their own slices and counters, then reports what the
+// tracer wrote and what an event costs the recording thread. Open the file
+// in ui.perfetto.dev or chrome://tracing.
+namespace {
+
+// Something to look at: bursts of work of varying length
+double work(std::size_t iterations) {
+    double x = 0;
+    for (std::size_t i = 0; i < iterations; ++i) x += std::sqrt(static_cast<double>(i));
+    return x;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string format = argc > 1 ? argv[1] : "json";
+    std::string path = argc > 2 ? argv[2] : (format == "json" ? "kuserspace.json" : "kuserspace.pftrace");
+    int seconds = argc > 3 ? std::stoi(argv[3]) : 2;
+
+    try {
+        Tracer tracer(path, format == "json" ? Tracer::Format::Json : Tracer::Format::Perfetto);
+
+        SystemSnapshot snapshot;
+        snapshot.enable(SystemSnapshot::Source::Pressure);
+        snapshot.startContinuousMonitoring([&tracer](const SystemSnapshot::Snapshot& s) {
+            tracer.record(s);
+        }, std::chrono::milliseconds(50));
+
+        std::atomic<bool> running{true};
+        std::atomic<double> sink{0};
+        std::vector<std::thread> workers;
+        for (int w = 0; w < 3; ++w) {
+            workers.emplace_back([&, w]() {
+                pthread_setname_np(pthread_self(), ("worker-" + std::to_string(w)).c_str());
+                std::size_t round = 0;
+                while (running) {
+                    Tracer::Scope request(tracer, "request");
+                    {
+                        Tracer::Scope parse(tracer, "parse");
+                        sink = sink + work(20000 * (1 + round % 5));
+                    }
+                    {
+                        Tracer::Scope compute(tracer, "compute");
+                        sink = sink + work(100000 * (1 + (round * 7 + w) % 9));
+                    }
+                    tracer.counter("app.queueDepth", static_cast<double>((round * 13 + w) % 32));
+                    if (round % 50 == 0) tracer.instant("checkpoint");
+                    ++round;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                }
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        running = false;
+        for (std::thread& worker : workers) worker.join();
+        snapshot.stopContinuousMonitoring();
+
+        // Cost on the recording thread, with the flusher draining alongside
+        constexpr int EVENTS = 10000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < EVENTS; ++i) tracer.counter("bench.counter", i);
+        double pushNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / EVENTS;
+
+        auto closeStart = std::chrono::steady_clock::now();
+        tracer.close();
+        double closeMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - closeStart).count();
+
+        Tracer::Stats stats = tracer.getStats();
+        std::cout << "Wrote " << stats.events << " events (" << stats.bytes << " bytes) from " << stats.threads
+                  << " threads to " << path << " in " << stats.flushes << " flushes" << std::endl;
+        std::cout << std::fixed << std::setprecision(1) << "Dropped " << stats.dropped << ", write errors "
+                  << stats.errors << "; " << pushNanos << " ns per event on the recording thread, final flush "
+                  << closeMillis << " ms" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -12,6 +12,7 @@
 #include <system_error>
 #include <filesystem>
 #include <array>
+#include <string_view>
 
 namespace kuserspace {
 
@@ -138,4 +139,36 @@ private:
     mutable std::shared_mutex mutex;
 };
 
+// Persistent read-only handle for procfs/sysfs files that are sampled
+// repeatedly. The descriptor stays open between samples and each read() is
+// a pread() from offset 0 into storage reused across reads.
+class PersistentFile {
+public:
+    PersistentFile() = default;
+    explicit PersistentFile(const std::string& path);
+    ~PersistentFile();
+
+    PersistentFile(const PersistentFile&) = delete;
+    PersistentFile& operator=(const PersistentFile&) = delete;
+    PersistentFile(PersistentFile&& other) noexcept;
+    PersistentFile& operator=(PersistentFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return fd != -1; }
+    int getFd() const { return fd; }
+    const std::string& getPath() const { return path; }
+
+    // Re-read the whole file. The view stays valid until the next read.
+    std::optional<std::string_view> read();
+
+    Buffer::Error getLastError() const { return lastError; }
+
+private:
+    int fd = -1;
+    std::string path;
+    std::vector<char> data;
+    Buffer::Error lastError = Buffer::Error::None;
+};
+
 } // namespace kuserspace
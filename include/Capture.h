@@ -0,0 +1,80 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "Root.h"
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <cstddef>
+
+namespace kuserspace {
+
+/**
+ * @class Capture
+ * @brief Snapshots the procfs/sysfs files collectors read into a directory
+ *
+ * Each frame is a numbered subdirectory laid out like the host
+ * (<dir>/0000/proc/meminfo, <dir>/0000/sys/devices/...). The "frames"
+ * manifest lists every frame with its offset from the first one. Root::at()
+ * reads a single frame; Replay steps through all of them.
+ */
+class Capture {
+public:
+    struct Options {
+        std::size_t frames = 1;
+        std::chrono::milliseconds interval{1000};
+        bool processes = true;      // /proc/<pid>/stat of every process
+        bool cgroups = true;        // cgroup v2 accounting files
+    };
+
+    struct Result {
+        std::size_t frames;
+        std::size_t files;
+        std::size_t bytes;
+    };
+
+    // Capture options.frames frames into directory, throws std::runtime_error
+    // if the directory cannot be written
+    static Result capture(const std::string& directory, const Options& options);
+    static Result capture(const std::string& directory);
+
+    // Capture the host once into directory/proc and directory/sys
+    static Result captureFrame(const std::string& directory, const Options& options);
+    static Result captureFrame(const std::string& directory);
+};
+
+/**
+ * @class Replay
+ * @brief Serves a capture frame by frame through a stable Root
+ *
+ * The current frame is mirrored into <dir>/live. Files are rewritten in
+ * place, so collectors that keep files open see the next frame on their
+ * next read just as they would a kernel file. Step frames between samples,
+ * not while a collector is reading.
+ */
+class Replay {
+public:
+    // Throws std::runtime_error if directory holds no capture
+    explicit Replay(const std::string& directory);
+
+    const Root& getRoot() const { return root; }
+    std::size_t getFrameCount() const { return frames.size(); }
+    std::size_t getFrame() const { return frame; }
+    // When the current frame was captured, relative to the first frame
+    std::chrono::milliseconds getFrameOffset() const { return frames[frame].second; }
+
+    // Advance to the next frame, false (and no change) at the last one
+    bool next();
+    // Jump to a frame, throws std::out_of_range past the end
+    void seek(std::size_t index);
+
+private:
+    std::string directory;
+    std::vector<std::pair<std::string, std::chrono::milliseconds>> frames;
+    std::size_t frame = 0;
+    Root root;
+    std::vector<char> buffer;
+};
+
+} // namespace kuserspace
@@ -0,0 +1,107 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "KSpace.h"
+#include "Root.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <future>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuserspace {
+
+// Walks the cgroup v2 hierarchy and keeps CPU, memory and I/O accounting for
+// every cgroup. Directories are opened relative to their parent's fd and
+// listed with getdents64, so a refresh costs a handful of syscalls per cgroup.
+class Cgroup {
+public:
+    // Counters as the kernel reports them. In cgroup v2 these are already
+    // recursive: a cgroup's figures include all of its descendants.
+    struct Usage {
+        uint64_t cpuUsageUsec;
+        uint64_t cpuUserUsec;
+        uint64_t cpuSystemUsec;
+        uint64_t cpuPeriods;            // nr_periods, 0 without the cpu controller
+        uint64_t cpuThrottledPeriods;
+        uint64_t cpuThrottledUsec;
+
+        uint64_t memoryCurrent;         // 0 without the memory controller
+        uint64_t memoryAnon;
+        uint64_t memoryFile;
+        uint64_t memoryKernel;
+        uint64_t memorySock;
+        uint64_t memoryShmem;
+        uint64_t pageFaults;
+        uint64_t majorPageFaults;
+
+        uint64_t ioReadBytes;           // summed over devices, 0 without the io controller
+        uint64_t ioWriteBytes;
+        uint64_t ioReads;
+        uint64_t ioWrites;
+    };
+
+    struct Stats {
+        std::string path;               // relative to the hierarchy root, "/" for the root
+        size_t depth;
+        size_t children;
+        size_t descendants;
+        Usage usage;                    // recursive, as read
+        Usage self;                     // usage minus the children's usage
+
+        // Rates of the recursive figures over the last refresh interval
+        double cpuUsage;                // CPUs consumed
+        double cpuThrottledPercent;     // share of periods that were throttled
+        double memoryGrowthPerSec;      // bytes per second, negative when shrinking
+        double majorFaultsPerSec;
+        double ioReadBytesPerSec;
+        double ioWriteBytesPerSec;
+        double ioReadsPerSec;
+        double ioWritesPerSec;
+    };
+
+    // An empty root uses the cgroup2 mount point of Root::getDefault()
+    explicit Cgroup(const std::string& root = std::string());
+    ~Cgroup();
+
+    static Cgroup& getInstance();
+
+    // cgroup2 mount point (handles hybrid hosts), empty without one. The
+    // overloads without a Root use Root::getDefault().
+    static std::string getMountPoint();
+    static std::string getMountPoint(const Root& root);
+    // This process's cgroup directory, empty without a unified hierarchy
+    static std::string getSelfPath();
+    static std::string getSelfPath(const Root& root);
+    // Another host process's cgroup directory, as seen from this namespace
+    static std::string getProcessPath(int pid);
+
+    // Sampling. A refresh re-walks the tree: cgroups created since the last
+    // walk are added, removed ones are dropped and survivors get rates. If
+    // the root can no longer be opened the tree is emptied and the collector
+    // reports unavailable until a refresh succeeds; only construction throws.
+    void refresh();
+    bool isAvailable() const;
+    std::vector<Stats> getStats() const;    // pre-order, parents before children
+    void getStats(std::vector<Stats>& stats) const;     // same, reusing storage
+    Stats getCgroupStats(const std::string& path) const;
+    std::vector<std::string> getChildren(const std::string& path) const;
+    size_t size() const;
+    std::future<std::vector<Stats>> getStatsAsync();
+    std::chrono::steady_clock::duration getRefreshDuration() const;  // wall time of the last walk
+    const std::string& getRoot() const;
+
+    // Continuous Monitoring
+    using StatsCallback = std::function<void(const std::vector<Stats>&)>;
+    void startContinuousMonitoring(StatsCallback callback, std::chrono::milliseconds interval);
+    void stopContinuousMonitoring();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
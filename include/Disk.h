@@ -1,2 +1,204 @@
 // Malghumuy - Library: kuserspace
+#pragma once
 
+#include "KSpace.h"
+#include "Histogram.h"
+#include "Root.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <future>
+#include <cstdint>
+
+namespace kuserspace {
+
+class Disk {
+public:
+    // Which block devices to report
+    enum class Filter {
+        All,
+        WholeDisks,
+        Partitions
+    };
+
+    // Raw cumulative counters from /proc/diskstats. Discard fields are
+    // present since Linux 4.18 and flush fields since 5.5; they read 0
+    // on older kernels.
+    struct Counters {
+        uint64_t readsCompleted;
+        uint64_t readsMerged;
+        uint64_t sectorsRead;
+        uint64_t readTimeMs;
+        uint64_t writesCompleted;
+        uint64_t writesMerged;
+        uint64_t sectorsWritten;
+        uint64_t writeTimeMs;
+        uint64_t ioInProgress;
+        uint64_t ioTimeMs;
+        uint64_t weightedIoTimeMs;
+        uint64_t discardsCompleted;
+        uint64_t discardsMerged;
+        uint64_t sectorsDiscarded;
+        uint64_t discardTimeMs;
+        uint64_t flushesCompleted;
+        uint64_t flushTimeMs;
+    };
+
+    // Per-device statistics; rates cover the interval between the last two samples
+    struct DeviceStats {
+        std::string name;
+        unsigned int major;
+        unsigned int minor;
+        bool partition;
+        bool fresh;                 // first sample of the device; rates are zero until the next
+        Counters counters;
+
+        double readIops;
+        double writeIops;
+        double discardIops;
+        double flushIops;
+        double readBytesPerSec;
+        double writeBytesPerSec;
+        double discardBytesPerSec;
+        double avgQueueDepth;
+        double readAwaitMs;
+        double writeAwaitMs;
+        double utilization;         // percent of the interval the device was busy
+    };
+
+    // blk-mq hardware queue and the CPUs that submit to it
+    struct HardwareQueue {
+        int id;
+        std::vector<int> cpus;
+        std::vector<int> numaNodes;     // nodes of those CPUs
+        bool crossNode;                 // serves CPUs outside the device's node
+    };
+
+    // Static queue properties from /sys/block/<dev>/queue and /sys/block/<dev>/mq
+    struct QueueInfo {
+        std::string name;
+        bool rotational;
+        unsigned int nrRequests;
+        std::string scheduler;                      // active scheduler
+        std::vector<std::string> availableSchedulers;
+        unsigned int maxSectorsKb;
+        unsigned int logicalBlockSize;
+        unsigned int physicalBlockSize;
+        unsigned int nrHwQueues;
+        bool writeCache;                            // "write back" cache mode
+        int numaNode;                               // -1 if unknown
+        std::vector<HardwareQueue> hardwareQueues;
+        unsigned int crossNodeQueues;
+    };
+
+    // Mounted filesystem from /proc/self/mountinfo with cached statvfs capacity
+    struct Filesystem {
+        int mountId;
+        int parentId;
+        unsigned int major;
+        unsigned int minor;
+        std::string mountPoint;
+        std::string root;
+        std::string fsType;
+        std::string source;
+        std::string options;
+        bool readOnly;
+
+        uint64_t blockSize;
+        uint64_t totalBytes;
+        uint64_t freeBytes;
+        uint64_t availableBytes;        // available to unprivileged users
+        uint64_t totalInodes;
+        uint64_t freeInodes;
+        uint64_t availableInodes;
+        std::chrono::steady_clock::time_point updated;  // last statvfs
+    };
+
+    // Where a latency distribution came from
+    enum class LatencySource {
+        None,
+        CgroupIoStat,       // avg_lat from the cgroup v2 io.stat file (io.latency)
+        DebugfsPollStat,    // /sys/kernel/debug/block/<dev>/poll_stat
+        Probe               // active O_DIRECT read probe
+    };
+
+    // Request latency for one device. Kernel sources only report mean/min/max,
+    // io.stat only the mean; percentiles and the histogram are filled by the
+    // active probe.
+    struct LatencyStats {
+        std::string device;
+        LatencySource source;
+        uint64_t samples;
+        bool meanOnly;              // minUs and maxUs are 0 because the source has no range
+        double meanUs;
+        double minUs;
+        double maxUs;
+        double p50Us;
+        double p99Us;
+        double p999Us;
+        Histogram histogram;        // per-request latency in nanoseconds
+    };
+
+    // Active probe settings. Reads are block-aligned and random within testFile,
+    // which must live on the device being measured and support O_DIRECT.
+    struct LatencyProbe {
+        std::string testFile;
+        unsigned int blockSize = 4096;
+        unsigned int queueDepth = 1;
+        std::chrono::milliseconds duration{1000};
+        uint64_t maxRequests = 0;   // 0 = run for the whole duration
+    };
+
+    // Constructor/Destructor. Devices are read through root's /proc and /sys.
+    explicit Disk(const Root& root = Root::getDefault());
+    ~Disk();
+
+    static Disk& getInstance();
+
+    // Sampling
+    void refresh();
+    std::vector<DeviceStats> getStats(Filter filter = Filter::All) const;
+    void getStats(std::vector<DeviceStats>& devices, Filter filter = Filter::All) const;  // reuses storage
+    DeviceStats getDeviceStats(const std::string& name) const;
+    std::future<std::vector<DeviceStats>> getStatsAsync(Filter filter = Filter::All);
+    std::chrono::steady_clock::duration getInterval() const;
+
+    // Queue topology inventory. The inventory is cached; refreshQueueTopology()
+    // re-reads sysfs and returns true (bumping the generation) when anything changed.
+    bool refreshQueueTopology();
+    std::vector<QueueInfo> getQueueTopology() const;
+    QueueInfo getQueueInfo(const std::string& name) const;
+    uint64_t getQueueTopologyGeneration() const;
+
+    // Filesystem view. The mount table is parsed once and re-parsed only when
+    // the kernel signals a change on the mountinfo fd; capacities come from
+    // statvfs() refreshed on a schedule, so queries never touch the filesystem.
+    void refreshFilesystems();
+    void startFilesystemMonitoring(std::chrono::milliseconds interval);
+    void stopFilesystemMonitoring();
+    std::vector<Filesystem> getFilesystems() const;
+    Filesystem getFilesystem(const std::string& path) const;   // mount containing path
+    uint64_t getAvailableBytes(const std::string& path) const;
+    uint64_t getAvailableInodes(const std::string& path) const;
+
+    // Latency distribution. getKernelLatency() returns source None when the
+    // kernel exposes nothing for the device; measureLatency() falls back to the
+    // active probe (io_uring, or pread() where io_uring is unavailable).
+    LatencyStats getKernelLatency(const std::string& name) const;
+    LatencyStats probeLatency(const LatencyProbe& probe) const;
+    LatencyStats measureLatency(const std::string& name, const LatencyProbe& probe) const;
+
+    // Continuous Monitoring
+    using StatsCallback = std::function<void(const std::vector<DeviceStats>&)>;
+    void startContinuousMonitoring(StatsCallback callback, std::chrono::milliseconds interval,
+                                   Filter filter = Filter::All);
+    void stopContinuousMonitoring();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
@@ -0,0 +1,68 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "SystemSnapshot.h"
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuserspace {
+
+/**
+ * @class Exporter
+ * @brief Embedded Prometheus / OpenMetrics endpoint over a SystemSnapshot
+ *
+ * Serves GET /metrics on a loopback TCP port or a Unix socket from one
+ * epoll thread. Every sampled source of the snapshot is rendered as
+ * kuserspace_* families, in OpenMetrics text when the scraper asks for it
+ * (Accept: application/openmetrics-text) and Prometheus text 0.0.4
+ * otherwise. Connections are answered once and closed.
+ *
+ * Rendering appends into buffers that keep their capacity between scrapes,
+ * numbers are formatted with std::to_chars and label sets ({cpu="17"},
+ * {device="nvme0n1"}, ...) are built once per CPU, device, interface and
+ * cgroup, so a steady-state scrape does not allocate.
+ *
+ * By default a scrape serves the last published snapshot; someone else
+ * (continuous monitoring, a History feeder) is expected to drive it.
+ */
+class Exporter {
+public:
+    struct Stats {
+        uint64_t scrapes;
+        uint64_t errors;                        // bad requests and failed writes
+        std::size_t lastBytes;                  // body of the last scrape
+        std::chrono::nanoseconds lastRender;    // render time of the last scrape
+    };
+
+    explicit Exporter(SystemSnapshot& snapshot);
+    ~Exporter();
+
+    Exporter(const Exporter&) = delete;
+    Exporter& operator=(const Exporter&) = delete;
+
+    // Start serving on 127.0.0.1:port (0 picks a free port) or on a Unix
+    // socket, replacing a stale socket file. Throws std::runtime_error if
+    // the socket cannot be set up; a running endpoint is stopped first.
+    void listen(uint16_t port);
+    void listen(const std::string& socketPath);
+    void stop();
+    bool isRunning() const;
+    uint16_t getPort() const;           // 0 for a Unix socket
+
+    // Run a snapshot pass for each scrape instead of serving the last one
+    void setRefreshOnScrape(bool refresh);
+
+    // Render a snapshot into out, which is cleared first
+    void render(const SystemSnapshot::Snapshot& snapshot, std::string& out, bool openMetrics = true);
+
+    Stats getStats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
@@ -0,0 +1,109 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "Stream.h"
+#include "Quantiles.h"
+#include "Histogram.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuserspace {
+
+/**
+ * @class Fleet
+ * @brief Cluster-wide rollups over snapshot streams from many hosts
+ *
+ * Every sample a host sends is reduced to the same fixed set of host-level
+ * metrics, so hosts with different CPUs, devices and interfaces share one
+ * slot per metric:
+ *
+ *     cpu.utilization, cpu.maxCoreUtilization, memory.{usedPercent,
+ *     availablePercent, availableMiB, swapUsedPercent}, pressure.cpu.some.avg10,
+ *     pressure.{memory,io}.{some,full}.avg10, disk.{readMiBPerSec,
+ *     writeMiBPerSec, readIops, writeIops} (summed over whole disks),
+ *     disk.{maxUtilization, maxAwaitMs}, net.{rxMiBPerSec, txMiBPerSec,
+ *     dropsPerSec, errorsPerSec} (summed over interfaces other than lo),
+ *     tcp.{retransmitPercent, listenDropsPerSec}
+ *
+ * Sizes and byte rates are in MiB so that the largest hosts stay below
+ * the sketches' ceiling of 10^12.
+ *
+ * publish() rolls the latest value of every host heard from within the
+ * host timeout into a sum and a Histogram sketch per metric; the sketches
+ * merge exactly with another aggregator's, in hundredths. Every sample
+ * also goes into a sliding Quantiles window by arrival time, so host
+ * clocks do not matter. ingest() publishes by itself at most once per
+ * publish interval. Hosts silent for ten host timeouts are dropped.
+ *
+ * ingest() may be called from any thread. Queries read the rollup of the
+ * last publish(), swapped in atomically, and never wait for ingestion.
+ */
+class Fleet {
+public:
+    using Clock = std::chrono::system_clock;
+    using MetricId = std::size_t;
+
+    struct Aggregate {
+        double sum;                     // of the hosts' latest values
+        Quantiles::Summary summary;     // count is the number of hosts reporting
+    };
+
+    struct Host {
+        std::string name;
+        Clock::time_point lastSeen;
+        uint64_t samples;
+        bool stale;                     // silent for longer than the host timeout
+    };
+
+    struct Stats {
+        uint64_t samples;
+        std::size_t hosts;
+        std::size_t staleHosts;
+        uint64_t publishes;
+        std::chrono::nanoseconds lastPublish;       // time the last rollup took
+    };
+
+    // Publish every second, hosts go stale after 30 s, window of 10 x 30 s
+    Fleet();
+    Fleet(std::chrono::milliseconds publishInterval, std::chrono::seconds hostTimeout,
+          std::chrono::seconds slotWidth, std::size_t slots);
+    ~Fleet();
+
+    Fleet(const Fleet&) = delete;
+    Fleet& operator=(const Fleet&) = delete;
+
+    // Accept StreamSenders; as StreamReceiver::listen()
+    void listen(uint16_t port);
+    void listen(const std::string& address, uint16_t port);
+    void listen(const std::string& socketPath);
+    void stop();
+    uint16_t getPort() const;
+    StreamReceiver::Stats getReceiverStats() const;
+
+    // One sample of one host, as the receiver delivers it
+    void ingest(const std::string& host, const SystemSnapshot::Snapshot& snapshot);
+    void publish(Clock::time_point now = Clock::now());
+
+    std::vector<std::string> getMetricNames() const;
+    MetricId findMetric(const std::string& name) const;     // throws std::out_of_range
+
+    Aggregate getAggregate(MetricId metric) const;
+    Histogram getSketch(MetricId metric) const;             // hosts' latest values, in hundredths
+    Quantiles::Summary getWindow(MetricId metric) const;    // every sample in the window
+    // Hosts with the highest latest values, highest first
+    std::vector<std::pair<std::string, double>> getTop(MetricId metric, std::size_t count) const;
+    std::vector<Host> getHosts() const;
+
+    Stats getStats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
@@ -0,0 +1,60 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "KSpace.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace kuserspace {
+
+/**
+ * @class Histogram
+ * @brief HDR-style log-linear histogram for latency-like values
+ *
+ * Values are grouped by power of two and each group is split into
+ * 2^precisionBits linear sub-buckets, so every recorded value is reported
+ * with a relative error below 2^-precisionBits using constant memory.
+ * Giving the highest value of interest trims the buckets above it; larger
+ * values are counted in the top bucket. Histograms with the same layout
+ * merge exactly, also after a serialize()/deserialize() round trip between
+ * hosts. The class is not synchronized; callers own the locking.
+ */
+class Histogram {
+public:
+    Histogram() : Histogram(5) {}
+    explicit Histogram(unsigned int precisionBits);
+    Histogram(unsigned int precisionBits, uint64_t highestValue);
+
+    // Recording
+    void record(uint64_t value);
+    void record(uint64_t value, uint64_t count);
+    void merge(const Histogram& other);
+    void reset();
+
+    // Queries
+    uint64_t getCount() const { return count; }
+    uint64_t getMin() const { return count ? min : 0; }
+    uint64_t getMax() const { return max; }
+    double getMean() const;
+    uint64_t getPercentile(double percentile) const;   // percentile in [0, 100]
+    unsigned int getPrecisionBits() const { return precisionBits; }
+
+    // Compact binary form: layout, totals and the non-empty buckets
+    std::string serialize() const;
+    static Histogram deserialize(std::string_view data);    // throws std::invalid_argument
+
+private:
+    size_t bucketIndex(uint64_t value) const;
+    uint64_t bucketUpperBound(size_t index) const;
+
+    unsigned int precisionBits;
+    std::vector<uint64_t> counts;
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    long double sum;
+};
+
+} // namespace kuserspace
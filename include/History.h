@@ -0,0 +1,139 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "SystemSnapshot.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuserspace {
+
+/**
+ * @class History
+ * @brief Compressed in-memory time series for any number of metrics
+ *
+ * Samples are packed Gorilla-style into fixed-size blocks: timestamps
+ * (millisecond resolution) as delta-of-delta, values as the XOR with the
+ * previous value's bits, so a steady one-second series costs a couple of
+ * bytes per sample. Each block also keeps the min, max, sum and count of its
+ * samples, which lets aggregate() answer for whole blocks without decoding
+ * them. Blocks older than the retention are recycled.
+ *
+ * Rollup tiers keep min/max/sum/count/last per fixed-width bucket for
+ * every series as samples arrive, in a ring per tier, so long ranges stay
+ * available at coarse resolution after the raw blocks have been recycled.
+ * getBuckets() reads the cheapest source that satisfies a resolution.
+ *
+ * Samples of one series must be appended in time order; older ones are
+ * rejected. All methods are thread-safe.
+ */
+class History {
+public:
+    using Clock = std::chrono::system_clock;
+    using SeriesId = std::size_t;
+
+    enum class Type {
+        Double,         // XOR of IEEE-754 bits
+        Integer         // value rounded to int64, XOR of its bits
+    };
+
+    struct Sample {
+        Clock::time_point time;
+        double value;
+    };
+
+    struct Aggregate {
+        std::size_t count;
+        double min;
+        double max;
+        double sum;
+        std::size_t blocksDecoded;      // blocks that had to be decoded
+        std::size_t blocksSummarized;   // blocks answered from their summary
+
+        double mean() const { return count ? sum / count : 0.0; }
+    };
+
+    // A rollup tier: buckets of resolution, kept for retention
+    struct Tier {
+        std::chrono::seconds resolution;
+        std::chrono::seconds retention;
+    };
+
+    struct Bucket {
+        Clock::time_point start;        // aligned to the bucket width since the epoch
+        std::size_t count;
+        double min;
+        double max;
+        double sum;
+        double last;
+
+        double mean() const { return count ? sum / count : 0.0; }
+    };
+
+    struct Downsampled {
+        std::chrono::milliseconds sourceResolution;     // tier read, 0 for raw samples
+        std::vector<Bucket> buckets;                    // non-empty buckets in time order
+    };
+
+    struct Stats {
+        std::size_t series;
+        std::size_t blocks;
+        std::size_t samples;
+        std::size_t bytes;              // block storage and metadata, allocated
+        std::size_t encodedBytes;       // bits actually written, in bytes
+        std::size_t rollupBytes;        // rollup rings, allocated
+
+        double bytesPerSample() const { return samples ? static_cast<double>(bytes) / samples : 0.0; }
+    };
+
+    // An hour of raw samples in 1 KiB blocks, 1-minute buckets for a day and
+    // 1-hour buckets for 30 days
+    History();
+    History(std::chrono::seconds retention, std::size_t blockBytes);
+    History(std::chrono::seconds retention, std::size_t blockBytes, const std::vector<Tier>& tiers);
+    ~History();
+
+    History(const History&) = delete;
+    History& operator=(const History&) = delete;
+
+    // Series are created on first use; the type of an existing series is kept
+    SeriesId getSeries(const std::string& name, Type type = Type::Double);
+    SeriesId findSeries(const std::string& name) const;     // throws std::out_of_range
+    std::vector<std::string> getSeriesNames() const;
+
+    // False if time is older than the series' last sample
+    bool append(SeriesId series, Clock::time_point time, double value);
+    bool append(const std::string& name, Clock::time_point time, double value);
+
+    // Every sampled source of a snapshot at its wall time: memory.*, cpu.*,
+    // cpu<N>.utilization, disk.<dev>.*, net.<if>.*, tcp.*, cgroup:<path>.*
+    // and pressure.<cpu|memory|io>.<some|full>.avg<10|60|300>
+    void append(const SystemSnapshot::Snapshot& snapshot);
+
+    // Samples with from <= time <= to
+    std::vector<Sample> query(SeriesId series, Clock::time_point from, Clock::time_point to) const;
+    void query(SeriesId series, Clock::time_point from, Clock::time_point to, std::vector<Sample>& samples) const;
+    // Over raw samples only
+    Aggregate aggregate(SeriesId series, Clock::time_point from, Clock::time_point to) const;
+
+    // Buckets of the given width over [from, to]. The source is the coarsest
+    // of raw samples and tiers that is at least that fine and still covers
+    // from; failing that the finest source covering from, failing that the
+    // one reaching furthest back. Tier buckets overlapping the range edges
+    // are included whole.
+    Downsampled getBuckets(SeriesId series, Clock::time_point from, Clock::time_point to,
+                           std::chrono::milliseconds resolution) const;
+    const std::vector<Tier>& getTiers() const;
+
+    Stats getStats() const;
+    void clear();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "KSpace.h"
+#include "Root.h"
 #include <shared_mutex>
 #include <memory>
 #include <mutex>
@@ -51,6 +52,7 @@ private:
         size_t directMap4k;
         size_t directMap2M;
         size_t directMap1G;
+        size_t available;
         
         // Memory zones
         struct ZoneInfo {
@@ -88,16 +90,14 @@ private:
     };
     
     // Private members
+    Root root;
     std::atomic<bool> isUpdating;
     std::shared_mutex mutex;
-    State currentState;
+    State currentState{};
     std::future<void> updateFuture;
     std::condition_variable updateCV;
     std::mutex updateMutex;
     
-    // Private constructor for singleton
-    Memory();
-    
     // Prevent copying
     Memory(const Memory&) = delete;
     Memory& operator=(const Memory&) = delete;
@@ -142,6 +142,9 @@ public:
         size_t directMap4k;
         size_t directMap2M;
         size_t directMap1G;
+
+        // Estimate of memory available for new allocations without swapping (MemAvailable)
+        size_t available;
     };
 
     // Memory zone information
@@ -176,7 +179,10 @@ public:
         std::vector<size_t> distances;
     };
 
-    // Singleton instance getter
+    // Collector over another proc/sys root, with its own state and thread
+    explicit Memory(const Root& root = Root::getDefault());
+
+    // Singleton instance getter (Root::getDefault() view)
     static inline Memory& getInstance() {
         if (!instance) {
             instance = new Memory();
@@ -188,6 +194,7 @@ public:
     ~Memory();
 
     // Basic stats methods
+    void refresh();
     Stats getStats();
     std::future<Stats> getStatsAsync();
     
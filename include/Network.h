@@ -0,0 +1,261 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "KSpace.h"
+#include "Root.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <future>
+#include <cstdint>
+
+namespace kuserspace {
+
+class Network {
+public:
+    // Raw cumulative counters from /proc/net/dev
+    struct Counters {
+        uint64_t rxBytes;
+        uint64_t rxPackets;
+        uint64_t rxErrors;
+        uint64_t rxDropped;
+        uint64_t rxFifoErrors;
+        uint64_t rxFrameErrors;
+        uint64_t rxCompressed;
+        uint64_t rxMulticast;
+        uint64_t txBytes;
+        uint64_t txPackets;
+        uint64_t txErrors;
+        uint64_t txDropped;
+        uint64_t txFifoErrors;
+        uint64_t collisions;
+        uint64_t txCarrierErrors;
+        uint64_t txCompressed;
+    };
+
+    // Error and drop breakdown from /sys/class/net/<if>/statistics, only
+    // read when detailed statistics are enabled
+    struct ErrorDetail {
+        uint64_t rxCrcErrors;
+        uint64_t rxLengthErrors;
+        uint64_t rxMissedErrors;
+        uint64_t rxOverErrors;
+        uint64_t rxNoHandler;
+        uint64_t txAbortedErrors;
+        uint64_t txHeartbeatErrors;
+        uint64_t txWindowErrors;
+    };
+
+    // Per-interface statistics; rates cover the interval between the last two samples
+    struct InterfaceStats {
+        std::string name;
+        Counters counters;
+        ErrorDetail detail;
+
+        double rxBytesPerSec;
+        double txBytesPerSec;
+        double rxPacketsPerSec;
+        double txPacketsPerSec;
+        double rxDropsPerSec;
+        double txDropsPerSec;
+        double rxErrorsPerSec;
+        double txErrorsPerSec;
+    };
+
+    // Protocol counters from /proc/net/snmp (Tcp, Udp) and /proc/net/netstat (TcpExt)
+    struct ProtocolCounters {
+        uint64_t tcpInSegs;
+        uint64_t tcpOutSegs;
+        uint64_t tcpRetransSegs;
+        uint64_t tcpInErrors;           // Tcp InErrs
+        uint64_t tcpListenOverflows;
+        uint64_t tcpListenDrops;
+        uint64_t tcpTimeouts;
+        uint64_t udpInErrors;
+        uint64_t udpRcvbufErrors;
+    };
+
+    // Counters that can carry a rate threshold
+    enum class ProtocolCounter {
+        RetransSegs,
+        ListenOverflows,
+        ListenDrops,
+        TCPTimeouts,
+        TcpInErrors,
+        UdpInErrors,
+        RcvbufErrors
+    };
+
+    struct ProtocolStats {
+        bool available;                 // false while /proc/net/snmp or netstat cannot be opened
+        ProtocolCounters counters;
+
+        double retransSegsPerSec;
+        double retransmitPercent;       // RetransSegs as a share of OutSegs
+        double listenOverflowsPerSec;
+        double listenDropsPerSec;
+        double timeoutsPerSec;
+        double tcpInErrorsPerSec;
+        double udpInErrorsPerSec;
+        double rcvbufErrorsPerSec;
+    };
+
+    // One NIC rx or tx queue and the CPUs that service it
+    struct Queue {
+        bool receive;                   // rx-<n> or tx-<n>
+        int index;
+        std::vector<int> steeringCpus;  // RPS (rx) or XPS (tx) mask, empty when unset
+        std::vector<int> irqs;          // MSI-X vectors attributed to this queue
+        std::vector<int> irqCpus;       // smp_affinity_list of those vectors
+        std::vector<int> numaNodes;     // nodes of every servicing CPU
+        bool crossNode;                 // serviced from outside the NIC's node
+    };
+
+    // Queue layout of one interface joined with IRQ affinity and CPU topology
+    struct QueueInfo {
+        std::string name;
+        int numaNode;                   // -1 if unknown
+        std::vector<int> irqs;          // all MSI-X vectors of the device
+        std::vector<Queue> queues;      // rx queues first, by index
+        unsigned int crossNodeQueues;
+    };
+
+    // Constructor/Destructor
+    explicit Network(const Root& root = Root::getDefault());
+    ~Network();
+
+    static Network& getInstance();
+
+    // Sampling. Interfaces that appear get zero rates until their second
+    // sample; interfaces that disappear are dropped.
+    void refresh();
+    std::vector<InterfaceStats> getStats() const;
+    void getStats(std::vector<InterfaceStats>& interfaces) const;    // reuses storage
+    InterfaceStats getInterfaceStats(const std::string& name) const;
+    std::future<std::vector<InterfaceStats>> getStatsAsync();
+    std::chrono::steady_clock::duration getInterval() const;
+
+    void setDetailedStats(bool enabled);
+    bool getDetailedStats() const;
+
+    // Queue topology. The map is cached; refreshQueueTopology() re-reads sysfs
+    // and /proc/irq and returns true (bumping the generation) when anything changed.
+    bool refreshQueueTopology();
+    std::vector<QueueInfo> getQueueTopology() const;
+    QueueInfo getQueueInfo(const std::string& name) const;
+    uint64_t getQueueTopologyGeneration() const;
+
+    // Protocol counters. Column positions are resolved from the header rows
+    // once; later samples only decode the value rows that hold a wanted column.
+    void refreshProtocolStats();
+    ProtocolStats getProtocolStats() const;
+    double getProtocolRate(ProtocolCounter counter) const;
+
+    // Threshold callbacks run on the thread that refreshes protocol stats,
+    // once per sample while the counter's rate is at or above the threshold
+    using ThresholdCallback = std::function<void(ProtocolCounter counter, double rate, double threshold)>;
+    void setProtocolThreshold(ProtocolCounter counter, double ratePerSec, ThresholdCallback callback);
+    void clearProtocolThreshold(ProtocolCounter counter);
+    void startProtocolMonitoring(std::chrono::milliseconds interval);
+    void stopProtocolMonitoring();
+
+    // Continuous Monitoring
+    using StatsCallback = std::function<void(const std::vector<InterfaceStats>&)>;
+    void startContinuousMonitoring(StatsCallback callback, std::chrono::milliseconds interval);
+    void stopContinuousMonitoring();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+// TCP socket inspector over NETLINK_SOCK_DIAG. State and port filters run in
+// the kernel, the dump is decoded as it streams in and the receive buffer is
+// reused across dumps. Not thread-safe; use one inspector per thread.
+class SocketInspector {
+public:
+    // TCP states, numbered as in the kernel
+    enum class State : uint8_t {
+        Established = 1,
+        SynSent,
+        SynRecv,
+        FinWait1,
+        FinWait2,
+        TimeWait,
+        Close,
+        CloseWait,
+        LastAck,
+        Listen,
+        Closing,
+        NewSynRecv
+    };
+
+    enum class Family {
+        IPv4,
+        IPv6,
+        Both
+    };
+
+    // Dump filter; port ranges are inclusive
+    struct Filter {
+        uint32_t states = ~0u;          // bitmask of (1 << State)
+        Family family = Family::Both;
+        uint16_t localPortMin = 0;
+        uint16_t localPortMax = 65535;
+        uint16_t remotePortMin = 0;
+        uint16_t remotePortMax = 65535;
+
+        Filter& only(State state);      // restrict to states added with only()
+    };
+
+    // Subset of struct tcp_info; fields the running kernel lacks read 0
+    struct TcpInfo {
+        uint32_t rttUs;
+        uint32_t rttVarUs;
+        uint32_t minRttUs;
+        uint32_t sendCwnd;              // segments
+        uint32_t sendSsthresh;
+        uint8_t retransmits;            // unrecovered RTO timeouts
+        uint32_t totalRetrans;
+        uint64_t deliveryRate;          // bytes per second
+        uint64_t bytesAcked;
+        uint64_t bytesReceived;
+    };
+
+    struct Socket {
+        int family;                     // AF_INET or AF_INET6
+        State state;
+        std::string localAddress;
+        uint16_t localPort;
+        std::string remoteAddress;
+        uint16_t remotePort;
+        uint32_t receiveQueue;          // bytes, or accept backlog for listeners
+        uint32_t sendQueue;
+        uint32_t uid;
+        uint64_t inode;
+        bool hasTcpInfo;
+        TcpInfo tcp;
+    };
+
+    SocketInspector();
+    ~SocketInspector();
+
+    SocketInspector(const SocketInspector&) = delete;
+    SocketInspector& operator=(const SocketInspector&) = delete;
+
+    // Stream matching sockets to the callback, returning how many were seen
+    using SocketCallback = std::function<void(const Socket&)>;
+    size_t dump(const Filter& filter, const SocketCallback& callback);
+    std::vector<Socket> dump(const Filter& filter);
+
+private:
+    void dumpFamily(int family, const Filter& filter, const SocketCallback& callback, size_t& count);
+
+    int fd;
+    uint32_t sequence;
+    std::vector<char> receiveBuffer;
+};
+
+} // namespace kuserspace
@@ -2,6 +2,8 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include <regex>
 #include <unordered_map>
 #include <memory>
@@ -146,6 +148,72 @@ public:
                          const std::function<void(const std::string&, const std::smatch&)>& handler,
                          const std::string& pattern);
 
+    /**
+     * @brief Split the next line off a buffer without copying
+     * @param input View over the remaining buffer; advanced past the line and its newline
+     * @return View of the line (without the newline), empty at end of input
+     */
+    static std::string_view nextLine(std::string_view& input);
+
+    /**
+     * @brief Split the next whitespace-delimited token off a line without copying
+     * @param input View over the remaining line; advanced past the token
+     * @return View of the token, empty when the line is exhausted
+     */
+    static std::string_view nextToken(std::string_view& input);
+
+    /**
+     * @brief Split a table row into whitespace-delimited fields
+     * @param line The row to split
+     * @param fields Receives views of the fields; its storage is reused between calls
+     * @return Number of fields found
+     */
+    static size_t splitFields(std::string_view line, std::vector<std::string_view>& fields);
+
+    /**
+     * @brief Parse a kernel CPU list such as "0-3,8,10-11"
+     * @param list The list to parse
+     * @return The expanded, ascending CPU ids
+     */
+    static std::vector<int> parseCpuList(std::string_view list);
+
+    /**
+     * @brief Parse a kernel hex CPU mask such as "00000000,0000000f"
+     * @param mask The mask to parse, most significant 32-bit word first
+     * @return The ascending CPU ids whose bits are set
+     */
+    static std::vector<int> parseCpuMask(std::string_view mask);
+
+    /**
+     * @brief Read a small sysfs or procfs attribute in a single read()
+     * @param path Path to the attribute
+     * @return The value without trailing newline or spaces, empty if unreadable
+     */
+    static std::string readAttribute(const std::string& path);
+
+    /**
+     * @brief Read the CPU-to-NUMA-node map from node<N>/cpulist files
+     * @param nodePath The node directory, e.g. Root::sysPath("/devices/system/node")
+     * @return The node of each CPU id, -1 for CPUs no node lists
+     */
+    static std::vector<int> readCpuNodes(const std::string& nodePath);
+
+    /**
+     * @brief Convert a run of leading decimal digits to an unsigned integer
+     * @param token The token to convert; trailing non-digits are ignored
+     * @return The parsed value, 0 if the token does not start with a digit
+     */
+    static uint64_t toUnsigned(std::string_view token);
+
+    /**
+     * @brief Parse a "Key:   value [unit]" or "key value" line without regex
+     * @param line The line to parse
+     * @param key Receives the key, without the trailing colon
+     * @param value Receives the first numeric value after the key
+     * @return true if both a key and a numeric value were found
+     */
+    static bool parseKeyValue(std::string_view line, std::string_view& key, uint64_t& value);
+
     /**
      * @brief Clear the regex cache
      */
@@ -1,2 +1,72 @@
 // Malghumuy - Library: kuserspace
+#pragma once
 
+#include "KSpace.h"
+#include "Root.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <cstdint>
+
+namespace kuserspace {
+
+class Process {
+public:
+    // Per-process information from /proc/[pid]/stat
+    struct Info {
+        pid_t pid;
+        pid_t ppid;
+        std::string name;
+        char state;
+        uint64_t cpuTime;       // utime + stime, in clock ticks
+        uint64_t startTime;     // clock ticks after boot, distinguishes reused pids
+        size_t rss;             // bytes
+    };
+
+    // Read a single process, std::nullopt if it does not exist (anymore)
+    static std::optional<Info> getInfo(pid_t pid, const Root& root = Root::getDefault());
+
+    // Scan all processes; the vector's storage is reused between calls
+    static void scan(std::vector<Info>& processes, const Root& root = Root::getDefault());
+    static std::vector<Info> scan(const Root& root = Root::getDefault());
+};
+
+// Parent/child tree maintained incrementally from successive scans.
+// Each node keeps aggregate totals for its subtree, updated by propagating
+// deltas upward, so subtree queries are O(1).
+class ProcessTree {
+public:
+    struct Totals {
+        size_t processes;       // live processes in the subtree
+        size_t rss;             // bytes
+        uint64_t cpuTime;       // clock ticks, including exited descendants
+        float cpuUsage;         // percent of one CPU over the last interval
+    };
+
+    explicit ProcessTree(const Root& root = Root::getDefault());
+    ~ProcessTree();
+
+    ProcessTree(const ProcessTree&) = delete;
+    ProcessTree& operator=(const ProcessTree&) = delete;
+
+    // Scan the root's /proc and apply the result
+    void refresh();
+    // Apply a scan taken elsewhere (e.g. from Process::scan)
+    void update(const std::vector<Process::Info>& processes);
+
+    // Queries, throw std::out_of_range for unknown pids
+    bool contains(pid_t pid) const;
+    Totals getSubtreeTotals(pid_t pid) const;
+    Process::Info getProcess(pid_t pid) const;
+    pid_t getParent(pid_t pid) const;
+    std::vector<pid_t> getChildren(pid_t pid) const;
+    std::vector<pid_t> getRoots() const;
+    size_t size() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
@@ -1,6 +1,8 @@
 // Malghumuy - Library: kuserspace
 #pragma once
 
+#include "KSpace.h"
+#include "Root.h"
 #include <string>
 #include <vector>
 #include <map>
@@ -77,6 +79,7 @@ public:
         std::map<CacheType, CacheInfo> caches;
         float temperature;
         float utilization;
+        int numaNode;           // -1 if the system exposes no NUMA topology
     };
 
     struct PackageInfo {
@@ -101,12 +104,37 @@ public:
         uint64_t stealTime;
         uint64_t guestTime;
         uint64_t guestNiceTime;
-        float totalUtilization;
-        std::vector<float> perCoreUtilization;
+        float totalUtilization;                 // percent since the previous call
+        std::vector<float> perCoreUtilization;  // indexed by CPU number
     };
 
-    // Constructor/Destructor
-    Processor();
+    // CPU capacity actually available to this process under cgroup v2
+    struct CpuBudget {
+        bool cgroupV2;                  // false: no unified hierarchy, host view only
+        std::string cgroupPath;
+        int64_t quotaUs;                // tightest cpu.max quota on the path, -1 for "max"
+        uint64_t periodUs;
+        unsigned int weight;            // cpu.weight (1-10000, default 100)
+        std::vector<int> cpus;          // cpuset.cpus.effective, or online CPUs
+        size_t affinityCpus;            // CPUs in this process's affinity mask
+        double effectiveCpus;           // min(quota / period, cpus, affinity)
+        size_t recommendedThreads;      // effectiveCpus rounded up, at least 1
+    };
+
+    // cpu.stat counters; rates cover the interval since the previous call
+    struct Throttling {
+        uint64_t usageUsec;
+        uint64_t periods;               // nr_periods
+        uint64_t throttledPeriods;      // nr_throttled
+        uint64_t throttledUsec;
+        double usageCpus;               // average CPUs consumed
+        double throttledPercent;        // share of periods that were throttled
+        double throttledUsecPerSec;
+    };
+
+    // Constructor/Destructor. A non-default Root gives an independent
+    // collector over that proc/sys view with its own caches and thread.
+    explicit Processor(const Root& root = Root::getDefault());
     ~Processor();
 
     static Processor& getInstance();
@@ -119,6 +147,15 @@ public:
     size_t getNumThreads() const;
     size_t getNumPackages() const;
 
+    // Topology
+    int getNumaNode(int coreId) const;
+    std::vector<int> getNumaNodeCores(int nodeId) const;
+
+    // Container CPU budget. getNumCores() reports host cores; thread pools
+    // should size themselves from getCpuBudget().recommendedThreads instead.
+    CpuBudget getCpuBudget() const;
+    Throttling getThrottling() const;
+
     // Core Information
     std::vector<CoreInfo> getAllCores() const;
     CoreInfo getCoreInfo(int coreId) const;
@@ -141,6 +178,7 @@ public:
 
     // System-wide Statistics
     Stats getStats() const;
+    void getStats(Stats& stats) const;      // reuses stats' storage
     std::future<Stats> getStatsAsync() const;
 
     // Continuous Monitoring
@@ -0,0 +1,94 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "SystemSnapshot.h"
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuserspace {
+
+/**
+ * @class Publisher
+ * @brief Writes snapshots into a POSIX shared memory segment for other processes
+ *
+ * One daemon per host samples with a SystemSnapshot and publishes every
+ * pass; any number of client processes attach a Publication read-only
+ * instead of parsing procfs themselves. Each source is a record with two
+ * slots, each guarded by a seqlock: a pass writes the slot readers are not
+ * being pointed at, then flips the record's latest index, so readers never
+ * wait for a write in progress.
+ *
+ * The segment is /dev/shm/<name> with a versioned header that records the
+ * layout of every record; a reader built against a different layout
+ * refuses to attach. Entries beyond the capacities given at construction
+ * are dropped and the record is marked truncated. Cgroups are not
+ * published, their paths are unbounded.
+ */
+class Publisher {
+public:
+    // Creates the segment, replacing one left by an earlier publisher
+    explicit Publisher(const std::string& name);
+    Publisher(const std::string& name, std::size_t maxCpus, std::size_t maxDevices, std::size_t maxInterfaces);
+    ~Publisher();       // removes the segment
+
+    Publisher(const Publisher&) = delete;
+    Publisher& operator=(const Publisher&) = delete;
+
+    // Every sampled source of the snapshot; call from one thread, e.g. the
+    // SystemSnapshot monitoring callback
+    void publish(const SystemSnapshot::Snapshot& snapshot);
+
+    const std::string& getName() const;
+    std::size_t getSize() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * @class Publication
+ * @brief Read-only view of a Publisher's segment
+ *
+ * getStats() fills the same structures as the collectors' fill-in
+ * overloads from the latest published pass of that source, and returns
+ * false until the publisher has published it. The collectors themselves
+ * never read the segment: a reader process calls these overloads on a
+ * Publication where it would call Memory::getStats() and friends.
+ * Every record is read consistently on its own; getSnapshot() combines
+ * the latest of each.
+ * Reads never block, take no lock and do not allocate once the output
+ * vectors have grown to size.
+ */
+class Publication {
+public:
+    // Throws std::runtime_error if the segment is missing or has another layout
+    explicit Publication(const std::string& name);
+    ~Publication();
+
+    Publication(const Publication&) = delete;
+    Publication& operator=(const Publication&) = delete;
+
+    bool getStats(Memory::Stats& stats) const;
+    bool getStats(Processor::Stats& stats) const;
+    bool getStats(std::vector<Disk::DeviceStats>& devices) const;
+    bool getStats(std::vector<Network::InterfaceStats>& interfaces) const;
+    bool getStats(Network::ProtocolStats& stats) const;
+    bool getStats(SystemSnapshot::Pressure& pressure) const;
+
+    // Sources missing from the publication are left as they were and
+    // marked not sampled
+    void getSnapshot(SystemSnapshot::Snapshot& snapshot) const;
+
+    uint64_t getSequence() const;       // snapshot sequence of the last pass, 0 before the first
+    bool isPublisherAlive() const;      // false once the publisher exited or replaced the segment
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
@@ -0,0 +1,77 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "Histogram.h"
+#include "SystemSnapshot.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuserspace {
+
+/**
+ * @class Quantiles
+ * @brief Sliding-window percentile sketches per metric
+ *
+ * Each metric keeps a ring of Histograms, one per slot of the window, so
+ * memory is constant however many samples arrive and old slots simply
+ * drop out. Values are recorded at 1/scale resolution with the Histogram's
+ * relative error. Sketches of different metrics, or of other hosts via
+ * Histogram::serialize(), merge exactly.
+ *
+ * record() and publish() belong to one sampler thread. Readers see the
+ * window as of the last publish(), through an immutable copy swapped in
+ * atomically, and never wait for the sampler.
+ */
+class Quantiles {
+public:
+    using Clock = std::chrono::system_clock;
+    using MetricId = std::size_t;
+
+    struct Summary {
+        std::size_t count;
+        double min;
+        double max;
+        double mean;
+        double p50;
+        double p95;
+        double p99;
+    };
+
+    // One hour in 12 five-minute slots, hundredths up to 10^6
+    Quantiles();
+    Quantiles(std::chrono::seconds slotWidth, std::size_t slots, double scale, double highestValue);
+    ~Quantiles();
+
+    Quantiles(const Quantiles&) = delete;
+    Quantiles& operator=(const Quantiles&) = delete;
+
+    MetricId getMetric(const std::string& name);
+    MetricId findMetric(const std::string& name) const;     // throws std::out_of_range
+    std::vector<std::string> getMetricNames() const;
+
+    // Sampler side. Samples older than the window are dropped.
+    void record(MetricId metric, Clock::time_point time, double value);
+    // Per-core utilization (cpu<N>.utilization), per-device await
+    // (disk.<dev>.readAwaitMs, .writeAwaitMs of whole disks) and
+    // memory.usedPercent, then publish
+    void record(const SystemSnapshot::Snapshot& snapshot);
+    // Advance every window to now and make recorded samples visible
+    void publish(Clock::time_point now = Clock::now());
+
+    // Reader side, in units of 1/scale
+    Histogram getSketch(MetricId metric) const;
+    Histogram getSketch(const std::vector<MetricId>& metrics) const;     // merged
+    Summary getSummary(MetricId metric) const;
+    Summary summarize(const Histogram& sketch) const;
+    double getScale() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
@@ -0,0 +1,190 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "Memory.h"
+#include "Processor.h"
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuserspace {
+
+/**
+ * @class Recording
+ * @brief Read side of the columnar sample file written by Recorder
+ *
+ * The file is a page-aligned header (magic, schema), a staging area and
+ * fixed-size blocks. Each block holds rowsPerBlock rows stored column by
+ * column, so one metric is contiguous within a block. Rows of the block
+ * being filled live in the staging area, one row after another, under a
+ * commit counter that is bumped with release ordering after a row's values
+ * are written; a full staging area is transposed into the next block.
+ * Rows past the counter were never committed and are ignored, which makes
+ * a file left by a crashed writer readable up to its last committed sample.
+ *
+ * Column 0 is always "time", nanoseconds since the epoch.
+ */
+class Recording {
+public:
+    enum class Type : uint8_t {
+        Unsigned,
+        Signed,
+        Double
+    };
+
+    struct Column {
+        std::string name;       // at most 55 bytes
+        Type type;
+    };
+    using Schema = std::vector<Column>;
+
+    // Every cell is 8 bytes; the column type says which member is valid
+    union Value {
+        uint64_t u;
+        int64_t i;
+        double d;
+    };
+
+    // One column's committed values within one block
+    struct Segment {
+        const Value* values;
+        std::size_t count;
+        std::size_t firstRow;
+    };
+
+    // Ready-made schemas for the scalar fields of Memory::Stats and
+    // Processor::Stats, in the order Recorder::set writes them
+    static Schema memorySchema();
+    static Schema processorSchema();
+
+    // Map a recording read-only, throws std::runtime_error if it is missing
+    // or not a recording
+    explicit Recording(const std::string& path);
+    ~Recording();
+
+    Recording(const Recording&) = delete;
+    Recording& operator=(const Recording&) = delete;
+
+    // Remap to pick up rows committed since the last call, e.g. while a
+    // Recorder is still appending. Staged rows are copied out column by
+    // column, so segments stay contiguous.
+    void refresh();
+
+    const Schema& getSchema() const { return schema; }
+    std::size_t getColumnIndex(const std::string& name) const;     // throws std::out_of_range
+    std::size_t getRowsPerBlock() const { return rowsPerBlock; }
+    std::size_t size() const { return rows; }
+
+    // Contiguous runs of one column, in row order
+    std::vector<Segment> getColumn(std::size_t column) const;
+    std::vector<Segment> getColumn(const std::string& name) const;
+    Value get(std::size_t row, std::size_t column) const;
+
+private:
+    void map();
+    void unmap();
+    bool isStaged(std::size_t block) const;
+    const Value* blockCells(std::size_t block) const;
+
+    std::string path;
+    int fd = -1;
+    const char* data = nullptr;
+    std::size_t mappedSize = 0;
+    Schema schema;
+    std::size_t rowsPerBlock = 0;
+    std::size_t blockSize = 0;
+    std::size_t headerSize = 0;
+    std::vector<std::size_t> blockRows;     // committed rows per block, the last one staged
+    std::vector<Value> staged;              // the staged rows, column by column
+    std::size_t rows = 0;
+};
+
+/**
+ * @class Recorder
+ * @brief Appends rows to a columnar recording through a memory mapping
+ *
+ * A row is built with set() and published with commit(); both only store
+ * into the mapped staging area, where a row's cells are adjacent, so a
+ * sample touches a handful of cache lines. Every rowsPerBlock rows the
+ * staging area is transposed and written out as one block with a single
+ * pwrite. Blocks default to 128 rows. The class is not synchronized;
+ * callers own the locking.
+ */
+class Recorder {
+public:
+    // Create path, or append to it if it already holds a recording with the
+    // same schema. Throws std::runtime_error if the file cannot be used.
+    Recorder(const std::string& path, const Recording::Schema& schema);
+    Recorder(const std::string& path, const Recording::Schema& schema, std::size_t rowsPerBlock);
+    ~Recorder();
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // Set a column (1-based: column 0 is time) of the row being built. The
+    // value is converted to the column's type.
+    template <typename T>
+    void set(std::size_t column, T value) {
+        Recording::Value& cell = cells[row * types.size() + column];
+        switch (types[column]) {
+        case Recording::Type::Unsigned: cell.u = static_cast<uint64_t>(value); break;
+        case Recording::Type::Signed: cell.i = static_cast<int64_t>(value); break;
+        case Recording::Type::Double: cell.d = static_cast<double>(value); break;
+        }
+    }
+
+    // Write Recording::memorySchema() / processorSchema() columns starting at first
+    void set(std::size_t first, const Memory::Stats& stats);
+    void set(std::size_t first, const Processor::Stats& stats);
+
+    // Publish the row; unset columns keep whatever the slot held. Sealing a
+    // full block throws std::runtime_error if it cannot be written: its
+    // rows stay staged, and each later commit() tries again and drops its
+    // own row while that fails.
+    void commit(std::chrono::system_clock::time_point time = std::chrono::system_clock::now()) {
+        if (row == rowsPerBlock) {
+            retrySeal();
+        }
+        cells[row * types.size()].i = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            time.time_since_epoch()).count();
+        committed->store(++row, std::memory_order_release);
+        if (row == rowsPerBlock) {
+            seal();
+        }
+    }
+
+    std::size_t getColumnCount() const { return types.size(); }
+    std::size_t size() const { return rows + row; }
+
+    // Flush committed rows to disk; commit() alone survives a process crash
+    // but not a power loss
+    void sync();
+
+private:
+    void seal();
+    void retrySeal();
+    void mapStage();
+    void unmapStage();
+
+    std::string path;
+    int fd = -1;
+    std::vector<Recording::Type> types;
+    std::size_t rowsPerBlock;
+    std::size_t blockSize = 0;
+    std::size_t headerSize = 0;
+    std::size_t block = 0;              // index of the block being filled
+    std::size_t rows = 0;               // rows in earlier blocks
+    std::size_t row = 0;                // next row in the staging area
+
+    void* mapping = nullptr;            // header and staging area
+    std::size_t mappingSize = 0;
+    std::atomic<uint64_t>* stagedBlock = nullptr;
+    std::atomic<uint64_t>* committed = nullptr;
+    Recording::Value* cells = nullptr;  // staged rows, one after another, then a spare
+    std::vector<char> sealing;          // a block being written out
+};
+
+} // namespace kuserspace
@@ -0,0 +1,54 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include <string>
+
+namespace kuserspace {
+
+/**
+ * @struct Root
+ * @brief Filesystem view a collector reads from
+ *
+ * The default is the host's own /proc and /sys. A collector constructed with
+ * another Root (for example Root::forProcess(pid) for a container) keeps its
+ * own caches, locks and monitoring thread, so one agent can run many of them
+ * side by side. Root::at() points collectors at a captured tree instead of
+ * the kernel, see Capture and Replay.
+ */
+struct Root {
+    std::string proc = "/proc";
+    std::string sys = "/sys";
+    std::string cgroup;     // cgroup v2 directory for budgets, empty for <proc>/self/cgroup
+    int pid = 0;            // process whose affinity is reported, 0 for this process
+
+    /**
+     * @brief The view from inside another process's mount namespace
+     * @param pid Any process in the container, typically its init
+     * @return Root at /proc/<pid>/root with that process's cgroup
+     */
+    static Root forProcess(int pid);
+
+    /**
+     * @brief A tree laid out like the host, e.g. a capture frame
+     * @param directory Directory holding proc/ and sys/
+     */
+    static Root at(const std::string& directory);
+
+    /**
+     * @brief Root used by getInstance() and default-constructed collectors
+     *
+     * Taken from $KUSERSPACE_ROOT (as Root::at) on first use, otherwise the
+     * host. setDefault() only affects collectors constructed afterwards.
+     */
+    static Root getDefault();
+    static void setDefault(const Root& root);
+
+    std::string procPath(const std::string& relative) const { return proc + relative; }
+    std::string sysPath(const std::string& relative) const { return sys + relative; }
+
+    // Map an absolute host path under /proc or /sys into this root; other
+    // paths are returned unchanged
+    std::string resolve(const std::string& path) const;
+};
+
+} // namespace kuserspace
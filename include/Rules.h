@@ -0,0 +1,104 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "SystemSnapshot.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <cstddef>
+
+namespace kuserspace {
+
+/**
+ * @class Rules
+ * @brief Threshold rules compiled once and evaluated on every snapshot
+ *
+ * A rule is an expression over metric names with an optional hold:
+ *
+ *     memory.availablePercent < 5% and pressure.memory.some.avg10 > 20 for 3 samples
+ *     disk.sda.utilization > 90 or disk.sda.writeAwaitMs > 50 for 30s
+ *
+ * Expressions support + - * /, comparisons (< <= > >= == !=), and / or /
+ * not (also && || !), parentheses, numbers with an optional % (ignored) or
+ * KiB/MiB/GiB/TiB suffix, and metric names; names with other characters
+ * (cgroup paths, interfaces with dashes) are written in double quotes.
+ *
+ * Snapshot metrics follow History's names: memory.{total, free, cached,
+ * buffers, available, swapTotal, swapFree, usedPercent, availablePercent,
+ * swapUsedPercent}, cpu.utilization, cpu<N>.utilization, disk.<dev>.*,
+ * net.<if>.*, tcp.*, cgroup:<path>.* and pressure.<cpu|memory|io>.<some|
+ * full>.<avg10|avg60|avg300|total>. Any other name is a custom metric fed
+ * with set(). A metric that is absent from the snapshot (source not
+ * sampled, device gone) or never set is NaN, which fails every comparison,
+ * != included; not of it stays NaN, and and/or follow three-valued logic.
+ *
+ * Names are resolved when a rule is added and each rule compiles to a
+ * short stack program over value slots. Per evaluation only the metrics
+ * some rule references are extracted, device and cgroup lookups reuse the
+ * position found in the previous snapshot, and nothing is allocated.
+ *
+ * A rule goes Pending when its expression first holds and Firing once it
+ * has held for N consecutive evaluations or for the given duration; the
+ * callback runs on the transition to Firing and again when it resolves.
+ * Callbacks run on the evaluating thread without the engine's lock held.
+ */
+class Rules {
+public:
+    using Clock = std::chrono::steady_clock;
+    using RuleId = std::size_t;
+    using MetricId = std::size_t;
+
+    enum class State {
+        Inactive,
+        Pending,        // holding, not yet for long enough
+        Firing
+    };
+
+    struct Status {
+        State state;
+        Clock::time_point since;        // first evaluation of the current hold
+        std::size_t samples;            // consecutive evaluations it has held
+    };
+
+    struct Event {
+        RuleId rule;
+        bool firing;                    // false when the rule resolves
+        Clock::time_point time;         // evaluation that changed the state
+        Status status;                  // as of the previous evaluation when resolving
+    };
+
+    using Callback = std::function<void(const Event&)>;
+
+    Rules();
+    ~Rules();
+
+    Rules(const Rules&) = delete;
+    Rules& operator=(const Rules&) = delete;
+
+    // Throws std::invalid_argument on a syntax error or an unknown
+    // snapshot metric (known prefix, unknown field)
+    RuleId add(const std::string& name, const std::string& rule, Callback callback);
+    void remove(RuleId rule);
+
+    const std::string& getName(RuleId rule) const;
+    Status getStatus(RuleId rule) const;
+    // The compiled program, one instruction per line
+    std::string disassemble(RuleId rule) const;
+
+    // Custom metrics keep their value until set again
+    MetricId getMetric(const std::string& name);
+    void set(MetricId metric, double value);
+
+    // Extract the referenced metrics, then evaluate at the snapshot's timestamp
+    void evaluate(const SystemSnapshot::Snapshot& snapshot);
+    // Evaluate over the current values (custom metrics, last snapshot)
+    void evaluate(Clock::time_point now = Clock::now());
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
@@ -0,0 +1,58 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuserspace {
+
+/**
+ * @class Server
+ * @brief Listening socket, connection pool and epoll thread behind Exporter and StreamReceiver
+ *
+ * Accepts on a TCP or Unix socket and hands each connection a slot: a
+ * small index the owner uses for its per-connection state. Slots are
+ * reused, but never within the epoll batch that closed them, so an event
+ * already queued for a closed connection is dropped instead of reaching
+ * the next one. Every handler runs on the server thread, which is also the
+ * only thread that may call close() and watch().
+ */
+class Server {
+public:
+    struct Handlers {
+        std::function<void(std::size_t slot)> accepted;                 // set up state for a new connection
+        std::function<void(std::size_t slot, uint32_t events)> ready;   // epoll events on it
+        std::function<void(std::size_t slot)> closed;                   // optional; on every close, also at stop()
+        std::function<void()> refused;                                  // optional; the pool was full
+    };
+
+    // At most maxConnections slots, which also bounds the owner's state
+    Server(std::size_t maxConnections, int backlog, Handlers handlers);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Bind an IPv4 address or a Unix socket, replacing a stale socket file,
+    // and start the thread. Throws std::runtime_error if the socket cannot
+    // be set up; a running server is stopped first.
+    void listen(const std::string& address, uint16_t port);
+    void listen(const std::string& socketPath);
+    void stop();
+    bool isRunning() const;
+    uint16_t getPort() const;           // 0 for a Unix socket
+
+    // From the handlers only
+    int getFd(std::size_t slot) const;                  // -1 once closed
+    void close(std::size_t slot);
+    void watch(std::size_t slot, uint32_t events);      // replace the epoll events of a connection
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
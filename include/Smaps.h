@@ -0,0 +1,75 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "KSpace.h"
+#include "Root.h"
+#include <string>
+#include <map>
+#include <future>
+
+namespace kuserspace {
+
+/**
+ * @class Smaps
+ * @brief Streaming analyzer for /proc/[pid]/smaps
+ *
+ * The file is read through a fixed-size window. Each window is cut at the last
+ * mapping header it contains and handed to a worker thread, so memory use stays
+ * bounded by (threads + 1) windows regardless of how large the file is.
+ */
+class Smaps {
+public:
+    // Mapping categories, derived from the pathname column and permissions
+    enum class Category {
+        Heap,           // [heap]
+        Stack,          // [stack], [stack:tid]
+        Anonymous,      // private anonymous mappings, [anon:name]
+        SharedMemory,   // shared anonymous, /dev/shm, SysV, memfd
+        File,           // file-backed mappings
+        Special         // [vdso], [vvar], [vsyscall] and other kernel mappings
+    };
+
+    // Aggregated usage, all values in bytes
+    struct Usage {
+        size_t mappings;
+        size_t size;
+        size_t rss;
+        size_t pss;
+        size_t privateDirty;
+        size_t anonHugePages;
+        size_t swap;
+
+        Usage& operator+=(const Usage& other);
+    };
+
+    struct Report {
+        Usage total;
+        std::map<Category, Usage> byCategory;
+        std::map<std::string, Usage> byFile;   // keyed by backing file path
+    };
+
+    struct Config {
+        size_t windowSize;          // Bytes per read window
+        size_t maxThreads;          // Worker threads used for large files
+    };
+
+    Smaps();
+    explicit Smaps(const Config& config);
+
+    // Analyze a process, throws std::runtime_error if smaps cannot be opened
+    Report analyze(pid_t pid, const Root& root = Root::getDefault()) const;
+    Report analyzeFile(const std::string& path) const;
+    std::future<Report> analyzeAsync(pid_t pid, const Root& root = Root::getDefault()) const;
+
+    // Configuration
+    void setWindowSize(size_t size);
+    void setMaxThreads(size_t threads);
+    Config getConfig() const { return config; }
+
+    static std::string categoryToString(Category category);
+
+private:
+    Config config;
+};
+
+} // namespace kuserspace
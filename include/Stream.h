@@ -0,0 +1,159 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "SystemSnapshot.h"
+#include <string>
+#include <string_view>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuserspace {
+
+/**
+ * @class StreamEncoder
+ * @brief Compact binary encoding of a stream of snapshots
+ *
+ * A stream is a sequence of frames: a hello naming the source, a schema
+ * that announces every field by section, entity and name, then one delta
+ * frame per sample. A delta carries a two-level bitmap of the fields that
+ * changed since the previous sample and, for those only, integers as
+ * zigzag varint differences and reals as the changed bytes of their XOR
+ * with the previous value. A new schema, and a sample against zero, is
+ * sent whenever the set of CPUs, devices, interfaces or cgroups changes.
+ *
+ * Decoders map fields by name, so a peer built with more or fewer fields
+ * per section still understands the fields both know.
+ */
+class StreamEncoder {
+public:
+    explicit StreamEncoder(const std::string& source);
+    ~StreamEncoder();
+
+    StreamEncoder(const StreamEncoder&) = delete;
+    StreamEncoder& operator=(const StreamEncoder&) = delete;
+
+    // Append the frames for one sample to out
+    void encode(const SystemSnapshot::Snapshot& snapshot, std::string& out);
+    // Start over as on a new connection: the next sample is announced in full
+    void reset();
+
+    std::size_t getFieldCount() const;      // in the current schema
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * @class StreamDecoder
+ * @brief Rebuilds snapshots from a StreamEncoder's frames
+ */
+class StreamDecoder {
+public:
+    enum class Frame { None, Hello, Schema, Sample };
+
+    StreamDecoder();
+    ~StreamDecoder();
+
+    StreamDecoder(const StreamDecoder&) = delete;
+    StreamDecoder& operator=(const StreamDecoder&) = delete;
+
+    // Decode the frame at the front of data and drop it from data. None
+    // means the frame is incomplete and data was left alone. Throws
+    // std::invalid_argument on a malformed stream.
+    Frame decode(std::string_view& data);
+
+    const std::string& getSource() const;                   // from the hello
+    const SystemSnapshot::Snapshot& getSnapshot() const;    // the last sample
+    std::size_t getFieldCount() const;                      // announced by the peer
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * @class StreamSender
+ * @brief Agent side of the stream over TCP or a Unix socket
+ *
+ * send() encodes and writes one sample with a blocking socket and a send
+ * timeout. When the connection drops the sample is lost and send()
+ * returns false; the next send() reconnects and starts a new stream.
+ */
+class StreamSender {
+public:
+    struct Stats {
+        uint64_t samples;
+        uint64_t bytes;
+        uint64_t connects;
+    };
+
+    explicit StreamSender(const std::string& source);
+    ~StreamSender();
+
+    StreamSender(const StreamSender&) = delete;
+    StreamSender& operator=(const StreamSender&) = delete;
+
+    // Throws std::runtime_error if the first connection fails
+    void connect(const std::string& host, uint16_t port);
+    void connect(const std::string& socketPath);
+    void close();
+    bool isConnected() const;
+
+    bool send(const SystemSnapshot::Snapshot& snapshot);
+
+    Stats getStats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * @class StreamReceiver
+ * @brief Accepts streams from many senders on one epoll thread
+ *
+ * Every connection has its own decoder; the callback runs on the receiver
+ * thread with the source name and the rebuilt snapshot, which is valid
+ * until it returns. A connection that sends a malformed stream, holds more
+ * than a frame's worth of unparsed bytes, or whose samples make the
+ * callback throw is closed; the others carry on. Unparsed bytes across all
+ * connections are capped at 256 MiB.
+ */
+class StreamReceiver {
+public:
+    struct Stats {
+        uint64_t connections;       // accepted so far
+        uint64_t samples;
+        uint64_t bytes;
+        uint64_t errors;            // connections closed for the reasons above, and refused ones
+    };
+
+    using Callback = std::function<void(const std::string& source, const SystemSnapshot::Snapshot& snapshot)>;
+
+    explicit StreamReceiver(Callback callback);
+    ~StreamReceiver();
+
+    StreamReceiver(const StreamReceiver&) = delete;
+    StreamReceiver& operator=(const StreamReceiver&) = delete;
+
+    // As Exporter::listen(): 127.0.0.1:port (0 picks a free port) or a
+    // Unix socket; agents on other hosts need an IPv4 address to bind, such
+    // as "0.0.0.0". Throws std::runtime_error if the socket cannot be set up.
+    void listen(uint16_t port);
+    void listen(const std::string& address, uint16_t port);
+    void listen(const std::string& socketPath);
+    void stop();
+    bool isRunning() const;
+    uint16_t getPort() const;
+
+    Stats getStats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
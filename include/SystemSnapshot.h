@@ -0,0 +1,124 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "Memory.h"
+#include "Processor.h"
+#include "Disk.h"
+#include "Network.h"
+#include "Cgroup.h"
+#include "Root.h"
+#include <array>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuserspace {
+
+/**
+ * @class SystemSnapshot
+ * @brief Samples every enabled collector in one pass under one timestamp
+ *
+ * The snapshot owns its own collector instances, so its rate windows are
+ * not disturbed by other users of the singletons. Each pass is written into
+ * a spare Snapshot whose vectors keep their capacity, then swapped with the
+ * published one, so steady-state sampling does not allocate.
+ */
+class SystemSnapshot {
+public:
+    enum class Source {
+        Memory,
+        Processor,
+        Disk,
+        Network,
+        Protocols,      // TCP/UDP counters from /proc/net/snmp and netstat
+        Cgroups,
+        Pressure        // PSI from /proc/pressure/{cpu,memory,io}
+    };
+    static constexpr std::size_t NUM_SOURCES = 7;
+
+    struct SourceTiming {
+        bool sampled;                                   // enabled during this pass
+        std::chrono::steady_clock::time_point readAt;   // when the read started
+        std::chrono::nanoseconds readDuration;
+    };
+
+    // One line of a /proc/pressure file: share of wall time in which some
+    // (or all) non-idle tasks were stalled on the resource
+    struct Stall {
+        double avg10;           // percent, over the last 10 seconds
+        double avg60;
+        double avg300;
+        uint64_t total;         // microseconds stalled since boot
+    };
+
+    struct Pressure {
+        struct Resource {
+            Stall some;
+            Stall full;         // zero where the kernel does not report it
+        };
+        Resource cpu;
+        Resource memory;
+        Resource io;
+    };
+
+    // Data of a source not sampled in this pass is left over from an
+    // earlier one; check timing(source).sampled before using it.
+
+    struct Snapshot {
+        uint64_t sequence;                              // 1 for the first pass
+        std::chrono::steady_clock::time_point timestamp;
+        std::chrono::system_clock::time_point wallTime;
+        std::chrono::nanoseconds duration;              // whole pass
+        std::array<SourceTiming, NUM_SOURCES> timings;
+
+        Memory::Stats memory;
+        Processor::Stats processor;
+        std::vector<Disk::DeviceStats> disks;
+        std::vector<Network::InterfaceStats> interfaces;
+        Network::ProtocolStats protocols;
+        std::vector<Cgroup::Stats> cgroups;
+        Pressure pressure;
+
+        const SourceTiming& timing(Source source) const {
+            return timings[static_cast<std::size_t>(source)];
+        }
+    };
+
+    // Memory, Processor, Disk and Network are enabled by default
+    explicit SystemSnapshot(const Root& root = Root::getDefault());
+    ~SystemSnapshot();
+
+    SystemSnapshot(const SystemSnapshot&) = delete;
+    SystemSnapshot& operator=(const SystemSnapshot&) = delete;
+
+    static SystemSnapshot& getInstance();
+
+    // A collector is created when its source is first enabled
+    void enable(Source source, bool enabled = true);
+    bool isEnabled(Source source) const;
+
+    // Run one pass now and publish it
+    void refresh();
+    // Copy of the last published snapshot
+    Snapshot getSnapshot() const;
+    // The same into an existing Snapshot, reusing its vectors' capacity
+    void getSnapshot(Snapshot& snapshot) const;
+
+    // One subscription for every source. The callback runs on the sampling
+    // thread with a copy of the published snapshot, valid until it returns,
+    // and holds no lock: it may call refresh(), getSnapshot() or enable(),
+    // but not stopContinuousMonitoring().
+    // Passes run on a fixed cadence.
+    using SnapshotCallback = std::function<void(const Snapshot&)>;
+    void startContinuousMonitoring(SnapshotCallback callback, std::chrono::milliseconds interval);
+    void stopContinuousMonitoring();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
@@ -0,0 +1,105 @@
+// Malghumuy - Library: kuserspace
+#pragma once
+
+#include "SystemSnapshot.h"
+#include "Root.h"
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuserspace {
+
+/**
+ * @class Tracer
+ * @brief Trace-event file of samples and library activity for Chrome and Perfetto
+ *
+ * record() turns a snapshot into counter tracks of this process:
+ *
+ *     cpu.utilization, cpu<N>.utilization, cpu<N>.frequency (MHz, read from
+ *     cpufreq at record time), memory.{used, available, cached, swapUsed}
+ *     (bytes), pressure.cpu.some.avg10, pressure.{memory,io}.{some,full}.avg10
+ *
+ * and the pass that produced it into slices on a "kuserspace collectors"
+ * track: one for the pass, nested ones for each source read. Applications
+ * add their own counters and slices from any thread.
+ *
+ * Timestamps are steady_clock (CLOCK_MONOTONIC), the clock of Chrome's
+ * trace events; Perfetto files carry clock snapshots so trace processor
+ * lines them up with traces taken on its default boot clock.
+ *
+ * Every thread appends to its own ring of fixed-size events without
+ * locking; a full ring drops and counts the event instead of waiting. A
+ * background thread drains the rings into the file every flush interval.
+ * JSON is written in the array form, which loads even when the process
+ * dies before close().
+ */
+class Tracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Format {
+        Json,           // Chrome trace-event JSON, for chrome://tracing and ui.perfetto.dev
+        Perfetto        // Perfetto TracePacket protobuf
+    };
+
+    struct Stats {
+        uint64_t events;        // written to the file
+        uint64_t dropped;       // lost to full rings, a failed write or close()
+        uint64_t flushes;
+        uint64_t bytes;
+        uint64_t errors;        // failed writes; the file stops growing after one
+        std::size_t threads;    // that have recorded
+    };
+
+    // Create or truncate path and flush every 100 ms, 16384 events per
+    // thread. Throws std::runtime_error if the file cannot be opened.
+    Tracer(const std::string& path, Format format, const Root& root = Root::getDefault());
+    Tracer(const std::string& path, Format format, std::chrono::milliseconds flushInterval,
+           std::size_t eventsPerThread, const Root& root = Root::getDefault());
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Counters of every sampled source and the slices of the pass
+    void record(const SystemSnapshot::Snapshot& snapshot);
+
+    // Names are kept by pointer until they are written: pass string
+    // literals or strings that outlive the tracer.
+    void counter(const char* track, double value);
+    void counter(const char* track, double value, Clock::time_point time);
+    // A slice on the calling thread's track
+    void slice(const char* name, Clock::time_point begin, Clock::time_point end);
+    void instant(const char* name);
+
+    // Slice from construction to destruction
+    class Scope {
+    public:
+        Scope(Tracer& tracer, const char* name) : tracer(tracer), name(name), begin(Clock::now()) {}
+        ~Scope() { tracer.slice(name, begin, Clock::now()); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Tracer& tracer;
+        const char* name;
+        Clock::time_point begin;
+    };
+
+    // Drain every ring into the file now
+    void flush();
+    // Stop the flusher, write what is left and finish the file; later events are dropped
+    void close();
+    bool isOpen() const;
+
+    Stats getStats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+} // namespace kuserspace
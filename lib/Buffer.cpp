@@ -167,32 +167,43 @@ std::pair<bool, Buffer::Error> Buffer::read(const std::string& path) {
             return {false, Buffer::Error::IOError};
         }
         
-        // Get file size
+        // Get file size. procfs cannot seek to the end and sysfs reports a
+        // full page, so the size is only a hint: read until EOF.
         file.seekg(0, std::ios::end);
-        size_t fileSize = file.tellg();
+        std::streamoff end = file.tellg();
+        file.clear();
         file.seekg(0, std::ios::beg);
-        
-        if (fileSize > config.maxBufferSize) {
+
+        if (end > 0 && static_cast<size_t>(end) > config.maxBufferSize) {
             updateLastError(Buffer::Error::BufferOverflow);
             return {false, Buffer::Error::BufferOverflow};
         }
-        
+
         // Read file using buffered I/O
-        state.data.resize(fileSize);
+        state.data.resize(end > 0 ? static_cast<size_t>(end) : config.readAheadSize);
         size_t totalRead = 0;
-        
-        while (totalRead < fileSize) {
-            size_t toRead = std::min(config.readAheadSize, fileSize - totalRead);
+
+        while (true) {
+            if (totalRead == state.data.size()) {
+                if (totalRead >= config.maxBufferSize) {
+                    updateLastError(Buffer::Error::BufferOverflow);
+                    return {false, Buffer::Error::BufferOverflow};
+                }
+                state.data.resize(std::min(config.maxBufferSize, totalRead * 2));
+            }
+            size_t toRead = std::min(config.readAheadSize, state.data.size() - totalRead);
             file.read(state.data.data() + totalRead, toRead);
             totalRead += file.gcount();
+            if (file.gcount() == 0 || file.eof()) break;
         }
-        
-        if (!file) {
+
+        if (file.bad()) {
             updateLastError(Buffer::Error::IOError);
             return {false, Buffer::Error::IOError};
         }
-        
-        state.size = fileSize;
+
+        state.data.resize(totalRead);
+        state.size = totalRead;
         state.isValid = true;
         state.lastUpdate = std::chrono::system_clock::now();
         currentPath = path;
@@ -374,4 +385,79 @@ std::chrono::system_clock::time_point Buffer::getLastUpdateTime() const {
     return state.lastUpdate;
 }
 
+PersistentFile::PersistentFile(const std::string& path) {
+    open(path);
+}
+
+PersistentFile::~PersistentFile() {
+    close();
+}
+
+PersistentFile::PersistentFile(PersistentFile&& other) noexcept
+    : fd(other.fd)
+    , path(std::move(other.path))
+    , data(std::move(other.data))
+    , lastError(other.lastError) {
+    other.fd = -1;
+}
+
+PersistentFile& PersistentFile::operator=(PersistentFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd = other.fd;
+        path = std::move(other.path);
+        data = std::move(other.data);
+        lastError = other.lastError;
+        other.fd = -1;
+    }
+    return *this;
+}
+
+bool PersistentFile::open(const std::string& filePath) {
+    close();
+    path = filePath;
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        lastError = Buffer::systemErrorToError(std::error_code(errno, std::generic_category()));
+        return false;
+    }
+    if (data.empty()) {
+        data.resize(4096);
+    }
+    lastError = Buffer::Error::None;
+    return true;
+}
+
+void PersistentFile::close() {
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+std::optional<std::string_view> PersistentFile::read() {
+    if (fd == -1) {
+        lastError = Buffer::Error::InvalidPath;
+        return std::nullopt;
+    }
+
+    size_t total = 0;
+    while (true) {
+        if (total == data.size()) {
+            data.resize(data.size() * 2);
+        }
+        ssize_t n = ::pread(fd, data.data() + total, data.size() - total, static_cast<off_t>(total));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            lastError = Buffer::systemErrorToError(std::error_code(errno, std::generic_category()));
+            return std::nullopt;
+        }
+        if (n == 0) break;
+        total += static_cast<size_t>(n);
+    }
+
+    lastError = Buffer::Error::None;
+    return std::string_view(data.data(), total);
+}
+
 } // namespace kuserspace 
@@ -0,0 +1,378 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Capture.h"
+#include "../include/Cgroup.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <unordered_set>
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace kuserspace {
+
+namespace {
+
+// procfs files the collectors read, relative to /proc
+const char* const PROC_FILES[] = {
+    "/meminfo", "/swaps", "/zoneinfo", "/stat", "/cpuinfo", "/diskstats", "/interrupts",
+    "/net/dev", "/net/snmp", "/net/netstat", "/self/mountinfo", "/self/cgroup",
+};
+
+// sysfs trees copied recursively, relative to /sys, with their depth
+struct SysTree {
+    const char* path;
+    int depth;
+};
+
+const SysTree SYS_TREES[] = {
+    {"/devices/system/cpu", 3},     // cpuN/cache/indexN/size, cpuN/cpufreq/*
+    {"/devices/system/node", 1},    // nodeN/meminfo, nodeN/cpulist
+    {"/kernel/mm/hugepages", 1},
+};
+
+// Class directories whose entries are symlinks into /sys/devices
+const char* const SYS_CLASSES[] = {"/class/net", "/class/block", "/block"};
+
+// Attributes read from the bus device above a class device
+const char* const BUS_ATTRIBUTES[] = {"numa_node", "local_cpulist"};
+
+// cgroup files read by Cgroup and Processor
+const char* const CGROUP_FILES[] = {
+    "cpu.stat", "cpu.max", "cpu.weight", "cpuset.cpus.effective",
+    "memory.current", "memory.stat", "io.stat",
+};
+
+constexpr size_t MAX_FILE_SIZE = 16 * 1024 * 1024;
+
+bool isNumeric(const char* name) {
+    return *name >= '0' && *name <= '9';
+}
+
+// Copy one regular file. The target is truncated rather than replaced, so
+// readers holding it open see the new content on their next read.
+bool copyFile(const std::string& from, const std::string& to, std::vector<char>& buffer, Capture::Result* result) {
+    int in = open(from.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (in == -1) return false;
+
+    struct stat st;
+    if (fstat(in, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(in);
+        return false;
+    }
+
+    // procfs reports size 0 and sysfs a full page, so read until EOF
+    size_t size = 0;
+    while (true) {
+        if (size == buffer.size()) {
+            if (size >= MAX_FILE_SIZE) break;
+            buffer.resize(std::max<size_t>(64 * 1024, buffer.size() * 2));
+        }
+        ssize_t n = read(in, buffer.data() + size, buffer.size() - size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            close(in);
+            return false;       // attributes without a show method, EIO, ...
+        }
+        if (n == 0) break;
+        size += static_cast<size_t>(n);
+    }
+    close(in);
+
+    int out = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out == -1) return false;
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(out, buffer.data() + written, size - written);
+        if (n <= 0) break;
+        written += static_cast<size_t>(n);
+    }
+    close(out);
+
+    if (result) {
+        ++result->files;
+        result->bytes += size;
+    }
+    return written == size;
+}
+
+// Recreate a symlink with the same (usually relative) target
+void copyLink(const std::string& from, const std::string& to) {
+    char target[4096];
+    ssize_t n = readlink(from.c_str(), target, sizeof(target) - 1);
+    if (n <= 0) return;
+    target[n] = '\0';
+
+    char existing[4096];
+    ssize_t m = readlink(to.c_str(), existing, sizeof(existing) - 1);
+    if (m == n && std::equal(target, target + n, existing)) return;
+
+    std::error_code ec;
+    std::filesystem::remove_all(to, ec);
+    if (symlink(target, to.c_str()) != 0) return;
+}
+
+// Copy files and symlinks below from, descending depth directory levels.
+// Directory symlinks are recreated, never followed.
+void copyTree(const std::string& from, const std::string& to, int depth,
+              std::vector<char>& buffer, Capture::Result& result) {
+    DIR* dir = opendir(from.c_str());
+    if (!dir) return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(to, ec);
+    while (struct dirent* entry = readdir(dir)) {
+        std::string_view name = entry->d_name;
+        if (name == "." || name == "..") continue;
+
+        std::string source = from + "/" + entry->d_name;
+        std::string target = to + "/" + entry->d_name;
+        struct stat st;
+        if (lstat(source.c_str(), &st) != 0) continue;
+
+        if (S_ISLNK(st.st_mode)) {
+            copyLink(source, target);
+        } else if (S_ISDIR(st.st_mode)) {
+            if (depth > 0) copyTree(source, target, depth - 1, buffer, result);
+        } else if (S_ISREG(st.st_mode)) {
+            copyFile(source, target, buffer, &result);
+        }
+    }
+    closedir(dir);
+}
+
+// Class entries link to a device directory (/sys/devices/.../net/eth0).
+// Copy the link, the device and the attributes Disk and Network read from
+// the bus devices above it. /sys/block and /sys/class/block share devices.
+void copyClassDevice(const std::string& link, const std::string& sys, std::unordered_set<std::string>& copied,
+                     std::vector<char>& buffer, Capture::Result& result) {
+    copyLink(link, sys + link.substr(4));
+
+    std::error_code ec;
+    std::filesystem::path device = std::filesystem::canonical(link, ec);
+    if (ec || device.string().compare(0, 13, "/sys/devices/") != 0) return;
+    if (!copied.insert(device.string()).second) return;
+    copyTree(device.string(), sys + device.string().substr(4), 2, buffer, result);
+
+    std::filesystem::path bus = std::filesystem::canonical(device / "device", ec);
+    for (; !ec && bus.has_relative_path() && bus != "/sys/devices"; bus = bus.parent_path()) {
+        std::string target = sys + bus.string().substr(4);
+        std::filesystem::create_directories(target, ec);
+        for (const char* attribute : BUS_ATTRIBUTES) {
+            copyFile(bus.string() + "/" + attribute, target + "/" + attribute, buffer, &result);
+        }
+        copyTree(bus.string() + "/msi_irqs", target + "/msi_irqs", 0, buffer, result);
+    }
+}
+
+// Accounting files of every cgroup below directory
+void copyCgroups(const std::string& from, const std::string& to,
+                 std::vector<char>& buffer, Capture::Result& result) {
+    DIR* dir = opendir(from.c_str());
+    if (!dir) return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(to, ec);
+    for (const char* file : CGROUP_FILES) {
+        copyFile(from + "/" + file, to + "/" + file, buffer, &result);
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_type != DT_DIR || entry->d_name[0] == '.') continue;
+        copyCgroups(from + "/" + entry->d_name, to + "/" + entry->d_name, buffer, result);
+    }
+    closedir(dir);
+}
+
+// Make the tree below to match from: same files, links and directories.
+// Regular files are rewritten in place to keep their inodes.
+void syncTree(const std::string& from, const std::string& to, std::vector<char>& buffer) {
+    DIR* dir = opendir(from.c_str());
+    if (!dir) return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(to, ec);
+    std::unordered_set<std::string> present;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string_view name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        present.emplace(name);
+
+        std::string source = from + "/" + entry->d_name;
+        std::string target = to + "/" + entry->d_name;
+        struct stat st, current;
+        if (lstat(source.c_str(), &st) != 0) continue;
+        bool exists = lstat(target.c_str(), &current) == 0;
+
+        if (S_ISLNK(st.st_mode)) {
+            if (exists && !S_ISLNK(current.st_mode)) std::filesystem::remove_all(target, ec);
+            copyLink(source, target);
+        } else if (S_ISDIR(st.st_mode)) {
+            if (exists && !S_ISDIR(current.st_mode)) std::filesystem::remove_all(target, ec);
+            syncTree(source, target, buffer);
+        } else if (S_ISREG(st.st_mode)) {
+            if (exists && !S_ISREG(current.st_mode)) std::filesystem::remove_all(target, ec);
+            copyFile(source, target, buffer, nullptr);
+        }
+    }
+    closedir(dir);
+
+    // Drop what the frame no longer has (exited processes, removed cgroups)
+    if (DIR* live = opendir(to.c_str())) {
+        std::vector<std::string> stale;
+        while (struct dirent* entry = readdir(live)) {
+            std::string_view name = entry->d_name;
+            if (name == "." || name == ".." || present.count(std::string(name))) continue;
+            stale.emplace_back(name);
+        }
+        closedir(live);
+        for (const auto& name : stale) {
+            std::filesystem::remove_all(to + "/" + name, ec);
+        }
+    }
+}
+
+std::string frameName(size_t index) {
+    std::ostringstream name;
+    name << std::setw(4) << std::setfill('0') << index;
+    return name.str();
+}
+
+} // namespace
+
+Capture::Result Capture::captureFrame(const std::string& directory, const Options& options) {
+    Result result{1, 0, 0};
+    std::vector<char> buffer(64 * 1024);
+    const std::string proc = directory + "/proc";
+    const std::string sys = directory + "/sys";
+
+    std::error_code ec;
+    if (!std::filesystem::create_directories(proc, ec) && ec) {
+        throw std::runtime_error("Could not create directory: " + proc);
+    }
+    std::filesystem::create_directories(proc + "/self", ec);
+    std::filesystem::create_directories(proc + "/net", ec);
+    std::filesystem::create_directories(sys, ec);
+
+    for (const char* file : PROC_FILES) {
+        copyFile(std::string("/proc") + file, proc + file, buffer, &result);
+    }
+
+    // Per-IRQ affinity and, optionally, every process's stat
+    if (DIR* dir = opendir("/proc/irq")) {
+        while (struct dirent* entry = readdir(dir)) {
+            if (!isNumeric(entry->d_name)) continue;
+            std::string target = proc + "/irq/" + entry->d_name;
+            std::filesystem::create_directories(target, ec);
+            copyFile(std::string("/proc/irq/") + entry->d_name + "/smp_affinity_list",
+                     target + "/smp_affinity_list", buffer, &result);
+        }
+        closedir(dir);
+    }
+    if (options.processes) {
+        if (DIR* dir = opendir("/proc")) {
+            while (struct dirent* entry = readdir(dir)) {
+                if (!isNumeric(entry->d_name)) continue;
+                std::string target = proc + "/" + entry->d_name;
+                std::filesystem::create_directories(target, ec);
+                if (!copyFile(std::string("/proc/") + entry->d_name + "/stat", target + "/stat", buffer, &result)) {
+                    std::filesystem::remove_all(target, ec);    // exited meanwhile
+                }
+            }
+            closedir(dir);
+        }
+    }
+
+    for (const auto& tree : SYS_TREES) {
+        copyTree(std::string("/sys") + tree.path, sys + tree.path, tree.depth, buffer, result);
+    }
+    std::unordered_set<std::string> devices;
+    for (const char* cls : SYS_CLASSES) {
+        std::string from = std::string("/sys") + cls;
+        std::filesystem::create_directories(sys + cls, ec);
+        if (DIR* dir = opendir(from.c_str())) {
+            while (struct dirent* entry = readdir(dir)) {
+                if (entry->d_name[0] == '.') continue;
+                copyClassDevice(from + "/" + entry->d_name, sys, devices, buffer, result);
+            }
+            closedir(dir);
+        }
+    }
+
+    // Only a hierarchy mounted below /sys can be mapped into the capture
+    if (options.cgroups) {
+        std::string mountPoint = Cgroup::getMountPoint(Root());
+        if (mountPoint.compare(0, 5, "/sys/") == 0) {
+            copyCgroups(mountPoint, sys + mountPoint.substr(4), buffer, result);
+        }
+    }
+    return result;
+}
+
+Capture::Result Capture::captureFrame(const std::string& directory) {
+    return captureFrame(directory, Options());
+}
+
+Capture::Result Capture::capture(const std::string& directory) {
+    return capture(directory, Options());
+}
+
+Capture::Result Capture::capture(const std::string& directory, const Options& options) {
+    Result total{0, 0, 0};
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    std::ofstream manifest(directory + "/frames", std::ios::trunc);
+    if (!manifest) {
+        throw std::runtime_error("Could not open file: " + directory + "/frames");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.frames; ++i) {
+        if (i > 0) {
+            std::this_thread::sleep_until(start + options.interval * static_cast<int64_t>(i));
+        }
+        auto offset = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::string name = frameName(i);
+        Result frame = captureFrame(directory + "/" + name, options);
+
+        manifest << name << ' ' << offset.count() << '\n' << std::flush;
+        total.frames += 1;
+        total.files += frame.files;
+        total.bytes += frame.bytes;
+    }
+    return total;
+}
+
+Replay::Replay(const std::string& directory) : directory(directory), root(Root::at(directory + "/live")) {
+    std::ifstream manifest(directory + "/frames");
+    std::string name;
+    long long offset;
+    while (manifest >> name >> offset) {
+        frames.emplace_back(name, std::chrono::milliseconds(offset));
+    }
+    if (frames.empty()) {
+        throw std::runtime_error("Could not open file: " + directory + "/frames");
+    }
+    seek(0);
+}
+
+bool Replay::next() {
+    if (frame + 1 >= frames.size()) return false;
+    seek(frame + 1);
+    return true;
+}
+
+void Replay::seek(std::size_t index) {
+    if (index >= frames.size()) {
+        throw std::out_of_range("Unknown frame: " + std::to_string(index));
+    }
+    syncTree(directory + "/" + frames[index].first, directory + "/live", buffer);
+    frame = index;
+}
+
+} // namespace kuserspace
@@ -0,0 +1,479 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Cgroup.h"
+#include "../include/Parser.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <stdexcept>
+#include <string_view>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+
+namespace kuserspace {
+
+namespace {
+
+// Record layout returned by getdents64(2)
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+// Every Usage counter, so totals can be added and subtracted field by field
+constexpr uint64_t Cgroup::Usage::* USAGE_FIELDS[] = {
+    &Cgroup::Usage::cpuUsageUsec,
+    &Cgroup::Usage::cpuUserUsec,
+    &Cgroup::Usage::cpuSystemUsec,
+    &Cgroup::Usage::cpuPeriods,
+    &Cgroup::Usage::cpuThrottledPeriods,
+    &Cgroup::Usage::cpuThrottledUsec,
+    &Cgroup::Usage::memoryCurrent,
+    &Cgroup::Usage::memoryAnon,
+    &Cgroup::Usage::memoryFile,
+    &Cgroup::Usage::memoryKernel,
+    &Cgroup::Usage::memorySock,
+    &Cgroup::Usage::memoryShmem,
+    &Cgroup::Usage::pageFaults,
+    &Cgroup::Usage::majorPageFaults,
+    &Cgroup::Usage::ioReadBytes,
+    &Cgroup::Usage::ioWriteBytes,
+    &Cgroup::Usage::ioReads,
+    &Cgroup::Usage::ioWrites,
+};
+
+// Locate the cgroup2 mount as seen through root. mountinfo lines read
+// "id parent major:minor root mountpoint options ... - fstype source options".
+bool findUnifiedMount(const Root& view, std::string& root, std::string& mountPoint) {
+    std::ifstream mountinfo(view.procPath("/self/mountinfo"));
+    std::string line;
+    while (std::getline(mountinfo, line)) {
+        if (line.find(" - cgroup2 ") == std::string::npos) continue;
+
+        std::string_view rest = line;
+        for (int field = 0; field < 5; ++field) {
+            std::string_view token = Parser::nextToken(rest);
+            if (field == 3) root.assign(token.data(), token.size());
+            if (field == 4) mountPoint = view.resolve(std::string(token));
+        }
+        return true;
+    }
+    return false;
+}
+
+// Directory of the "0::" entry in a /proc/<pid>/cgroup file
+std::string cgroupDirectory(const std::string& cgroupFile, const Root& view) {
+    std::string relative;
+    std::ifstream cgroup(cgroupFile);
+    std::string line;
+    while (std::getline(cgroup, line)) {
+        if (line.compare(0, 3, "0::") == 0) {
+            relative = line.substr(3);
+            break;
+        }
+    }
+
+    std::string root, mountPoint;
+    if (relative.empty() || !findUnifiedMount(view, root, mountPoint)) {
+        return std::string();
+    }
+
+    // Inside a cgroup namespace the mount root may be a prefix of our path
+    if (root != "/" && relative.compare(0, root.size(), root) == 0) {
+        relative.erase(0, root.size());
+    }
+    return relative == "/" ? mountPoint : mountPoint + relative;
+}
+
+// Counter delta, treating a backwards step as no activity
+inline uint64_t delta(uint64_t current, uint64_t previous) {
+    return current >= previous ? current - previous : 0;
+}
+
+} // namespace
+
+class Cgroup::Impl {
+public:
+    struct Node {
+        Stats stats;
+        std::size_t parent;         // index in pre-order, npos for the root
+    };
+
+    static constexpr std::size_t NO_PARENT = static_cast<std::size_t>(-1);
+
+    explicit Impl(const std::string& rootPath)
+        : root(rootPath.empty() ? Cgroup::getMountPoint() : rootPath)
+        , monitoringActive(false)
+        , readBuffer(64 * 1024)
+        , direntBuffer(32 * 1024) {
+        while (root.size() > 1 && root.back() == '/') {
+            root.pop_back();
+        }
+        refresh();
+        if (!root.empty() && !available) {
+            throw std::runtime_error("Could not open directory: " + root);
+        }
+    }
+
+    void refresh() {
+        std::lock_guard<std::mutex> walkLock(walkMutex);
+        if (root.empty()) return;
+
+        auto start = std::chrono::steady_clock::now();
+        next.clear();
+
+        // Runs on monitoring and scrape threads: a vanished root empties the
+        // tree and marks it unavailable instead of throwing
+        int rootFd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (rootFd == -1) {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            nodes.clear();
+            index.clear();
+            refreshed = false;
+            available = false;
+            return;
+        }
+        walk(rootFd, "/", 0, NO_PARENT);
+        close(rootFd);
+
+        // Children follow their parent in pre-order, so a reverse pass sees
+        // every child before its parent
+        std::vector<Usage> childTotals(next.size(), Usage{});
+        for (std::size_t i = next.size(); i-- > 1;) {
+            Node& node = next[i];
+            Node& parent = next[node.parent];
+            parent.stats.children += 1;
+            parent.stats.descendants += 1 + node.stats.descendants;
+            for (auto field : USAGE_FIELDS) {
+                childTotals[node.parent].*field += node.stats.usage.*field;
+            }
+        }
+        for (std::size_t i = 0; i < next.size(); ++i) {
+            Usage& self = next[i].stats.self;
+            self = next[i].stats.usage;
+            for (auto field : USAGE_FIELDS) {
+                self.*field = delta(self.*field, childTotals[i].*field);
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        double seconds = std::chrono::duration<double>(now - lastRefresh).count();
+        std::unordered_map<std::string, std::size_t> nextIndex;
+        nextIndex.reserve(next.size());
+        for (std::size_t i = 0; i < next.size(); ++i) {
+            Stats& stats = next[i].stats;
+            nextIndex.emplace(stats.path, i);
+
+            // Only cgroups present in both walks get rates
+            auto previous = index.find(stats.path);
+            if (refreshed && seconds > 0.0 && previous != index.end()) {
+                computeRates(stats, nodes[previous->second].stats.usage, seconds);
+            }
+        }
+
+        nodes.swap(next);
+        index.swap(nextIndex);
+        lastRefresh = now;
+        refreshed = true;
+        available = true;
+        refreshDuration = now - start;
+    }
+
+    // Assigning over existing elements keeps their path strings' storage
+    void getStats(std::vector<Stats>& result) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        result.resize(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            result[i] = nodes[i].stats;
+        }
+    }
+
+    std::vector<Stats> getStats() const {
+        std::vector<Stats> result;
+        getStats(result);
+        return result;
+    }
+
+    const Node& at(const std::string& path) const {
+        auto it = index.find(path);
+        if (it == index.end()) {
+            throw std::out_of_range("Unknown cgroup: " + path);
+        }
+        return nodes[it->second];
+    }
+
+    std::vector<std::string> getChildren(const std::string& path) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = index.find(path);
+        if (it == index.end()) {
+            throw std::out_of_range("Unknown cgroup: " + path);
+        }
+        std::size_t parent = it->second;
+
+        // Descendants are contiguous after the parent in pre-order
+        std::vector<std::string> result;
+        std::size_t end = parent + 1 + nodes[parent].stats.descendants;
+        for (std::size_t i = parent + 1; i < end; ++i) {
+            if (nodes[i].parent == parent) {
+                result.push_back(nodes[i].stats.path);
+            }
+        }
+        return result;
+    }
+
+    void startMonitoring(StatsCallback callback, std::chrono::milliseconds period) {
+        if (monitoringActive) return;
+        monitoringActive = true;
+        monitoringThread = std::thread([this, callback, period]() {
+            while (monitoringActive) {
+                refresh();
+                callback(getStats());
+
+                std::unique_lock<std::mutex> lock(monitorMutex);
+                monitorCV.wait_for(lock, period, [this]() { return !monitoringActive; });
+            }
+        });
+    }
+
+    void stopMonitoring() {
+        monitoringActive = false;
+        monitorCV.notify_all();
+        if (monitoringThread.joinable()) {
+            monitoringThread.join();
+        }
+    }
+
+    std::string root;
+    std::vector<Node> nodes;
+    std::unordered_map<std::string, std::size_t> index;
+    std::chrono::steady_clock::time_point lastRefresh;
+    std::chrono::steady_clock::duration refreshDuration{};
+    bool refreshed = false;
+    bool available = false;     // the last refresh could open the root
+    mutable std::shared_mutex mutex;
+
+private:
+    void walk(int dirFd, const std::string& path, std::size_t depth, std::size_t parent) {
+        std::size_t current = next.size();
+        next.push_back(Node{Stats{}, parent});
+        next[current].stats.path = path;
+        next[current].stats.depth = depth;
+        readUsage(dirFd, next[current].stats.usage);
+
+        std::vector<std::string> names;
+        listDirectories(dirFd, names);
+        for (const auto& name : names) {
+            // A cgroup removed since the listing simply fails to open
+            int childFd = openat(dirFd, name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (childFd == -1) continue;
+            walk(childFd, path.size() == 1 ? path + name : path + "/" + name, depth + 1, current);
+            close(childFd);
+        }
+    }
+
+    void listDirectories(int dirFd, std::vector<std::string>& names) {
+        while (true) {
+            long n = syscall(SYS_getdents64, dirFd, direntBuffer.data(), direntBuffer.size());
+            if (n <= 0) break;
+
+            for (long offset = 0; offset < n;) {
+                auto* entry = reinterpret_cast<LinuxDirent64*>(direntBuffer.data() + offset);
+                offset += entry->d_reclen;
+                if (entry->d_type != DT_DIR || entry->d_name[0] == '.') continue;
+                names.emplace_back(entry->d_name);
+            }
+        }
+    }
+
+    // Read a file relative to a cgroup directory into the shared buffer
+    std::string_view readAt(int dirFd, const char* name) {
+        int fd = openat(dirFd, name, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) return std::string_view();
+
+        ssize_t n = ::read(fd, readBuffer.data(), readBuffer.size());
+        close(fd);
+        return n > 0 ? std::string_view(readBuffer.data(), static_cast<std::size_t>(n)) : std::string_view();
+    }
+
+    void readUsage(int dirFd, Usage& usage) {
+        std::string_view key;
+        uint64_t value;
+
+        std::string_view rest = readAt(dirFd, "cpu.stat");
+        while (!rest.empty()) {
+            if (!Parser::parseKeyValue(Parser::nextLine(rest), key, value)) continue;
+            if (key == "usage_usec") usage.cpuUsageUsec = value;
+            else if (key == "user_usec") usage.cpuUserUsec = value;
+            else if (key == "system_usec") usage.cpuSystemUsec = value;
+            else if (key == "nr_periods") usage.cpuPeriods = value;
+            else if (key == "nr_throttled") usage.cpuThrottledPeriods = value;
+            else if (key == "throttled_usec") usage.cpuThrottledUsec = value;
+        }
+
+        usage.memoryCurrent = Parser::toUnsigned(readAt(dirFd, "memory.current"));
+
+        // "kernel" exists since Linux 5.18; older kernels report its parts
+        uint64_t kernelStack = 0, slab = 0;
+        bool haveKernel = false;
+        rest = readAt(dirFd, "memory.stat");
+        while (!rest.empty()) {
+            if (!Parser::parseKeyValue(Parser::nextLine(rest), key, value)) continue;
+            if (key == "anon") usage.memoryAnon = value;
+            else if (key == "file") usage.memoryFile = value;
+            else if (key == "kernel") { usage.memoryKernel = value; haveKernel = true; }
+            else if (key == "kernel_stack") kernelStack = value;
+            else if (key == "slab") slab = value;
+            else if (key == "sock") usage.memorySock = value;
+            else if (key == "shmem") usage.memoryShmem = value;
+            else if (key == "pgfault") usage.pageFaults = value;
+            else if (key == "pgmajfault") usage.majorPageFaults = value;
+        }
+        if (!haveKernel) {
+            usage.memoryKernel = kernelStack + slab;
+        }
+
+        // One line per device: "8:0 rbytes=1 wbytes=2 rios=3 wios=4 dbytes=0 dios=0"
+        rest = readAt(dirFd, "io.stat");
+        while (!rest.empty()) {
+            std::string_view line = Parser::nextLine(rest);
+            Parser::nextToken(line);
+            for (auto token = Parser::nextToken(line); !token.empty(); token = Parser::nextToken(line)) {
+                std::size_t equals = token.find('=');
+                if (equals == std::string_view::npos) continue;
+                std::string_view name = token.substr(0, equals);
+                uint64_t amount = Parser::toUnsigned(token.substr(equals + 1));
+                if (name == "rbytes") usage.ioReadBytes += amount;
+                else if (name == "wbytes") usage.ioWriteBytes += amount;
+                else if (name == "rios") usage.ioReads += amount;
+                else if (name == "wios") usage.ioWrites += amount;
+            }
+        }
+    }
+
+    static void computeRates(Stats& stats, const Usage& previous, double seconds) {
+        const Usage& u = stats.usage;
+        uint64_t periods = delta(u.cpuPeriods, previous.cpuPeriods);
+
+        stats.cpuUsage = delta(u.cpuUsageUsec, previous.cpuUsageUsec) / (seconds * 1e6);
+        stats.cpuThrottledPercent = periods
+            ? 100.0 * delta(u.cpuThrottledPeriods, previous.cpuThrottledPeriods) / periods
+            : 0.0;
+        stats.memoryGrowthPerSec = (static_cast<double>(u.memoryCurrent) -
+                                    static_cast<double>(previous.memoryCurrent)) / seconds;
+        stats.majorFaultsPerSec = delta(u.majorPageFaults, previous.majorPageFaults) / seconds;
+        stats.ioReadBytesPerSec = delta(u.ioReadBytes, previous.ioReadBytes) / seconds;
+        stats.ioWriteBytesPerSec = delta(u.ioWriteBytes, previous.ioWriteBytes) / seconds;
+        stats.ioReadsPerSec = delta(u.ioReads, previous.ioReads) / seconds;
+        stats.ioWritesPerSec = delta(u.ioWrites, previous.ioWrites) / seconds;
+    }
+
+    std::vector<Node> next;             // walk in progress, swapped in when done
+    std::mutex walkMutex;
+    std::atomic<bool> monitoringActive;
+    std::thread monitoringThread;
+    std::mutex monitorMutex;
+    std::condition_variable monitorCV;
+    std::vector<char> readBuffer;
+    std::vector<char> direntBuffer;
+};
+
+// Singleton instance
+Cgroup& Cgroup::getInstance() {
+    static Cgroup instance;
+    return instance;
+}
+
+Cgroup::Cgroup(const std::string& root) : pImpl(std::make_unique<Impl>(root)) {}
+
+Cgroup::~Cgroup() {
+    pImpl->stopMonitoring();
+}
+
+std::string Cgroup::getMountPoint() {
+    return getMountPoint(Root::getDefault());
+}
+
+std::string Cgroup::getMountPoint(const Root& view) {
+    std::string root, mountPoint;
+    findUnifiedMount(view, root, mountPoint);
+    return mountPoint;
+}
+
+std::string Cgroup::getSelfPath() {
+    return getSelfPath(Root::getDefault());
+}
+
+std::string Cgroup::getSelfPath(const Root& view) {
+    return cgroupDirectory(view.procPath("/self/cgroup"), view);
+}
+
+std::string Cgroup::getProcessPath(int pid) {
+    return cgroupDirectory("/proc/" + std::to_string(pid) + "/cgroup", Root());
+}
+
+void Cgroup::refresh() {
+    pImpl->refresh();
+}
+
+std::vector<Cgroup::Stats> Cgroup::getStats() const {
+    return pImpl->getStats();
+}
+
+void Cgroup::getStats(std::vector<Stats>& stats) const {
+    pImpl->getStats(stats);
+}
+
+Cgroup::Stats Cgroup::getCgroupStats(const std::string& path) const {
+    std::shared_lock<std::shared_mutex> lock(pImpl->mutex);
+    return pImpl->at(path).stats;
+}
+
+std::vector<std::string> Cgroup::getChildren(const std::string& path) const {
+    return pImpl->getChildren(path);
+}
+
+size_t Cgroup::size() const {
+    std::shared_lock<std::shared_mutex> lock(pImpl->mutex);
+    return pImpl->nodes.size();
+}
+
+std::future<std::vector<Cgroup::Stats>> Cgroup::getStatsAsync() {
+    return std::async(std::launch::async, [this]() {
+        refresh();
+        return getStats();
+    });
+}
+
+std::chrono::steady_clock::duration Cgroup::getRefreshDuration() const {
+    std::shared_lock<std::shared_mutex> lock(pImpl->mutex);
+    return pImpl->refreshDuration;
+}
+
+const std::string& Cgroup::getRoot() const {
+    return pImpl->root;
+}
+
+bool Cgroup::isAvailable() const {
+    std::shared_lock<std::shared_mutex> lock(pImpl->mutex);
+    return pImpl->available;
+}
+
+// Continuous Monitoring
+void Cgroup::startContinuousMonitoring(StatsCallback callback, std::chrono::milliseconds interval) {
+    pImpl->startMonitoring(callback, interval);
+}
+
+void Cgroup::stopContinuousMonitoring() {
+    pImpl->stopMonitoring();
+}
+
+} // namespace kuserspace
@@ -0,0 +1,1096 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Disk.h"
+#include "../include/Buffer.h"
+#include "../include/Cgroup.h"
+#include "../include/Parser.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <filesystem>
+#include <random>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/statvfs.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <linux/io_uring.h>
+
+namespace kuserspace {
+
+namespace {
+
+constexpr uint64_t SECTOR_SIZE = 512;  // diskstats always counts 512-byte sectors
+
+// Counter delta, treating a backwards step (wrap or device reset) as no activity
+inline uint64_t delta(uint64_t current, uint64_t previous) {
+    return current >= previous ? current - previous : 0;
+}
+
+bool isPartition(const Root& root, std::string_view name) {
+    // Device names containing '/' appear with '!' in sysfs
+    std::string path = root.sysPath("/class/block/");
+    size_t prefix = path.size();
+    path.append(name.data(), name.size());
+    std::replace(path.begin() + static_cast<std::ptrdiff_t>(prefix), path.end(), '/', '!');
+    path += "/partition";
+    return access(path.c_str(), F_OK) == 0;
+}
+
+// The numa_node attribute lives on the bus device (PCI function), which may
+// be several levels above the block device, so walk up from device/.
+int deviceNumaNode(const Root& root, const std::string& blockPath) {
+    std::error_code ec;
+    auto path = std::filesystem::canonical(blockPath + "/device", ec);
+    if (ec) return -1;
+
+    const std::filesystem::path devices = root.sysPath("/devices");
+    for (; path.has_relative_path() && path != devices; path = path.parent_path()) {
+        std::string value = Parser::readAttribute((path / "numa_node").string());
+        if (!value.empty()) {
+            return std::stoi(value);
+        }
+    }
+    return -1;
+}
+
+// mountinfo escapes space, tab, newline and backslash as octal (\040)
+std::string unescapeMountField(std::string_view field) {
+    std::string result;
+    result.reserve(field.size());
+    for (size_t i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size() &&
+            field[i + 1] >= '0' && field[i + 1] <= '7') {
+            result += static_cast<char>((field[i + 1] - '0') * 64 + (field[i + 2] - '0') * 8 + (field[i + 3] - '0'));
+            i += 3;
+        } else {
+            result += field[i];
+        }
+    }
+    return result;
+}
+
+// Parse one mountinfo line:
+// 36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+bool parseMountInfo(std::string_view line, Disk::Filesystem& fs) {
+    std::string_view mountId = Parser::nextToken(line);
+    std::string_view parentId = Parser::nextToken(line);
+    std::string_view device = Parser::nextToken(line);
+    std::string_view root = Parser::nextToken(line);
+    std::string_view mountPoint = Parser::nextToken(line);
+    std::string_view options = Parser::nextToken(line);
+    if (options.empty()) return false;
+
+    // Skip optional fields up to the "-" separator
+    std::string_view token = Parser::nextToken(line);
+    while (!token.empty() && token != "-") {
+        token = Parser::nextToken(line);
+    }
+    std::string_view fsType = Parser::nextToken(line);
+    std::string_view source = Parser::nextToken(line);
+    if (fsType.empty()) return false;
+
+    size_t colon = device.find(':');
+    fs.mountId = static_cast<int>(Parser::toUnsigned(mountId));
+    fs.parentId = static_cast<int>(Parser::toUnsigned(parentId));
+    fs.major = static_cast<unsigned int>(Parser::toUnsigned(device));
+    fs.minor = colon == std::string_view::npos ? 0 : static_cast<unsigned int>(Parser::toUnsigned(device.substr(colon + 1)));
+    fs.root = unescapeMountField(root);
+    fs.mountPoint = unescapeMountField(mountPoint);
+    fs.options = std::string(options);
+    fs.fsType = std::string(fsType);
+    fs.source = unescapeMountField(source);
+    fs.readOnly = options.compare(0, 2, "ro") == 0 && (options.size() == 2 || options[2] == ',');
+    return true;
+}
+
+// Minimal io_uring instance driven through the raw syscalls, enough for the
+// latency probe: one SQE per request, user_data carries the request slot.
+class Uring {
+public:
+    ~Uring() {
+        if (sqEntries) munmap(sqEntries, sqEntriesSize);
+        if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing) munmap(sqRing, sqRingSize);
+        if (fd != -1) close(fd);
+    }
+
+    bool init(unsigned int entries) {
+        io_uring_params params{};
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            fd = -1;
+            return false;
+        }
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+
+        sqRing = mapRing(sqRingSize, IORING_OFF_SQ_RING);
+        if (!sqRing) return false;
+        cqRing = singleMmap ? sqRing : mapRing(cqRingSize, IORING_OFF_CQ_RING);
+        if (!cqRing) return false;
+        sqEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqEntries = static_cast<io_uring_sqe*>(mapRing(sqEntriesSize, IORING_OFF_SQES));
+        if (!sqEntries) return false;
+
+        char* sq = static_cast<char*>(sqRing);
+        sqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+        sqSize = params.sq_entries;
+
+        char* cq = static_cast<char*>(cqRing);
+        cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Queue a read; false if the submission ring is full
+    bool prepareRead(int file, void* buffer, unsigned int length, uint64_t offset, uint64_t userData) {
+        unsigned int tail = *sqTail;
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqSize) return false;
+
+        unsigned int index = tail & sqMask;
+        io_uring_sqe& sqe = sqEntries[index];
+        sqe = io_uring_sqe{};
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = file;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = length;
+        sqe.off = offset;
+        sqe.user_data = userData;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++queued;
+        return true;
+    }
+
+    // Submit queued reads and wait for at least minComplete completions
+    bool submitAndWait(unsigned int minComplete) {
+        unsigned int toSubmit = queued;
+        queued = 0;
+        while (true) {
+            long ret = syscall(__NR_io_uring_enter, fd, toSubmit, minComplete,
+                               minComplete ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if (ret >= 0) return true;
+            if (errno != EINTR) return false;
+            toSubmit = 0;
+        }
+    }
+
+    bool reap(uint64_t& userData, int& result) {
+        unsigned int head = *cqHead;
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) return false;
+
+        const io_uring_cqe& cqe = cqes[head & cqMask];
+        userData = cqe.user_data;
+        result = cqe.res;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    void* mapRing(size_t size, off_t offset) {
+        void* ring = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return ring == MAP_FAILED ? nullptr : ring;
+    }
+
+    int fd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    io_uring_sqe* sqEntries = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    size_t sqEntriesSize = 0;
+
+    unsigned int* sqHead = nullptr;
+    unsigned int* sqTail = nullptr;
+    unsigned int* sqArray = nullptr;
+    unsigned int sqMask = 0;
+    unsigned int sqSize = 0;
+    unsigned int queued = 0;
+
+    unsigned int* cqHead = nullptr;
+    unsigned int* cqTail = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned int cqMask = 0;
+};
+
+void fillPercentiles(Disk::LatencyStats& stats) {
+    const Histogram& h = stats.histogram;
+    stats.samples = h.getCount();
+    stats.meanUs = h.getMean() / 1000.0;
+    stats.minUs = h.getMin() / 1000.0;
+    stats.maxUs = h.getMax() / 1000.0;
+    stats.p50Us = h.getPercentile(50.0) / 1000.0;
+    stats.p99Us = h.getPercentile(99.0) / 1000.0;
+    stats.p999Us = h.getPercentile(99.9) / 1000.0;
+}
+
+bool sameQueue(const Disk::QueueInfo& a, const Disk::QueueInfo& b) {
+    if (a.name != b.name || a.rotational != b.rotational || a.nrRequests != b.nrRequests ||
+        a.scheduler != b.scheduler || a.availableSchedulers != b.availableSchedulers ||
+        a.maxSectorsKb != b.maxSectorsKb || a.logicalBlockSize != b.logicalBlockSize ||
+        a.physicalBlockSize != b.physicalBlockSize || a.writeCache != b.writeCache ||
+        a.numaNode != b.numaNode || a.hardwareQueues.size() != b.hardwareQueues.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.hardwareQueues.size(); ++i) {
+        if (a.hardwareQueues[i].id != b.hardwareQueues[i].id ||
+            a.hardwareQueues[i].cpus != b.hardwareQueues[i].cpus) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+class Disk::Impl {
+public:
+    explicit Impl(const Root& root) : root(root), monitoringActive(false) {
+        diskstats.open(root.procPath("/diskstats"));
+        cpuNodes = Parser::readCpuNodes(root.sysPath("/devices/system/node"));
+        sample();
+    }
+
+    void sample() {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+
+        auto content = diskstats.read();
+        if (!content) return;
+
+        auto now = std::chrono::steady_clock::now();
+        bool first = !sampled;
+        interval = now - lastSample;
+        lastSample = now;
+        sampled = true;
+        double seconds = std::chrono::duration<double>(interval).count();
+
+        size_t count = 0;
+        std::string_view rest = *content;
+        while (!rest.empty()) {
+            std::string_view line = Parser::nextLine(rest);
+            size_t numFields = Parser::splitFields(line, fields);
+            if (numFields < 14) continue;
+
+            DeviceStats& device = findDevice(fields[2], count++);
+            Counters previous = device.counters;
+            Counters& c = device.counters;
+
+            c.readsCompleted = Parser::toUnsigned(fields[3]);
+            c.readsMerged = Parser::toUnsigned(fields[4]);
+            c.sectorsRead = Parser::toUnsigned(fields[5]);
+            c.readTimeMs = Parser::toUnsigned(fields[6]);
+            c.writesCompleted = Parser::toUnsigned(fields[7]);
+            c.writesMerged = Parser::toUnsigned(fields[8]);
+            c.sectorsWritten = Parser::toUnsigned(fields[9]);
+            c.writeTimeMs = Parser::toUnsigned(fields[10]);
+            c.ioInProgress = Parser::toUnsigned(fields[11]);
+            c.ioTimeMs = Parser::toUnsigned(fields[12]);
+            c.weightedIoTimeMs = Parser::toUnsigned(fields[13]);
+            if (numFields >= 18) {
+                c.discardsCompleted = Parser::toUnsigned(fields[14]);
+                c.discardsMerged = Parser::toUnsigned(fields[15]);
+                c.sectorsDiscarded = Parser::toUnsigned(fields[16]);
+                c.discardTimeMs = Parser::toUnsigned(fields[17]);
+            }
+            if (numFields >= 20) {
+                c.flushesCompleted = Parser::toUnsigned(fields[18]);
+                c.flushTimeMs = Parser::toUnsigned(fields[19]);
+            }
+
+            device.major = static_cast<unsigned int>(Parser::toUnsigned(fields[0]));
+            device.minor = static_cast<unsigned int>(Parser::toUnsigned(fields[1]));
+
+            // A device that just appeared has no previous counters to rate against
+            if (!first && !device.fresh && seconds > 0.0) {
+                computeRates(device, previous, seconds);
+            }
+        }
+
+        // Devices that disappeared were moved past the end by findDevice
+        devices.erase(devices.begin() + static_cast<std::ptrdiff_t>(count), devices.end());
+    }
+
+    // Assigning over existing elements keeps their name strings' storage
+    void getStats(std::vector<DeviceStats>& result, Filter filter) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        size_t count = 0;
+        for (const auto& device : devices) {
+            if (filter == Filter::WholeDisks && device.partition) continue;
+            if (filter == Filter::Partitions && !device.partition) continue;
+            if (count == result.size()) {
+                result.push_back(device);
+            } else {
+                result[count] = device;
+            }
+            ++count;
+        }
+        result.resize(count);
+    }
+
+    std::vector<DeviceStats> getStats(Filter filter) const {
+        std::vector<DeviceStats> result;
+        getStats(result, filter);
+        return result;
+    }
+
+    DeviceStats getDeviceStats(const std::string& name) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (const auto& device : devices) {
+            if (device.name == name) return device;
+        }
+        throw std::out_of_range("Unknown block device: " + name);
+    }
+
+    std::chrono::steady_clock::duration getInterval() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return interval;
+    }
+
+    LatencyStats kernelLatency(const std::string& name) const {
+        DeviceStats device = getDeviceStats(name);
+        LatencyStats stats{};
+        stats.device = name;
+        stats.source = LatencySource::None;
+
+        // io.latency adds avg_lat (microseconds) to the device's io.stat line
+        std::string cgroup = Cgroup::getSelfPath(root);
+        PersistentFile ioStat;
+        if (!cgroup.empty() && ioStat.open(cgroup + "/io.stat")) {
+            std::string id = std::to_string(device.major) + ":" + std::to_string(device.minor);
+            auto content = ioStat.read();
+            std::string_view rest = content ? *content : std::string_view();
+            while (!rest.empty()) {
+                std::string_view line = Parser::nextLine(rest);
+                if (Parser::nextToken(line) != id) continue;
+                for (std::string_view token = Parser::nextToken(line); !token.empty();
+                     token = Parser::nextToken(line)) {
+                    if (token.substr(0, 8) == "avg_lat=") {
+                        stats.source = LatencySource::CgroupIoStat;
+                        stats.meanOnly = true;
+                        stats.meanUs = static_cast<double>(Parser::toUnsigned(token.substr(8)));
+                        return stats;
+                    }
+                }
+            }
+        }
+
+        // Polled-I/O statistics, one line per direction and request size (nanoseconds):
+        //   read  (4096 Bytes): samples=12, mean=8100, min=7000, max=9900
+        std::string sysfsName = name;
+        std::replace(sysfsName.begin(), sysfsName.end(), '/', '!');
+        PersistentFile pollStat;
+        if (pollStat.open(root.sysPath("/kernel/debug/block/" + sysfsName + "/poll_stat"))) {
+            auto content = pollStat.read();
+            std::string_view rest = content ? *content : std::string_view();
+            double weighted = 0.0;
+            uint64_t minNs = UINT64_MAX, maxNs = 0;
+            while (!rest.empty()) {
+                std::string_view line = Parser::nextLine(rest);
+                uint64_t samples = 0, mean = 0, min = 0, max = 0;
+                for (std::string_view token = Parser::nextToken(line); !token.empty();
+                     token = Parser::nextToken(line)) {
+                    if (token.substr(0, 8) == "samples=") samples = Parser::toUnsigned(token.substr(8));
+                    else if (token.substr(0, 5) == "mean=") mean = Parser::toUnsigned(token.substr(5));
+                    else if (token.substr(0, 4) == "min=") min = Parser::toUnsigned(token.substr(4));
+                    else if (token.substr(0, 4) == "max=") max = Parser::toUnsigned(token.substr(4));
+                }
+                if (samples == 0) continue;
+                stats.samples += samples;
+                weighted += static_cast<double>(mean) * samples;
+                minNs = std::min(minNs, min);
+                maxNs = std::max(maxNs, max);
+            }
+            if (stats.samples) {
+                stats.source = LatencySource::DebugfsPollStat;
+                stats.meanUs = weighted / stats.samples / 1000.0;
+                stats.minUs = minNs / 1000.0;
+                stats.maxUs = maxNs / 1000.0;
+            }
+        }
+        return stats;
+    }
+
+    LatencyStats runProbe(const LatencyProbe& probe) const {
+        if (probe.blockSize == 0 || probe.blockSize % 512 != 0) {
+            throw std::invalid_argument("Probe block size must be a multiple of 512");
+        }
+
+        int file = open(probe.testFile.c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+        if (file == -1) {
+            if (errno == EINVAL) {
+                throw std::runtime_error("O_DIRECT not supported for: " + probe.testFile);
+            }
+            throw std::runtime_error("Could not open file: " + probe.testFile);
+        }
+        std::unique_ptr<int, void (*)(int*)> fileGuard(&file, [](int* fd) { close(*fd); });
+
+        struct stat info;
+        if (fstat(file, &info) == -1) {
+            throw std::runtime_error("Could not stat file: " + probe.testFile);
+        }
+        uint64_t blocks = static_cast<uint64_t>(info.st_size) / probe.blockSize;
+        if (blocks == 0) {
+            throw std::runtime_error("Probe file is smaller than one block: " + probe.testFile);
+        }
+
+        LatencyStats stats{};
+        stats.source = LatencySource::Probe;
+        stats.device = deviceName(major(info.st_dev), minor(info.st_dev));
+
+        unsigned int depth = std::max(1u, probe.queueDepth);
+        void* memory = nullptr;
+        if (posix_memalign(&memory, 4096, static_cast<size_t>(depth) * probe.blockSize) != 0) {
+            throw std::bad_alloc();
+        }
+        std::unique_ptr<char, void (*)(void*)> buffers(static_cast<char*>(memory), free);
+
+        std::mt19937_64 random(std::random_device{}());
+        std::uniform_int_distribution<uint64_t> pickBlock(0, blocks - 1);
+        auto deadline = std::chrono::steady_clock::now() + probe.duration;
+        uint64_t issued = 0;
+        auto more = [&]() {
+            return (probe.maxRequests == 0 || issued < probe.maxRequests)
+                && std::chrono::steady_clock::now() < deadline;
+        };
+
+        Uring ring;
+        if (ring.init(depth) && uringProbe(ring, file, probe, depth, buffers.get(),
+                                           random, pickBlock, issued, more, stats.histogram)) {
+            fillPercentiles(stats);
+            return stats;
+        }
+
+        // Synchronous fallback for kernels without io_uring (or IORING_OP_READ)
+        while (more()) {
+            uint64_t offset = pickBlock(random) * probe.blockSize;
+            auto start = std::chrono::steady_clock::now();
+            ssize_t n = pread(file, buffers.get(), probe.blockSize, static_cast<off_t>(offset));
+            auto end = std::chrono::steady_clock::now();
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Probe read failed: " + probe.testFile);
+            }
+            ++issued;
+            stats.histogram.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        }
+        fillPercentiles(stats);
+        return stats;
+    }
+
+    bool refreshTopology() {
+        std::vector<QueueInfo> current = readTopology();
+
+        std::unique_lock<std::shared_mutex> lock(topologyMutex);
+        topologyLoaded = true;
+        bool changed = current.size() != topology.size() ||
+                       !std::equal(current.begin(), current.end(), topology.begin(), sameQueue);
+        if (changed) {
+            topology = std::move(current);
+            ++topologyGeneration;
+        }
+        return changed;
+    }
+
+    std::vector<QueueInfo> getTopology() {
+        ensureTopology();
+        std::shared_lock<std::shared_mutex> lock(topologyMutex);
+        return topology;
+    }
+
+    QueueInfo getQueueInfo(const std::string& name) {
+        ensureTopology();
+        std::shared_lock<std::shared_mutex> lock(topologyMutex);
+        for (const auto& queue : topology) {
+            if (queue.name == name) return queue;
+        }
+        throw std::out_of_range("Unknown block device: " + name);
+    }
+
+    uint64_t getTopologyGeneration() const {
+        std::shared_lock<std::shared_mutex> lock(topologyMutex);
+        return topologyGeneration;
+    }
+
+    // Re-parse mountinfo if the kernel flagged a change (or on first use),
+    // then refresh every mount's capacity.
+    void refreshFilesystems() {
+        std::lock_guard<std::mutex> lock(mountinfoMutex);
+        if (!mountinfo.isOpen()) {
+            mountinfo.open(root.procPath("/self/mountinfo"));
+        }
+
+        struct pollfd pfd = {mountinfo.getFd(), POLLPRI, 0};
+        bool changed = !mountsLoaded || (pfd.fd != -1 && poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLPRI | POLLERR)));
+        if (changed) {
+            reloadMounts();
+        }
+        updateCapacity();
+    }
+
+    void startFilesystemMonitoring(std::chrono::milliseconds period) {
+        if (filesystemMonitoringActive) return;
+        refreshFilesystems();
+
+        wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        filesystemMonitoringActive = true;
+        filesystemThread = std::thread([this, period]() {
+            auto nextRefresh = std::chrono::steady_clock::now() + period;
+            while (filesystemMonitoringActive) {
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    nextRefresh - std::chrono::steady_clock::now());
+
+                // Mount changes wake us immediately via POLLPRI on the mountinfo fd
+                struct pollfd fds[2] = {{mountinfo.getFd(), POLLPRI, 0}, {wakeFd, POLLIN, 0}};
+                int ready = poll(fds, 2, static_cast<int>(std::max<int64_t>(remaining.count(), 0)));
+                if (!filesystemMonitoringActive) break;
+
+                std::lock_guard<std::mutex> lock(mountinfoMutex);
+                if (ready > 0 && (fds[0].revents & (POLLPRI | POLLERR))) {
+                    reloadMounts();
+                    updateCapacity();
+                }
+                if (std::chrono::steady_clock::now() >= nextRefresh) {
+                    updateCapacity();
+                    nextRefresh = std::chrono::steady_clock::now() + period;
+                }
+            }
+        });
+    }
+
+    void stopFilesystemMonitoring() {
+        if (!filesystemMonitoringActive) return;
+        filesystemMonitoringActive = false;
+        uint64_t one = 1;
+        ssize_t written = ::write(wakeFd, &one, sizeof(one));
+        (void)written;
+        if (filesystemThread.joinable()) {
+            filesystemThread.join();
+        }
+        ::close(wakeFd);
+        wakeFd = -1;
+    }
+
+    std::vector<Filesystem> getFilesystems() {
+        ensureFilesystems();
+        std::shared_lock<std::shared_mutex> lock(filesystemMutex);
+        return filesystems;
+    }
+
+    Filesystem getFilesystem(const std::string& path) {
+        ensureFilesystems();
+        std::shared_lock<std::shared_mutex> lock(filesystemMutex);
+        return filesystems[findMount(path)];
+    }
+
+    uint64_t getAvailableBytes(const std::string& path) {
+        ensureFilesystems();
+        std::shared_lock<std::shared_mutex> lock(filesystemMutex);
+        return filesystems[findMount(path)].availableBytes;
+    }
+
+    uint64_t getAvailableInodes(const std::string& path) {
+        ensureFilesystems();
+        std::shared_lock<std::shared_mutex> lock(filesystemMutex);
+        return filesystems[findMount(path)].availableInodes;
+    }
+
+    void startMonitoring(StatsCallback callback, std::chrono::milliseconds period, Filter filter) {
+        if (monitoringActive) return;
+        monitoringActive = true;
+        monitoringThread = std::thread([this, callback, period, filter]() {
+            while (monitoringActive) {
+                sample();
+                callback(getStats(filter));
+
+                std::unique_lock<std::mutex> lock(monitorMutex);
+                monitorCV.wait_for(lock, period, [this]() { return !monitoringActive; });
+            }
+        });
+    }
+
+    void stopMonitoring() {
+        monitoringActive = false;
+        monitorCV.notify_all();
+        if (monitoringThread.joinable()) {
+            monitoringThread.join();
+        }
+    }
+
+private:
+    // Devices are kept in /proc/diskstats order, so the expected device is
+    // normally already at position `index` and no lookup is needed.
+    DeviceStats& findDevice(std::string_view name, size_t index) {
+        if (index < devices.size() && devices[index].name == name) {
+            devices[index].fresh = false;
+            return devices[index];
+        }
+
+        for (size_t i = index + 1; i < devices.size(); ++i) {
+            if (devices[i].name == name) {
+                std::swap(devices[index], devices[i]);
+                devices[index].fresh = false;
+                return devices[index];
+            }
+        }
+
+        DeviceStats device{};
+        device.name.assign(name.data(), name.size());
+        device.partition = isPartition(root, name);
+        device.fresh = true;
+        return *devices.insert(devices.begin() + static_cast<std::ptrdiff_t>(index), std::move(device));
+    }
+
+    void ensureFilesystems() {
+        {
+            std::shared_lock<std::shared_mutex> lock(filesystemMutex);
+            if (mountsLoaded) return;
+        }
+        refreshFilesystems();
+    }
+
+    void reloadMounts() {
+        auto content = mountinfo.read();
+        if (!content) return;
+
+        std::vector<Filesystem> current;
+        std::string_view rest = *content;
+        while (!rest.empty()) {
+            Filesystem fs{};
+            if (parseMountInfo(Parser::nextLine(rest), fs)) {
+                current.push_back(std::move(fs));
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(filesystemMutex);
+
+        // Keep the last known capacity of mounts that are still present
+        std::unordered_map<int, const Filesystem*> previous;
+        for (const auto& fs : filesystems) {
+            previous[fs.mountId] = &fs;
+        }
+        for (auto& fs : current) {
+            auto it = previous.find(fs.mountId);
+            if (it == previous.end()) continue;
+            const Filesystem& old = *it->second;
+            fs.blockSize = old.blockSize;
+            fs.totalBytes = old.totalBytes;
+            fs.freeBytes = old.freeBytes;
+            fs.availableBytes = old.availableBytes;
+            fs.totalInodes = old.totalInodes;
+            fs.freeInodes = old.freeInodes;
+            fs.availableInodes = old.availableInodes;
+            fs.updated = old.updated;
+        }
+
+        // Later entries shadow earlier ones mounted on the same point
+        mountIndex.clear();
+        for (size_t i = 0; i < current.size(); ++i) {
+            mountIndex[current[i].mountPoint] = i;
+        }
+        filesystems = std::move(current);
+        mountsLoaded = true;
+    }
+
+    // statvfs() runs without holding the lock; results are matched back by mount id
+    void updateCapacity() {
+        std::vector<std::pair<int, std::string>> mounts;
+        {
+            std::shared_lock<std::shared_mutex> lock(filesystemMutex);
+            mounts.reserve(filesystems.size());
+            for (const auto& fs : filesystems) {
+                mounts.emplace_back(fs.mountId, fs.mountPoint);
+            }
+        }
+
+        std::vector<std::pair<int, struct statvfs>> results;
+        results.reserve(mounts.size());
+        for (const auto& [mountId, mountPoint] : mounts) {
+            struct statvfs st;
+            if (statvfs(mountPoint.c_str(), &st) == 0) {
+                results.emplace_back(mountId, st);
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        std::unique_lock<std::shared_mutex> lock(filesystemMutex);
+        size_t position = 0;
+        for (const auto& [mountId, st] : results) {
+            // Both lists are in mount table order, so this is normally a single step
+            while (position < filesystems.size() && filesystems[position].mountId != mountId) {
+                ++position;
+            }
+            if (position == filesystems.size()) break;
+
+            Filesystem& fs = filesystems[position];
+            uint64_t fragment = st.f_frsize ? st.f_frsize : st.f_bsize;
+            fs.blockSize = st.f_bsize;
+            fs.totalBytes = static_cast<uint64_t>(st.f_blocks) * fragment;
+            fs.freeBytes = static_cast<uint64_t>(st.f_bfree) * fragment;
+            fs.availableBytes = static_cast<uint64_t>(st.f_bavail) * fragment;
+            fs.totalInodes = st.f_files;
+            fs.freeInodes = st.f_ffree;
+            fs.availableInodes = st.f_favail;
+            fs.updated = now;
+        }
+    }
+
+    // Index of the mount containing path: exact mount points hit the first
+    // lookup, other paths walk up one component at a time
+    size_t findMount(const std::string& path) const {
+        auto it = mountIndex.find(path);
+        if (it != mountIndex.end()) return it->second;
+
+        std::string candidate = path;
+        while (candidate.size() > 1) {
+            size_t slash = candidate.find_last_of('/');
+            if (slash == std::string::npos) break;
+            candidate.resize(slash == 0 ? 1 : slash);
+            it = mountIndex.find(candidate);
+            if (it != mountIndex.end()) return it->second;
+        }
+        throw std::out_of_range("No filesystem mounted for path: " + path);
+    }
+
+    void ensureTopology() {
+        {
+            std::shared_lock<std::shared_mutex> lock(topologyMutex);
+            if (topologyLoaded) return;
+        }
+        refreshTopology();
+    }
+
+    int nodeOf(int cpu) const {
+        return cpu >= 0 && static_cast<size_t>(cpu) < cpuNodes.size() ? cpuNodes[static_cast<size_t>(cpu)] : -1;
+    }
+
+    std::vector<QueueInfo> readTopology() const {
+        std::vector<QueueInfo> result;
+        DIR* dir = opendir(root.sysPath("/block").c_str());
+        if (!dir) return result;
+
+        while (struct dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') continue;
+
+            std::string base = root.sysPath("/block/") + entry->d_name;
+            std::string queue = base + "/queue/";
+
+            QueueInfo info{};
+            info.name = entry->d_name;
+            info.rotational = Parser::readAttribute(queue + "rotational") == "1";
+            info.nrRequests = static_cast<unsigned int>(Parser::toUnsigned(Parser::readAttribute(queue + "nr_requests")));
+            info.maxSectorsKb = static_cast<unsigned int>(Parser::toUnsigned(Parser::readAttribute(queue + "max_sectors_kb")));
+            info.logicalBlockSize = static_cast<unsigned int>(Parser::toUnsigned(Parser::readAttribute(queue + "logical_block_size")));
+            info.physicalBlockSize = static_cast<unsigned int>(Parser::toUnsigned(Parser::readAttribute(queue + "physical_block_size")));
+            info.writeCache = Parser::readAttribute(queue + "write_cache") == "write back";
+            info.numaNode = deviceNumaNode(root, base);
+
+            // "none [mq-deadline] kyber": the bracketed entry is active
+            std::string schedulers = Parser::readAttribute(queue + "scheduler");
+            std::string_view rest = schedulers;
+            for (auto token = Parser::nextToken(rest); !token.empty(); token = Parser::nextToken(rest)) {
+                bool active = token.front() == '[' && token.back() == ']';
+                if (active) {
+                    token = token.substr(1, token.size() - 2);
+                }
+                info.availableSchedulers.emplace_back(token);
+                if (active || info.availableSchedulers.size() == 1) {
+                    info.scheduler = std::string(token);
+                }
+            }
+
+            // One mq/<n> directory per blk-mq hardware queue
+            if (DIR* mq = opendir((base + "/mq").c_str())) {
+                while (struct dirent* hctx = readdir(mq)) {
+                    if (!std::isdigit(static_cast<unsigned char>(hctx->d_name[0]))) continue;
+
+                    HardwareQueue hardwareQueue{};
+                    hardwareQueue.id = static_cast<int>(Parser::toUnsigned(hctx->d_name));
+                    hardwareQueue.cpus = Parser::parseCpuList(
+                        Parser::readAttribute(base + "/mq/" + hctx->d_name + "/cpu_list"));
+
+                    for (int cpu : hardwareQueue.cpus) {
+                        int node = nodeOf(cpu);
+                        if (node < 0) continue;
+                        if (std::find(hardwareQueue.numaNodes.begin(), hardwareQueue.numaNodes.end(), node) ==
+                            hardwareQueue.numaNodes.end()) {
+                            hardwareQueue.numaNodes.push_back(node);
+                        }
+                        if (info.numaNode >= 0 && node != info.numaNode) {
+                            hardwareQueue.crossNode = true;
+                        }
+                    }
+                    std::sort(hardwareQueue.numaNodes.begin(), hardwareQueue.numaNodes.end());
+                    info.crossNodeQueues += hardwareQueue.crossNode ? 1 : 0;
+                    info.hardwareQueues.push_back(std::move(hardwareQueue));
+                }
+                closedir(mq);
+            }
+            std::sort(info.hardwareQueues.begin(), info.hardwareQueues.end(),
+                      [](const HardwareQueue& a, const HardwareQueue& b) { return a.id < b.id; });
+            info.nrHwQueues = static_cast<unsigned int>(info.hardwareQueues.size());
+
+            result.push_back(std::move(info));
+        }
+        closedir(dir);
+
+        std::sort(result.begin(), result.end(),
+                  [](const QueueInfo& a, const QueueInfo& b) { return a.name < b.name; });
+        return result;
+    }
+
+    // Keep queueDepth reads in flight; false if the ring cannot do plain reads
+    template <typename More>
+    static bool uringProbe(Uring& ring, int file, const LatencyProbe& probe, unsigned int depth,
+                           char* buffers, std::mt19937_64& random,
+                           std::uniform_int_distribution<uint64_t>& pickBlock,
+                           uint64_t& issued, More more, Histogram& histogram) {
+        std::vector<std::chrono::steady_clock::time_point> started(depth);
+        unsigned int inflight = 0;
+        int failure = 0;
+
+        auto issue = [&](unsigned int slot) {
+            uint64_t offset = pickBlock(random) * probe.blockSize;
+            started[slot] = std::chrono::steady_clock::now();
+            ring.prepareRead(file, buffers + static_cast<size_t>(slot) * probe.blockSize,
+                             probe.blockSize, offset, slot);
+            ++inflight;
+            ++issued;
+        };
+
+        for (unsigned int slot = 0; slot < depth && more(); ++slot) {
+            issue(slot);
+        }
+        while (inflight) {
+            if (!ring.submitAndWait(1)) {
+                if (histogram.getCount() == 0) {
+                    issued = 0;
+                    return false;
+                }
+                throw std::runtime_error("io_uring_enter failed for: " + probe.testFile);
+            }
+
+            uint64_t slot;
+            int result;
+            while (ring.reap(slot, result)) {
+                auto end = std::chrono::steady_clock::now();
+                --inflight;
+                if (result < 0) {
+                    failure = -result;
+                    continue;
+                }
+                histogram.record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - started[slot]).count()));
+                if (!failure && more()) {
+                    issue(static_cast<unsigned int>(slot));
+                }
+            }
+        }
+
+        if (failure) {
+            // Kernels before 5.6 reject IORING_OP_READ; let the caller fall back
+            if (failure == EINVAL && histogram.getCount() == 0) {
+                issued = 0;
+                return false;
+            }
+            throw std::runtime_error("Probe read failed: " + probe.testFile);
+        }
+        return true;
+    }
+
+    std::string deviceName(unsigned int major, unsigned int minor) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (const auto& device : devices) {
+            if (device.major == major && device.minor == minor) return device.name;
+        }
+        return std::to_string(major) + ":" + std::to_string(minor);
+    }
+
+    static void computeRates(DeviceStats& device, const Counters& previous, double seconds) {
+        const Counters& c = device.counters;
+        double intervalMs = seconds * 1000.0;
+
+        uint64_t reads = delta(c.readsCompleted, previous.readsCompleted);
+        uint64_t writes = delta(c.writesCompleted, previous.writesCompleted);
+
+        device.readIops = reads / seconds;
+        device.writeIops = writes / seconds;
+        device.discardIops = delta(c.discardsCompleted, previous.discardsCompleted) / seconds;
+        device.flushIops = delta(c.flushesCompleted, previous.flushesCompleted) / seconds;
+        device.readBytesPerSec = delta(c.sectorsRead, previous.sectorsRead) * SECTOR_SIZE / seconds;
+        device.writeBytesPerSec = delta(c.sectorsWritten, previous.sectorsWritten) * SECTOR_SIZE / seconds;
+        device.discardBytesPerSec = delta(c.sectorsDiscarded, previous.sectorsDiscarded) * SECTOR_SIZE / seconds;
+        device.avgQueueDepth = delta(c.weightedIoTimeMs, previous.weightedIoTimeMs) / intervalMs;
+        device.readAwaitMs = reads ? static_cast<double>(delta(c.readTimeMs, previous.readTimeMs)) / reads : 0.0;
+        device.writeAwaitMs = writes ? static_cast<double>(delta(c.writeTimeMs, previous.writeTimeMs)) / writes : 0.0;
+        device.utilization = std::min(100.0, 100.0 * delta(c.ioTimeMs, previous.ioTimeMs) / intervalMs);
+    }
+
+    Root root;
+    std::vector<int> cpuNodes;      // node of each CPU of this Root, read once
+    PersistentFile diskstats;
+    std::vector<DeviceStats> devices;
+    std::vector<std::string_view> fields;
+    std::chrono::steady_clock::time_point lastSample;
+    std::chrono::steady_clock::duration interval{};
+    bool sampled = false;
+    mutable std::shared_mutex mutex;
+
+    PersistentFile mountinfo;
+    std::vector<Filesystem> filesystems;
+    std::unordered_map<std::string, size_t> mountIndex;
+    bool mountsLoaded = false;
+    mutable std::shared_mutex filesystemMutex;
+    std::mutex mountinfoMutex;      // serializes mountinfo reads and capacity refreshes
+    std::atomic<bool> filesystemMonitoringActive{false};
+    std::thread filesystemThread;
+    int wakeFd = -1;
+
+    std::vector<QueueInfo> topology;
+    uint64_t topologyGeneration = 0;
+    bool topologyLoaded = false;
+    mutable std::shared_mutex topologyMutex;
+
+    std::atomic<bool> monitoringActive;
+    std::thread monitoringThread;
+    std::mutex monitorMutex;
+    std::condition_variable monitorCV;
+};
+
+// Singleton instance
+Disk& Disk::getInstance() {
+    static Disk instance;
+    return instance;
+}
+
+Disk::Disk(const Root& root) : pImpl(std::make_unique<Impl>(root)) {}
+
+Disk::~Disk() {
+    pImpl->stopMonitoring();
+    pImpl->stopFilesystemMonitoring();
+}
+
+void Disk::refresh() {
+    pImpl->sample();
+}
+
+std::vector<Disk::DeviceStats> Disk::getStats(Filter filter) const {
+    return pImpl->getStats(filter);
+}
+
+void Disk::getStats(std::vector<DeviceStats>& devices, Filter filter) const {
+    pImpl->getStats(devices, filter);
+}
+
+Disk::DeviceStats Disk::getDeviceStats(const std::string& name) const {
+    return pImpl->getDeviceStats(name);
+}
+
+std::future<std::vector<Disk::DeviceStats>> Disk::getStatsAsync(Filter filter) {
+    return std::async(std::launch::async, [this, filter]() {
+        refresh();
+        return getStats(filter);
+    });
+}
+
+std::chrono::steady_clock::duration Disk::getInterval() const {
+    return pImpl->getInterval();
+}
+
+// Queue Topology
+bool Disk::refreshQueueTopology() {
+    return pImpl->refreshTopology();
+}
+
+std::vector<Disk::QueueInfo> Disk::getQueueTopology() const {
+    return pImpl->getTopology();
+}
+
+Disk::QueueInfo Disk::getQueueInfo(const std::string& name) const {
+    return pImpl->getQueueInfo(name);
+}
+
+uint64_t Disk::getQueueTopologyGeneration() const {
+    return pImpl->getTopologyGeneration();
+}
+
+// Filesystems
+void Disk::refreshFilesystems() {
+    pImpl->refreshFilesystems();
+}
+
+void Disk::startFilesystemMonitoring(std::chrono::milliseconds interval) {
+    pImpl->startFilesystemMonitoring(interval);
+}
+
+void Disk::stopFilesystemMonitoring() {
+    pImpl->stopFilesystemMonitoring();
+}
+
+std::vector<Disk::Filesystem> Disk::getFilesystems() const {
+    return pImpl->getFilesystems();
+}
+
+Disk::Filesystem Disk::getFilesystem(const std::string& path) const {
+    return pImpl->getFilesystem(path);
+}
+
+uint64_t Disk::getAvailableBytes(const std::string& path) const {
+    return pImpl->getAvailableBytes(path);
+}
+
+uint64_t Disk::getAvailableInodes(const std::string& path) const {
+    return pImpl->getAvailableInodes(path);
+}
+
+// Latency
+Disk::LatencyStats Disk::getKernelLatency(const std::string& name) const {
+    return pImpl->kernelLatency(name);
+}
+
+Disk::LatencyStats Disk::probeLatency(const LatencyProbe& probe) const {
+    return pImpl->runProbe(probe);
+}
+
+Disk::LatencyStats Disk::measureLatency(const std::string& name, const LatencyProbe& probe) const {
+    LatencyStats stats = pImpl->kernelLatency(name);
+    if (stats.source != LatencySource::None) {
+        return stats;
+    }
+    return pImpl->runProbe(probe);
+}
+
+// Continuous Monitoring
+void Disk::startContinuousMonitoring(StatsCallback callback, std::chrono::milliseconds interval, Filter filter) {
+    pImpl->startMonitoring(callback, interval, filter);
+}
+
+void Disk::stopContinuousMonitoring() {
+    pImpl->stopMonitoring();
+}
+
+} // namespace kuserspace
@@ -0,0 +1,574 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Exporter.h"
+#include "../include/Server.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <string_view>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <cmath>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+
+namespace kuserspace {
+
+namespace {
+
+constexpr std::size_t MAX_CONNECTIONS = 64;
+constexpr std::size_t MAX_REQUEST = 4096;
+constexpr std::size_t INITIAL_BODY = 64 * 1024;
+
+const char* const SOURCE_LABELS[SystemSnapshot::NUM_SOURCES] = {
+    "{source=\"memory\"}", "{source=\"processor\"}", "{source=\"disk\"}", "{source=\"network\"}",
+    "{source=\"protocols\"}", "{source=\"cgroups\"}", "{source=\"pressure\"}"
+};
+
+enum class Type { Gauge, Counter };
+
+// Appends one exposition to a buffer that keeps its capacity. Counter
+// samples carry _total; in OpenMetrics the family name does not.
+class Writer {
+public:
+    Writer(std::string& output, bool openMetricsFormat) : out(output), openMetrics(openMetricsFormat) {
+        out.clear();
+    }
+
+    void family(std::string_view familyName, Type familyType, std::string_view help) {
+        name = familyName;
+        counter = familyType == Type::Counter;
+        bool suffix = counter && !openMetrics;
+        out += "# HELP ";
+        out += name;
+        if (suffix) out += "_total";
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        if (suffix) out += "_total";
+        out += counter ? " counter\n" : " gauge\n";
+    }
+
+    void sample(std::string_view labels, double value) {
+        begin(labels);
+        if (std::isnan(value)) {
+            out += "NaN";
+        } else if (std::isinf(value)) {
+            out += value > 0 ? "+Inf" : "-Inf";
+        } else {
+            char buffer[32];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, result.ptr);
+        }
+        out += '\n';
+    }
+
+    void sample(std::string_view labels, uint64_t value) {
+        begin(labels);
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+        out += '\n';
+    }
+
+    template <typename T>
+    void sample(T value) {
+        sample(std::string_view(), value);
+    }
+
+    void finish() {
+        if (openMetrics) out += "# EOF\n";
+    }
+
+private:
+    void begin(std::string_view labels) {
+        out += name;
+        if (counter) out += "_total";
+        out += labels;
+        out += ' ';
+    }
+
+    std::string& out;
+    const bool openMetrics;
+    std::string_view name;
+    bool counter = false;
+};
+
+// {key="value"} with the value escaped
+std::string makeLabels(std::string_view key, std::string_view value) {
+    std::string labels = "{";
+    labels += key;
+    labels += "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            labels += '\\';
+            labels += c;
+        } else if (c == '\n') {
+            labels += "\\n";
+        } else {
+            labels += c;
+        }
+    }
+    labels += "\"}";
+    return labels;
+}
+
+} // namespace
+
+class Exporter::Impl {
+public:
+    explicit Impl(SystemSnapshot& snapshot)
+        : source(snapshot),
+          server(MAX_CONNECTIONS, 64, {
+              [this](std::size_t slot) { accepted(slot); },
+              [this](std::size_t slot, uint32_t events) { ready(slot, events); },
+              nullptr,
+              [this]() { ++errors; }
+          }) {
+        long ticks = sysconf(_SC_CLK_TCK);
+        ticksPerSecond = ticks > 0 ? static_cast<double>(ticks) : 100.0;
+
+        static const char* const RESOURCES[] = {"cpu", "memory", "io"};
+        static const char* const KINDS[] = {"some", "full"};
+        static const char* const WINDOWS[] = {"10s", "60s", "300s"};
+        for (const char* resource : RESOURCES) {
+            for (const char* kind : KINDS) {
+                std::string labels = std::string("{resource=\"") + resource + "\",kind=\"" + kind + "\"";
+                pressureLabels.push_back(labels + "}");
+                for (const char* window : WINDOWS) {
+                    pressureWindowLabels.push_back(labels + ",window=\"" + window + "\"}");
+                }
+            }
+        }
+    }
+
+    ~Impl() {
+        stop();
+    }
+
+    void listen(uint16_t port) {
+        server.listen("127.0.0.1", port);
+    }
+
+    void listen(const std::string& path) {
+        server.listen(path);
+    }
+
+    void stop() {
+        server.stop();
+    }
+
+    bool isRunning() const {
+        return server.isRunning();
+    }
+
+    uint16_t getPort() const {
+        return server.getPort();
+    }
+
+    void setRefreshOnScrape(bool refresh) {
+        refreshOnScrape = refresh;
+    }
+
+    void render(const SystemSnapshot::Snapshot& snapshot, std::string& out, bool openMetrics) {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        renderLocked(snapshot, out, openMetrics);
+    }
+
+    Stats getStats() const {
+        return {scrapes.load(), errors.load(), lastBytes.load(), std::chrono::nanoseconds(lastRenderNs.load())};
+    }
+
+private:
+    struct Connection {
+        char request[MAX_REQUEST];
+        std::size_t received = 0;
+        char header[256];
+        std::size_t headerLength = 0;   // non-zero once a response is queued
+        std::string body;
+        std::size_t sent = 0;           // header first, then body
+    };
+
+    void accepted(std::size_t slot) {
+        if (slot == pool.size()) {
+            pool.push_back(std::make_unique<Connection>());
+            pool.back()->body.reserve(INITIAL_BODY);
+        }
+        Connection& connection = *pool[slot];
+        connection.received = 0;
+        connection.headerLength = 0;
+        connection.sent = 0;
+    }
+
+    void ready(std::size_t slot, uint32_t events) {
+        if (pool[slot]->headerLength) {
+            send(slot);
+        } else if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+            receive(slot);
+        }
+    }
+
+    void receive(std::size_t slot) {
+        Connection& connection = *pool[slot];
+        int fd = server.getFd(slot);
+        bool shutdown = false;      // the peer finished sending; it may still read the answer
+        while (connection.received < MAX_REQUEST) {
+            ssize_t n = ::read(fd, connection.request + connection.received, MAX_REQUEST - connection.received);
+            if (n > 0) {
+                connection.received += static_cast<std::size_t>(n);
+                continue;
+            }
+            if (n == 0) {
+                shutdown = true;
+                break;
+            }
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) break;
+            server.close(slot);
+            return;
+        }
+        std::string_view request(connection.request, connection.received);
+        if (request.find("\r\n\r\n") == std::string_view::npos && request.find("\n\n") == std::string_view::npos) {
+            if (connection.received == MAX_REQUEST) {
+                respond(slot, 431, "Request Header Fields Too Large");
+            } else if (shutdown) {
+                server.close(slot);     // peer went away before a full request
+            }
+            return;
+        }
+
+        std::string_view method = request.substr(0, request.find(' '));
+        std::size_t targetStart = method.size() + 1;
+        std::string_view target = request.substr(std::min(targetStart, request.size()));
+        target = target.substr(0, target.find_first_of(" ?\r\n"));
+        if (method != "GET") {
+            respond(slot, 405, "Method Not Allowed");
+        } else if (target != "/metrics") {
+            respond(slot, 404, "Not Found");
+        } else {
+            scrape(slot, request.find("application/openmetrics-text") != std::string_view::npos);
+        }
+    }
+
+    void scrape(std::size_t slot, bool openMetrics) {
+        Connection& connection = *pool[slot];
+        if (refreshOnScrape) source.refresh();
+        {
+            std::lock_guard<std::mutex> lock(renderMutex);
+            source.getSnapshot(current);
+            auto start = std::chrono::steady_clock::now();
+            renderLocked(current, connection.body, openMetrics);
+            lastRenderNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+        ++scrapes;
+        lastBytes = connection.body.size();
+        const char* type = openMetrics ? "application/openmetrics-text; version=1.0.0; charset=utf-8"
+                                       : "text/plain; version=0.0.4; charset=utf-8";
+        queue(slot, 200, "OK", type);
+    }
+
+    void respond(std::size_t slot, int status, const char* reason) {
+        ++errors;
+        Connection& connection = *pool[slot];
+        connection.body.assign(reason);
+        connection.body += '\n';
+        queue(slot, status, reason, "text/plain; charset=utf-8");
+    }
+
+    void queue(std::size_t slot, int status, const char* reason, const char* type) {
+        Connection& connection = *pool[slot];
+        int length = std::snprintf(connection.header, sizeof(connection.header),
+                                   "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                                   status, reason, type, connection.body.size());
+        connection.headerLength = static_cast<std::size_t>(length);
+        connection.sent = 0;
+        send(slot);
+        if (server.getFd(slot) != -1) server.watch(slot, EPOLLOUT);
+    }
+
+    void send(std::size_t slot) {
+        Connection& connection = *pool[slot];
+        int fd = server.getFd(slot);
+        std::size_t total = connection.headerLength + connection.body.size();
+        while (connection.sent < total) {
+            iovec parts[2];
+            int count = 0;
+            if (connection.sent < connection.headerLength) {
+                parts[count++] = {connection.header + connection.sent, connection.headerLength - connection.sent};
+                parts[count++] = {connection.body.data(), connection.body.size()};
+            } else {
+                std::size_t offset = connection.sent - connection.headerLength;
+                parts[count++] = {connection.body.data() + offset, connection.body.size() - offset};
+            }
+            ssize_t n = ::writev(fd, parts, count);
+            if (n > 0) {
+                connection.sent += static_cast<std::size_t>(n);
+                continue;
+            }
+            if (n == -1 && errno == EAGAIN) return;
+            ++errors;
+            break;
+        }
+        server.close(slot);
+    }
+
+    // The label set of each item, built the first time its name is seen.
+    // Caller holds renderMutex.
+    template <typename T, typename Name>
+    void labelsFor(std::string_view key, std::unordered_map<std::string, std::string>& cache,
+                   const std::vector<T>& items, Name nameOf, std::vector<const std::string*>& labels) {
+        if (cache.size() > 2 * items.size() + 64) cache.clear();   // drop departed entities
+        labels.clear();
+        for (const T& item : items) {
+            const std::string& name = nameOf(item);
+            auto it = cache.find(name);
+            if (it == cache.end()) it = cache.emplace(name, makeLabels(key, name)).first;
+            labels.push_back(&it->second);
+        }
+    }
+
+    template <typename T, typename Value>
+    static void samples(Writer& writer, const std::vector<T>& items, const std::vector<const std::string*>& labels,
+                        Value value) {
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            writer.sample(*labels[i], value(items[i]));
+        }
+    }
+
+    void renderLocked(const SystemSnapshot::Snapshot& s, std::string& out, bool openMetrics) {
+        using Source = SystemSnapshot::Source;
+        Writer w(out, openMetrics);
+
+        w.family("kuserspace_snapshot_timestamp_seconds", Type::Gauge, "Wall time of the snapshot served.");
+        w.sample(std::chrono::duration<double>(s.wallTime.time_since_epoch()).count());
+        w.family("kuserspace_snapshot_duration_seconds", Type::Gauge, "Time taken by the whole sampling pass.");
+        w.sample(std::chrono::duration<double>(s.duration).count());
+        w.family("kuserspace_source_read_duration_seconds", Type::Gauge, "Time taken to read each sampled source.");
+        for (std::size_t i = 0; i < SystemSnapshot::NUM_SOURCES; ++i) {
+            if (s.timings[i].sampled) {
+                w.sample(SOURCE_LABELS[i], std::chrono::duration<double>(s.timings[i].readDuration).count());
+            }
+        }
+
+        if (s.timing(Source::Memory).sampled) {
+            const Memory::Stats& m = s.memory;
+            auto bytes = [](kuserspace::size_t value) { return static_cast<uint64_t>(value); };
+            w.family("kuserspace_memory_total_bytes", Type::Gauge, "MemTotal.");
+            w.sample(bytes(m.total));
+            w.family("kuserspace_memory_free_bytes", Type::Gauge, "MemFree.");
+            w.sample(bytes(m.free));
+            w.family("kuserspace_memory_available_bytes", Type::Gauge, "MemAvailable.");
+            w.sample(bytes(m.available));
+            w.family("kuserspace_memory_cached_bytes", Type::Gauge, "Page cache.");
+            w.sample(bytes(m.cached));
+            w.family("kuserspace_memory_buffers_bytes", Type::Gauge, "Block device buffers.");
+            w.sample(bytes(m.buffers));
+            w.family("kuserspace_memory_swap_total_bytes", Type::Gauge, "Swap space.");
+            w.sample(bytes(m.swapTotal));
+            w.family("kuserspace_memory_swap_free_bytes", Type::Gauge, "Unused swap space.");
+            w.sample(bytes(m.swapFree));
+        }
+
+        if (s.timing(Source::Processor).sampled) {
+            const Processor::Stats& p = s.processor;
+            w.family("kuserspace_cpu_seconds", Type::Counter, "CPU time of all CPUs by mode.");
+            w.sample("{mode=\"user\"}", p.userTime / ticksPerSecond);
+            w.sample("{mode=\"nice\"}", p.niceTime / ticksPerSecond);
+            w.sample("{mode=\"system\"}", p.systemTime / ticksPerSecond);
+            w.sample("{mode=\"idle\"}", p.idleTime / ticksPerSecond);
+            w.sample("{mode=\"iowait\"}", p.iowaitTime / ticksPerSecond);
+            w.sample("{mode=\"irq\"}", p.irqTime / ticksPerSecond);
+            w.sample("{mode=\"softirq\"}", p.softirqTime / ticksPerSecond);
+            w.sample("{mode=\"steal\"}", p.stealTime / ticksPerSecond);
+            w.family("kuserspace_cpu_utilization_ratio", Type::Gauge, "Busy share of all CPUs over the last interval.");
+            w.sample(static_cast<double>(p.totalUtilization) / 100.0);
+
+            w.family("kuserspace_cpu_core_utilization_ratio", Type::Gauge, "Busy share of each CPU over the last interval.");
+            while (coreLabels.size() < p.perCoreUtilization.size()) {
+                coreLabels.push_back(makeLabels("cpu", std::to_string(coreLabels.size())));
+            }
+            for (std::size_t cpu = 0; cpu < p.perCoreUtilization.size(); ++cpu) {
+                w.sample(coreLabels[cpu], static_cast<double>(p.perCoreUtilization[cpu]) / 100.0);
+            }
+        }
+
+        if (s.timing(Source::Disk).sampled) {
+            using Device = Disk::DeviceStats;
+            const auto& d = s.disks;
+            labelsFor("device", diskCache, d, [](const Device& x) -> const std::string& { return x.name; }, diskLabels);
+            w.family("kuserspace_disk_reads_completed", Type::Counter, "Reads completed.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.counters.readsCompleted; });
+            w.family("kuserspace_disk_writes_completed", Type::Counter, "Writes completed.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.counters.writesCompleted; });
+            w.family("kuserspace_disk_read_bytes", Type::Counter, "Bytes read.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.counters.sectorsRead * 512; });
+            w.family("kuserspace_disk_written_bytes", Type::Counter, "Bytes written.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.counters.sectorsWritten * 512; });
+            w.family("kuserspace_disk_read_time_seconds", Type::Counter, "Time spent on reads.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.counters.readTimeMs / 1e3; });
+            w.family("kuserspace_disk_write_time_seconds", Type::Counter, "Time spent on writes.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.counters.writeTimeMs / 1e3; });
+            w.family("kuserspace_disk_io_time_seconds", Type::Counter, "Time the device had I/O in flight.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.counters.ioTimeMs / 1e3; });
+            w.family("kuserspace_disk_io_now", Type::Gauge, "I/Os in flight.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.counters.ioInProgress; });
+            w.family("kuserspace_disk_utilization_ratio", Type::Gauge, "Busy share of the last interval.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.utilization / 100.0; });
+            w.family("kuserspace_disk_queue_depth", Type::Gauge, "Average queue depth over the last interval.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.avgQueueDepth; });
+            w.family("kuserspace_disk_read_await_seconds", Type::Gauge, "Average read latency over the last interval.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.readAwaitMs / 1e3; });
+            w.family("kuserspace_disk_write_await_seconds", Type::Gauge, "Average write latency over the last interval.");
+            samples(w, d, diskLabels, [](const Device& x) { return x.writeAwaitMs / 1e3; });
+        }
+
+        if (s.timing(Source::Network).sampled) {
+            using Interface = Network::InterfaceStats;
+            const auto& n = s.interfaces;
+            labelsFor("interface", netCache, n, [](const Interface& x) -> const std::string& { return x.name; }, netLabels);
+            w.family("kuserspace_network_receive_bytes", Type::Counter, "Bytes received.");
+            samples(w, n, netLabels, [](const Interface& x) { return x.counters.rxBytes; });
+            w.family("kuserspace_network_transmit_bytes", Type::Counter, "Bytes transmitted.");
+            samples(w, n, netLabels, [](const Interface& x) { return x.counters.txBytes; });
+            w.family("kuserspace_network_receive_packets", Type::Counter, "Packets received.");
+            samples(w, n, netLabels, [](const Interface& x) { return x.counters.rxPackets; });
+            w.family("kuserspace_network_transmit_packets", Type::Counter, "Packets transmitted.");
+            samples(w, n, netLabels, [](const Interface& x) { return x.counters.txPackets; });
+            w.family("kuserspace_network_receive_errors", Type::Counter, "Receive errors.");
+            samples(w, n, netLabels, [](const Interface& x) { return x.counters.rxErrors; });
+            w.family("kuserspace_network_transmit_errors", Type::Counter, "Transmit errors.");
+            samples(w, n, netLabels, [](const Interface& x) { return x.counters.txErrors; });
+            w.family("kuserspace_network_receive_drops", Type::Counter, "Received packets dropped.");
+            samples(w, n, netLabels, [](const Interface& x) { return x.counters.rxDropped; });
+            w.family("kuserspace_network_transmit_drops", Type::Counter, "Transmitted packets dropped.");
+            samples(w, n, netLabels, [](const Interface& x) { return x.counters.txDropped; });
+        }
+
+        if (s.timing(Source::Protocols).sampled) {
+            const Network::ProtocolCounters& c = s.protocols.counters;
+            w.family("kuserspace_tcp_segments_received", Type::Counter, "TCP segments received.");
+            w.sample(c.tcpInSegs);
+            w.family("kuserspace_tcp_segments_sent", Type::Counter, "TCP segments sent.");
+            w.sample(c.tcpOutSegs);
+            w.family("kuserspace_tcp_segments_retransmitted", Type::Counter, "TCP segments retransmitted.");
+            w.sample(c.tcpRetransSegs);
+            w.family("kuserspace_tcp_in_errors", Type::Counter, "TCP segments received in error.");
+            w.sample(c.tcpInErrors);
+            w.family("kuserspace_tcp_listen_overflows", Type::Counter, "Accept queue overflows.");
+            w.sample(c.tcpListenOverflows);
+            w.family("kuserspace_tcp_listen_drops", Type::Counter, "Connection requests dropped at listen.");
+            w.sample(c.tcpListenDrops);
+            w.family("kuserspace_tcp_timeouts", Type::Counter, "TCP retransmission timeouts.");
+            w.sample(c.tcpTimeouts);
+            w.family("kuserspace_udp_in_errors", Type::Counter, "UDP datagrams received in error.");
+            w.sample(c.udpInErrors);
+            w.family("kuserspace_udp_receive_buffer_errors", Type::Counter, "UDP datagrams dropped for a full receive buffer.");
+            w.sample(c.udpRcvbufErrors);
+        }
+
+        if (s.timing(Source::Cgroups).sampled) {
+            using Group = Cgroup::Stats;
+            const auto& g = s.cgroups;
+            labelsFor("cgroup", cgroupCache, g, [](const Group& x) -> const std::string& { return x.path; }, cgroupLabels);
+            w.family("kuserspace_cgroup_cpu_usage_seconds", Type::Counter, "CPU time of the cgroup and its descendants.");
+            samples(w, g, cgroupLabels, [](const Group& x) { return x.usage.cpuUsageUsec / 1e6; });
+            w.family("kuserspace_cgroup_cpu_throttled_seconds", Type::Counter, "Time throttled by cpu.max.");
+            samples(w, g, cgroupLabels, [](const Group& x) { return x.usage.cpuThrottledUsec / 1e6; });
+            w.family("kuserspace_cgroup_memory_current_bytes", Type::Gauge, "memory.current.");
+            samples(w, g, cgroupLabels, [](const Group& x) { return x.usage.memoryCurrent; });
+            w.family("kuserspace_cgroup_major_page_faults", Type::Counter, "Major page faults.");
+            samples(w, g, cgroupLabels, [](const Group& x) { return x.usage.majorPageFaults; });
+            w.family("kuserspace_cgroup_io_read_bytes", Type::Counter, "Bytes read across devices.");
+            samples(w, g, cgroupLabels, [](const Group& x) { return x.usage.ioReadBytes; });
+            w.family("kuserspace_cgroup_io_written_bytes", Type::Counter, "Bytes written across devices.");
+            samples(w, g, cgroupLabels, [](const Group& x) { return x.usage.ioWriteBytes; });
+        }
+
+        if (s.timing(Source::Pressure).sampled) {
+            const SystemSnapshot::Pressure::Resource* resources[] = {&s.pressure.cpu, &s.pressure.memory, &s.pressure.io};
+            w.family("kuserspace_pressure_ratio", Type::Gauge, "Share of time stalled on the resource, averaged over the window.");
+            for (std::size_t i = 0; i < 6; ++i) {
+                const SystemSnapshot::Stall& stall = i % 2 ? resources[i / 2]->full : resources[i / 2]->some;
+                w.sample(pressureWindowLabels[i * 3], stall.avg10 / 100.0);
+                w.sample(pressureWindowLabels[i * 3 + 1], stall.avg60 / 100.0);
+                w.sample(pressureWindowLabels[i * 3 + 2], stall.avg300 / 100.0);
+            }
+            w.family("kuserspace_pressure_stalled_seconds", Type::Counter, "Time stalled on the resource.");
+            for (std::size_t i = 0; i < 6; ++i) {
+                const SystemSnapshot::Stall& stall = i % 2 ? resources[i / 2]->full : resources[i / 2]->some;
+                w.sample(pressureLabels[i], static_cast<double>(stall.total) / 1e6);
+            }
+        }
+
+        w.finish();
+    }
+
+    SystemSnapshot& source;
+    double ticksPerSecond;
+    std::atomic<bool> refreshOnScrape{false};
+
+    std::mutex renderMutex;                 // guards current and the label caches
+    SystemSnapshot::Snapshot current{};
+    std::vector<std::string> coreLabels;
+    std::vector<std::string> pressureLabels;            // resource, kind
+    std::vector<std::string> pressureWindowLabels;      // resource, kind, window
+    std::unordered_map<std::string, std::string> diskCache;
+    std::unordered_map<std::string, std::string> netCache;
+    std::unordered_map<std::string, std::string> cgroupCache;
+    std::vector<const std::string*> diskLabels;
+    std::vector<const std::string*> netLabels;
+    std::vector<const std::string*> cgroupLabels;
+
+    // Connection state per server slot, owned by the server thread
+    std::vector<std::unique_ptr<Connection>> pool;
+
+    std::atomic<uint64_t> scrapes{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<std::size_t> lastBytes{0};
+    std::atomic<int64_t> lastRenderNs{0};
+
+    Server server;                          // last: its thread stops before the state above goes
+};
+
+Exporter::Exporter(SystemSnapshot& snapshot) : pImpl(std::make_unique<Impl>(snapshot)) {}
+
+Exporter::~Exporter() = default;
+
+void Exporter::listen(uint16_t port) {
+    pImpl->listen(port);
+}
+
+void Exporter::listen(const std::string& socketPath) {
+    pImpl->listen(socketPath);
+}
+
+void Exporter::stop() {
+    pImpl->stop();
+}
+
+bool Exporter::isRunning() const {
+    return pImpl->isRunning();
+}
+
+uint16_t Exporter::getPort() const {
+    return pImpl->getPort();
+}
+
+void Exporter::setRefreshOnScrape(bool refresh) {
+    pImpl->setRefreshOnScrape(refresh);
+}
+
+void Exporter::render(const SystemSnapshot::Snapshot& snapshot, std::string& out, bool openMetrics) {
+    pImpl->render(snapshot, out, openMetrics);
+}
+
+Exporter::Stats Exporter::getStats() const {
+    return pImpl->getStats();
+}
+
+} // namespace kuserspace
@@ -0,0 +1,408 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Fleet.h"
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <cmath>
+
+namespace kuserspace {
+
+namespace {
+
+using Snapshot = SystemSnapshot::Snapshot;
+using Source = SystemSnapshot::Source;
+
+// Hundredths up to 10^12. Sizes and byte rates are kept in MiB so that
+// large hosts stay well below the ceiling.
+constexpr unsigned int PRECISION_BITS = 5;
+constexpr double SCALE = 100.0;
+constexpr double HIGHEST = 1e12;
+constexpr double NOT_REPORTED = std::numeric_limits<double>::quiet_NaN();
+constexpr double MIB = 1024.0 * 1024.0;
+
+// Hosts silent for this many host timeouts are forgotten
+constexpr int EVICT_TIMEOUTS = 10;
+
+double percentOf(double part, double whole) {
+    return whole > 0 ? 100.0 * part / whole : NOT_REPORTED;
+}
+
+double memoryUsedPercent(const Snapshot& s) {
+    const Memory::Stats& m = s.memory;
+    return percentOf(static_cast<double>(m.total - m.free - m.cached - m.buffers), static_cast<double>(m.total));
+}
+
+double maxCoreUtilization(const Snapshot& s) {
+    const auto& cores = s.processor.perCoreUtilization;
+    return cores.empty() ? NOT_REPORTED : static_cast<double>(*std::max_element(cores.begin(), cores.end()));
+}
+
+// Whole disks only; partitions would count their I/O twice
+template <typename Field>
+double overDisks(const Snapshot& s, bool maximum, Field field) {
+    double total = 0;
+    for (const Disk::DeviceStats& disk : s.disks) {
+        if (disk.partition) continue;
+        total = maximum ? std::max(total, field(disk)) : total + field(disk);
+    }
+    return total;
+}
+
+template <typename Field>
+double overInterfaces(const Snapshot& s, Field field) {
+    double total = 0;
+    for (const Network::InterfaceStats& interface : s.interfaces) {
+        if (interface.name != "lo") total += field(interface);
+    }
+    return total;
+}
+
+struct FleetMetric {
+    const char* name;
+    Source source;                      // not reported unless sampled
+    double (*get)(const Snapshot&);
+};
+
+// The shared slots; their order is the MetricId
+const FleetMetric METRICS[] = {
+    {"cpu.utilization", Source::Processor,
+     [](const Snapshot& s) { return static_cast<double>(s.processor.totalUtilization); }},
+    {"cpu.maxCoreUtilization", Source::Processor, maxCoreUtilization},
+    {"memory.usedPercent", Source::Memory, memoryUsedPercent},
+    {"memory.availablePercent", Source::Memory,
+     [](const Snapshot& s) {
+         return percentOf(static_cast<double>(s.memory.available), static_cast<double>(s.memory.total));
+     }},
+    {"memory.availableMiB", Source::Memory, [](const Snapshot& s) { return static_cast<double>(s.memory.available) / MIB; }},
+    {"memory.swapUsedPercent", Source::Memory,
+     [](const Snapshot& s) {
+         double total = static_cast<double>(s.memory.swapTotal);
+         return total > 0 ? percentOf(total - static_cast<double>(s.memory.swapFree), total) : 0.0;
+     }},
+    {"pressure.cpu.some.avg10", Source::Pressure, [](const Snapshot& s) { return s.pressure.cpu.some.avg10; }},
+    {"pressure.memory.some.avg10", Source::Pressure, [](const Snapshot& s) { return s.pressure.memory.some.avg10; }},
+    {"pressure.memory.full.avg10", Source::Pressure, [](const Snapshot& s) { return s.pressure.memory.full.avg10; }},
+    {"pressure.io.some.avg10", Source::Pressure, [](const Snapshot& s) { return s.pressure.io.some.avg10; }},
+    {"pressure.io.full.avg10", Source::Pressure, [](const Snapshot& s) { return s.pressure.io.full.avg10; }},
+    {"disk.readMiBPerSec", Source::Disk,
+     [](const Snapshot& s) { return overDisks(s, false, [](const Disk::DeviceStats& d) { return d.readBytesPerSec; }) / MIB; }},
+    {"disk.writeMiBPerSec", Source::Disk,
+     [](const Snapshot& s) { return overDisks(s, false, [](const Disk::DeviceStats& d) { return d.writeBytesPerSec; }) / MIB; }},
+    {"disk.readIops", Source::Disk,
+     [](const Snapshot& s) { return overDisks(s, false, [](const Disk::DeviceStats& d) { return d.readIops; }); }},
+    {"disk.writeIops", Source::Disk,
+     [](const Snapshot& s) { return overDisks(s, false, [](const Disk::DeviceStats& d) { return d.writeIops; }); }},
+    {"disk.maxUtilization", Source::Disk,
+     [](const Snapshot& s) { return overDisks(s, true, [](const Disk::DeviceStats& d) { return d.utilization; }); }},
+    {"disk.maxAwaitMs", Source::Disk,
+     [](const Snapshot& s) {
+         return overDisks(s, true, [](const Disk::DeviceStats& d) { return std::max(d.readAwaitMs, d.writeAwaitMs); });
+     }},
+    {"net.rxMiBPerSec", Source::Network,
+     [](const Snapshot& s) { return overInterfaces(s, [](const Network::InterfaceStats& n) { return n.rxBytesPerSec; }) / MIB; }},
+    {"net.txMiBPerSec", Source::Network,
+     [](const Snapshot& s) { return overInterfaces(s, [](const Network::InterfaceStats& n) { return n.txBytesPerSec; }) / MIB; }},
+    {"net.dropsPerSec", Source::Network,
+     [](const Snapshot& s) {
+         return overInterfaces(s, [](const Network::InterfaceStats& n) { return n.rxDropsPerSec + n.txDropsPerSec; });
+     }},
+    {"net.errorsPerSec", Source::Network,
+     [](const Snapshot& s) {
+         return overInterfaces(s, [](const Network::InterfaceStats& n) { return n.rxErrorsPerSec + n.txErrorsPerSec; });
+     }},
+    {"tcp.retransmitPercent", Source::Protocols, [](const Snapshot& s) { return s.protocols.retransmitPercent; }},
+    {"tcp.listenDropsPerSec", Source::Protocols, [](const Snapshot& s) { return s.protocols.listenDropsPerSec; }}
+};
+
+constexpr std::size_t NUM_METRICS = sizeof(METRICS) / sizeof(METRICS[0]);
+
+uint64_t toScaled(double value) {
+    if (!(value > 0)) return 0;
+    double scaled = std::round(value * SCALE);
+    return scaled >= 1.8e19 ? std::numeric_limits<uint64_t>::max() : static_cast<uint64_t>(scaled);
+}
+
+} // namespace
+
+class Fleet::Impl {
+public:
+    Impl(std::chrono::milliseconds interval, std::chrono::seconds timeout, std::chrono::seconds slotWidth,
+         std::size_t slots)
+        : publishInterval(interval), hostTimeout(timeout), window(slotWidth, slots, SCALE, HIGHEST),
+          receiver([this](const std::string& host, const Snapshot& snapshot) { ingest(host, snapshot); }) {
+        for (const FleetMetric& metric : METRICS) window.getMetric(metric.name);
+        auto empty = std::make_shared<View>();
+        empty->sketches.assign(NUM_METRICS, Histogram(PRECISION_BITS, toScaled(HIGHEST)));
+        empty->sums.assign(NUM_METRICS, 0.0);
+        std::atomic_store(&view, std::shared_ptr<const View>(std::move(empty)));
+    }
+
+    void listen(const std::string& address, uint16_t port) {
+        receiver.listen(address, port);
+    }
+
+    void listen(const std::string& path) {
+        receiver.listen(path);
+    }
+
+    void stop() {
+        receiver.stop();
+    }
+
+    uint16_t getPort() const {
+        return receiver.getPort();
+    }
+
+    StreamReceiver::Stats getReceiverStats() const {
+        return receiver.getStats();
+    }
+
+    void ingest(const std::string& name, const Snapshot& snapshot) {
+        Clock::time_point now = Clock::now();
+        double values[NUM_METRICS];
+        for (std::size_t i = 0; i < NUM_METRICS; ++i) {
+            values[i] = snapshot.timing(METRICS[i].source).sampled ? METRICS[i].get(snapshot) : NOT_REPORTED;
+        }
+
+        bool due;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = index.find(name);
+            if (it == index.end()) {
+                it = index.emplace(name, hosts.size()).first;
+                hosts.push_back({name, {}, 0, {}});
+            }
+            HostRow& host = hosts[it->second];
+            std::copy(values, values + NUM_METRICS, host.values);
+            host.lastSeen = now;
+            ++host.samples;
+            for (std::size_t i = 0; i < NUM_METRICS; ++i) {
+                if (!std::isnan(values[i])) window.record(i, now, values[i]);
+            }
+            ++samples;
+            due = now - lastPublished >= publishInterval;
+        }
+        if (due) publish(now);
+    }
+
+    void publish(Clock::time_point now) {
+        auto start = std::chrono::steady_clock::now();
+        auto next = std::make_shared<View>();
+        next->sketches.assign(NUM_METRICS, Histogram(PRECISION_BITS, toScaled(HIGHEST)));
+        next->sums.assign(NUM_METRICS, 0.0);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        lastPublished = now;
+        window.publish(now);
+        evict(now);
+        next->hosts.reserve(hosts.size());
+        next->values.reserve(hosts.size() * NUM_METRICS);
+        for (const HostRow& host : hosts) {
+            bool stale = now - host.lastSeen > hostTimeout;
+            next->hosts.push_back({host.name, host.lastSeen, host.samples, stale});
+            next->staleHosts += stale;
+            for (std::size_t i = 0; i < NUM_METRICS; ++i) {
+                double value = stale ? NOT_REPORTED : host.values[i];
+                next->values.push_back(value);
+                if (std::isnan(value)) continue;
+                next->sketches[i].record(toScaled(value));
+                next->sums[i] += value;
+            }
+        }
+        // Under the lock, so a slower rollup never replaces a newer one
+        std::atomic_store(&view, std::shared_ptr<const View>(std::move(next)));
+        ++publishes;
+        lastPublishNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::vector<std::string> getMetricNames() const {
+        std::vector<std::string> names;
+        for (const FleetMetric& metric : METRICS) names.emplace_back(metric.name);
+        return names;
+    }
+
+    MetricId findMetric(const std::string& name) const {
+        for (std::size_t i = 0; i < NUM_METRICS; ++i) {
+            if (name == METRICS[i].name) return i;
+        }
+        throw std::out_of_range("Unknown metric: " + name);
+    }
+
+    Aggregate getAggregate(MetricId metric) const {
+        auto current = published(metric);
+        return {current->sums[metric], window.summarize(current->sketches[metric])};
+    }
+
+    Histogram getSketch(MetricId metric) const {
+        return published(metric)->sketches[metric];
+    }
+
+    Quantiles::Summary getWindow(MetricId metric) const {
+        published(metric);
+        return window.getSummary(metric);
+    }
+
+    std::vector<std::pair<std::string, double>> getTop(MetricId metric, std::size_t count) const {
+        auto current = published(metric);
+        std::vector<std::pair<double, std::size_t>> ranked;
+        for (std::size_t h = 0; h < current->hosts.size(); ++h) {
+            double value = current->values[h * NUM_METRICS + metric];
+            if (!std::isnan(value)) ranked.emplace_back(value, h);
+        }
+        count = std::min(count, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(count), ranked.end(),
+                          [](const auto& a, const auto& b) { return a.first > b.first; });
+        std::vector<std::pair<std::string, double>> top;
+        for (std::size_t i = 0; i < count; ++i) {
+            top.emplace_back(current->hosts[ranked[i].second].name, ranked[i].first);
+        }
+        return top;
+    }
+
+    std::vector<Host> getHosts() const {
+        return std::atomic_load(&view)->hosts;
+    }
+
+    Stats getStats() const {
+        auto current = std::atomic_load(&view);
+        return {samples.load(), current->hosts.size(), current->staleHosts, publishes.load(),
+                std::chrono::nanoseconds(lastPublishNs.load())};
+    }
+
+private:
+    struct HostRow {
+        std::string name;
+        Clock::time_point lastSeen;
+        uint64_t samples;
+        double values[NUM_METRICS];     // NaN where the source was not sampled
+    };
+
+    // The rollup of one publish(), never modified once swapped in
+    struct View {
+        std::vector<Histogram> sketches;
+        std::vector<double> sums;
+        std::vector<Host> hosts;
+        std::vector<double> values;     // per host, per metric; NaN for stale hosts
+        std::size_t staleHosts = 0;
+    };
+
+    // Drop hosts gone for good, so churn does not grow the table and every
+    // rollup without bound. Caller holds mutex.
+    void evict(Clock::time_point now) {
+        for (std::size_t h = 0; h < hosts.size();) {
+            if (now - hosts[h].lastSeen <= EVICT_TIMEOUTS * hostTimeout) {
+                ++h;
+                continue;
+            }
+            index.erase(hosts[h].name);
+            if (h + 1 != hosts.size()) {
+                hosts[h] = std::move(hosts.back());
+                index[hosts[h].name] = h;
+            }
+            hosts.pop_back();
+        }
+    }
+
+    std::shared_ptr<const View> published(MetricId metric) const {
+        if (metric >= NUM_METRICS) {
+            throw std::out_of_range("Unknown metric: " + std::to_string(metric));
+        }
+        return std::atomic_load(&view);
+    }
+
+    const std::chrono::milliseconds publishInterval;
+    const std::chrono::seconds hostTimeout;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::size_t> index;
+    std::vector<HostRow> hosts;
+    Quantiles window;
+    Clock::time_point lastPublished{};
+    std::shared_ptr<const View> view;       // std::atomic_load / atomic_store only
+
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> publishes{0};
+    std::atomic<int64_t> lastPublishNs{0};
+
+    // Last, so it stops delivering before the state above goes away
+    StreamReceiver receiver;
+};
+
+Fleet::Fleet()
+    : Fleet(std::chrono::milliseconds(1000), std::chrono::seconds(30), std::chrono::seconds(30), 10) {}
+
+Fleet::Fleet(std::chrono::milliseconds publishInterval, std::chrono::seconds hostTimeout,
+             std::chrono::seconds slotWidth, std::size_t slots)
+    : pImpl(std::make_unique<Impl>(publishInterval, hostTimeout, slotWidth, slots)) {}
+
+Fleet::~Fleet() = default;
+
+void Fleet::listen(uint16_t port) {
+    pImpl->listen("127.0.0.1", port);
+}
+
+void Fleet::listen(const std::string& address, uint16_t port) {
+    pImpl->listen(address, port);
+}
+
+void Fleet::listen(const std::string& socketPath) {
+    pImpl->listen(socketPath);
+}
+
+void Fleet::stop() {
+    pImpl->stop();
+}
+
+uint16_t Fleet::getPort() const {
+    return pImpl->getPort();
+}
+
+StreamReceiver::Stats Fleet::getReceiverStats() const {
+    return pImpl->getReceiverStats();
+}
+
+void Fleet::ingest(const std::string& host, const SystemSnapshot::Snapshot& snapshot) {
+    pImpl->ingest(host, snapshot);
+}
+
+void Fleet::publish(Clock::time_point now) {
+    pImpl->publish(now);
+}
+
+std::vector<std::string> Fleet::getMetricNames() const {
+    return pImpl->getMetricNames();
+}
+
+Fleet::MetricId Fleet::findMetric(const std::string& name) const {
+    return pImpl->findMetric(name);
+}
+
+Fleet::Aggregate Fleet::getAggregate(MetricId metric) const {
+    return pImpl->getAggregate(metric);
+}
+
+Histogram Fleet::getSketch(MetricId metric) const {
+    return pImpl->getSketch(metric);
+}
+
+Quantiles::Summary Fleet::getWindow(MetricId metric) const {
+    return pImpl->getWindow(metric);
+}
+
+std::vector<std::pair<std::string, double>> Fleet::getTop(MetricId metric, std::size_t count) const {
+    return pImpl->getTop(metric, count);
+}
+
+std::vector<Fleet::Host> Fleet::getHosts() const {
+    return pImpl->getHosts();
+}
+
+Fleet::Stats Fleet::getStats() const {
+    return pImpl->getStats();
+}
+
+} // namespace kuserspace
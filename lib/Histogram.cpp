@@ -0,0 +1,193 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Histogram.h"
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <cstring>
+
+namespace kuserspace {
+
+namespace {
+
+constexpr char SERIAL_MAGIC = 'H';
+constexpr char SERIAL_VERSION = 1;
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool getVarint(std::string_view& in, uint64_t& value) {
+    value = 0;
+    for (unsigned int shift = 0; shift < 64 && !in.empty(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+Histogram::Histogram(unsigned int precisionBits)
+    : precisionBits(precisionBits)
+    , count(0)
+    , min(std::numeric_limits<uint64_t>::max())
+    , max(0)
+    , sum(0) {
+    if (precisionBits < 1 || precisionBits > 16) {
+        throw std::invalid_argument("Histogram precision must be between 1 and 16 bits");
+    }
+    // One linear group below 2^precisionBits, then one group per remaining power of two
+    size_t subBuckets = size_t(1) << precisionBits;
+    counts.assign(subBuckets + (64 - precisionBits) * subBuckets, 0);
+}
+
+Histogram::Histogram(unsigned int precisionBits, uint64_t highestValue) : Histogram(precisionBits) {
+    counts.resize(std::min<std::size_t>(counts.size(), bucketIndex(highestValue) + 1));
+}
+
+size_t Histogram::bucketIndex(uint64_t value) const {
+    size_t subBuckets = size_t(1) << precisionBits;
+    if (value < subBuckets) {
+        return static_cast<size_t>(value);
+    }
+    unsigned int exponent = 63 - static_cast<unsigned int>(__builtin_clzll(value));
+    unsigned int shift = exponent - precisionBits;
+    size_t subBucket = static_cast<size_t>(value >> shift) - subBuckets;
+    size_t index = subBuckets + shift * subBuckets + subBucket;
+    return counts.empty() || index < counts.size() ? index : counts.size() - 1;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t index) const {
+    size_t subBuckets = size_t(1) << precisionBits;
+    if (index < subBuckets) {
+        return index;
+    }
+    size_t shift = (index - subBuckets) / subBuckets;
+    uint64_t subBucket = (index - subBuckets) % subBuckets;
+    uint64_t lower = (subBuckets + subBucket) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void Histogram::record(uint64_t value) {
+    record(value, 1);
+}
+
+void Histogram::record(uint64_t value, uint64_t n) {
+    if (n == 0) return;
+    counts[bucketIndex(value)] += n;
+    count += n;
+    min = std::min(min, value);
+    max = std::max(max, value);
+    sum += static_cast<long double>(value) * n;
+}
+
+void Histogram::merge(const Histogram& other) {
+    if (other.precisionBits != precisionBits || other.counts.size() != counts.size()) {
+        throw std::invalid_argument("Cannot merge histograms with different precision");
+    }
+    for (size_t i = 0; i < counts.size(); ++i) {
+        counts[i] += other.counts[i];
+    }
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sum += other.sum;
+}
+
+void Histogram::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    count = 0;
+    min = std::numeric_limits<uint64_t>::max();
+    max = 0;
+    sum = 0;
+}
+
+double Histogram::getMean() const {
+    return count ? static_cast<double>(sum / count) : 0.0;
+}
+
+uint64_t Histogram::getPercentile(double percentile) const {
+    if (count == 0) return 0;
+
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count) + 0.5);
+    rank = std::clamp<uint64_t>(rank, 1, count);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::clamp(bucketUpperBound(i), getMin(), max);
+        }
+    }
+    return max;
+}
+
+std::string Histogram::serialize() const {
+    std::string out;
+    out.push_back(SERIAL_MAGIC);
+    out.push_back(SERIAL_VERSION);
+    putVarint(out, precisionBits);
+    putVarint(out, counts.size());
+    putVarint(out, count);
+    putVarint(out, count ? min : 0);
+    putVarint(out, max);
+    double total = static_cast<double>(sum);
+    char bytes[sizeof(total)];
+    std::memcpy(bytes, &total, sizeof(total));
+    out.append(bytes, sizeof(bytes));
+
+    // Non-empty buckets as (gap from the previous one, count)
+    size_t previous = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] == 0) continue;
+        putVarint(out, i - previous);
+        putVarint(out, counts[i]);
+        previous = i;
+    }
+    return out;
+}
+
+Histogram Histogram::deserialize(std::string_view data) {
+    if (data.size() < 2 || data[0] != SERIAL_MAGIC || data[1] != SERIAL_VERSION) {
+        throw std::invalid_argument("Not a serialized histogram");
+    }
+    data.remove_prefix(2);
+
+    uint64_t precision, buckets, total, low, high;
+    if (!getVarint(data, precision) || !getVarint(data, buckets) || !getVarint(data, total) ||
+        !getVarint(data, low) || !getVarint(data, high) || data.size() < sizeof(double) ||
+        precision < 1 || precision > 16) {
+        throw std::invalid_argument("Truncated serialized histogram");
+    }
+    Histogram histogram(static_cast<unsigned int>(precision));
+    if (buckets == 0 || buckets > histogram.counts.size()) {
+        throw std::invalid_argument("Invalid serialized histogram layout");
+    }
+    histogram.counts.resize(buckets);
+    double bucketSum;
+    std::memcpy(&bucketSum, data.data(), sizeof(bucketSum));
+    data.remove_prefix(sizeof(bucketSum));
+
+    uint64_t index = 0, gap, n;
+    while (!data.empty()) {
+        if (!getVarint(data, gap) || !getVarint(data, n) || index + gap >= buckets) {
+            throw std::invalid_argument("Truncated serialized histogram");
+        }
+        index += gap;
+        histogram.counts[index] += n;
+    }
+    histogram.count = total;
+    histogram.min = total ? low : std::numeric_limits<uint64_t>::max();
+    histogram.max = high;
+    histogram.sum = bucketSum;
+    return histogram;
+}
+
+} // namespace kuserspace
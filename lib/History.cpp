@@ -0,0 +1,718 @@
+// Malghumuy - Library: kuserspace
+#include "../include/History.h"
+#include <shared_mutex>
+#include <mutex>
+#include <unordered_map>
+#include <deque>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+namespace kuserspace {
+
+namespace {
+
+// Worst case for one sample: '1111' + 64-bit delta-of-delta, then
+// '11' + 5-bit leading zeros + 6-bit length + 64 meaningful bits
+constexpr std::size_t MAX_SAMPLE_BITS = 4 + 64 + 2 + 5 + 6 + 64;
+
+void writeBits(uint64_t* words, std::size_t& position, uint64_t value, unsigned int bits) {
+    if (bits == 0) return;
+    if (bits < 64) value &= (uint64_t(1) << bits) - 1;
+    std::size_t word = position >> 6;
+    unsigned int room = 64 - static_cast<unsigned int>(position & 63);
+    if (bits <= room) {
+        words[word] |= value << (room - bits);
+    } else {
+        words[word] |= value >> (bits - room);
+        words[word + 1] |= value << (64 - (bits - room));
+    }
+    position += bits;
+}
+
+uint64_t readBits(const uint64_t* words, std::size_t& position, unsigned int bits) {
+    if (bits == 0) return 0;
+    std::size_t word = position >> 6;
+    unsigned int room = 64 - static_cast<unsigned int>(position & 63);
+    uint64_t value;
+    if (bits <= room) {
+        value = words[word] >> (room - bits);
+    } else {
+        value = (words[word] << (bits - room)) | (words[word + 1] >> (64 - (bits - room)));
+    }
+    position += bits;
+    return bits == 64 ? value : value & ((uint64_t(1) << bits) - 1);
+}
+
+int64_t signExtend(uint64_t value, unsigned int bits) {
+    uint64_t sign = uint64_t(1) << (bits - 1);
+    return static_cast<int64_t>((value ^ sign) - sign);
+}
+
+bool fits(int64_t value, unsigned int bits) {
+    int64_t limit = int64_t(1) << (bits - 1);
+    return value >= -limit && value < limit;
+}
+
+int64_t toMillis(History::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+History::Clock::time_point fromMillis(int64_t millis) {
+    return History::Clock::time_point(std::chrono::duration_cast<History::Clock::duration>(std::chrono::milliseconds(millis)));
+}
+
+} // namespace
+
+class History::Impl {
+public:
+    Impl(std::chrono::seconds retentionPeriod, std::size_t blockBytes, const std::vector<Tier>& rollupTiers)
+        : retention(std::chrono::duration_cast<std::chrono::milliseconds>(retentionPeriod).count()),
+          blockWords(std::max<std::size_t>(blockBytes / 8, (2 * MAX_SAMPLE_BITS + 63) / 64)),
+          tiers(rollupTiers) {
+        for (const Tier& tier : tiers) {
+            int64_t width = std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(tier.resolution).count(), 1);
+            int64_t span = std::chrono::duration_cast<std::chrono::milliseconds>(tier.retention).count();
+            // One extra slot for the bucket still filling
+            tierLayouts.push_back({width, static_cast<std::size_t>(std::max<int64_t>(span / width, 1)) + 1});
+        }
+    }
+
+    struct Block {
+        std::unique_ptr<uint64_t[]> words;
+        std::size_t bits = 0;
+        std::size_t count = 0;
+        int64_t firstTime = 0;
+        int64_t lastTime = 0;
+        double min = 0;
+        double max = 0;
+        double sum = 0;
+    };
+
+    struct RollupBucket {
+        int64_t start = std::numeric_limits<int64_t>::min();
+        std::size_t count = 0;
+        double min = 0;
+        double max = 0;
+        double sum = 0;
+        double last = 0;
+    };
+
+    struct TierLayout {
+        int64_t width;                  // milliseconds
+        std::size_t slots;
+    };
+
+    struct Series {
+        std::string name;
+        Type type;
+        std::deque<Block> blocks;
+        int64_t firstTime = 0;
+        std::vector<std::vector<RollupBucket>> rollups;     // ring per tier, bucket start / width mod slots
+
+        // Encoder state of the last block
+        int64_t previousTime = 0;
+        int64_t previousDelta = 0;
+        uint64_t previousBits = 0;
+        unsigned int previousLeading = 0;
+        unsigned int previousTrailing = 0;
+    };
+
+    SeriesId getSeries(const std::string& name, Type type) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = index.find(name);
+            if (it != index.end()) return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        return seriesLocked(name, type);
+    }
+
+    SeriesId findSeries(const std::string& name) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = index.find(name);
+        if (it == index.end()) {
+            throw std::out_of_range("Unknown series: " + name);
+        }
+        return it->second;
+    }
+
+    std::vector<std::string> getSeriesNames() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        std::vector<std::string> names;
+        names.reserve(series.size());
+        for (const auto& s : series) {
+            names.push_back(s->name);
+        }
+        return names;
+    }
+
+    bool append(SeriesId id, Clock::time_point time, double value) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        return appendLocked(id, toMillis(time), value);
+    }
+
+    void append(const SystemSnapshot::Snapshot& snapshot) {
+        using Source = SystemSnapshot::Source;
+        int64_t time = toMillis(snapshot.wallTime);
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (snapshot.timing(Source::Memory).sampled) {
+            const Memory::Stats& memory = snapshot.memory;
+            const double values[] = {
+                static_cast<double>(memory.total), static_cast<double>(memory.free),
+                static_cast<double>(memory.available), static_cast<double>(memory.cached),
+                static_cast<double>(memory.buffers), static_cast<double>(memory.swapFree)
+            };
+            appendGroup("memory", "", {".total", ".free", ".available", ".cached", ".buffers", ".swapFree"},
+                        Type::Integer, values, time);
+        }
+        if (snapshot.timing(Source::Processor).sampled) {
+            const Processor::Stats& processor = snapshot.processor;
+            double total = processor.totalUtilization;
+            appendGroup("cpu", "", {".utilization"}, Type::Double, &total, time);
+            for (std::size_t cpu = 0; cpu < processor.perCoreUtilization.size(); ++cpu) {
+                double core = processor.perCoreUtilization[cpu];
+                appendGroup("cpu", std::to_string(cpu), {".utilization"}, Type::Double, &core, time);
+            }
+        }
+        if (snapshot.timing(Source::Disk).sampled) {
+            for (const auto& disk : snapshot.disks) {
+                const double values[] = {
+                    disk.readBytesPerSec, disk.writeBytesPerSec, disk.readIops, disk.writeIops,
+                    disk.avgQueueDepth, disk.utilization
+                };
+                appendGroup("disk.", disk.name, {".readBytesPerSec", ".writeBytesPerSec", ".readIops",
+                            ".writeIops", ".avgQueueDepth", ".utilization"}, Type::Double, values, time);
+            }
+        }
+        if (snapshot.timing(Source::Network).sampled) {
+            for (const auto& interface : snapshot.interfaces) {
+                const double values[] = {
+                    interface.rxBytesPerSec, interface.txBytesPerSec, interface.rxPacketsPerSec,
+                    interface.txPacketsPerSec, interface.rxDropsPerSec, interface.txDropsPerSec
+                };
+                appendGroup("net.", interface.name, {".rxBytesPerSec", ".txBytesPerSec", ".rxPacketsPerSec",
+                            ".txPacketsPerSec", ".rxDropsPerSec", ".txDropsPerSec"}, Type::Double, values, time);
+            }
+        }
+        if (snapshot.timing(Source::Protocols).sampled) {
+            const Network::ProtocolStats& protocols = snapshot.protocols;
+            const double values[] = {
+                protocols.retransSegsPerSec, protocols.listenDropsPerSec, protocols.timeoutsPerSec
+            };
+            appendGroup("tcp", "", {".retransSegsPerSec", ".listenDropsPerSec", ".timeoutsPerSec"},
+                        Type::Double, values, time);
+        }
+        if (snapshot.timing(Source::Pressure).sampled) {
+            static const std::string KINDS[] = {"cpu.some", "cpu.full", "memory.some", "memory.full", "io.some", "io.full"};
+            const SystemSnapshot::Pressure& pressure = snapshot.pressure;
+            const SystemSnapshot::Stall* stalls[] = {
+                &pressure.cpu.some, &pressure.cpu.full, &pressure.memory.some,
+                &pressure.memory.full, &pressure.io.some, &pressure.io.full
+            };
+            for (std::size_t i = 0; i < 6; ++i) {
+                const double values[] = {stalls[i]->avg10, stalls[i]->avg60, stalls[i]->avg300};
+                appendGroup("pressure.", KINDS[i], {".avg10", ".avg60", ".avg300"}, Type::Double, values, time);
+            }
+        }
+        if (snapshot.timing(Source::Cgroups).sampled) {
+            for (const auto& cgroup : snapshot.cgroups) {
+                const double values[] = {
+                    cgroup.cpuUsage, static_cast<double>(cgroup.usage.memoryCurrent),
+                    cgroup.ioReadBytesPerSec, cgroup.ioWriteBytesPerSec
+                };
+                appendGroup("cgroup:", cgroup.path, {".cpuUsage", ".memoryCurrent", ".ioReadBytesPerSec",
+                            ".ioWriteBytesPerSec"}, Type::Double, values, time);
+            }
+        }
+    }
+
+    void query(SeriesId id, Clock::time_point from, Clock::time_point to, std::vector<Sample>& samples) const {
+        int64_t first = toMillis(from), last = toMillis(to);
+        samples.clear();
+
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        const Series& s = at(id);
+        for (const Block& block : s.blocks) {
+            if (block.lastTime < first) continue;
+            if (block.firstTime > last) break;
+            decode(s, block, [&](int64_t time, double value) {
+                if (time >= first && time <= last) {
+                    samples.push_back({fromMillis(time), value});
+                }
+            });
+        }
+    }
+
+    Aggregate aggregate(SeriesId id, Clock::time_point from, Clock::time_point to) const {
+        int64_t first = toMillis(from), last = toMillis(to);
+        Aggregate result{0, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), 0.0, 0, 0};
+        auto add = [&result](double value) {
+            result.min = std::min(result.min, value);
+            result.max = std::max(result.max, value);
+            result.sum += value;
+            ++result.count;
+        };
+
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        const Series& s = at(id);
+        for (const Block& block : s.blocks) {
+            if (block.lastTime < first) continue;
+            if (block.firstTime > last) break;
+            if (block.firstTime >= first && block.lastTime <= last) {
+                result.min = std::min(result.min, block.min);
+                result.max = std::max(result.max, block.max);
+                result.sum += block.sum;
+                result.count += block.count;
+                ++result.blocksSummarized;
+                continue;
+            }
+            decode(s, block, [&](int64_t time, double value) {
+                if (time >= first && time <= last) add(value);
+            });
+            ++result.blocksDecoded;
+        }
+        if (result.count == 0) {
+            result.min = result.max = 0.0;
+        }
+        return result;
+    }
+
+    Downsampled getBuckets(SeriesId id, Clock::time_point from, Clock::time_point to,
+                           std::chrono::milliseconds resolution) const {
+        int64_t first = toMillis(from), last = toMillis(to);
+        int64_t width = std::max<int64_t>(resolution.count(), 1);
+        Downsampled result{std::chrono::milliseconds(0), {}};
+
+        auto add = [&](int64_t time, std::size_t count, double min, double max, double sum, double lastValue) {
+            int64_t start = bucketStart(time, width);
+            if (result.buckets.empty() || toMillis(result.buckets.back().start) != start) {
+                result.buckets.push_back({fromMillis(start), 0, min, max, 0.0, lastValue});
+            }
+            Bucket& bucket = result.buckets.back();
+            bucket.count += count;
+            bucket.min = std::min(bucket.min, min);
+            bucket.max = std::max(bucket.max, max);
+            bucket.sum += sum;
+            bucket.last = lastValue;
+        };
+
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        const Series& s = at(id);
+        if (s.blocks.empty()) return result;
+        // Nothing is stored past the newest sample; a far-future 'to' must not walk empty buckets
+        last = std::min(last, s.previousTime);
+        if (first > last) return result;
+
+        std::size_t source = chooseSource(s, first, width);
+        if (source == 0) {
+            for (const Block& block : s.blocks) {
+                if (block.lastTime < first) continue;
+                if (block.firstTime > last) break;
+                decode(s, block, [&](int64_t time, double value) {
+                    if (time >= first && time <= last) add(time, 1, value, value, value, value);
+                });
+            }
+            return result;
+        }
+
+        const TierLayout& layout = tierLayouts[source - 1];
+        result.sourceResolution = std::chrono::milliseconds(layout.width);
+        const std::vector<RollupBucket>& ring = s.rollups[source - 1];
+        int64_t oldest = coverageStart(s, source);
+        for (int64_t start = bucketStart(std::max(first, oldest), layout.width); start <= last; start += layout.width) {
+            const RollupBucket& bucket = ring[slot(start, layout)];
+            if (bucket.start == start && bucket.count) {
+                add(start, bucket.count, bucket.min, bucket.max, bucket.sum, bucket.last);
+            }
+        }
+        return result;
+    }
+
+    const std::vector<Tier>& getTiers() const {
+        return tiers;
+    }
+
+    Stats getStats() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        Stats stats{series.size(), 0, 0, 0, 0, 0};
+        for (const auto& s : series) {
+            stats.bytes += sizeof(Series) + s->name.capacity();
+            for (const auto& ring : s->rollups) {
+                stats.rollupBytes += ring.capacity() * sizeof(RollupBucket);
+            }
+            for (const Block& block : s->blocks) {
+                ++stats.blocks;
+                stats.samples += block.count;
+                stats.bytes += sizeof(Block) + blockWords * sizeof(uint64_t);
+                stats.encodedBytes += (block.bits + 7) / 8;
+            }
+        }
+        return stats;
+    }
+
+    void clear() {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        series.clear();
+        index.clear();
+        groups.clear();
+        spares.clear();
+    }
+
+private:
+    const Series& at(SeriesId id) const {
+        if (id >= series.size()) {
+            throw std::out_of_range("Unknown series: " + std::to_string(id));
+        }
+        return *series[id];
+    }
+
+    SeriesId seriesLocked(const std::string& name, Type type) {
+        auto it = index.find(name);
+        if (it != index.end()) return it->second;
+        auto s = std::make_unique<Series>();
+        s->name = name;
+        s->type = type;
+        series.push_back(std::move(s));
+        index.emplace(name, series.size() - 1);
+        return series.size() - 1;
+    }
+
+    // Snapshot metrics are looked up per entity ("disk.sda"), so steady-state
+    // appends do not build a name per metric
+    template <std::size_t N>
+    void appendGroup(const char* prefix, const std::string& entity, const char* const (&suffixes)[N],
+                     Type type, const double* values, int64_t time) {
+        std::string key = prefix;
+        key += entity;
+        auto it = groups.find(key);
+        if (it == groups.end()) {
+            std::vector<SeriesId> ids;
+            for (const char* suffix : suffixes) {
+                ids.push_back(seriesLocked(key + suffix, type));
+            }
+            it = groups.emplace(key, std::move(ids)).first;
+        }
+        for (std::size_t i = 0; i < N; ++i) {
+            appendLocked(it->second[i], time, values[i]);
+        }
+    }
+
+    bool appendLocked(SeriesId id, int64_t time, double value) {
+        if (id >= series.size()) {
+            throw std::out_of_range("Unknown series: " + std::to_string(id));
+        }
+        Series& s = *series[id];
+        if (!s.blocks.empty() && time < s.previousTime) {
+            return false;
+        }
+
+        uint64_t bits;
+        if (s.type == Type::Integer) {
+            int64_t integer = static_cast<int64_t>(std::llround(value));
+            value = static_cast<double>(integer);
+            bits = static_cast<uint64_t>(integer);
+        } else {
+            std::memcpy(&bits, &value, sizeof(bits));
+        }
+
+        if (s.blocks.empty() && s.rollups.empty()) {
+            s.firstTime = time;
+            s.rollups.resize(tierLayouts.size());
+            for (std::size_t t = 0; t < tierLayouts.size(); ++t) {
+                s.rollups[t].resize(tierLayouts[t].slots);
+            }
+        }
+        if (s.blocks.empty() || s.blocks.back().bits + MAX_SAMPLE_BITS > blockWords * 64) {
+            openBlock(s, time, value, bits);
+        } else {
+            encode(s, s.blocks.back(), time, bits);
+            Block& block = s.blocks.back();
+            block.lastTime = time;
+            block.min = std::min(block.min, value);
+            block.max = std::max(block.max, value);
+            block.sum += value;
+            ++block.count;
+        }
+
+        for (std::size_t t = 0; t < tierLayouts.size(); ++t) {
+            addToRollup(s, t, time, value);
+        }
+
+        // Retire blocks that ended before the retention window
+        while (s.blocks.size() > 1 && s.blocks.front().lastTime < time - retention) {
+            spares.push_back(std::move(s.blocks.front().words));
+            s.blocks.pop_front();
+        }
+        return true;
+    }
+
+    static int64_t bucketStart(int64_t time, int64_t width) {
+        int64_t start = time - time % width;
+        return time < 0 && time % width ? start - width : start;
+    }
+
+    // O(1): the ring slot of the sample's bucket is reset if it still holds
+    // an expired bucket, then updated in place
+    void addToRollup(Series& s, std::size_t tier, int64_t time, double value) {
+        const TierLayout& layout = tierLayouts[tier];
+        int64_t start = bucketStart(time, layout.width);
+        RollupBucket& bucket = s.rollups[tier][slot(start, layout)];
+        if (bucket.start != start) {
+            bucket = RollupBucket{start, 0, value, value, 0.0, value};
+        }
+        bucket.min = std::min(bucket.min, value);
+        bucket.max = std::max(bucket.max, value);
+        bucket.sum += value;
+        bucket.last = value;
+        ++bucket.count;
+    }
+
+    static std::size_t slot(int64_t start, const TierLayout& layout) {
+        int64_t index = (start / layout.width) % static_cast<int64_t>(layout.slots);
+        return static_cast<std::size_t>(index < 0 ? index + static_cast<int64_t>(layout.slots) : index);
+    }
+
+    // Oldest time a source still has data for; source 0 is the raw blocks,
+    // source t + 1 is tier t
+    int64_t coverageStart(const Series& s, std::size_t source) const {
+        if (source == 0) {
+            return s.blocks.front().firstTime;
+        }
+        const TierLayout& layout = tierLayouts[source - 1];
+        int64_t newest = bucketStart(s.previousTime, layout.width);
+        return std::max(s.firstTime, newest - static_cast<int64_t>(layout.slots - 1) * layout.width);
+    }
+
+    std::size_t chooseSource(const Series& s, int64_t from, int64_t width) const {
+        int64_t needed = std::max(from, s.firstTime);
+        auto resolution = [this](std::size_t source) {
+            return source == 0 ? int64_t(0) : tierLayouts[source - 1].width;
+        };
+        std::size_t sources = tierLayouts.size() + 1;
+        std::size_t best = sources;
+        // Coarsest covering source at least as fine as asked
+        for (std::size_t source = 0; source < sources; ++source) {
+            if (resolution(source) <= width && coverageStart(s, source) <= needed &&
+                (best == sources || resolution(source) > resolution(best))) {
+                best = source;
+            }
+        }
+        if (best != sources) return best;
+        // Finest covering source
+        for (std::size_t source = 0; source < sources; ++source) {
+            if (coverageStart(s, source) <= needed && (best == sources || resolution(source) < resolution(best))) {
+                best = source;
+            }
+        }
+        if (best != sources) return best;
+        // Whatever reaches furthest back
+        best = 0;
+        for (std::size_t source = 1; source < sources; ++source) {
+            if (coverageStart(s, source) < coverageStart(s, best)) best = source;
+        }
+        return best;
+    }
+
+    // A block starts with its first sample in full
+    void openBlock(Series& s, int64_t time, double value, uint64_t bits) {
+        Block block;
+        if (!spares.empty()) {
+            block.words = std::move(spares.back());
+            spares.pop_back();
+            std::memset(block.words.get(), 0, blockWords * sizeof(uint64_t));
+        } else {
+            block.words = std::make_unique<uint64_t[]>(blockWords);
+        }
+        writeBits(block.words.get(), block.bits, static_cast<uint64_t>(time), 64);
+        writeBits(block.words.get(), block.bits, bits, 64);
+        block.count = 1;
+        block.firstTime = block.lastTime = time;
+        block.min = block.max = block.sum = value;
+        s.blocks.push_back(std::move(block));
+
+        s.previousTime = time;
+        s.previousDelta = 0;
+        s.previousBits = bits;
+        s.previousLeading = 64;
+        s.previousTrailing = 64;
+    }
+
+    static void encode(Series& s, Block& block, int64_t time, uint64_t bits) {
+        uint64_t* words = block.words.get();
+        std::size_t& position = block.bits;
+
+        int64_t delta = time - s.previousTime;
+        int64_t deltaOfDelta = delta - s.previousDelta;
+        if (deltaOfDelta == 0) {
+            writeBits(words, position, 0b0, 1);
+        } else if (fits(deltaOfDelta, 7)) {
+            writeBits(words, position, 0b10, 2);
+            writeBits(words, position, static_cast<uint64_t>(deltaOfDelta), 7);
+        } else if (fits(deltaOfDelta, 9)) {
+            writeBits(words, position, 0b110, 3);
+            writeBits(words, position, static_cast<uint64_t>(deltaOfDelta), 9);
+        } else if (fits(deltaOfDelta, 12)) {
+            writeBits(words, position, 0b1110, 4);
+            writeBits(words, position, static_cast<uint64_t>(deltaOfDelta), 12);
+        } else {
+            writeBits(words, position, 0b1111, 4);
+            writeBits(words, position, static_cast<uint64_t>(deltaOfDelta), 64);
+        }
+        s.previousTime = time;
+        s.previousDelta = delta;
+
+        uint64_t xored = bits ^ s.previousBits;
+        s.previousBits = bits;
+        if (xored == 0) {
+            writeBits(words, position, 0b0, 1);
+            return;
+        }
+        unsigned int leading = std::min(static_cast<unsigned int>(__builtin_clzll(xored)), 31u);
+        unsigned int trailing = static_cast<unsigned int>(__builtin_ctzll(xored));
+        if (s.previousLeading + s.previousTrailing < 64 &&
+            leading >= s.previousLeading && trailing >= s.previousTrailing) {
+            // Meaningful bits fit in the previous window
+            writeBits(words, position, 0b10, 2);
+            writeBits(words, position, xored >> s.previousTrailing, 64 - s.previousLeading - s.previousTrailing);
+        } else {
+            unsigned int meaningful = 64 - leading - trailing;
+            writeBits(words, position, 0b11, 2);
+            writeBits(words, position, leading, 5);
+            writeBits(words, position, meaningful - 1, 6);
+            writeBits(words, position, xored >> trailing, meaningful);
+            s.previousLeading = leading;
+            s.previousTrailing = trailing;
+        }
+    }
+
+    template <typename Visit>
+    static void decode(const Series& s, const Block& block, Visit&& visit) {
+        const uint64_t* words = block.words.get();
+        std::size_t position = 0;
+        int64_t time = static_cast<int64_t>(readBits(words, position, 64));
+        uint64_t bits = readBits(words, position, 64);
+        int64_t delta = 0;
+        unsigned int leading = 64, trailing = 64;
+        visit(time, toValue(s.type, bits));
+
+        for (std::size_t i = 1; i < block.count; ++i) {
+            int64_t deltaOfDelta = 0;
+            if (readBits(words, position, 1)) {
+                if (!readBits(words, position, 1)) {
+                    deltaOfDelta = signExtend(readBits(words, position, 7), 7);
+                } else if (!readBits(words, position, 1)) {
+                    deltaOfDelta = signExtend(readBits(words, position, 9), 9);
+                } else if (!readBits(words, position, 1)) {
+                    deltaOfDelta = signExtend(readBits(words, position, 12), 12);
+                } else {
+                    deltaOfDelta = static_cast<int64_t>(readBits(words, position, 64));
+                }
+            }
+            delta += deltaOfDelta;
+            time += delta;
+
+            if (readBits(words, position, 1)) {
+                if (readBits(words, position, 1)) {
+                    leading = static_cast<unsigned int>(readBits(words, position, 5));
+                    unsigned int meaningful = static_cast<unsigned int>(readBits(words, position, 6)) + 1;
+                    trailing = 64 - leading - meaningful;
+                }
+                bits ^= readBits(words, position, 64 - leading - trailing) << trailing;
+            }
+            visit(time, toValue(s.type, bits));
+        }
+    }
+
+    static double toValue(Type type, uint64_t bits) {
+        if (type == Type::Integer) {
+            return static_cast<double>(static_cast<int64_t>(bits));
+        }
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    const int64_t retention;            // milliseconds
+    const std::size_t blockWords;
+    const std::vector<Tier> tiers;
+    std::vector<TierLayout> tierLayouts;
+
+    std::vector<std::unique_ptr<Series>> series;
+    std::unordered_map<std::string, SeriesId> index;
+    std::unordered_map<std::string, std::vector<SeriesId>> groups;
+    std::vector<std::unique_ptr<uint64_t[]>> spares;     // retired block storage
+    mutable std::shared_mutex mutex;
+};
+
+History::History()
+    : History(std::chrono::hours(1), 1024, {{std::chrono::minutes(1), std::chrono::hours(24)},
+                                            {std::chrono::hours(1), std::chrono::hours(24 * 30)}}) {}
+
+History::History(std::chrono::seconds retention, std::size_t blockBytes)
+    : pImpl(std::make_unique<Impl>(retention, blockBytes, std::vector<Tier>())) {}
+
+History::History(std::chrono::seconds retention, std::size_t blockBytes, const std::vector<Tier>& tiers)
+    : pImpl(std::make_unique<Impl>(retention, blockBytes, tiers)) {}
+
+History::~History() = default;
+
+History::SeriesId History::getSeries(const std::string& name, Type type) {
+    return pImpl->getSeries(name, type);
+}
+
+History::SeriesId History::findSeries(const std::string& name) const {
+    return pImpl->findSeries(name);
+}
+
+std::vector<std::string> History::getSeriesNames() const {
+    return pImpl->getSeriesNames();
+}
+
+bool History::append(SeriesId series, Clock::time_point time, double value) {
+    return pImpl->append(series, time, value);
+}
+
+bool History::append(const std::string& name, Clock::time_point time, double value) {
+    return pImpl->append(pImpl->getSeries(name, Type::Double), time, value);
+}
+
+void History::append(const SystemSnapshot::Snapshot& snapshot) {
+    pImpl->append(snapshot);
+}
+
+std::vector<History::Sample> History::query(SeriesId series, Clock::time_point from, Clock::time_point to) const {
+    std::vector<Sample> samples;
+    pImpl->query(series, from, to, samples);
+    return samples;
+}
+
+void History::query(SeriesId series, Clock::time_point from, Clock::time_point to, std::vector<Sample>& samples) const {
+    pImpl->query(series, from, to, samples);
+}
+
+History::Aggregate History::aggregate(SeriesId series, Clock::time_point from, Clock::time_point to) const {
+    return pImpl->aggregate(series, from, to);
+}
+
+History::Downsampled History::getBuckets(SeriesId series, Clock::time_point from, Clock::time_point to,
+                                        std::chrono::milliseconds resolution) const {
+    return pImpl->getBuckets(series, from, to, resolution);
+}
+
+const std::vector<History::Tier>& History::getTiers() const {
+    return pImpl->getTiers();
+}
+
+History::Stats History::getStats() const {
+    return pImpl->getStats();
+}
+
+void History::clear() {
+    pImpl->clear();
+}
+
+} // namespace kuserspace
@@ -13,14 +13,12 @@ namespace kuserspace {
 // Initialize static member
 Memory* Memory::instance = nullptr;
 
-Memory::Memory() : isUpdating(false) {
+Memory::Memory(const Root& root) : root(root), isUpdating(false) {
     updateStats();
 }
 
 Memory::~Memory() {
     stopMonitoring();
-    delete instance;
-    instance = nullptr;
 }
 
 void Memory::updateStats() {
@@ -34,7 +32,7 @@ void Memory::updateStats() {
 
 void Memory::readProcMeminfo() {
     Buffer buffer;
-    auto result = buffer.read("/proc/meminfo");
+    auto result = buffer.read(root.procPath("/meminfo"));
     
     if (!result.first) {
         return;
@@ -47,7 +45,8 @@ void Memory::readProcMeminfo() {
     // Regular expressions for parsing
     std::regex memTotalRegex(R"(MemTotal:\s+(\d+))");
     std::regex memFreeRegex(R"(MemFree:\s+(\d+))");
-    std::regex cachedRegex(R"(Cached:\s+(\d+))");
+    std::regex memAvailableRegex(R"(MemAvailable:\s+(\d+))");
+    std::regex cachedRegex(R"(^Cached:\s+(\d+))");
     std::regex buffersRegex(R"(Buffers:\s+(\d+))");
     std::regex activeRegex(R"(Active:\s+(\d+))");
     std::regex inactiveRegex(R"(Inactive:\s+(\d+))");
@@ -79,6 +78,9 @@ void Memory::readProcMeminfo() {
         else if (std::regex_search(line, matches, memFreeRegex)) {
             currentState.free = std::stoull(matches[1]) * 1024;
         }
+        else if (std::regex_search(line, matches, memAvailableRegex)) {
+            currentState.available = std::stoull(matches[1]) * 1024;
+        }
         else if (std::regex_search(line, matches, cachedRegex)) {
             currentState.cached = std::stoull(matches[1]) * 1024;
         }
@@ -150,7 +152,7 @@ void Memory::readProcMeminfo() {
 
 void Memory::readProcSwaps() {
     Buffer buffer;
-    auto result = buffer.read("/proc/swaps");
+    auto result = buffer.read(root.procPath("/swaps"));
     
     if (!result.first) {
         return;
@@ -179,7 +181,7 @@ void Memory::readProcSwaps() {
 }
 
 void Memory::readMemoryZones() {
-    const std::string zonePath = "/proc/zoneinfo";
+    const std::string zonePath = root.procPath("/zoneinfo");
     Buffer buffer;
     auto result = buffer.read(zonePath);
     
@@ -230,8 +232,9 @@ void Memory::readMemoryZones() {
 }
 
 void Memory::readNumaInfo() {
-    const std::string numaPath = "/sys/devices/system/node/";
-    for (const auto& entry : std::filesystem::directory_iterator(numaPath)) {
+    const std::string numaPath = root.sysPath("/devices/system/node/");
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(numaPath, ec)) {
         if (entry.path().filename().string().find("node") == 0) {
             int nodeId = std::stoi(entry.path().filename().string().substr(4));
             State::NumaNode node;
@@ -283,8 +286,9 @@ void Memory::readNumaInfo() {
 }
 
 void Memory::readHugePages() {
-    const std::string hugePagesPath = "/sys/kernel/mm/hugepages/";
-    for (const auto& entry : std::filesystem::directory_iterator(hugePagesPath)) {
+    const std::string hugePagesPath = root.sysPath("/kernel/mm/hugepages/");
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(hugePagesPath, ec)) {
         if (entry.path().filename().string().find("hugepages-") == 0) {
             std::string sizeStr = entry.path().filename().string().substr(10);
             size_t pageSize = std::stoull(sizeStr) * 1024; // Convert KB to bytes
@@ -316,6 +320,10 @@ void Memory::readHugePages() {
     }
 }
 
+void Memory::refresh() {
+    updateStats();
+}
+
 Memory::Stats Memory::getStats() {
     std::shared_lock<std::shared_mutex> lock(mutex);
     return {
@@ -344,7 +352,8 @@ Memory::Stats Memory::getStats() {
         currentState.hugePageSize,
         currentState.directMap4k,
         currentState.directMap2M,
-        currentState.directMap1G
+        currentState.directMap1G,
+        currentState.available
     };
 }
 
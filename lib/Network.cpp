@@ -0,0 +1,995 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Network.h"
+#include "../include/Buffer.h"
+#include "../include/Parser.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+#include <map>
+#include <cstring>
+#include <cctype>
+#include <filesystem>
+#include <unordered_map>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#include <linux/tcp.h>
+
+namespace kuserspace {
+
+namespace {
+
+// Counter delta, treating a backwards step (wrap or interface reset) as no activity
+inline uint64_t delta(uint64_t current, uint64_t previous) {
+    return current >= previous ? current - previous : 0;
+}
+
+// Files under /sys/class/net/<if>/statistics, in ErrorDetail order
+const char* const DETAIL_FILES[] = {
+    "rx_crc_errors",
+    "rx_length_errors",
+    "rx_missed_errors",
+    "rx_over_errors",
+    "rx_nohandler",
+    "tx_aborted_errors",
+    "tx_heartbeat_errors",
+    "tx_window_errors",
+};
+constexpr size_t NUM_DETAIL_FILES = sizeof(DETAIL_FILES) / sizeof(DETAIL_FILES[0]);
+
+// Protocol tables use a header row of column names followed by a value row
+// with the same prefix, e.g. "Tcp: ... RetransSegs ..." / "Tcp: ... 1234 ..."
+const char* const PROTOCOL_FILES[] = {"/net/snmp", "/net/netstat"};     // under /proc
+
+struct ProtocolColumn {
+    size_t file;                // index into PROTOCOL_FILES
+    const char* section;
+    const char* name;
+    uint64_t Network::ProtocolCounters::* member;
+};
+
+const ProtocolColumn PROTOCOL_COLUMNS[] = {
+    {0, "Tcp", "InSegs", &Network::ProtocolCounters::tcpInSegs},
+    {0, "Tcp", "OutSegs", &Network::ProtocolCounters::tcpOutSegs},
+    {0, "Tcp", "RetransSegs", &Network::ProtocolCounters::tcpRetransSegs},
+    {0, "Tcp", "InErrs", &Network::ProtocolCounters::tcpInErrors},
+    {0, "Udp", "InErrors", &Network::ProtocolCounters::udpInErrors},
+    {0, "Udp", "RcvbufErrors", &Network::ProtocolCounters::udpRcvbufErrors},
+    {1, "TcpExt", "ListenOverflows", &Network::ProtocolCounters::tcpListenOverflows},
+    {1, "TcpExt", "ListenDrops", &Network::ProtocolCounters::tcpListenDrops},
+    {1, "TcpExt", "TCPTimeouts", &Network::ProtocolCounters::tcpTimeouts},
+};
+
+// IRQ number -> action name (last column) from /proc/interrupts
+std::unordered_map<int, std::string> readIrqNames(const Root& root) {
+    std::unordered_map<int, std::string> names;
+    PersistentFile interrupts;
+    if (!interrupts.open(root.procPath("/interrupts"))) return names;
+
+    auto content = interrupts.read();
+    std::string_view rest = content ? *content : std::string_view();
+    while (!rest.empty()) {
+        std::string_view line = Parser::nextLine(rest);
+        std::string_view irq = Parser::nextToken(line);
+        if (irq.empty() || !std::isdigit(static_cast<unsigned char>(irq[0]))) continue;
+
+        std::string_view last;
+        for (auto token = Parser::nextToken(line); !token.empty(); token = Parser::nextToken(line)) {
+            last = token;
+        }
+        names.emplace(static_cast<int>(Parser::toUnsigned(irq)), std::string(last));
+    }
+    return names;
+}
+
+// Queue a NIC vector serves, from driver naming conventions such as
+// "eth0-TxRx-3", "eth0-rx-3", "virtio3-input.3" or "mlx5_comp3@pci:...".
+// Returns -1 for vectors that are not per-queue (config, async events).
+int irqQueue(std::string_view name, const std::string& interface, bool& receive, bool& transmit) {
+    name = name.substr(0, name.find('@'));
+    if (name == interface) return -1;
+
+    size_t digits = name.size();
+    while (digits > 0 && std::isdigit(static_cast<unsigned char>(name[digits - 1]))) {
+        --digits;
+    }
+    if (digits == name.size() || digits == 0) return -1;
+
+    std::string lower(name.substr(0, digits));
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    bool rx = lower.find("rx") != std::string::npos || lower.find("input") != std::string::npos;
+    bool tx = lower.find("tx") != std::string::npos || lower.find("output") != std::string::npos;
+    receive = rx || !tx;        // combined vectors ("comp", "TxRx") serve both
+    transmit = tx || !rx;
+    return static_cast<int>(Parser::toUnsigned(name.substr(digits)));
+}
+
+bool sameQueue(const Network::QueueInfo& a, const Network::QueueInfo& b) {
+    if (a.name != b.name || a.numaNode != b.numaNode || a.irqs != b.irqs || a.queues.size() != b.queues.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.queues.size(); ++i) {
+        const auto& x = a.queues[i];
+        const auto& y = b.queues[i];
+        if (x.receive != y.receive || x.index != y.index || x.steeringCpus != y.steeringCpus ||
+            x.irqs != y.irqs || x.irqCpus != y.irqCpus) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Kernel-side port filter: each comparison is an op followed by a second op
+// holding the port. A match falls through to the next comparison; a miss
+// jumps past the end of the program, which rejects the socket.
+std::vector<inet_diag_bc_op> buildBytecode(const SocketInspector::Filter& filter) {
+    struct Comparison {
+        uint8_t code;
+        uint16_t port;
+    };
+    std::vector<Comparison> comparisons;
+    if (filter.localPortMin > 0) comparisons.push_back({INET_DIAG_BC_S_GE, filter.localPortMin});
+    if (filter.localPortMax < 65535) comparisons.push_back({INET_DIAG_BC_S_LE, filter.localPortMax});
+    if (filter.remotePortMin > 0) comparisons.push_back({INET_DIAG_BC_D_GE, filter.remotePortMin});
+    if (filter.remotePortMax < 65535) comparisons.push_back({INET_DIAG_BC_D_LE, filter.remotePortMax});
+
+    constexpr uint16_t OP_SIZE = 2 * sizeof(inet_diag_bc_op);
+    std::vector<inet_diag_bc_op> program;
+    uint16_t remaining = static_cast<uint16_t>(comparisons.size() * OP_SIZE);
+    for (const auto& comparison : comparisons) {
+        program.push_back({comparison.code, OP_SIZE, static_cast<uint16_t>(remaining + 4)});
+        program.push_back({0, 0, comparison.port});
+        remaining = static_cast<uint16_t>(remaining - OP_SIZE);
+    }
+    return program;
+}
+
+} // namespace
+
+class Network::Impl {
+public:
+    struct Interface {
+        InterfaceStats stats;
+        std::vector<PersistentFile> detailFiles;    // opened on first detailed sample
+        bool fresh;                                 // no previous sample yet
+    };
+
+    // Where the wanted columns sit in one protocol file: each row is a value
+    // line number, its expected prefix and the columns to decode from it
+    struct ProtocolTable {
+        struct Row {
+            size_t line;
+            std::string prefix;
+            std::vector<std::pair<size_t, uint64_t ProtocolCounters::*>> columns;
+        };
+
+        PersistentFile file;
+        std::vector<Row> rows;
+        bool mapped = false;
+    };
+
+    struct Threshold {
+        double ratePerSec;
+        ThresholdCallback callback;
+    };
+
+    explicit Impl(const Root& root)
+        : root(root), protocolMonitoringActive(false), monitoringActive(false), detailed(false) {
+        netdev.open(root.procPath("/net/dev"));
+        cpuNodes = Parser::readCpuNodes(root.sysPath("/devices/system/node"));
+        sample();
+    }
+
+    void sample() {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+
+        auto content = netdev.read();
+        if (!content) return;
+
+        auto now = std::chrono::steady_clock::now();
+        interval = now - lastSample;
+        lastSample = now;
+        double seconds = std::chrono::duration<double>(interval).count();
+
+        // Two header lines, then "name: rx fields... tx fields..." where the
+        // name is padded on the left and large counters may touch the colon
+        size_t count = 0;
+        std::string_view rest = *content;
+        while (!rest.empty()) {
+            std::string_view line = Parser::nextLine(rest);
+            size_t colon = line.find(':');
+            if (colon == std::string_view::npos) continue;
+
+            std::string_view name = line.substr(0, colon);
+            name.remove_prefix(std::min(name.find_first_not_of(' '), name.size()));
+            if (Parser::splitFields(line.substr(colon + 1), fields) < 16) continue;
+
+            Interface& interface = findInterface(name, count++);
+            Counters previous = interface.stats.counters;
+            Counters& c = interface.stats.counters;
+
+            c.rxBytes = Parser::toUnsigned(fields[0]);
+            c.rxPackets = Parser::toUnsigned(fields[1]);
+            c.rxErrors = Parser::toUnsigned(fields[2]);
+            c.rxDropped = Parser::toUnsigned(fields[3]);
+            c.rxFifoErrors = Parser::toUnsigned(fields[4]);
+            c.rxFrameErrors = Parser::toUnsigned(fields[5]);
+            c.rxCompressed = Parser::toUnsigned(fields[6]);
+            c.rxMulticast = Parser::toUnsigned(fields[7]);
+            c.txBytes = Parser::toUnsigned(fields[8]);
+            c.txPackets = Parser::toUnsigned(fields[9]);
+            c.txErrors = Parser::toUnsigned(fields[10]);
+            c.txDropped = Parser::toUnsigned(fields[11]);
+            c.txFifoErrors = Parser::toUnsigned(fields[12]);
+            c.collisions = Parser::toUnsigned(fields[13]);
+            c.txCarrierErrors = Parser::toUnsigned(fields[14]);
+            c.txCompressed = Parser::toUnsigned(fields[15]);
+
+            if (detailed) {
+                readDetail(interface);
+            }
+
+            if (interface.fresh) {
+                interface.fresh = false;
+            } else if (seconds > 0.0) {
+                computeRates(interface.stats, previous, seconds);
+            }
+        }
+
+        // Interfaces that disappeared were moved past the end by findInterface
+        interfaces.erase(interfaces.begin() + static_cast<std::ptrdiff_t>(count), interfaces.end());
+    }
+
+    // Assigning over existing elements keeps their name strings' storage
+    void getStats(std::vector<InterfaceStats>& result) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        result.resize(interfaces.size());
+        for (size_t i = 0; i < interfaces.size(); ++i) {
+            result[i] = interfaces[i].stats;
+        }
+    }
+
+    std::vector<InterfaceStats> getStats() const {
+        std::vector<InterfaceStats> result;
+        getStats(result);
+        return result;
+    }
+
+    InterfaceStats getInterfaceStats(const std::string& name) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (const auto& interface : interfaces) {
+            if (interface.stats.name == name) return interface.stats;
+        }
+        throw std::out_of_range("Unknown network interface: " + name);
+    }
+
+    std::chrono::steady_clock::duration getInterval() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return interval;
+    }
+
+    void setDetailed(bool enabled) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        detailed = enabled;
+        if (!enabled) {
+            for (auto& interface : interfaces) {
+                interface.detailFiles.clear();
+                interface.stats.detail = ErrorDetail{};
+            }
+        }
+    }
+
+    bool isDetailed() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return detailed;
+    }
+
+    bool refreshTopology() {
+        std::vector<QueueInfo> current = readTopology();
+
+        std::unique_lock<std::shared_mutex> lock(topologyMutex);
+        topologyLoaded = true;
+        bool changed = current.size() != topology.size() ||
+                       !std::equal(current.begin(), current.end(), topology.begin(), sameQueue);
+        if (changed) {
+            topology = std::move(current);
+            ++topologyGeneration;
+        }
+        return changed;
+    }
+
+    std::vector<QueueInfo> getTopology() {
+        ensureTopology();
+        std::shared_lock<std::shared_mutex> lock(topologyMutex);
+        return topology;
+    }
+
+    QueueInfo getQueueInfo(const std::string& name) {
+        ensureTopology();
+        std::shared_lock<std::shared_mutex> lock(topologyMutex);
+        for (const auto& info : topology) {
+            if (info.name == name) return info;
+        }
+        throw std::out_of_range("Unknown network interface: " + name);
+    }
+
+    uint64_t getTopologyGeneration() const {
+        std::shared_lock<std::shared_mutex> lock(topologyMutex);
+        return topologyGeneration;
+    }
+
+    void sampleProtocols() {
+        std::vector<std::pair<ProtocolCounter, double>> exceeded;
+        std::vector<Threshold> triggered;
+        {
+            std::unique_lock<std::shared_mutex> lock(protocolMutex);
+
+            ProtocolCounters previous = protocol.counters;
+            for (size_t i = 0; i < 2; ++i) {
+                ProtocolTable& table = tables[i];
+                // Runs on the monitoring thread, so a missing file (a Root
+                // without /proc/net) marks the stats unavailable instead of throwing
+                if (!table.file.isOpen() && !table.file.open(root.procPath(PROTOCOL_FILES[i]))) {
+                    protocol.available = false;
+                    protocolSampled = false;
+                    return;
+                }
+
+                auto content = table.file.read();
+                if (!content) continue;
+
+                // A row that moved (sections can appear at runtime) forces a remap
+                if (!table.mapped || !decodeTable(table, *content)) {
+                    mapTable(table, i, *content);
+                    decodeTable(table, *content);
+                }
+            }
+
+            protocol.available = true;
+            auto now = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(now - lastProtocolSample).count();
+            bool first = !protocolSampled;
+            lastProtocolSample = now;
+            protocolSampled = true;
+            if (first || seconds <= 0.0) return;
+
+            computeProtocolRates(protocol, previous, seconds);
+
+            for (const auto& [counter, threshold] : thresholds) {
+                double rate = protocolRate(counter);
+                if (rate >= threshold.ratePerSec) {
+                    exceeded.emplace_back(counter, rate);
+                    triggered.push_back(threshold);
+                }
+            }
+        }
+
+        // Callbacks run without the lock so they may query the collector
+        for (size_t i = 0; i < triggered.size(); ++i) {
+            triggered[i].callback(exceeded[i].first, exceeded[i].second, triggered[i].ratePerSec);
+        }
+    }
+
+    ProtocolStats getProtocolStats() const {
+        std::shared_lock<std::shared_mutex> lock(protocolMutex);
+        return protocol;
+    }
+
+    double getProtocolRate(ProtocolCounter counter) const {
+        std::shared_lock<std::shared_mutex> lock(protocolMutex);
+        return protocolRate(counter);
+    }
+
+    void setThreshold(ProtocolCounter counter, double ratePerSec, ThresholdCallback callback) {
+        std::unique_lock<std::shared_mutex> lock(protocolMutex);
+        thresholds[counter] = Threshold{ratePerSec, std::move(callback)};
+    }
+
+    void clearThreshold(ProtocolCounter counter) {
+        std::unique_lock<std::shared_mutex> lock(protocolMutex);
+        thresholds.erase(counter);
+    }
+
+    void startProtocolMonitoring(std::chrono::milliseconds period) {
+        if (protocolMonitoringActive) return;
+        protocolMonitoringActive = true;
+        protocolThread = std::thread([this, period]() {
+            while (protocolMonitoringActive) {
+                sampleProtocols();
+
+                std::unique_lock<std::mutex> lock(monitorMutex);
+                monitorCV.wait_for(lock, period, [this]() { return !protocolMonitoringActive; });
+            }
+        });
+    }
+
+    void stopProtocolMonitoring() {
+        protocolMonitoringActive = false;
+        monitorCV.notify_all();
+        if (protocolThread.joinable()) {
+            protocolThread.join();
+        }
+    }
+
+    void startMonitoring(StatsCallback callback, std::chrono::milliseconds period) {
+        if (monitoringActive) return;
+        monitoringActive = true;
+        monitoringThread = std::thread([this, callback, period]() {
+            while (monitoringActive) {
+                sample();
+                callback(getStats());
+
+                std::unique_lock<std::mutex> lock(monitorMutex);
+                monitorCV.wait_for(lock, period, [this]() { return !monitoringActive; });
+            }
+        });
+    }
+
+    void stopMonitoring() {
+        monitoringActive = false;
+        monitorCV.notify_all();
+        if (monitoringThread.joinable()) {
+            monitoringThread.join();
+        }
+    }
+
+private:
+    // Interfaces are kept in /proc/net/dev order, so the expected interface
+    // is normally already at position `index` and no lookup is needed.
+    Interface& findInterface(std::string_view name, size_t index) {
+        if (index < interfaces.size() && interfaces[index].stats.name == name) {
+            return interfaces[index];
+        }
+
+        for (size_t i = index + 1; i < interfaces.size(); ++i) {
+            if (interfaces[i].stats.name == name) {
+                std::swap(interfaces[index], interfaces[i]);
+                return interfaces[index];
+            }
+        }
+
+        Interface interface{};
+        interface.stats.name.assign(name.data(), name.size());
+        interface.fresh = true;
+        return *interfaces.insert(interfaces.begin() + static_cast<std::ptrdiff_t>(index), std::move(interface));
+    }
+
+    void readDetail(Interface& interface) const {
+        if (interface.detailFiles.empty()) {
+            std::string base = root.sysPath("/class/net/" + interface.stats.name + "/statistics/");
+            interface.detailFiles.resize(NUM_DETAIL_FILES);
+            for (size_t i = 0; i < NUM_DETAIL_FILES; ++i) {
+                interface.detailFiles[i].open(base + DETAIL_FILES[i]);
+            }
+        }
+
+        uint64_t values[NUM_DETAIL_FILES] = {};
+        for (size_t i = 0; i < NUM_DETAIL_FILES; ++i) {
+            auto& file = interface.detailFiles[i];
+            if (!file.isOpen()) continue;
+            if (auto content = file.read()) {
+                values[i] = Parser::toUnsigned(*content);
+            }
+        }
+
+        ErrorDetail& d = interface.stats.detail;
+        d.rxCrcErrors = values[0];
+        d.rxLengthErrors = values[1];
+        d.rxMissedErrors = values[2];
+        d.rxOverErrors = values[3];
+        d.rxNoHandler = values[4];
+        d.txAbortedErrors = values[5];
+        d.txHeartbeatErrors = values[6];
+        d.txWindowErrors = values[7];
+    }
+
+    void ensureTopology() {
+        {
+            std::shared_lock<std::shared_mutex> lock(topologyMutex);
+            if (topologyLoaded) return;
+        }
+        refreshTopology();
+    }
+
+    int nodeOf(int cpu) const {
+        return cpu >= 0 && static_cast<size_t>(cpu) < cpuNodes.size() ? cpuNodes[static_cast<size_t>(cpu)] : -1;
+    }
+
+    std::vector<QueueInfo> readTopology() const {
+        std::vector<QueueInfo> result;
+        DIR* dir = opendir(root.sysPath("/class/net").c_str());
+        if (!dir) return result;
+
+        std::unordered_map<int, std::string> irqNames = readIrqNames(root);
+        std::unordered_map<int, std::vector<int>> irqAffinity;
+        auto affinity = [this, &irqAffinity](int irq) -> const std::vector<int>& {
+            auto it = irqAffinity.find(irq);
+            if (it == irqAffinity.end()) {
+                it = irqAffinity.emplace(irq, Parser::parseCpuList(Parser::readAttribute(
+                    root.procPath("/irq/" + std::to_string(irq) + "/smp_affinity_list")))).first;
+            }
+            return it->second;
+        };
+
+        while (struct dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') continue;
+
+            std::string base = root.sysPath("/class/net/") + entry->d_name;
+            QueueInfo info{};
+            info.name = entry->d_name;
+            info.numaNode = -1;
+
+            // msi_irqs and numa_node sit on the bus device, which may be a
+            // parent of device/ (virtio), so walk up from it
+            std::error_code ec;
+            auto path = std::filesystem::canonical(base + "/device", ec);
+            const std::filesystem::path devices = root.sysPath("/devices");
+            for (; !ec && path.has_relative_path() && path != devices; path = path.parent_path()) {
+                if (info.irqs.empty()) {
+                    if (DIR* msi = opendir((path / "msi_irqs").c_str())) {
+                        while (struct dirent* irq = readdir(msi)) {
+                            if (std::isdigit(static_cast<unsigned char>(irq->d_name[0]))) {
+                                info.irqs.push_back(static_cast<int>(Parser::toUnsigned(irq->d_name)));
+                            }
+                        }
+                        closedir(msi);
+                        std::sort(info.irqs.begin(), info.irqs.end());
+                    }
+                }
+                if (info.numaNode < 0) {
+                    std::string node = Parser::readAttribute((path / "numa_node").string());
+                    if (!node.empty()) {
+                        info.numaNode = std::stoi(node);
+                    }
+                }
+            }
+
+            if (DIR* queues = opendir((base + "/queues").c_str())) {
+                while (struct dirent* queueEntry = readdir(queues)) {
+                    std::string_view queueName = queueEntry->d_name;
+                    bool receive = queueName.substr(0, 3) == "rx-";
+                    if (!receive && queueName.substr(0, 3) != "tx-") continue;
+
+                    Queue queue{};
+                    queue.receive = receive;
+                    queue.index = static_cast<int>(Parser::toUnsigned(queueName.substr(3)));
+                    queue.steeringCpus = Parser::parseCpuMask(Parser::readAttribute(
+                        base + "/queues/" + queueEntry->d_name + (receive ? "/rps_cpus" : "/xps_cpus")));
+                    info.queues.push_back(std::move(queue));
+                }
+                closedir(queues);
+            }
+            std::sort(info.queues.begin(), info.queues.end(), [](const Queue& a, const Queue& b) {
+                return a.receive != b.receive ? a.receive : a.index < b.index;
+            });
+
+            for (int irq : info.irqs) {
+                auto name = irqNames.find(irq);
+                if (name == irqNames.end()) continue;
+
+                bool receive = false, transmit = false;
+                int index = irqQueue(name->second, info.name, receive, transmit);
+                if (index < 0) continue;
+
+                for (auto& queue : info.queues) {
+                    if (queue.index != index || !(queue.receive ? receive : transmit)) continue;
+                    queue.irqs.push_back(irq);
+                    for (int cpu : affinity(irq)) {
+                        if (std::find(queue.irqCpus.begin(), queue.irqCpus.end(), cpu) == queue.irqCpus.end()) {
+                            queue.irqCpus.push_back(cpu);
+                        }
+                    }
+                }
+            }
+
+            for (auto& queue : info.queues) {
+                std::sort(queue.irqCpus.begin(), queue.irqCpus.end());
+                for (const auto* cpus : {&queue.irqCpus, &queue.steeringCpus}) {
+                    for (int cpu : *cpus) {
+                        int node = nodeOf(cpu);
+                        if (node < 0) continue;
+                        if (std::find(queue.numaNodes.begin(), queue.numaNodes.end(), node) == queue.numaNodes.end()) {
+                            queue.numaNodes.push_back(node);
+                        }
+                        if (info.numaNode >= 0 && node != info.numaNode) {
+                            queue.crossNode = true;
+                        }
+                    }
+                }
+                std::sort(queue.numaNodes.begin(), queue.numaNodes.end());
+                info.crossNodeQueues += queue.crossNode ? 1 : 0;
+            }
+
+            result.push_back(std::move(info));
+        }
+        closedir(dir);
+
+        std::sort(result.begin(), result.end(),
+                  [](const QueueInfo& a, const QueueInfo& b) { return a.name < b.name; });
+        return result;
+    }
+
+    void mapTable(ProtocolTable& table, size_t fileIndex, std::string_view content) {
+        table.rows.clear();
+        table.mapped = true;
+
+        std::string_view rest = content;
+        std::string_view header;
+        for (size_t line = 0; !rest.empty(); ++line) {
+            std::string_view current = Parser::nextLine(rest);
+            std::string_view prefix = current.substr(0, current.find(':') + 1);
+            if (prefix.empty()) {
+                header = std::string_view();
+                continue;
+            }
+
+            // The value row repeats its header's prefix
+            if (header.empty() || header.substr(0, prefix.size()) != prefix) {
+                header = current;
+                continue;
+            }
+
+            ProtocolTable::Row row{line, std::string(prefix), {}};
+            size_t numFields = Parser::splitFields(header, protocolFields);
+            for (const auto& column : PROTOCOL_COLUMNS) {
+                if (column.file != fileIndex || prefix.compare(0, prefix.size() - 1, column.section) != 0) {
+                    continue;
+                }
+                for (size_t i = 1; i < numFields; ++i) {
+                    if (protocolFields[i] == column.name) {
+                        row.columns.emplace_back(i, column.member);
+                        break;
+                    }
+                }
+            }
+            if (!row.columns.empty()) {
+                table.rows.push_back(std::move(row));
+            }
+            header = std::string_view();
+        }
+    }
+
+    // Decode only the mapped value rows; false if a row is not where it was
+    bool decodeTable(const ProtocolTable& table, std::string_view content) {
+        std::string_view rest = content;
+        size_t line = 0;
+        for (const auto& row : table.rows) {
+            std::string_view current;
+            while (line <= row.line && !rest.empty()) {
+                current = Parser::nextLine(rest);
+                ++line;
+            }
+            if (line != row.line + 1 || current.substr(0, row.prefix.size()) != row.prefix) {
+                return false;
+            }
+
+            size_t numFields = Parser::splitFields(current, protocolFields);
+            for (const auto& [index, member] : row.columns) {
+                if (index < numFields) {
+                    protocol.counters.*member = Parser::toUnsigned(protocolFields[index]);
+                }
+            }
+        }
+        return true;
+    }
+
+    double protocolRate(ProtocolCounter counter) const {
+        switch (counter) {
+            case ProtocolCounter::RetransSegs: return protocol.retransSegsPerSec;
+            case ProtocolCounter::ListenOverflows: return protocol.listenOverflowsPerSec;
+            case ProtocolCounter::ListenDrops: return protocol.listenDropsPerSec;
+            case ProtocolCounter::TCPTimeouts: return protocol.timeoutsPerSec;
+            case ProtocolCounter::TcpInErrors: return protocol.tcpInErrorsPerSec;
+            case ProtocolCounter::UdpInErrors: return protocol.udpInErrorsPerSec;
+            case ProtocolCounter::RcvbufErrors: return protocol.rcvbufErrorsPerSec;
+        }
+        return 0.0;
+    }
+
+    static void computeProtocolRates(ProtocolStats& stats, const ProtocolCounters& previous, double seconds) {
+        const ProtocolCounters& c = stats.counters;
+        uint64_t retrans = delta(c.tcpRetransSegs, previous.tcpRetransSegs);
+        uint64_t outSegs = delta(c.tcpOutSegs, previous.tcpOutSegs);
+
+        stats.retransSegsPerSec = retrans / seconds;
+        stats.retransmitPercent = outSegs ? 100.0 * retrans / outSegs : 0.0;
+        stats.listenOverflowsPerSec = delta(c.tcpListenOverflows, previous.tcpListenOverflows) / seconds;
+        stats.listenDropsPerSec = delta(c.tcpListenDrops, previous.tcpListenDrops) / seconds;
+        stats.timeoutsPerSec = delta(c.tcpTimeouts, previous.tcpTimeouts) / seconds;
+        stats.tcpInErrorsPerSec = delta(c.tcpInErrors, previous.tcpInErrors) / seconds;
+        stats.udpInErrorsPerSec = delta(c.udpInErrors, previous.udpInErrors) / seconds;
+        stats.rcvbufErrorsPerSec = delta(c.udpRcvbufErrors, previous.udpRcvbufErrors) / seconds;
+    }
+
+    static void computeRates(InterfaceStats& stats, const Counters& previous, double seconds) {
+        const Counters& c = stats.counters;
+        stats.rxBytesPerSec = delta(c.rxBytes, previous.rxBytes) / seconds;
+        stats.txBytesPerSec = delta(c.txBytes, previous.txBytes) / seconds;
+        stats.rxPacketsPerSec = delta(c.rxPackets, previous.rxPackets) / seconds;
+        stats.txPacketsPerSec = delta(c.txPackets, previous.txPackets) / seconds;
+        stats.rxDropsPerSec = delta(c.rxDropped, previous.rxDropped) / seconds;
+        stats.txDropsPerSec = delta(c.txDropped, previous.txDropped) / seconds;
+        stats.rxErrorsPerSec = delta(c.rxErrors, previous.rxErrors) / seconds;
+        stats.txErrorsPerSec = delta(c.txErrors, previous.txErrors) / seconds;
+    }
+
+    Root root;
+    std::vector<int> cpuNodes;      // node of each CPU of this Root, read once
+    PersistentFile netdev;
+    std::vector<Interface> interfaces;
+    std::vector<std::string_view> fields;
+    std::chrono::steady_clock::time_point lastSample;
+    std::chrono::steady_clock::duration interval{};
+    mutable std::shared_mutex mutex;
+
+    std::vector<QueueInfo> topology;
+    uint64_t topologyGeneration = 0;
+    bool topologyLoaded = false;
+    mutable std::shared_mutex topologyMutex;
+
+    ProtocolTable tables[2];
+    std::vector<std::string_view> protocolFields;
+    ProtocolStats protocol{};
+    std::map<ProtocolCounter, Threshold> thresholds;
+    std::chrono::steady_clock::time_point lastProtocolSample;
+    bool protocolSampled = false;
+    mutable std::shared_mutex protocolMutex;
+    std::atomic<bool> protocolMonitoringActive;
+    std::thread protocolThread;
+
+    std::atomic<bool> monitoringActive;
+    bool detailed;
+    std::thread monitoringThread;
+    std::mutex monitorMutex;
+    std::condition_variable monitorCV;
+};
+
+// Singleton instance
+Network& Network::getInstance() {
+    static Network instance;
+    return instance;
+}
+
+Network::Network(const Root& root) : pImpl(std::make_unique<Impl>(root)) {}
+
+Network::~Network() {
+    pImpl->stopMonitoring();
+    pImpl->stopProtocolMonitoring();
+}
+
+void Network::refresh() {
+    pImpl->sample();
+}
+
+std::vector<Network::InterfaceStats> Network::getStats() const {
+    return pImpl->getStats();
+}
+
+void Network::getStats(std::vector<InterfaceStats>& interfaces) const {
+    pImpl->getStats(interfaces);
+}
+
+Network::InterfaceStats Network::getInterfaceStats(const std::string& name) const {
+    return pImpl->getInterfaceStats(name);
+}
+
+std::future<std::vector<Network::InterfaceStats>> Network::getStatsAsync() {
+    return std::async(std::launch::async, [this]() {
+        refresh();
+        return getStats();
+    });
+}
+
+std::chrono::steady_clock::duration Network::getInterval() const {
+    return pImpl->getInterval();
+}
+
+void Network::setDetailedStats(bool enabled) {
+    pImpl->setDetailed(enabled);
+}
+
+bool Network::getDetailedStats() const {
+    return pImpl->isDetailed();
+}
+
+// Queue Topology
+bool Network::refreshQueueTopology() {
+    return pImpl->refreshTopology();
+}
+
+std::vector<Network::QueueInfo> Network::getQueueTopology() const {
+    return pImpl->getTopology();
+}
+
+Network::QueueInfo Network::getQueueInfo(const std::string& name) const {
+    return pImpl->getQueueInfo(name);
+}
+
+uint64_t Network::getQueueTopologyGeneration() const {
+    return pImpl->getTopologyGeneration();
+}
+
+// Protocol Counters
+void Network::refreshProtocolStats() {
+    pImpl->sampleProtocols();
+}
+
+Network::ProtocolStats Network::getProtocolStats() const {
+    return pImpl->getProtocolStats();
+}
+
+double Network::getProtocolRate(ProtocolCounter counter) const {
+    return pImpl->getProtocolRate(counter);
+}
+
+void Network::setProtocolThreshold(ProtocolCounter counter, double ratePerSec, ThresholdCallback callback) {
+    pImpl->setThreshold(counter, ratePerSec, std::move(callback));
+}
+
+void Network::clearProtocolThreshold(ProtocolCounter counter) {
+    pImpl->clearThreshold(counter);
+}
+
+void Network::startProtocolMonitoring(std::chrono::milliseconds interval) {
+    pImpl->startProtocolMonitoring(interval);
+}
+
+void Network::stopProtocolMonitoring() {
+    pImpl->stopProtocolMonitoring();
+}
+
+// Continuous Monitoring
+void Network::startContinuousMonitoring(StatsCallback callback, std::chrono::milliseconds interval) {
+    pImpl->startMonitoring(callback, interval);
+}
+
+void Network::stopContinuousMonitoring() {
+    pImpl->stopMonitoring();
+}
+
+// Socket Inspector
+SocketInspector::Filter& SocketInspector::Filter::only(State state) {
+    if (states == ~0u) {
+        states = 0;
+    }
+    states |= 1u << static_cast<unsigned int>(state);
+    return *this;
+}
+
+SocketInspector::SocketInspector() : sequence(0), receiveBuffer(64 * 1024) {
+    fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (fd == -1) {
+        throw std::runtime_error("Could not open netlink socket: " + std::string(strerror(errno)));
+    }
+}
+
+SocketInspector::~SocketInspector() {
+    close(fd);
+}
+
+size_t SocketInspector::dump(const Filter& filter, const SocketCallback& callback) {
+    size_t count = 0;
+    if (filter.family != Family::IPv6) dumpFamily(AF_INET, filter, callback, count);
+    if (filter.family != Family::IPv4) dumpFamily(AF_INET6, filter, callback, count);
+    return count;
+}
+
+std::vector<SocketInspector::Socket> SocketInspector::dump(const Filter& filter) {
+    std::vector<Socket> sockets;
+    dump(filter, [&sockets](const Socket& socket) { sockets.push_back(socket); });
+    return sockets;
+}
+
+void SocketInspector::dumpFamily(int family, const Filter& filter, const SocketCallback& callback, size_t& count) {
+    std::vector<inet_diag_bc_op> bytecode = buildBytecode(filter);
+    size_t bytecodeSize = bytecode.size() * sizeof(inet_diag_bc_op);
+
+    // nlmsghdr + inet_diag_req_v2 [+ INET_DIAG_REQ_BYTECODE attribute]
+    size_t requestSize = NLMSG_LENGTH(sizeof(inet_diag_req_v2));
+    size_t attributeOffset = NLMSG_ALIGN(requestSize);
+    if (bytecodeSize) {
+        requestSize = attributeOffset + RTA_LENGTH(bytecodeSize);
+    }
+    std::vector<char> request(NLMSG_ALIGN(requestSize), 0);
+
+    auto* header = reinterpret_cast<nlmsghdr*>(request.data());
+    header->nlmsg_len = static_cast<uint32_t>(requestSize);
+    header->nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    header->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    header->nlmsg_seq = ++sequence;
+
+    auto* diag = static_cast<inet_diag_req_v2*>(NLMSG_DATA(header));
+    diag->sdiag_family = static_cast<uint8_t>(family);
+    diag->sdiag_protocol = IPPROTO_TCP;
+    diag->idiag_states = filter.states;
+    diag->idiag_ext = 1 << (INET_DIAG_INFO - 1);
+
+    if (bytecodeSize) {
+        auto* attribute = reinterpret_cast<rtattr*>(request.data() + attributeOffset);
+        attribute->rta_type = INET_DIAG_REQ_BYTECODE;
+        attribute->rta_len = static_cast<unsigned short>(RTA_LENGTH(bytecodeSize));
+        memcpy(RTA_DATA(attribute), bytecode.data(), bytecodeSize);
+    }
+
+    sockaddr_nl kernel{};
+    kernel.nl_family = AF_NETLINK;
+    if (sendto(fd, request.data(), requestSize, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0) {
+        throw std::runtime_error("sock_diag request failed: " + std::string(strerror(errno)));
+    }
+
+    // The current socket is decoded in place so its strings keep their storage
+    Socket current{};
+    char address[INET6_ADDRSTRLEN];
+    while (true) {
+        ssize_t received = recv(fd, receiveBuffer.data(), receiveBuffer.size(), 0);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("sock_diag receive failed: " + std::string(strerror(errno)));
+        }
+
+        int remaining = static_cast<int>(received);
+        for (auto* message = reinterpret_cast<nlmsghdr*>(receiveBuffer.data()); NLMSG_OK(message, remaining);
+             message = NLMSG_NEXT(message, remaining)) {
+            if (message->nlmsg_seq != sequence) continue;
+            if (message->nlmsg_type == NLMSG_DONE) return;
+            if (message->nlmsg_type == NLMSG_ERROR) {
+                auto* error = static_cast<nlmsgerr*>(NLMSG_DATA(message));
+                throw std::runtime_error("sock_diag dump failed: " + std::string(strerror(-error->error)));
+            }
+            if (message->nlmsg_type != SOCK_DIAG_BY_FAMILY) continue;
+
+            auto* msg = static_cast<inet_diag_msg*>(NLMSG_DATA(message));
+            current.family = msg->idiag_family;
+            current.state = static_cast<State>(msg->idiag_state);
+            inet_ntop(msg->idiag_family, msg->id.idiag_src, address, sizeof(address));
+            current.localAddress = address;
+            current.localPort = ntohs(msg->id.idiag_sport);
+            inet_ntop(msg->idiag_family, msg->id.idiag_dst, address, sizeof(address));
+            current.remoteAddress = address;
+            current.remotePort = ntohs(msg->id.idiag_dport);
+            current.receiveQueue = msg->idiag_rqueue;
+            current.sendQueue = msg->idiag_wqueue;
+            current.uid = msg->idiag_uid;
+            current.inode = msg->idiag_inode;
+            current.hasTcpInfo = false;
+            current.tcp = TcpInfo{};
+
+            int attributeLength = static_cast<int>(message->nlmsg_len - NLMSG_LENGTH(sizeof(*msg)));
+            for (auto* attribute = reinterpret_cast<rtattr*>(msg + 1); RTA_OK(attribute, attributeLength);
+                 attribute = RTA_NEXT(attribute, attributeLength)) {
+                if (attribute->rta_type != INET_DIAG_INFO) continue;
+
+                // Older kernels send a shorter tcp_info; missing fields stay 0
+                tcp_info info{};
+                memcpy(&info, RTA_DATA(attribute), std::min<size_t>(RTA_PAYLOAD(attribute), sizeof(info)));
+                current.hasTcpInfo = true;
+                current.tcp.rttUs = info.tcpi_rtt;
+                current.tcp.rttVarUs = info.tcpi_rttvar;
+                current.tcp.minRttUs = info.tcpi_min_rtt;
+                current.tcp.sendCwnd = info.tcpi_snd_cwnd;
+                current.tcp.sendSsthresh = info.tcpi_snd_ssthresh;
+                current.tcp.retransmits = info.tcpi_retransmits;
+                current.tcp.totalRetrans = info.tcpi_total_retrans;
+                current.tcp.deliveryRate = info.tcpi_delivery_rate;
+                current.tcp.bytesAcked = info.tcpi_bytes_acked;
+                current.tcp.bytesReceived = info.tcpi_bytes_received;
+            }
+
+            ++count;
+            callback(current);
+        }
+    }
+}
+
+} // namespace kuserspace
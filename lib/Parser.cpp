@@ -5,6 +5,9 @@
 #include <stdexcept>
 #include <system_error>
 #include <chrono>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace kuserspace {
 
@@ -176,6 +179,138 @@ void Parser::parseWithHandler(
     }
 }
 
+std::string_view Parser::nextLine(std::string_view& input) {
+    size_t end = input.find('\n');
+    std::string_view line = input.substr(0, end);
+    input.remove_prefix(end == std::string_view::npos ? input.size() : end + 1);
+    return line;
+}
+
+std::string_view Parser::nextToken(std::string_view& input) {
+    size_t begin = 0;
+    while (begin < input.size() && (input[begin] == ' ' || input[begin] == '\t')) {
+        ++begin;
+    }
+    size_t end = begin;
+    while (end < input.size() && input[end] != ' ' && input[end] != '\t') {
+        ++end;
+    }
+    std::string_view token = input.substr(begin, end - begin);
+    input.remove_prefix(end);
+    return token;
+}
+
+size_t Parser::splitFields(std::string_view line, std::vector<std::string_view>& fields) {
+    fields.clear();
+    for (std::string_view field = nextToken(line); !field.empty(); field = nextToken(line)) {
+        fields.push_back(field);
+    }
+    return fields.size();
+}
+
+std::vector<int> Parser::parseCpuList(std::string_view list) {
+    std::vector<int> cpus;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view range = list.substr(0, comma);
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+
+        while (!range.empty() && (range.back() == '\n' || range.back() == ' ')) {
+            range.remove_suffix(1);
+        }
+        if (range.empty() || range[0] < '0' || range[0] > '9') continue;
+
+        size_t dash = range.find('-');
+        int first = static_cast<int>(toUnsigned(range));
+        int last = dash == std::string_view::npos ? first : static_cast<int>(toUnsigned(range.substr(dash + 1)));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> Parser::parseCpuMask(std::string_view mask) {
+    std::vector<int> cpus;
+    int bit = 0;
+    for (size_t i = mask.size(); i-- > 0;) {
+        char c = mask[i];
+        int nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else continue;  // commas, newline
+
+        for (int j = 0; j < 4; ++j) {
+            if (nibble & (1 << j)) {
+                cpus.push_back(bit + j);
+            }
+        }
+        bit += 4;
+    }
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
+std::string Parser::readAttribute(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return std::string();
+
+    char buffer[4096];
+    ssize_t n = ::read(fd, buffer, sizeof(buffer));
+    close(fd);
+    if (n <= 0) return std::string();
+
+    std::string value(buffer, static_cast<size_t>(n));
+    while (!value.empty() && (value.back() == '\n' || value.back() == ' ')) {
+        value.pop_back();
+    }
+    return value;
+}
+
+std::vector<int> Parser::readCpuNodes(const std::string& nodePath) {
+    std::vector<int> nodes;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(nodePath, ec)) {
+        std::string name = entry.path().filename().string();
+        std::string_view id = std::string_view(name).substr(std::min<size_t>(name.size(), 4));
+        if (name.compare(0, 4, "node") != 0 || id.empty() || id.size() > 9 ||
+            id.find_first_not_of("0123456789") != std::string_view::npos) {
+            continue;
+        }
+        int node = static_cast<int>(toUnsigned(id));
+
+        for (int cpu : parseCpuList(readAttribute((entry.path() / "cpulist").string()))) {
+            if (cpu < 0) continue;
+            if (static_cast<size_t>(cpu) >= nodes.size()) nodes.resize(static_cast<size_t>(cpu) + 1, -1);
+            nodes[static_cast<size_t>(cpu)] = node;
+        }
+    }
+    return nodes;
+}
+
+uint64_t Parser::toUnsigned(std::string_view token) {
+    uint64_t value = 0;
+    for (char c : token) {
+        if (c < '0' || c > '9') break;
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return value;
+}
+
+bool Parser::parseKeyValue(std::string_view line, std::string_view& key, uint64_t& value) {
+    key = nextToken(line);
+    if (key.empty()) return false;
+    if (key.back() == ':') {
+        key.remove_suffix(1);
+    }
+
+    std::string_view token = nextToken(line);
+    if (token.empty() || token[0] < '0' || token[0] > '9') return false;
+    value = toUnsigned(token);
+    return true;
+}
+
 void Parser::clearCache() {
     std::lock_guard<std::mutex> lock(cacheMutex);
     regexCache.clear();
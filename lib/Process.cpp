@@ -0,0 +1,367 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Process.h"
+#include "../include/Parser.h"
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <chrono>
+#include <string_view>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+namespace kuserspace {
+
+namespace {
+
+// Parse /proc/[pid]/stat. The comm field may contain spaces and parentheses,
+// so the remaining fields are located from the last ')'.
+bool parseStat(std::string_view content, Process::Info& info) {
+    size_t open = content.find('(');
+    size_t close = content.rfind(')');
+    if (open == std::string_view::npos || close == std::string_view::npos || close < open) {
+        return false;
+    }
+
+    info.pid = static_cast<pid_t>(Parser::toUnsigned(content.substr(0, open)));
+    info.name.assign(content.data() + open + 1, close - open - 1);
+
+    std::string_view rest = content.substr(close + 1);
+    std::string_view state = Parser::nextToken(rest);
+    info.state = state.empty() ? '?' : state[0];
+
+    // Fields after state are numbered from 4 (ppid) as in proc(5)
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    uint64_t utime = 0, stime = 0;
+    for (int field = 4; field <= 24; ++field) {
+        std::string_view token = Parser::nextToken(rest);
+        if (token.empty()) return false;
+
+        switch (field) {
+            case 4: info.ppid = static_cast<pid_t>(Parser::toUnsigned(token)); break;
+            case 14: utime = Parser::toUnsigned(token); break;
+            case 15: stime = Parser::toUnsigned(token); break;
+            case 22: info.startTime = Parser::toUnsigned(token); break;
+            case 24: info.rss = Parser::toUnsigned(token) * pageSize; break;
+            default: break;
+        }
+    }
+
+    info.cpuTime = utime + stime;
+    return true;
+}
+
+bool readStat(const char* path, Process::Info& info) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return false;
+
+    char buffer[1024];
+    ssize_t n = ::read(fd, buffer, sizeof(buffer));
+    close(fd);
+    if (n <= 0) return false;
+
+    return parseStat(std::string_view(buffer, static_cast<size_t>(n)), info);
+}
+
+} // namespace
+
+std::optional<Process::Info> Process::getInfo(pid_t pid, const Root& root) {
+    Info info{};
+    std::string path = root.procPath("/" + std::to_string(pid) + "/stat");
+    if (!readStat(path.c_str(), info)) {
+        return std::nullopt;
+    }
+    return info;
+}
+
+void Process::scan(std::vector<Info>& processes, const Root& root) {
+    DIR* dir = opendir(root.proc.c_str());
+    if (!dir) {
+        throw std::runtime_error("Could not open directory: " + root.proc);
+    }
+
+    // Reuse existing elements so their name strings keep their storage
+    size_t count = 0;
+    std::string path = root.proc + "/";
+    const size_t prefix = path.size();
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') continue;
+
+        if (count == processes.size()) {
+            processes.emplace_back();
+        }
+        path.resize(prefix);
+        path += entry->d_name;
+        path += "/stat";
+        if (readStat(path.c_str(), processes[count])) {
+            ++count;
+        }
+    }
+    closedir(dir);
+
+    processes.resize(count);
+}
+
+std::vector<Process::Info> Process::scan(const Root& root) {
+    std::vector<Info> processes;
+    scan(processes, root);
+    return processes;
+}
+
+class ProcessTree::Impl {
+public:
+    struct Node {
+        Process::Info info;
+        Node* parent = nullptr;
+        std::vector<Node*> children;
+        size_t processes = 0;       // subtree totals
+        size_t rss = 0;
+        uint64_t cpuTime = 0;
+        uint64_t previousCpuTime = 0;  // subtree cpuTime at the previous update
+        uint64_t generation = 0;
+    };
+
+    // Signed change applied to a node and all of its ancestors
+    struct Delta {
+        int64_t processes;
+        int64_t rss;
+        int64_t cpuTime;
+        int64_t previousCpuTime;
+    };
+
+    explicit Impl(const Root& root) : root(root), clockTicks(static_cast<uint64_t>(sysconf(_SC_CLK_TCK))) {}
+
+    void update(const std::vector<Process::Info>& processes) {
+        auto now = std::chrono::steady_clock::now();
+        bool initial = nodes.empty();
+        ++generation;
+
+        for (auto& [pid, node] : nodes) {
+            node.previousCpuTime = node.cpuTime;
+        }
+
+        pending.clear();
+        for (const auto& info : processes) {
+            auto [it, inserted] = nodes.try_emplace(info.pid);
+            Node& node = it->second;
+
+            // Same pid, different start time: the pid was reused
+            if (!inserted && node.info.startTime != info.startTime) {
+                retire(node);
+                node = Node();
+                inserted = true;
+            }
+
+            if (inserted) {
+                node.info = info;
+                node.processes = 1;
+                node.rss = info.rss;
+                node.cpuTime = info.cpuTime;
+                node.generation = generation;
+                pending.push_back(&node);
+                continue;
+            }
+
+            node.generation = generation;
+            apply(&node, {0,
+                          static_cast<int64_t>(info.rss) - static_cast<int64_t>(node.info.rss),
+                          static_cast<int64_t>(info.cpuTime - node.info.cpuTime),
+                          0});
+
+            if (info.ppid != node.info.ppid) {
+                unlink(node);
+                pending.push_back(&node);
+            }
+
+            node.info.ppid = info.ppid;
+            node.info.state = info.state;
+            node.info.rss = info.rss;
+            node.info.cpuTime = info.cpuTime;
+            if (node.info.name != info.name) {
+                node.info.name = info.name;
+            }
+        }
+
+        // Remove processes that exited since the previous scan
+        for (auto it = nodes.begin(); it != nodes.end();) {
+            if (it->second.generation != generation) {
+                retire(it->second);
+                it = nodes.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // Link new and reparented processes once every parent is known
+        for (Node* node : pending) {
+            auto it = nodes.find(node->info.ppid);
+            if (it != nodes.end() && it->second.generation == generation) {
+                link(*node, it->second);
+            }
+        }
+
+        if (initial) {
+            for (auto& [pid, node] : nodes) {
+                node.previousCpuTime = node.cpuTime;
+            }
+        }
+
+        interval = now - lastUpdate;
+        lastUpdate = now;
+    }
+
+    const Node& at(pid_t pid) const {
+        auto it = nodes.find(pid);
+        if (it == nodes.end()) {
+            throw std::out_of_range("Unknown process: " + std::to_string(pid));
+        }
+        return it->second;
+    }
+
+    Totals totals(const Node& node) const {
+        float usage = 0.0f;
+        double seconds = std::chrono::duration<double>(interval).count();
+        if (node.cpuTime > node.previousCpuTime && seconds > 0.0) {
+            usage = static_cast<float>(100.0 * static_cast<double>(node.cpuTime - node.previousCpuTime)
+                                       / static_cast<double>(clockTicks) / seconds);
+        }
+        return {node.processes, node.rss, node.cpuTime, usage};
+    }
+
+    std::unordered_map<pid_t, Node> nodes;
+    mutable std::shared_mutex mutex;
+
+    Root root;
+
+    // Scan storage reused by refresh()
+    std::vector<Process::Info> scanBuffer;
+    std::mutex scanMutex;
+
+private:
+    void apply(Node* node, const Delta& delta) {
+        for (; node; node = node->parent) {
+            node->processes += static_cast<size_t>(delta.processes);
+            node->rss += static_cast<size_t>(delta.rss);
+            node->cpuTime += static_cast<uint64_t>(delta.cpuTime);
+            node->previousCpuTime += static_cast<uint64_t>(delta.previousCpuTime);
+        }
+    }
+
+    void link(Node& node, Node& parent) {
+        // Refuse links that would create a cycle (possible with racy scans)
+        for (Node* ancestor = &parent; ancestor; ancestor = ancestor->parent) {
+            if (ancestor == &node) return;
+        }
+
+        node.parent = &parent;
+        parent.children.push_back(&node);
+        apply(&parent, {static_cast<int64_t>(node.processes),
+                        static_cast<int64_t>(node.rss),
+                        static_cast<int64_t>(node.cpuTime),
+                        static_cast<int64_t>(node.previousCpuTime)});
+    }
+
+    void detach(Node& node) {
+        auto& siblings = node.parent->children;
+        for (auto& sibling : siblings) {
+            if (sibling == &node) {
+                sibling = siblings.back();
+                siblings.pop_back();
+                break;
+            }
+        }
+        node.parent = nullptr;
+    }
+
+    void unlink(Node& node) {
+        if (!node.parent) return;
+        Node* parent = node.parent;
+        detach(node);
+        apply(parent, {-static_cast<int64_t>(node.processes),
+                       -static_cast<int64_t>(node.rss),
+                       -static_cast<int64_t>(node.cpuTime),
+                       -static_cast<int64_t>(node.previousCpuTime)});
+    }
+
+    // Remove an exited process. Its CPU time stays accounted in its
+    // ancestors so subtree CPU time never goes backwards.
+    void retire(Node& node) {
+        while (!node.children.empty()) {
+            unlink(*node.children.back());
+        }
+        if (!node.parent) return;
+        Node* parent = node.parent;
+        detach(node);
+        apply(parent, {-1, -static_cast<int64_t>(node.info.rss), 0, 0});
+    }
+
+    uint64_t clockTicks;
+    uint64_t generation = 0;
+    std::vector<Node*> pending;
+    std::chrono::steady_clock::time_point lastUpdate;
+    std::chrono::steady_clock::duration interval{};
+};
+
+ProcessTree::ProcessTree(const Root& root) : pImpl(std::make_unique<Impl>(root)) {}
+ProcessTree::~ProcessTree() = default;
+
+void ProcessTree::refresh() {
+    // The scan itself runs without holding the tree lock
+    std::lock_guard<std::mutex> lock(pImpl->scanMutex);
+    Process::scan(pImpl->scanBuffer, pImpl->root);
+    update(pImpl->scanBuffer);
+}
+
+void ProcessTree::update(const std::vector<Process::Info>& processes) {
+    std::unique_lock<std::shared_mutex> lock(pImpl->mutex);
+    pImpl->update(processes);
+}
+
+bool ProcessTree::contains(pid_t pid) const {
+    std::shared_lock<std::shared_mutex> lock(pImpl->mutex);
+    return pImpl->nodes.find(pid) != pImpl->nodes.end();
+}
+
+ProcessTree::Totals ProcessTree::getSubtreeTotals(pid_t pid) const {
+    std::shared_lock<std::shared_mutex> lock(pImpl->mutex);
+    return pImpl->totals(pImpl->at(pid));
+}
+
+Process::Info ProcessTree::getProcess(pid_t pid) const {
+    std::shared_lock<std::shared_mutex> lock(pImpl->mutex);
+    return pImpl->at(pid).info;
+}
+
+pid_t ProcessTree::getParent(pid_t pid) const {
+    std::shared_lock<std::shared_mutex> lock(pImpl->mutex);
+    const auto& node = pImpl->at(pid);
+    return node.parent ? node.parent->info.pid : 0;
+}
+
+std::vector<pid_t> ProcessTree::getChildren(pid_t pid) const {
+    std::shared_lock<std::shared_mutex> lock(pImpl->mutex);
+    std::vector<pid_t> result;
+    for (const auto* child : pImpl->at(pid).children) {
+        result.push_back(child->info.pid);
+    }
+    return result;
+}
+
+std::vector<pid_t> ProcessTree::getRoots() const {
+    std::shared_lock<std::shared_mutex> lock(pImpl->mutex);
+    std::vector<pid_t> result;
+    for (const auto& [pid, node] : pImpl->nodes) {
+        if (!node.parent) {
+            result.push_back(pid);
+        }
+    }
+    return result;
+}
+
+size_t ProcessTree::size() const {
+    std::shared_lock<std::shared_mutex> lock(pImpl->mutex);
+    return pImpl->nodes.size();
+}
+
+} // namespace kuserspace
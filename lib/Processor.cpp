@@ -1,5 +1,7 @@
 // Malghumuy - Library: kuserspace
 #include "../include/Processor.h"
+#include "../include/Parser.h"
+#include "../include/Cgroup.h"
 #include <fstream>
 #include <sstream>
 #include <regex>
@@ -10,20 +12,30 @@
 #include <mutex>
 #include <condition_variable>
 #include <future>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <sched.h>
 
 namespace kuserspace {
 
 class Processor::Impl {
 public:
-    Impl() : monitoringActive(false) {
+    explicit Impl(const Root& root) : root(root), monitoringActive(false) {
         initialize();
     }
 
+    ~Impl() {
+        stopMonitoring();
+    }
+
     void initialize() {
         // Read CPU information from /proc/cpuinfo
         readCpuInfo();
         // Read cache information
         readCacheInfo();
+        // Read NUMA topology
+        readNumaTopology();
         // Initialize thermal monitoring
         initializeThermal();
         // Initialize frequency scaling
@@ -31,7 +43,7 @@ public:
     }
 
     void readCpuInfo() {
-        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::ifstream cpuinfo(root.procPath("/cpuinfo"));
         std::string line;
         int currentCore = -1;
         int currentPackage = -1;
@@ -43,12 +55,12 @@ public:
             }
 
             std::smatch matches;
-            if (std::regex_match(line, matches, std::regex("processor\s+:\s+(\d+)"))) {
+            if (std::regex_match(line, matches, std::regex(R"(processor\s+:\s+(\d+))"))) {
                 currentCore = std::stoi(matches[1]);
                 cores[currentCore] = CoreInfo{};
                 cores[currentCore].id = currentCore;
             }
-            else if (std::regex_match(line, matches, std::regex("physical id\s+:\s+(\d+)"))) {
+            else if (std::regex_match(line, matches, std::regex(R"(physical id\s+:\s+(\d+))"))) {
                 currentPackage = std::stoi(matches[1]);
                 if (packages.find(currentPackage) == packages.end()) {
                     packages[currentPackage] = PackageInfo{};
@@ -57,11 +69,11 @@ public:
                 cores[currentCore].physicalId = currentPackage;
                 packages[currentPackage].coreIds.push_back(currentCore);
             }
-            else if (std::regex_match(line, matches, std::regex("model name\s+:\s+(.+)"))) {
+            else if (std::regex_match(line, matches, std::regex(R"(model name\s+:\s+(.+))"))) {
                 cores[currentCore].modelName = matches[1];
                 packages[currentPackage].model = matches[1];
             }
-            else if (std::regex_match(line, matches, std::regex("vendor_id\s+:\s+(.+)"))) {
+            else if (std::regex_match(line, matches, std::regex(R"(vendor_id\s+:\s+(.+))"))) {
                 std::string vendor = matches[1];
                 if (vendor.find("Intel") != std::string::npos) {
                     packages[currentPackage].vendor = Vendor::Intel;
@@ -90,10 +102,11 @@ public:
 
     void readCacheInfo() {
         for (const auto& [coreId, core] : cores) {
-            std::string cachePath = "/sys/devices/system/cpu/cpu" + std::to_string(coreId) + "/cache/";
+            std::string cachePath = root.sysPath("/devices/system/cpu/cpu" + std::to_string(coreId) + "/cache/");
             for (int i = 0; i < 4; ++i) { // L1 to L4
                 std::string levelPath = cachePath + "index" + std::to_string(i) + "/";
-                if (!std::filesystem::exists(levelPath)) continue;
+                std::error_code ec;
+                if (!std::filesystem::exists(levelPath, ec)) continue;
 
                 CacheInfo cache;
                 std::ifstream sizeFile(levelPath + "size");
@@ -132,11 +145,41 @@ public:
         }
     }
 
+    void readNumaTopology() {
+        for (auto& [coreId, core] : cores) {
+            core.numaNode = -1;
+        }
+
+        const std::string nodePath = root.sysPath("/devices/system/node/");
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(nodePath, ec)) {
+            std::string name = entry.path().filename().string();
+            if (name.find("node") != 0 || name.size() <= 4 || !std::isdigit(static_cast<unsigned char>(name[4]))) {
+                continue;
+            }
+            int nodeId = std::stoi(name.substr(4));
+
+            std::ifstream cpulistFile(entry.path() / "cpulist");
+            std::string cpulist;
+            std::getline(cpulistFile, cpulist);
+
+            for (int cpu : Parser::parseCpuList(cpulist)) {
+                numaNodes[nodeId].push_back(cpu);
+                cpuNodes[cpu] = nodeId;
+                auto it = cores.find(cpu);
+                if (it != cores.end()) {
+                    it->second.numaNode = nodeId;
+                }
+            }
+        }
+    }
+
     void initializeThermal() {
         // Initialize thermal monitoring
         for (const auto& [coreId, core] : cores) {
-            std::string thermalPath = "/sys/class/thermal/thermal_zone" + std::to_string(coreId) + "/";
-            if (std::filesystem::exists(thermalPath)) {
+            std::string thermalPath = root.sysPath("/class/thermal/thermal_zone" + std::to_string(coreId) + "/");
+            std::error_code ec;
+            if (std::filesystem::exists(thermalPath, ec)) {
                 thermalPaths[coreId] = thermalPath;
             }
         }
@@ -145,8 +188,9 @@ public:
     void initializeFrequencyScaling() {
         // Initialize frequency scaling
         for (const auto& [coreId, core] : cores) {
-            std::string freqPath = "/sys/devices/system/cpu/cpu" + std::to_string(coreId) + "/cpufreq/";
-            if (std::filesystem::exists(freqPath)) {
+            std::string freqPath = root.sysPath("/devices/system/cpu/cpu" + std::to_string(coreId) + "/cpufreq/");
+            std::error_code ec;
+            if (std::filesystem::exists(freqPath, ec)) {
                 freqPaths[coreId] = freqPath;
                 updateCoreFrequency(coreId);
             }
@@ -167,37 +211,63 @@ public:
 
     Stats getStats() const {
         Stats stats;
-        std::ifstream statFile("/proc/stat");
-        std::string line;
-        std::getline(statFile, line); // Skip first line (total)
-
-        std::istringstream iss(line);
-        iss >> stats.userTime >> stats.niceTime >> stats.systemTime >> stats.idleTime
-            >> stats.iowaitTime >> stats.irqTime >> stats.softirqTime >> stats.stealTime
-            >> stats.guestTime >> stats.guestNiceTime;
+        getStats(stats);
+        return stats;
+    }
 
-        // Calculate utilization
-        uint64_t totalTime = stats.userTime + stats.niceTime + stats.systemTime + stats.idleTime
-                           + stats.iowaitTime + stats.irqTime + stats.softirqTime + stats.stealTime;
-        uint64_t idleTime = stats.idleTime + stats.iowaitTime;
-        stats.totalUtilization = 100.0f * (1.0f - static_cast<float>(idleTime) / totalTime);
+    // Fills stats in place; perCoreUtilization keeps its capacity.
+    // Utilization covers the interval since the previous call (since boot
+    // on the first), per line of /proc/stat: "cpu" then "cpuN".
+    void getStats(Stats& stats) const {
+        std::ifstream statFile(root.procPath("/stat"));
+        std::string line;
 
-        // Get per-core utilization
+        std::lock_guard<std::mutex> lock(statsMutex);
         stats.perCoreUtilization.clear();
         while (std::getline(statFile, line)) {
-            if (line.find("cpu") == 0) continue;
-            std::istringstream coreIss(line);
-            std::string cpu;
-            uint64_t user, nice, system, idle, iowait, irq, softirq, steal, guest, guestNice;
-            coreIss >> cpu >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal >> guest >> guestNice;
-
-            uint64_t coreTotal = user + nice + system + idle + iowait + irq + softirq + steal;
-            uint64_t coreIdle = idle + iowait;
-            float coreUtil = 100.0f * (1.0f - static_cast<float>(coreIdle) / coreTotal);
-            stats.perCoreUtilization.push_back(coreUtil);
-        }
+            std::string_view rest = line;
+            std::string_view label = Parser::nextToken(rest);
+            if (label.substr(0, 3) != "cpu") break;     // cpu lines come first
 
-        return stats;
+            uint64_t ticks[10] = {};
+            for (uint64_t& value : ticks) {
+                value = Parser::toUnsigned(Parser::nextToken(rest));
+            }
+            uint64_t total = 0;
+            for (int i = 0; i < 8; ++i) total += ticks[i];   // guest time is already in user
+            uint64_t idle = ticks[3] + ticks[4];
+
+            // Slot 0 is the aggregate line, slot N + 1 is cpuN
+            bool aggregate = label.size() == 3;
+            size_t slot = aggregate ? 0 : Parser::toUnsigned(label.substr(3)) + 1;
+            if (slot >= previousTicks.size()) {
+                previousTicks.resize(slot + 1);
+            }
+            CpuTicks& previous = previousTicks[slot];
+            uint64_t totalDelta = total >= previous.total ? total - previous.total : 0;
+            uint64_t idleDelta = idle >= previous.idle ? idle - previous.idle : 0;
+            float utilization = totalDelta ? 100.0f * (1.0f - static_cast<float>(idleDelta) / totalDelta) : 0.0f;
+            previous = {total, idle};
+
+            if (aggregate) {
+                stats.userTime = ticks[0];
+                stats.niceTime = ticks[1];
+                stats.systemTime = ticks[2];
+                stats.idleTime = ticks[3];
+                stats.iowaitTime = ticks[4];
+                stats.irqTime = ticks[5];
+                stats.softirqTime = ticks[6];
+                stats.stealTime = ticks[7];
+                stats.guestTime = ticks[8];
+                stats.guestNiceTime = ticks[9];
+                stats.totalUtilization = utilization;
+            } else {
+                if (stats.perCoreUtilization.size() < slot) {
+                    stats.perCoreUtilization.resize(slot, 0.0f);
+                }
+                stats.perCoreUtilization[slot - 1] = utilization;
+            }
+        }
     }
 
     void startMonitoring(StatsCallback callback, std::chrono::milliseconds interval) {
@@ -218,7 +288,7 @@ public:
     }
 
     bool setCoreOnline(int coreId, bool online) {
-        std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(coreId) + "/online";
+        std::string path = root.sysPath("/devices/system/cpu/cpu" + std::to_string(coreId) + "/online");
         std::ofstream onlineFile(path);
         if (!onlineFile) return false;
         onlineFile << (online ? "1" : "0");
@@ -269,7 +339,7 @@ public:
 
     bool setPowerLimit(float watts) {
         for (const auto& [packageId, _] : packages) {
-            std::string path = "/sys/class/powercap/intel-rapl:" + std::to_string(packageId) + ":0/constraint_0_power_limit_uw";
+            std::string path = root.sysPath("/class/powercap/intel-rapl:" + std::to_string(packageId) + ":0/constraint_0_power_limit_uw");
             if (!std::filesystem::exists(path)) continue;
             std::ofstream powerFile(path);
             if (!powerFile) continue;
@@ -278,10 +348,128 @@ public:
         return true;
     }
 
+    CpuBudget readCpuBudget() const {
+        CpuBudget budget{};
+        budget.quotaUs = -1;
+        budget.periodUs = 100000;
+        budget.weight = 100;
+        budget.cpus = Parser::parseCpuList(Parser::readAttribute(root.sysPath("/devices/system/cpu/online")));
+
+        cpu_set_t affinity;
+        CPU_ZERO(&affinity);
+        budget.affinityCpus = sched_getaffinity(root.pid, sizeof(affinity), &affinity) == 0
+            ? static_cast<size_t>(CPU_COUNT(&affinity))
+            : budget.cpus.size();
+
+        double quotaCpus = std::numeric_limits<double>::infinity();
+        budget.cgroupPath = root.cgroup.empty() ? Cgroup::getSelfPath(root) : root.cgroup;
+        budget.cgroupV2 = !budget.cgroupPath.empty();
+        if (budget.cgroupV2) {
+            std::string effective = Parser::readAttribute(budget.cgroupPath + "/cpuset.cpus.effective");
+            if (!effective.empty()) {
+                budget.cpus = Parser::parseCpuList(effective);
+            }
+            std::string weight = Parser::readAttribute(budget.cgroupPath + "/cpu.weight");
+            if (!weight.empty()) {
+                budget.weight = static_cast<unsigned int>(Parser::toUnsigned(weight));
+            }
+
+            // A cpu.max quota on any ancestor caps this cgroup too. A cgroup
+            // whose parent does not enable the cpu controller has no cpu.max,
+            // so keep walking up to the cgroup2 mount point, which has none.
+            std::filesystem::path mount = std::filesystem::path(Cgroup::getMountPoint(root)).lexically_normal();
+            if (!mount.has_filename()) mount = mount.parent_path();
+            for (std::filesystem::path dir = std::filesystem::path(budget.cgroupPath).lexically_normal(); ;
+                 dir = dir.parent_path()) {
+                if (!dir.has_filename()) dir = dir.parent_path();
+                if (dir == mount || !dir.has_relative_path()) break;
+
+                std::string max = Parser::readAttribute((dir / "cpu.max").string());
+                std::string_view rest = max;
+                std::string_view quota = Parser::nextToken(rest);
+                uint64_t period = Parser::toUnsigned(Parser::nextToken(rest));
+                if (!quota.empty() && quota != "max" && period > 0) {
+                    double cpus = static_cast<double>(Parser::toUnsigned(quota)) / period;
+                    if (cpus < quotaCpus) {
+                        quotaCpus = cpus;
+                        budget.quotaUs = static_cast<int64_t>(Parser::toUnsigned(quota));
+                        budget.periodUs = period;
+                    }
+                }
+                if (dir.parent_path() == dir) break;
+            }
+        }
+
+        budget.effectiveCpus = std::min({quotaCpus,
+                                         static_cast<double>(budget.cpus.size()),
+                                         static_cast<double>(budget.affinityCpus)});
+        budget.recommendedThreads = std::max<size_t>(1, static_cast<size_t>(std::ceil(budget.effectiveCpus - 1e-9)));
+        return budget;
+    }
+
+    Throttling readThrottling() {
+        std::lock_guard<std::mutex> lock(throttlingMutex);
+        if (!throttlingPathResolved) {
+            std::string path = root.cgroup.empty() ? Cgroup::getSelfPath(root) : root.cgroup;
+            if (!path.empty()) {
+                cpuStatPath = path + "/cpu.stat";
+            }
+            throttlingPathResolved = true;
+        }
+
+        Throttling current{};
+        std::string content = cpuStatPath.empty() ? std::string() : Parser::readAttribute(cpuStatPath);
+        if (!content.empty()) {
+            std::string_view rest = content;
+            std::string_view key;
+            uint64_t value;
+            while (!rest.empty()) {
+                if (!Parser::parseKeyValue(Parser::nextLine(rest), key, value)) continue;
+                if (key == "usage_usec") current.usageUsec = value;
+                else if (key == "nr_periods") current.periods = value;
+                else if (key == "nr_throttled") current.throttledPeriods = value;
+                else if (key == "throttled_usec") current.throttledUsec = value;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - lastThrottlingSample).count();
+        if (throttlingSampled && seconds > 0.0) {
+            auto delta = [](uint64_t a, uint64_t b) { return a >= b ? a - b : 0; };
+            uint64_t periods = delta(current.periods, lastThrottling.periods);
+            current.usageCpus = delta(current.usageUsec, lastThrottling.usageUsec) / (seconds * 1e6);
+            current.throttledPercent = periods
+                ? 100.0 * delta(current.throttledPeriods, lastThrottling.throttledPeriods) / periods
+                : 0.0;
+            current.throttledUsecPerSec = delta(current.throttledUsec, lastThrottling.throttledUsec) / seconds;
+        }
+        lastThrottling = current;
+        lastThrottlingSample = now;
+        throttlingSampled = true;
+        return current;
+    }
+
+    Root root;
     std::map<int, CoreInfo> cores;
     std::map<int, PackageInfo> packages;
     std::map<int, std::string> thermalPaths;
     std::map<int, std::string> freqPaths;
+    std::map<int, std::vector<int>> numaNodes;
+    std::map<int, int> cpuNodes;
+
+    struct CpuTicks {
+        uint64_t total;
+        uint64_t idle;
+    };
+    mutable std::vector<CpuTicks> previousTicks;    // [0] aggregate, [N + 1] cpuN
+    mutable std::mutex statsMutex;
+
+    std::string cpuStatPath;
+    Throttling lastThrottling{};
+    std::chrono::steady_clock::time_point lastThrottlingSample;
+    bool throttlingSampled = false;
+    bool throttlingPathResolved = false;
+    std::mutex throttlingMutex;
     std::atomic<bool> monitoringActive;
     std::thread monitoringThread;
 };
@@ -292,7 +480,7 @@ Processor& Processor::getInstance() {
     return instance;
 }
 
-Processor::Processor() : pImpl(std::make_unique<Impl>()) {}
+Processor::Processor(const Root& root) : pImpl(std::make_unique<Impl>(root)) {}
 Processor::~Processor() = default;
 
 // Basic CPU Information
@@ -324,6 +512,26 @@ size_t Processor::getNumPackages() const {
     return pImpl->packages.size();
 }
 
+// Topology
+int Processor::getNumaNode(int coreId) const {
+    auto it = pImpl->cpuNodes.find(coreId);
+    return it == pImpl->cpuNodes.end() ? -1 : it->second;
+}
+
+std::vector<int> Processor::getNumaNodeCores(int nodeId) const {
+    auto it = pImpl->numaNodes.find(nodeId);
+    return it == pImpl->numaNodes.end() ? std::vector<int>() : it->second;
+}
+
+// CPU Budget
+Processor::CpuBudget Processor::getCpuBudget() const {
+    return pImpl->readCpuBudget();
+}
+
+Processor::Throttling Processor::getThrottling() const {
+    return pImpl->readThrottling();
+}
+
 // Core Information
 std::vector<Processor::CoreInfo> Processor::getAllCores() const {
     std::vector<CoreInfo> result;
@@ -407,6 +615,10 @@ Processor::Stats Processor::getStats() const {
     return pImpl->getStats();
 }
 
+void Processor::getStats(Stats& stats) const {
+    pImpl->getStats(stats);
+}
+
 std::future<Processor::Stats> Processor::getStatsAsync() const {
     return std::async(std::launch::async, [this]() { return getStats(); });
 }
@@ -470,7 +682,7 @@ bool Processor::setFrequencyRange(int coreId, uint64_t minFreq, uint64_t maxFreq
 float Processor::getPowerConsumption() const {
     float totalPower = 0.0f;
     for (const auto& [packageId, _] : pImpl->packages) {
-        std::string path = "/sys/class/powercap/intel-rapl:" + std::to_string(packageId) + ":0/energy_uj";
+        std::string path = pImpl->root.sysPath("/class/powercap/intel-rapl:" + std::to_string(packageId) + ":0/energy_uj");
         if (!std::filesystem::exists(path)) continue;
         std::ifstream powerFile(path);
         uint64_t energy;
@@ -483,7 +695,7 @@ float Processor::getPowerConsumption() const {
 float Processor::getPowerLimit() const {
     float limit = 0.0f;
     for (const auto& [packageId, _] : pImpl->packages) {
-        std::string path = "/sys/class/powercap/intel-rapl:" + std::to_string(packageId) + ":0/constraint_0_power_limit_uw";
+        std::string path = pImpl->root.sysPath("/class/powercap/intel-rapl:" + std::to_string(packageId) + ":0/constraint_0_power_limit_uw");
         if (!std::filesystem::exists(path)) continue;
         std::ifstream limitFile(path);
         uint64_t powerLimit;
@@ -533,7 +745,8 @@ bool Processor::isThermalMonitoringAvailable() const {
 }
 
 bool Processor::isPowerMonitoringAvailable() const {
-    return std::filesystem::exists("/sys/class/powercap/");
+    std::error_code ec;
+    return std::filesystem::exists(pImpl->root.sysPath("/class/powercap/"), ec);
 }
 
 } // namespace kuserspace 
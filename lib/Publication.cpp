@@ -0,0 +1,593 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Publication.h"
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace kuserspace {
+
+namespace {
+
+constexpr char MAGIC[8] = {'K', 'U', 'S', 'S', 'H', 'M', '0', '1'};
+constexpr uint32_t VERSION = 1;
+constexpr std::size_t NAME_BYTES = 32;
+
+enum Kind : uint32_t {
+    META,
+    MEMORY,
+    PROCESSOR,
+    DISK,
+    NETWORK,
+    PROTOCOLS,
+    PRESSURE,
+    NUM_RECORDS
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlocks in shared memory need lock-free atomics");
+static_assert(std::is_trivially_copyable<Memory::Stats>::value, "Memory::Stats is published as is");
+static_assert(std::is_trivially_copyable<Network::ProtocolStats>::value, "ProtocolStats is published as is");
+static_assert(std::is_trivially_copyable<SystemSnapshot::Pressure>::value, "Pressure is published as is");
+
+// One per source. The slot readers should use is slotOffset[latest % 2].
+struct alignas(64) RecordHeader {
+    std::atomic<uint64_t> latest;       // passes written, 0 before the first
+    uint32_t fixedBytes;                // per-pass part
+    uint32_t elementBytes;              // per-CPU, per-device or per-interface part
+    uint32_t capacity;
+    uint32_t reserved;
+    uint64_t slotOffset[2];
+    uint64_t slotBytes;
+};
+
+struct alignas(64) SegmentHeader {
+    char magic[8];                      // written last, once the layout is complete
+    uint32_t version;
+    uint32_t recordCount;
+    uint64_t segmentBytes;
+    int64_t publisherPid;
+    std::atomic<uint32_t> retired;      // the publisher exited or replaced the segment
+    RecordHeader records[NUM_RECORDS];
+};
+
+// Followed by fixedBytes, then capacity elements
+struct SlotHeader {
+    std::atomic<uint64_t> sequence;     // odd while the slot is being written
+    uint64_t snapshotSequence;
+    uint32_t count;
+    uint32_t truncated;
+    uint64_t reserved;
+};
+
+struct MetaRecord {
+    uint64_t sequence;
+    int64_t timestampNs;                // steady clock, comparable across processes
+    int64_t wallTimeNs;
+    int64_t durationNs;
+    struct Timing {
+        uint64_t sampled;
+        int64_t readAtNs;
+        int64_t readDurationNs;
+    } timings[SystemSnapshot::NUM_SOURCES];
+};
+
+struct ProcessorRecord {
+    uint64_t ticks[10];
+    float totalUtilization;
+};
+
+struct DiskRecord {
+    char name[NAME_BYTES];
+    uint32_t major;
+    uint32_t minor;
+    uint32_t partition;
+    Disk::Counters counters;
+    double readIops;
+    double writeIops;
+    double discardIops;
+    double flushIops;
+    double readBytesPerSec;
+    double writeBytesPerSec;
+    double discardBytesPerSec;
+    double avgQueueDepth;
+    double readAwaitMs;
+    double writeAwaitMs;
+    double utilization;
+};
+
+struct InterfaceRecord {
+    char name[NAME_BYTES];
+    Network::Counters counters;
+    Network::ErrorDetail detail;
+    double rxBytesPerSec;
+    double txBytesPerSec;
+    double rxPacketsPerSec;
+    double txPacketsPerSec;
+    double rxDropsPerSec;
+    double txDropsPerSec;
+    double rxErrorsPerSec;
+    double txErrorsPerSec;
+};
+
+struct RecordLayout {
+    uint32_t fixedBytes;
+    uint32_t elementBytes;
+};
+
+// The schema a reader checks the segment against
+constexpr RecordLayout LAYOUTS[NUM_RECORDS] = {
+    {sizeof(MetaRecord), 0},
+    {sizeof(Memory::Stats), 0},
+    {sizeof(ProcessorRecord), sizeof(float)},
+    {0, sizeof(DiskRecord)},
+    {0, sizeof(InterfaceRecord)},
+    {sizeof(Network::ProtocolStats), 0},
+    {sizeof(SystemSnapshot::Pressure), 0}
+};
+
+std::string shmName(const std::string& name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+std::size_t roundUp(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int64_t toNanos(std::chrono::nanoseconds duration) {
+    return static_cast<int64_t>(duration.count());
+}
+
+void copyName(char (&destination)[NAME_BYTES], const std::string& source) {
+    std::size_t length = std::min(source.size(), NAME_BYTES - 1);
+    std::memcpy(destination, source.data(), length);
+    std::memset(destination + length, 0, NAME_BYTES - length);
+}
+
+std::string_view readName(const char (&source)[NAME_BYTES]) {
+    return std::string_view(source, strnlen(source, NAME_BYTES));
+}
+
+// Write one record into the slot readers are not pointed at, then point
+// them at it. fill(fixed, elements, capacity) returns the element count
+// it wanted to write.
+template <typename Fill>
+void writeRecord(unsigned char* base, Kind kind, uint64_t snapshotSequence, Fill fill) {
+    RecordHeader& record = reinterpret_cast<SegmentHeader*>(base)->records[kind];
+    uint64_t next = record.latest.load(std::memory_order_relaxed) + 1;
+    SlotHeader* slot = reinterpret_cast<SlotHeader*>(base + record.slotOffset[next % 2]);
+    unsigned char* fixed = reinterpret_cast<unsigned char*>(slot + 1);
+
+    uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::size_t count = fill(fixed, fixed + record.fixedBytes, record.capacity);
+    slot->count = static_cast<uint32_t>(std::min<std::size_t>(count, record.capacity));
+    slot->truncated = count > record.capacity;
+    slot->snapshotSequence = snapshotSequence;
+
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+    record.latest.store(next, std::memory_order_release);
+}
+
+// Read the latest slot of a record; retried only if the publisher lapped
+// this reader onto the same slot. read(fixed, elements, count) may run
+// more than once and must not trust what it read until this returns.
+template <typename Read>
+bool readRecord(const unsigned char* base, Kind kind, Read read) {
+    const RecordHeader& record = reinterpret_cast<const SegmentHeader*>(base)->records[kind];
+    while (true) {
+        uint64_t latest = record.latest.load(std::memory_order_acquire);
+        if (latest == 0) return false;
+        const SlotHeader* slot = reinterpret_cast<const SlotHeader*>(base + record.slotOffset[latest % 2]);
+        uint64_t before = slot->sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+
+        const unsigned char* fixed = reinterpret_cast<const unsigned char*>(slot + 1);
+        read(fixed, fixed + record.fixedBytes, std::min(slot->count, record.capacity));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) == before) return true;
+    }
+}
+
+} // namespace
+
+// The mapping itself; released with the Impl, also when a constructor throws
+class Publisher::Impl {
+public:
+    explicit Impl(const std::string& name) : name(name) {}
+
+    ~Impl() {
+        if (!base) return;
+        reinterpret_cast<SegmentHeader*>(base)->retired.store(1, std::memory_order_release);
+        munmap(base, size);
+        shm_unlink(shmName(name).c_str());
+    }
+
+    std::string name;
+    std::size_t size = 0;
+    unsigned char* base = nullptr;
+};
+
+class Publication::Impl {
+public:
+    explicit Impl(const std::string& name) : name(name) {}
+
+    ~Impl() {
+        if (base) munmap(const_cast<unsigned char*>(base), size);
+    }
+
+    std::string name;
+    std::size_t size = 0;
+    const unsigned char* base = nullptr;
+};
+
+Publisher::Publisher(const std::string& segmentName) : Publisher(segmentName, 4096, 1024, 1024) {}
+
+Publisher::Publisher(const std::string& segmentName, std::size_t maxCpus, std::size_t maxDevices,
+                     std::size_t maxInterfaces)
+    : pImpl(std::make_unique<Impl>(segmentName)) {
+    const std::size_t capacities[NUM_RECORDS] = {0, 0, maxCpus, maxDevices, maxInterfaces, 0, 0};
+    uint64_t slotBytes[NUM_RECORDS];
+    std::size_t offset = roundUp(sizeof(SegmentHeader), 64);
+    for (std::size_t kind = 0; kind < NUM_RECORDS; ++kind) {
+        slotBytes[kind] = roundUp(sizeof(SlotHeader) + LAYOUTS[kind].fixedBytes +
+                                  LAYOUTS[kind].elementBytes * capacities[kind], 64);
+        offset += 2 * slotBytes[kind];
+    }
+    pImpl->size = offset;
+
+    // Tell readers of an earlier segment that it is gone, then replace it
+    std::string path = shmName(pImpl->name);
+    int old = shm_open(path.c_str(), O_RDWR, 0);
+    if (old != -1) {
+        struct stat status;
+        if (fstat(old, &status) == 0 && static_cast<std::size_t>(status.st_size) >= sizeof(SegmentHeader)) {
+            void* mapped = mmap(nullptr, sizeof(SegmentHeader), PROT_READ | PROT_WRITE, MAP_SHARED, old, 0);
+            if (mapped != MAP_FAILED) {
+                auto* header = static_cast<SegmentHeader*>(mapped);
+                if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0) {
+                    header->retired.store(1, std::memory_order_release);
+                }
+                munmap(mapped, sizeof(SegmentHeader));
+            }
+        }
+        ::close(old);
+        shm_unlink(path.c_str());
+    }
+
+    int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("Could not create shared memory: " + path + ": " + std::strerror(errno));
+    }
+    if (ftruncate(fd, static_cast<off_t>(pImpl->size)) == -1) {
+        int error = errno;
+        ::close(fd);
+        shm_unlink(path.c_str());
+        throw std::runtime_error("Could not size shared memory: " + path + ": " + std::strerror(error));
+    }
+    void* mapped = mmap(nullptr, pImpl->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        shm_unlink(path.c_str());
+        throw std::runtime_error("Could not map shared memory: " + path);
+    }
+    pImpl->base = static_cast<unsigned char*>(mapped);
+
+    // ftruncate zero-filled the segment, which is a valid empty state
+    auto* header = reinterpret_cast<SegmentHeader*>(pImpl->base);
+    header->version = VERSION;
+    header->recordCount = NUM_RECORDS;
+    header->segmentBytes = pImpl->size;
+    header->publisherPid = getpid();
+    offset = roundUp(sizeof(SegmentHeader), 64);
+    for (std::size_t kind = 0; kind < NUM_RECORDS; ++kind) {
+        RecordHeader& record = header->records[kind];
+        record.fixedBytes = LAYOUTS[kind].fixedBytes;
+        record.elementBytes = LAYOUTS[kind].elementBytes;
+        record.capacity = static_cast<uint32_t>(capacities[kind]);
+        record.slotBytes = slotBytes[kind];
+        record.slotOffset[0] = offset;
+        record.slotOffset[1] = offset + slotBytes[kind];
+        offset += 2 * slotBytes[kind];
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+}
+
+Publisher::~Publisher() = default;
+
+const std::string& Publisher::getName() const {
+    return pImpl->name;
+}
+
+std::size_t Publisher::getSize() const {
+    return pImpl->size;
+}
+
+void Publisher::publish(const SystemSnapshot::Snapshot& snapshot) {
+    using Source = SystemSnapshot::Source;
+    uint64_t sequence = snapshot.sequence;
+
+    if (snapshot.timing(Source::Memory).sampled) {
+        writeRecord(pImpl->base, MEMORY, sequence, [&](unsigned char* fixed, unsigned char*, std::size_t) {
+            std::memcpy(fixed, &snapshot.memory, sizeof(Memory::Stats));
+            return std::size_t(0);
+        });
+    }
+    if (snapshot.timing(Source::Processor).sampled) {
+        writeRecord(pImpl->base, PROCESSOR, sequence, [&](unsigned char* fixed, unsigned char* elements, std::size_t capacity) {
+            const Processor::Stats& p = snapshot.processor;
+            ProcessorRecord record{{p.userTime, p.niceTime, p.systemTime, p.idleTime, p.iowaitTime, p.irqTime,
+                                    p.softirqTime, p.stealTime, p.guestTime, p.guestNiceTime}, p.totalUtilization};
+            std::memcpy(fixed, &record, sizeof(record));
+            std::size_t count = p.perCoreUtilization.size();
+            std::memcpy(elements, p.perCoreUtilization.data(), std::min(count, capacity) * sizeof(float));
+            return count;
+        });
+    }
+    if (snapshot.timing(Source::Disk).sampled) {
+        writeRecord(pImpl->base, DISK, sequence, [&](unsigned char*, unsigned char* elements, std::size_t capacity) {
+            auto* records = reinterpret_cast<DiskRecord*>(elements);
+            for (std::size_t i = 0; i < std::min(snapshot.disks.size(), capacity); ++i) {
+                const Disk::DeviceStats& d = snapshot.disks[i];
+                DiskRecord& r = records[i];
+                copyName(r.name, d.name);
+                r.major = d.major;
+                r.minor = d.minor;
+                r.partition = d.partition;
+                r.counters = d.counters;
+                r.readIops = d.readIops;
+                r.writeIops = d.writeIops;
+                r.discardIops = d.discardIops;
+                r.flushIops = d.flushIops;
+                r.readBytesPerSec = d.readBytesPerSec;
+                r.writeBytesPerSec = d.writeBytesPerSec;
+                r.discardBytesPerSec = d.discardBytesPerSec;
+                r.avgQueueDepth = d.avgQueueDepth;
+                r.readAwaitMs = d.readAwaitMs;
+                r.writeAwaitMs = d.writeAwaitMs;
+                r.utilization = d.utilization;
+            }
+            return snapshot.disks.size();
+        });
+    }
+    if (snapshot.timing(Source::Network).sampled) {
+        writeRecord(pImpl->base, NETWORK, sequence, [&](unsigned char*, unsigned char* elements, std::size_t capacity) {
+            auto* records = reinterpret_cast<InterfaceRecord*>(elements);
+            for (std::size_t i = 0; i < std::min(snapshot.interfaces.size(), capacity); ++i) {
+                const Network::InterfaceStats& n = snapshot.interfaces[i];
+                InterfaceRecord& r = records[i];
+                copyName(r.name, n.name);
+                r.counters = n.counters;
+                r.detail = n.detail;
+                r.rxBytesPerSec = n.rxBytesPerSec;
+                r.txBytesPerSec = n.txBytesPerSec;
+                r.rxPacketsPerSec = n.rxPacketsPerSec;
+                r.txPacketsPerSec = n.txPacketsPerSec;
+                r.rxDropsPerSec = n.rxDropsPerSec;
+                r.txDropsPerSec = n.txDropsPerSec;
+                r.rxErrorsPerSec = n.rxErrorsPerSec;
+                r.txErrorsPerSec = n.txErrorsPerSec;
+            }
+            return snapshot.interfaces.size();
+        });
+    }
+    if (snapshot.timing(Source::Protocols).sampled) {
+        writeRecord(pImpl->base, PROTOCOLS, sequence, [&](unsigned char* fixed, unsigned char*, std::size_t) {
+            std::memcpy(fixed, &snapshot.protocols, sizeof(Network::ProtocolStats));
+            return std::size_t(0);
+        });
+    }
+    if (snapshot.timing(Source::Pressure).sampled) {
+        writeRecord(pImpl->base, PRESSURE, sequence, [&](unsigned char* fixed, unsigned char*, std::size_t) {
+            std::memcpy(fixed, &snapshot.pressure, sizeof(SystemSnapshot::Pressure));
+            return std::size_t(0);
+        });
+    }
+
+    // Last, so a reader that sees this pass's sequence finds its records
+    writeRecord(pImpl->base, META, sequence, [&](unsigned char* fixed, unsigned char*, std::size_t) {
+        MetaRecord meta{};
+        meta.sequence = sequence;
+        meta.timestampNs = toNanos(snapshot.timestamp.time_since_epoch());
+        meta.wallTimeNs = toNanos(snapshot.wallTime.time_since_epoch());
+        meta.durationNs = toNanos(snapshot.duration);
+        for (std::size_t i = 0; i < SystemSnapshot::NUM_SOURCES; ++i) {
+            const SystemSnapshot::SourceTiming& timing = snapshot.timings[i];
+            meta.timings[i] = {timing.sampled, toNanos(timing.readAt.time_since_epoch()), toNanos(timing.readDuration)};
+        }
+        std::memcpy(fixed, &meta, sizeof(meta));
+        return std::size_t(0);
+    });
+}
+
+Publication::Publication(const std::string& segmentName) : pImpl(std::make_unique<Impl>(segmentName)) {
+    std::string path = shmName(pImpl->name);
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd == -1) {
+        throw std::runtime_error("Could not open shared memory: " + path + ": " + std::strerror(errno));
+    }
+    struct stat status;
+    if (fstat(fd, &status) == -1 || static_cast<std::size_t>(status.st_size) < sizeof(SegmentHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Not a stats publication: " + path);
+    }
+    pImpl->size = static_cast<std::size_t>(status.st_size);
+    void* mapped = mmap(nullptr, pImpl->size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Could not map shared memory: " + path);
+    }
+    pImpl->base = static_cast<const unsigned char*>(mapped);
+
+    const auto* header = reinterpret_cast<const SegmentHeader*>(pImpl->base);
+    bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && header->version == VERSION && header->recordCount == NUM_RECORDS && header->segmentBytes <= pImpl->size;
+    for (std::size_t kind = 0; valid && kind < NUM_RECORDS; ++kind) {
+        const RecordHeader& record = header->records[kind];
+        valid = record.fixedBytes == LAYOUTS[kind].fixedBytes && record.elementBytes == LAYOUTS[kind].elementBytes &&
+                record.slotBytes >= sizeof(SlotHeader) + record.fixedBytes +
+                                    static_cast<uint64_t>(record.elementBytes) * record.capacity &&
+                record.slotOffset[0] + record.slotBytes <= pImpl->size && record.slotOffset[1] + record.slotBytes <= pImpl->size;
+    }
+    if (!valid) {
+        munmap(const_cast<unsigned char*>(pImpl->base), pImpl->size);
+        pImpl->base = nullptr;
+        throw std::runtime_error("Incompatible stats publication: " + path);
+    }
+}
+
+Publication::~Publication() = default;
+
+bool Publication::getStats(Memory::Stats& stats) const {
+    return readRecord(pImpl->base, MEMORY, [&](const unsigned char* fixed, const unsigned char*, uint32_t) {
+        std::memcpy(&stats, fixed, sizeof(Memory::Stats));
+    });
+}
+
+bool Publication::getStats(Processor::Stats& stats) const {
+    return readRecord(pImpl->base, PROCESSOR, [&](const unsigned char* fixed, const unsigned char* elements, uint32_t count) {
+        ProcessorRecord record;
+        std::memcpy(&record, fixed, sizeof(record));
+        stats.userTime = record.ticks[0];
+        stats.niceTime = record.ticks[1];
+        stats.systemTime = record.ticks[2];
+        stats.idleTime = record.ticks[3];
+        stats.iowaitTime = record.ticks[4];
+        stats.irqTime = record.ticks[5];
+        stats.softirqTime = record.ticks[6];
+        stats.stealTime = record.ticks[7];
+        stats.guestTime = record.ticks[8];
+        stats.guestNiceTime = record.ticks[9];
+        stats.totalUtilization = record.totalUtilization;
+        stats.perCoreUtilization.resize(count);
+        std::memcpy(stats.perCoreUtilization.data(), elements, count * sizeof(float));
+    });
+}
+
+bool Publication::getStats(std::vector<Disk::DeviceStats>& devices) const {
+    return readRecord(pImpl->base, DISK, [&](const unsigned char*, const unsigned char* elements, uint32_t count) {
+        devices.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            DiskRecord r;
+            std::memcpy(&r, elements + i * sizeof(DiskRecord), sizeof(DiskRecord));
+            Disk::DeviceStats& d = devices[i];
+            d.name.assign(readName(r.name));
+            d.major = r.major;
+            d.minor = r.minor;
+            d.partition = r.partition != 0;
+            d.counters = r.counters;
+            d.readIops = r.readIops;
+            d.writeIops = r.writeIops;
+            d.discardIops = r.discardIops;
+            d.flushIops = r.flushIops;
+            d.readBytesPerSec = r.readBytesPerSec;
+            d.writeBytesPerSec = r.writeBytesPerSec;
+            d.discardBytesPerSec = r.discardBytesPerSec;
+            d.avgQueueDepth = r.avgQueueDepth;
+            d.readAwaitMs = r.readAwaitMs;
+            d.writeAwaitMs = r.writeAwaitMs;
+            d.utilization = r.utilization;
+        }
+    });
+}
+
+bool Publication::getStats(std::vector<Network::InterfaceStats>& interfaces) const {
+    return readRecord(pImpl->base, NETWORK, [&](const unsigned char*, const unsigned char* elements, uint32_t count) {
+        interfaces.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            InterfaceRecord r;
+            std::memcpy(&r, elements + i * sizeof(InterfaceRecord), sizeof(InterfaceRecord));
+            Network::InterfaceStats& n = interfaces[i];
+            n.name.assign(readName(r.name));
+            n.counters = r.counters;
+            n.detail = r.detail;
+            n.rxBytesPerSec = r.rxBytesPerSec;
+            n.txBytesPerSec = r.txBytesPerSec;
+            n.rxPacketsPerSec = r.rxPacketsPerSec;
+            n.txPacketsPerSec = r.txPacketsPerSec;
+            n.rxDropsPerSec = r.rxDropsPerSec;
+            n.txDropsPerSec = r.txDropsPerSec;
+            n.rxErrorsPerSec = r.rxErrorsPerSec;
+            n.txErrorsPerSec = r.txErrorsPerSec;
+        }
+    });
+}
+
+bool Publication::getStats(Network::ProtocolStats& stats) const {
+    return readRecord(pImpl->base, PROTOCOLS, [&](const unsigned char* fixed, const unsigned char*, uint32_t) {
+        std::memcpy(&stats, fixed, sizeof(Network::ProtocolStats));
+    });
+}
+
+bool Publication::getStats(SystemSnapshot::Pressure& pressure) const {
+    return readRecord(pImpl->base, PRESSURE, [&](const unsigned char* fixed, const unsigned char*, uint32_t) {
+        std::memcpy(&pressure, fixed, sizeof(SystemSnapshot::Pressure));
+    });
+}
+
+void Publication::getSnapshot(SystemSnapshot::Snapshot& snapshot) const {
+    using Source = SystemSnapshot::Source;
+    MetaRecord meta{};
+    if (!readRecord(pImpl->base, META, [&](const unsigned char* fixed, const unsigned char*, uint32_t) {
+            std::memcpy(&meta, fixed, sizeof(meta));
+        })) {
+        for (auto& timing : snapshot.timings) timing.sampled = false;
+        return;
+    }
+
+    using SteadyClock = std::chrono::steady_clock;
+    using SystemClock = std::chrono::system_clock;
+    snapshot.sequence = meta.sequence;
+    snapshot.timestamp = SteadyClock::time_point(std::chrono::duration_cast<SteadyClock::duration>(
+        std::chrono::nanoseconds(meta.timestampNs)));
+    snapshot.wallTime = SystemClock::time_point(std::chrono::duration_cast<SystemClock::duration>(
+        std::chrono::nanoseconds(meta.wallTimeNs)));
+    snapshot.duration = std::chrono::nanoseconds(meta.durationNs);
+    for (std::size_t i = 0; i < SystemSnapshot::NUM_SOURCES; ++i) {
+        SystemSnapshot::SourceTiming& timing = snapshot.timings[i];
+        timing.sampled = meta.timings[i].sampled != 0;
+        timing.readAt = SteadyClock::time_point(std::chrono::duration_cast<SteadyClock::duration>(
+            std::chrono::nanoseconds(meta.timings[i].readAtNs)));
+        timing.readDuration = std::chrono::nanoseconds(meta.timings[i].readDurationNs);
+    }
+
+    auto read = [&](Source source, bool found) {
+        SystemSnapshot::SourceTiming& timing = snapshot.timings[static_cast<std::size_t>(source)];
+        timing.sampled = timing.sampled && found;
+    };
+    read(Source::Memory, getStats(snapshot.memory));
+    read(Source::Processor, getStats(snapshot.processor));
+    read(Source::Disk, getStats(snapshot.disks));
+    read(Source::Network, getStats(snapshot.interfaces));
+    read(Source::Protocols, getStats(snapshot.protocols));
+    read(Source::Cgroups, false);
+    read(Source::Pressure, getStats(snapshot.pressure));
+}
+
+uint64_t Publication::getSequence() const {
+    uint64_t sequence = 0;
+    readRecord(pImpl->base, META, [&](const unsigned char* fixed, const unsigned char*, uint32_t) {
+        std::memcpy(&sequence, fixed + offsetof(MetaRecord, sequence), sizeof(sequence));
+    });
+    return sequence;
+}
+
+bool Publication::isPublisherAlive() const {
+    const auto* header = reinterpret_cast<const SegmentHeader*>(pImpl->base);
+    if (header->retired.load(std::memory_order_acquire)) return false;
+    pid_t pid = static_cast<pid_t>(header->publisherPid);
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+} // namespace kuserspace
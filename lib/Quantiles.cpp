@@ -0,0 +1,280 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Quantiles.h"
+#include <shared_mutex>
+#include <mutex>
+#include <unordered_map>
+#include <deque>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace kuserspace {
+
+namespace {
+
+constexpr unsigned int PRECISION_BITS = 5;
+
+} // namespace
+
+class Quantiles::Impl {
+public:
+    Impl(std::chrono::seconds width, std::size_t slotCount, double valueScale, double highestValue)
+        : slotWidth(std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(width).count(), 1)),
+          slots(std::max<std::size_t>(slotCount, 1)),
+          scale(valueScale > 0 ? valueScale : 1.0),
+          highest(toScaled(highestValue)) {}
+
+    struct Metric {
+        std::string name;
+        std::vector<Histogram> ring;        // slot s lives at s % slots
+        Histogram closed;                   // the window's slots before the current one
+        int64_t slot = std::numeric_limits<int64_t>::min();
+        bool dirty = false;
+        std::shared_ptr<const Histogram> published;     // std::atomic_load / atomic_store only
+    };
+
+    MetricId getMetric(const std::string& name) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = index.find(name);
+            if (it != index.end()) return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto it = index.find(name);
+        if (it != index.end()) return it->second;
+
+        auto metric = std::make_unique<Metric>(Metric{name, {}, emptySketch(), std::numeric_limits<int64_t>::min(),
+                                                      false, nullptr});
+        metric->ring.assign(slots, emptySketch());
+        std::atomic_store(&metric->published, std::make_shared<const Histogram>(emptySketch()));
+        metrics.push_back(std::move(metric));
+        index.emplace(name, metrics.size() - 1);
+        return metrics.size() - 1;
+    }
+
+    MetricId findMetric(const std::string& name) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = index.find(name);
+        if (it == index.end()) {
+            throw std::out_of_range("Unknown metric: " + name);
+        }
+        return it->second;
+    }
+
+    std::vector<std::string> getMetricNames() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        std::vector<std::string> names;
+        for (const auto& metric : metrics) {
+            names.push_back(metric->name);
+        }
+        return names;
+    }
+
+    void record(MetricId id, Clock::time_point time, double value) {
+        Metric& metric = at(id);
+        int64_t slot = slotOf(time);
+        if (metric.slot == std::numeric_limits<int64_t>::min()) {
+            metric.slot = slot;
+        } else if (slot > metric.slot) {
+            advance(metric, slot);
+        } else if (slot <= metric.slot - static_cast<int64_t>(slots)) {
+            return;     // older than the window
+        } else if (slot < metric.slot) {
+            // Late sample for a closed slot still in the window
+            metric.ring[ringIndex(slot)].record(toScaled(value));
+            metric.closed.record(toScaled(value));
+            metric.dirty = true;
+            return;
+        }
+        metric.ring[ringIndex(slot)].record(toScaled(value));
+        metric.dirty = true;
+    }
+
+    void record(const SystemSnapshot::Snapshot& snapshot) {
+        using Source = SystemSnapshot::Source;
+        Clock::time_point time = snapshot.wallTime;
+
+        if (snapshot.timing(Source::Processor).sampled) {
+            const auto& cores = snapshot.processor.perCoreUtilization;
+            for (std::size_t cpu = 0; cpu < cores.size(); ++cpu) {
+                if (cpu >= coreIds.size()) {
+                    coreIds.push_back(getMetric("cpu" + std::to_string(cpu) + ".utilization"));
+                }
+                record(coreIds[cpu], time, cores[cpu]);
+            }
+        }
+        if (snapshot.timing(Source::Disk).sampled) {
+            for (const auto& disk : snapshot.disks) {
+                if (disk.partition) continue;
+                auto it = diskIds.find(disk.name);
+                if (it == diskIds.end()) {
+                    it = diskIds.emplace(disk.name, std::make_pair(getMetric("disk." + disk.name + ".readAwaitMs"),
+                                                                   getMetric("disk." + disk.name + ".writeAwaitMs"))).first;
+                }
+                // Await is only defined over intervals that completed requests
+                if (disk.readIops > 0) record(it->second.first, time, disk.readAwaitMs);
+                if (disk.writeIops > 0) record(it->second.second, time, disk.writeAwaitMs);
+            }
+        }
+        if (snapshot.timing(Source::Memory).sampled && snapshot.memory.total) {
+            const Memory::Stats& memory = snapshot.memory;
+            double used = static_cast<double>(memory.total - memory.free - memory.cached - memory.buffers);
+            if (memoryId == NONE) memoryId = getMetric("memory.usedPercent");
+            record(memoryId, time, 100.0 * used / static_cast<double>(memory.total));
+        }
+        publish(time);
+    }
+
+    void publish(Clock::time_point now) {
+        int64_t slot = slotOf(now);
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (const auto& metric : metrics) {
+            if (metric->slot != std::numeric_limits<int64_t>::min() && slot > metric->slot) {
+                advance(*metric, slot);
+            }
+            if (!metric->dirty) continue;
+            auto sketch = std::make_shared<Histogram>(metric->closed);
+            sketch->merge(metric->ring[ringIndex(metric->slot)]);
+            std::atomic_store(&metric->published, std::shared_ptr<const Histogram>(std::move(sketch)));
+            metric->dirty = false;
+        }
+    }
+
+    Histogram getSketch(const std::vector<MetricId>& ids) const {
+        Histogram merged = emptySketch();
+        for (MetricId id : ids) {
+            merged.merge(*std::atomic_load(&at(id).published));
+        }
+        return merged;
+    }
+
+    Summary summarize(const Histogram& sketch) const {
+        return {
+            static_cast<std::size_t>(sketch.getCount()),
+            static_cast<double>(sketch.getMin()) / scale,
+            static_cast<double>(sketch.getMax()) / scale,
+            sketch.getMean() / scale,
+            static_cast<double>(sketch.getPercentile(50)) / scale,
+            static_cast<double>(sketch.getPercentile(95)) / scale,
+            static_cast<double>(sketch.getPercentile(99)) / scale
+        };
+    }
+
+    double getScale() const {
+        return scale;
+    }
+
+private:
+    static constexpr MetricId NONE = std::numeric_limits<MetricId>::max();
+
+    Metric& at(MetricId id) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (id >= metrics.size()) {
+            throw std::out_of_range("Unknown metric: " + std::to_string(id));
+        }
+        return *metrics[id];
+    }
+
+    Histogram emptySketch() const {
+        return Histogram(PRECISION_BITS, highest);
+    }
+
+    uint64_t toScaled(double value) const {
+        if (!(value > 0)) return 0;
+        double scaled = std::round(value * scale);
+        return scaled >= 1.8e19 ? std::numeric_limits<uint64_t>::max() : static_cast<uint64_t>(scaled);
+    }
+
+    int64_t slotOf(Clock::time_point time) const {
+        int64_t millis = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+        return millis / slotWidth - (millis < 0 && millis % slotWidth ? 1 : 0);
+    }
+
+    std::size_t ringIndex(int64_t slot) const {
+        int64_t index = slot % static_cast<int64_t>(slots);
+        return static_cast<std::size_t>(index < 0 ? index + static_cast<int64_t>(slots) : index);
+    }
+
+    // Move the current slot forward, clearing slots that left the window,
+    // and rebuild the merge of the closed ones
+    void advance(Metric& metric, int64_t slot) {
+        int64_t steps = std::min<int64_t>(slot - metric.slot, static_cast<int64_t>(slots));
+        for (int64_t k = 1; k <= steps; ++k) {
+            metric.ring[ringIndex(slot - steps + k)].reset();
+        }
+        metric.slot = slot;
+        metric.closed.reset();
+        for (std::size_t k = 1; k < slots; ++k) {
+            metric.closed.merge(metric.ring[ringIndex(slot - static_cast<int64_t>(k))]);
+        }
+        metric.dirty = true;
+    }
+
+    const int64_t slotWidth;            // milliseconds
+    const std::size_t slots;
+    const double scale;
+    const uint64_t highest;
+
+    std::deque<std::unique_ptr<Metric>> metrics;
+    std::unordered_map<std::string, MetricId> index;
+    mutable std::shared_mutex mutex;    // guards the registry, not the sketches
+
+    // Sampler-side caches for record(snapshot)
+    std::vector<MetricId> coreIds;
+    std::unordered_map<std::string, std::pair<MetricId, MetricId>> diskIds;
+    MetricId memoryId = NONE;
+};
+
+Quantiles::Quantiles() : Quantiles(std::chrono::minutes(5), 12, 100.0, 1e6) {}
+
+Quantiles::Quantiles(std::chrono::seconds slotWidth, std::size_t slots, double scale, double highestValue)
+    : pImpl(std::make_unique<Impl>(slotWidth, slots, scale, highestValue)) {}
+
+Quantiles::~Quantiles() = default;
+
+Quantiles::MetricId Quantiles::getMetric(const std::string& name) {
+    return pImpl->getMetric(name);
+}
+
+Quantiles::MetricId Quantiles::findMetric(const std::string& name) const {
+    return pImpl->findMetric(name);
+}
+
+std::vector<std::string> Quantiles::getMetricNames() const {
+    return pImpl->getMetricNames();
+}
+
+void Quantiles::record(MetricId metric, Clock::time_point time, double value) {
+    pImpl->record(metric, time, value);
+}
+
+void Quantiles::record(const SystemSnapshot::Snapshot& snapshot) {
+    pImpl->record(snapshot);
+}
+
+void Quantiles::publish(Clock::time_point now) {
+    pImpl->publish(now);
+}
+
+Histogram Quantiles::getSketch(MetricId metric) const {
+    return pImpl->getSketch({metric});
+}
+
+Histogram Quantiles::getSketch(const std::vector<MetricId>& metrics) const {
+    return pImpl->getSketch(metrics);
+}
+
+Quantiles::Summary Quantiles::getSummary(MetricId metric) const {
+    return pImpl->summarize(pImpl->getSketch({metric}));
+}
+
+Quantiles::Summary Quantiles::summarize(const Histogram& sketch) const {
+    return pImpl->summarize(sketch);
+}
+
+double Quantiles::getScale() const {
+    return pImpl->getScale();
+}
+
+} // namespace kuserspace
@@ -0,0 +1,513 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Recording.h"
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace kuserspace {
+
+namespace {
+
+constexpr char FILE_MAGIC[8] = {'K', 'U', 'S', 'R', 'E', 'C', '0', '1'};
+constexpr char BLOCK_MAGIC[8] = {'K', 'U', 'S', 'B', 'L', 'O', 'C', 'K'};
+constexpr char STAGE_MAGIC[8] = {'K', 'U', 'S', 'S', 'T', 'A', 'G', 'E'};
+constexpr uint32_t VERSION = 2;
+constexpr std::size_t ALIGNMENT = 4096;
+constexpr std::size_t COLUMNS_OFFSET = 64;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t columns;           // including time
+    uint64_t rowsPerBlock;
+    uint64_t blockSize;
+    uint64_t headerSize;
+};
+
+struct ColumnEntry {
+    char name[56];              // NUL-terminated
+    uint8_t type;
+    uint8_t reserved[7];
+};
+
+// Blocks are written whole, once their rows are all committed
+struct BlockHeader {
+    char magic[8];
+    uint64_t index;
+    uint64_t rows;
+    uint64_t reserved[5];
+};
+
+// Rows of the block being filled, one after another. block changes, and
+// committed restarts, only after the previous block was written.
+struct StageHeader {
+    char magic[8];
+    std::atomic<uint64_t> block;
+    std::atomic<uint64_t> committed;
+    uint64_t reserved[5];
+};
+
+static_assert(sizeof(FileHeader) <= COLUMNS_OFFSET, "file header overlaps the schema");
+static_assert(sizeof(ColumnEntry) == 64, "column entries are 64 bytes");
+static_assert(sizeof(BlockHeader) == 64, "block header is one cache line");
+static_assert(sizeof(StageHeader) == 64, "stage header is one cache line");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "commit counter must be lock-free in shared memory");
+
+std::size_t alignUp(std::size_t value) {
+    return (value + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// The staging area has a spare row for a sample set while sealing fails
+std::size_t stageSize(std::size_t columns, std::size_t rowsPerBlock) {
+    return alignUp(sizeof(StageHeader) + columns * (rowsPerBlock + 1) * sizeof(Recording::Value));
+}
+
+Recording::Schema withTime(const Recording::Schema& schema) {
+    Recording::Schema full;
+    full.reserve(schema.size() + 1);
+    full.push_back({"time", Recording::Type::Signed});
+    full.insert(full.end(), schema.begin(), schema.end());
+    return full;
+}
+
+// Read and validate the header and schema at the start of a recording
+bool readHeader(const char* data, std::size_t size, FileHeader& header, Recording::Schema& schema) {
+    if (size < COLUMNS_OFFSET) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != VERSION ||
+        header.columns == 0 || header.rowsPerBlock == 0 || header.headerSize > size ||
+        COLUMNS_OFFSET + header.columns * sizeof(ColumnEntry) > header.headerSize ||
+        header.blockSize < sizeof(BlockHeader) + header.columns * header.rowsPerBlock * sizeof(Recording::Value)) {
+        return false;
+    }
+
+    schema.clear();
+    for (uint32_t i = 0; i < header.columns; ++i) {
+        ColumnEntry entry;
+        std::memcpy(&entry, data + COLUMNS_OFFSET + i * sizeof(ColumnEntry), sizeof(entry));
+        entry.name[sizeof(entry.name) - 1] = '\0';
+        if (entry.type > static_cast<uint8_t>(Recording::Type::Double)) return false;
+        schema.push_back({entry.name, static_cast<Recording::Type>(entry.type)});
+    }
+    return true;
+}
+
+} // namespace
+
+Recording::Schema Recording::memorySchema() {
+    const char* names[] = {
+        "memory.total", "memory.free", "memory.available", "memory.cached", "memory.buffers",
+        "memory.swapTotal", "memory.swapFree", "memory.active", "memory.inactive",
+        "memory.activeAnon", "memory.inactiveAnon", "memory.activeFile", "memory.inactiveFile",
+        "memory.unevictable", "memory.mlocked", "memory.highTotal", "memory.highFree",
+        "memory.lowTotal", "memory.lowFree", "memory.hugePagesTotal", "memory.hugePagesFree",
+        "memory.hugePagesRsvd", "memory.hugePagesSurp", "memory.hugePageSize", "memory.directMap4k",
+        "memory.directMap2M", "memory.directMap1G"
+    };
+    Schema schema;
+    for (const char* name : names) {
+        schema.push_back({name, Type::Unsigned});
+    }
+    return schema;
+}
+
+Recording::Schema Recording::processorSchema() {
+    const char* names[] = {
+        "cpu.user", "cpu.nice", "cpu.system", "cpu.idle", "cpu.iowait",
+        "cpu.irq", "cpu.softirq", "cpu.steal", "cpu.guest", "cpu.guestNice"
+    };
+    Schema schema;
+    for (const char* name : names) {
+        schema.push_back({name, Type::Unsigned});
+    }
+    schema.push_back({"cpu.utilization", Type::Double});
+    return schema;
+}
+
+// ---------------------------------------------------------------------------
+// Recording
+
+Recording::Recording(const std::string& file) : path(file) {
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    try {
+        map();
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+}
+
+Recording::~Recording() {
+    unmap();
+    if (fd != -1) {
+        close(fd);
+    }
+}
+
+void Recording::refresh() {
+    unmap();
+    map();
+}
+
+void Recording::map() {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        throw std::runtime_error("Could not stat file: " + path);
+    }
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    if (size > 0) {
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Could not map file: " + path);
+        }
+        data = static_cast<const char*>(mapped);
+        mappedSize = size;
+    }
+
+    FileHeader header;
+    if (!data || !readHeader(data, mappedSize, header, schema) ||
+        header.headerSize + stageSize(header.columns, header.rowsPerBlock) > mappedSize ||
+        std::memcmp(data + header.headerSize, STAGE_MAGIC, sizeof(STAGE_MAGIC)) != 0) {
+        unmap();
+        throw std::runtime_error("Not a recording: " + path);
+    }
+    rowsPerBlock = header.rowsPerBlock;
+    blockSize = header.blockSize;
+    headerSize = header.headerSize;
+    std::size_t columns = schema.size();
+    std::size_t blocksOffset = headerSize + stageSize(columns, rowsPerBlock);
+
+    // Copy the staged rows out column by column. The writer moves on to
+    // the next block before it overwrites a row, so a block number that
+    // held still across the copy means the copy is of that block.
+    const auto* stage = reinterpret_cast<const StageHeader*>(data + headerSize);
+    const auto* stagedCells = reinterpret_cast<const Value*>(stage + 1);
+    std::size_t stagedBlock;
+    std::size_t count;
+    while (true) {
+        stagedBlock = stage->block.load(std::memory_order_acquire);
+        count = stage->committed.load(std::memory_order_acquire);
+        if (count > rowsPerBlock) count = rowsPerBlock;
+        staged.resize(columns * count);
+        for (std::size_t r = 0; r < count; ++r) {
+            for (std::size_t c = 0; c < columns; ++c) {
+                staged[c * count + r] = stagedCells[r * columns + c];
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (stage->block.load(std::memory_order_relaxed) == stagedBlock) break;
+    }
+
+    blockRows.clear();
+    rows = 0;
+    std::size_t sealed = 0;
+    for (std::size_t offset = blocksOffset; offset + blockSize <= mappedSize; offset += blockSize, ++sealed) {
+        const auto* block = reinterpret_cast<const BlockHeader*>(data + offset);
+        if (std::memcmp(block->magic, BLOCK_MAGIC, sizeof(BLOCK_MAGIC)) != 0 || block->index != sealed) break;
+        blockRows.push_back(rowsPerBlock);
+        rows += rowsPerBlock;
+    }
+    if (sealed < stagedBlock) {
+        // Blocks written since the file was measured; measure again
+        unmap();
+        map();
+        return;
+    }
+    if (sealed > stagedBlock) {
+        staged.clear();         // sealed while we looked; its rows are in the blocks now
+    } else if (count > 0) {
+        blockRows.push_back(count);
+        rows += count;
+    }
+}
+
+void Recording::unmap() {
+    if (data) {
+        munmap(const_cast<char*>(data), mappedSize);
+        data = nullptr;
+        mappedSize = 0;
+    }
+}
+
+std::size_t Recording::getColumnIndex(const std::string& name) const {
+    for (std::size_t i = 0; i < schema.size(); ++i) {
+        if (schema[i].name == name) return i;
+    }
+    throw std::out_of_range("Unknown column: " + name);
+}
+
+std::vector<Recording::Segment> Recording::getColumn(std::size_t column) const {
+    if (column >= schema.size()) {
+        throw std::out_of_range("Unknown column: " + std::to_string(column));
+    }
+    std::vector<Segment> segments;
+    segments.reserve(blockRows.size());
+    std::size_t firstRow = 0;
+    for (std::size_t b = 0; b < blockRows.size(); ++b) {
+        if (isStaged(b)) {
+            segments.push_back({staged.data() + column * blockRows[b], blockRows[b], firstRow});
+        } else {
+            segments.push_back({blockCells(b) + column * rowsPerBlock, blockRows[b], firstRow});
+        }
+        firstRow += blockRows[b];
+    }
+    return segments;
+}
+
+std::vector<Recording::Segment> Recording::getColumn(const std::string& name) const {
+    return getColumn(getColumnIndex(name));
+}
+
+Recording::Value Recording::get(std::size_t row, std::size_t column) const {
+    if (row >= rows || column >= schema.size()) {
+        throw std::out_of_range("Unknown cell: " + std::to_string(row) + ", " + std::to_string(column));
+    }
+    std::size_t b = row / rowsPerBlock;
+    if (isStaged(b)) {
+        return staged[column * blockRows[b] + row % rowsPerBlock];
+    }
+    return blockCells(b)[column * rowsPerBlock + row % rowsPerBlock];
+}
+
+bool Recording::isStaged(std::size_t block) const {
+    return !staged.empty() && block + 1 == blockRows.size();
+}
+
+const Recording::Value* Recording::blockCells(std::size_t block) const {
+    std::size_t offset = headerSize + stageSize(schema.size(), rowsPerBlock) + block * blockSize;
+    return reinterpret_cast<const Value*>(data + offset + sizeof(BlockHeader));
+}
+
+// ---------------------------------------------------------------------------
+// Recorder
+
+Recorder::Recorder(const std::string& file, const Recording::Schema& schema)
+    : Recorder(file, schema, 128) {}
+
+Recorder::Recorder(const std::string& file, const Recording::Schema& userSchema, std::size_t blockRows)
+    : path(file), rowsPerBlock(blockRows ? blockRows : 1) {
+    Recording::Schema schema = withTime(userSchema);
+    for (const auto& column : schema) {
+        if (column.name.size() >= sizeof(ColumnEntry::name)) {
+            throw std::runtime_error("Column name too long: " + column.name);
+        }
+        types.push_back(column.type);
+    }
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    try {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            throw std::runtime_error("Could not stat file: " + path);
+        }
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+
+        std::size_t stage = stageSize(schema.size(), rowsPerBlock);
+        if (size == 0) {
+            // New recording: write the header, schema and an empty staging area
+            headerSize = alignUp(COLUMNS_OFFSET + schema.size() * sizeof(ColumnEntry));
+            blockSize = alignUp(sizeof(BlockHeader) + schema.size() * rowsPerBlock * sizeof(Recording::Value));
+            std::vector<char> header(headerSize + stage, 0);
+            FileHeader fileHeader{};
+            std::memcpy(fileHeader.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+            fileHeader.version = VERSION;
+            fileHeader.columns = static_cast<uint32_t>(schema.size());
+            fileHeader.rowsPerBlock = rowsPerBlock;
+            fileHeader.blockSize = blockSize;
+            fileHeader.headerSize = headerSize;
+            std::memcpy(header.data(), &fileHeader, sizeof(fileHeader));
+            for (std::size_t i = 0; i < schema.size(); ++i) {
+                ColumnEntry entry{};
+                std::memcpy(entry.name, schema[i].name.data(), schema[i].name.size());
+                entry.type = static_cast<uint8_t>(schema[i].type);
+                std::memcpy(header.data() + COLUMNS_OFFSET + i * sizeof(ColumnEntry), &entry, sizeof(entry));
+            }
+            std::memcpy(header.data() + headerSize, STAGE_MAGIC, sizeof(STAGE_MAGIC));
+            if (pwrite(fd, header.data(), header.size(), 0) != static_cast<ssize_t>(header.size())) {
+                throw std::runtime_error("Could not write file: " + path);
+            }
+            mapStage();
+        } else {
+            // Existing recording: the schema must match, then resume after the
+            // last committed row
+            FileHeader fileHeader{};
+            if (pread(fd, &fileHeader, sizeof(fileHeader), 0) != sizeof(fileHeader) || fileHeader.headerSize > size) {
+                throw std::runtime_error("Not a recording: " + path);
+            }
+            std::vector<char> header(fileHeader.headerSize);
+            Recording::Schema existing;
+            if (pread(fd, header.data(), header.size(), 0) != static_cast<ssize_t>(header.size()) ||
+                !readHeader(header.data(), header.size(), fileHeader, existing)) {
+                throw std::runtime_error("Not a recording: " + path);
+            }
+            bool same = existing.size() == schema.size();
+            for (std::size_t i = 0; same && i < schema.size(); ++i) {
+                same = existing[i].name == schema[i].name && existing[i].type == schema[i].type;
+            }
+            if (!same) {
+                throw std::runtime_error("Recording schema mismatch: " + path);
+            }
+            rowsPerBlock = fileHeader.rowsPerBlock;
+            blockSize = fileHeader.blockSize;
+            headerSize = fileHeader.headerSize;
+            stage = stageSize(schema.size(), rowsPerBlock);
+            if (headerSize + stage > size) {
+                throw std::runtime_error("Not a recording: " + path);
+            }
+
+            std::size_t blocks = (size - headerSize - stage) / blockSize;
+            for (block = 0; block < blocks; ++block) {
+                BlockHeader blockHeader;
+                if (pread(fd, &blockHeader, sizeof(blockHeader), headerSize + stage + block * blockSize) != sizeof(blockHeader) ||
+                    std::memcmp(blockHeader.magic, BLOCK_MAGIC, sizeof(BLOCK_MAGIC)) != 0 || blockHeader.index != block) {
+                    break;
+                }
+            }
+            rows = block * rowsPerBlock;
+
+            mapStage();
+            if (std::memcmp(static_cast<char*>(mapping) + headerSize, STAGE_MAGIC, sizeof(STAGE_MAGIC)) != 0) {
+                throw std::runtime_error("Not a recording: " + path);
+            }
+            if (stagedBlock->load(std::memory_order_relaxed) == block) {
+                std::size_t count = committed->load(std::memory_order_relaxed);
+                row = count < rowsPerBlock ? count : rowsPerBlock;
+            } else {
+                // Stopped between writing a block and clearing the staging area
+                committed->store(0, std::memory_order_relaxed);
+                stagedBlock->store(block, std::memory_order_release);
+            }
+        }
+        sealing.assign(blockSize, 0);
+        if (row == rowsPerBlock) {
+            seal();
+        }
+    } catch (...) {
+        unmapStage();
+        close(fd);
+        throw;
+    }
+}
+
+Recorder::~Recorder() {
+    unmapStage();
+    if (fd != -1) {
+        close(fd);
+    }
+}
+
+void Recorder::set(std::size_t first, const Memory::Stats& stats) {
+    const size_t values[] = {
+        stats.total, stats.free, stats.available, stats.cached, stats.buffers,
+        stats.swapTotal, stats.swapFree, stats.active, stats.inactive,
+        stats.activeAnon, stats.inactiveAnon, stats.activeFile, stats.inactiveFile,
+        stats.unevictable, stats.mlocked, stats.highTotal, stats.highFree,
+        stats.lowTotal, stats.lowFree, stats.hugePagesTotal, stats.hugePagesFree,
+        stats.hugePagesRsvd, stats.hugePagesSurp, stats.hugePageSize, stats.directMap4k,
+        stats.directMap2M, stats.directMap1G
+    };
+    for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        set(first + i, values[i]);
+    }
+}
+
+void Recorder::set(std::size_t first, const Processor::Stats& stats) {
+    const uint64_t values[] = {
+        stats.userTime, stats.niceTime, stats.systemTime, stats.idleTime, stats.iowaitTime,
+        stats.irqTime, stats.softirqTime, stats.stealTime, stats.guestTime, stats.guestNiceTime
+    };
+    std::size_t count = sizeof(values) / sizeof(values[0]);
+    for (std::size_t i = 0; i < count; ++i) {
+        set(first + i, values[i]);
+    }
+    set(first + count, stats.totalUtilization);
+}
+
+void Recorder::sync() {
+    if (mapping) {
+        msync(mapping, mappingSize, MS_SYNC);
+    }
+    fdatasync(fd);
+}
+
+void Recorder::seal() {
+    // Transpose the staged rows into a block and write it in one go
+    std::size_t columns = types.size();
+    BlockHeader header{};
+    std::memcpy(header.magic, BLOCK_MAGIC, sizeof(BLOCK_MAGIC));
+    header.index = block;
+    header.rows = rowsPerBlock;
+    std::memcpy(sealing.data(), &header, sizeof(header));
+    auto* out = reinterpret_cast<Recording::Value*>(sealing.data() + sizeof(BlockHeader));
+    for (std::size_t c = 0; c < columns; ++c) {
+        for (std::size_t r = 0; r < rowsPerBlock; ++r) {
+            out[c * rowsPerBlock + r] = cells[r * columns + c];
+        }
+    }
+    off_t offset = static_cast<off_t>(headerSize + stageSize(columns, rowsPerBlock) + block * blockSize);
+    for (std::size_t written = 0; written < blockSize;) {
+        ssize_t n = pwrite(fd, sealing.data() + written, blockSize - written, offset + static_cast<off_t>(written));
+        if (n > 0) {
+            written += static_cast<std::size_t>(n);
+        } else if (n == -1 && errno != EINTR) {
+            // The staged rows stay put; the next commit() tries again
+            throw std::runtime_error("Could not write file: " + path + ": " + std::strerror(errno));
+        }
+    }
+
+    // Readers must see the new block number before any row is overwritten
+    committed->store(0, std::memory_order_relaxed);
+    stagedBlock->store(++block, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    rows += rowsPerBlock;
+    row = 0;
+}
+
+void Recorder::retrySeal() {
+    seal();
+    // The row set while sealing failed sits in the spare row
+    std::memcpy(cells, cells + rowsPerBlock * types.size(), types.size() * sizeof(Recording::Value));
+}
+
+void Recorder::mapStage() {
+    // The header pages come along so the mapping starts at offset 0
+    std::size_t size = headerSize + stageSize(types.size(), rowsPerBlock);
+    void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Could not map file: " + path);
+    }
+#ifdef MADV_POPULATE_WRITE
+    // Take the staging area's write faults now instead of on the first
+    // samples; older kernels reject the advice and fault lazily
+    madvise(mapped, size, MADV_POPULATE_WRITE);
+#endif
+    mapping = mapped;
+    mappingSize = size;
+    auto* header = reinterpret_cast<StageHeader*>(static_cast<char*>(mapped) + headerSize);
+    stagedBlock = &header->block;
+    committed = &header->committed;
+    cells = reinterpret_cast<Recording::Value*>(header + 1);
+}
+
+void Recorder::unmapStage() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        stagedBlock = nullptr;
+        committed = nullptr;
+        cells = nullptr;
+    }
+}
+
+} // namespace kuserspace
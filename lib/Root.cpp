@@ -0,0 +1,63 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Root.h"
+#include "../include/Cgroup.h"
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+
+namespace kuserspace {
+
+namespace {
+
+std::mutex defaultMutex;
+std::unique_ptr<Root> defaultRoot;
+
+// True if path is prefix itself or lies below it
+bool under(const std::string& path, const char* prefix, size_t length) {
+    return path.compare(0, length, prefix) == 0 && (path.size() == length || path[length] == '/');
+}
+
+} // namespace
+
+Root Root::forProcess(int pid) {
+    Root root;
+    std::string base = "/proc/" + std::to_string(pid) + "/root";
+    root.proc = base + "/proc";
+    root.sys = base + "/sys";
+    root.cgroup = Cgroup::getProcessPath(pid);
+    root.pid = pid;
+    return root;
+}
+
+Root Root::at(const std::string& directory) {
+    Root root;
+    std::string base = directory;
+    while (base.size() > 1 && base.back() == '/') {
+        base.pop_back();
+    }
+    root.proc = base + "/proc";
+    root.sys = base + "/sys";
+    return root;
+}
+
+Root Root::getDefault() {
+    std::lock_guard<std::mutex> lock(defaultMutex);
+    if (!defaultRoot) {
+        const char* directory = std::getenv("KUSERSPACE_ROOT");
+        defaultRoot = std::make_unique<Root>(directory && *directory ? Root::at(directory) : Root());
+    }
+    return *defaultRoot;
+}
+
+void Root::setDefault(const Root& root) {
+    std::lock_guard<std::mutex> lock(defaultMutex);
+    defaultRoot = std::make_unique<Root>(root);
+}
+
+std::string Root::resolve(const std::string& path) const {
+    if (under(path, "/proc", 5)) return proc + path.substr(5);
+    if (under(path, "/sys", 4)) return sys + path.substr(4);
+    return path;
+}
+
+} // namespace kuserspace
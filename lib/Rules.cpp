@@ -0,0 +1,869 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Rules.h"
+#include <mutex>
+#include <unordered_map>
+#include <deque>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <charconv>
+#include <cstdint>
+#include <cmath>
+
+namespace kuserspace {
+
+namespace {
+
+using Snapshot = SystemSnapshot::Snapshot;
+using Source = SystemSnapshot::Source;
+
+constexpr double MISSING = std::numeric_limits<double>::quiet_NaN();
+
+enum class Op : uint8_t {
+    Load, Const, Neg, Not,
+    Add, Sub, Mul, Div,
+    Lt, Le, Gt, Ge, Eq, Ne,
+    And, Or
+};
+
+const char* const OP_NAMES[] = {
+    "load", "const", "neg", "not",
+    "add", "sub", "mul", "div",
+    "lt", "le", "gt", "ge", "eq", "ne",
+    "and", "or"
+};
+
+struct Instruction {
+    Op op;
+    uint32_t slot;      // Load
+    double value;       // Const
+};
+
+// NaN, a missing metric, is false
+inline bool truth(double value) {
+    return value == value && value != 0.0;
+}
+
+inline bool missing(double value) {
+    return value != value;
+}
+
+// A comparison with a missing operand is missing, not false, so that
+// negating it does not fire either. and/or follow three-valued logic: a
+// known false (true) operand decides and/or, otherwise missing wins.
+inline double logicalNot(double value) {
+    return missing(value) ? MISSING : (truth(value) ? 0.0 : 1.0);
+}
+
+inline double binary(Op op, double a, double b) {
+    switch (op) {
+    case Op::Add: return a + b;
+    case Op::Sub: return a - b;
+    case Op::Mul: return a * b;
+    case Op::Div: return a / b;
+    case Op::And:
+        if ((!missing(a) && !truth(a)) || (!missing(b) && !truth(b))) return 0.0;
+        return missing(a) || missing(b) ? MISSING : 1.0;
+    case Op::Or:
+        if (truth(a) || truth(b)) return 1.0;
+        return missing(a) || missing(b) ? MISSING : 0.0;
+    default:
+        break;
+    }
+    if (missing(a) || missing(b)) return MISSING;
+    switch (op) {
+    case Op::Lt: return a < b;
+    case Op::Le: return a <= b;
+    case Op::Gt: return a > b;
+    case Op::Ge: return a >= b;
+    case Op::Eq: return a == b;
+    case Op::Ne: return a != b;
+    default: return MISSING;
+    }
+}
+
+// A parsed rule. Load instructions index names until the rule is bound.
+struct Program {
+    std::vector<Instruction> code;
+    std::vector<std::string> names;
+    std::size_t depth = 0;
+    std::size_t holdSamples = 1;
+    Rules::Clock::duration holdTime{0};
+};
+
+/**
+ * Recursive descent over the rule text, emitting postfix code as it goes.
+ * Constant subexpressions are folded at emission.
+ *
+ *     rule    := or ['for' number ('sample' | 'samples' | 'ms' | 's' | 'm' | 'h')]
+ *     or      := and (('or' | '||') and)*
+ *     and     := not (('and' | '&&') not)*
+ *     not     := ('not' | '!') not | compare
+ *     compare := sum [('<' | '<=' | '>' | '>=' | '==' | '!=') sum]
+ *     sum     := term (('+' | '-') term)*
+ *     term    := unary (('*' | '/') unary)*
+ *     unary   := '-' unary | number ['%' | 'KiB' | 'MiB' | 'GiB' | 'TiB'] | name | '(' or ')'
+ */
+class Compiler {
+public:
+    explicit Compiler(std::string_view rule) : text(rule) {
+        advance();
+    }
+
+    Program compile() {
+        parseOr();
+        if (isKeyword("for")) {
+            advance();
+            parseHold();
+        }
+        if (token.kind != Kind::End) fail("unexpected '" + std::string(token.text) + "'");
+        return std::move(program);
+    }
+
+private:
+    enum class Kind { End, Number, Name, Quoted, Symbol };
+
+    struct Token {
+        Kind kind;
+        std::string_view text;
+        std::size_t begin;
+        std::size_t end;
+        double number;
+    };
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::invalid_argument("Rule error at column " + std::to_string(token.begin + 1) + ": " + message);
+    }
+
+    static bool isNameChar(char c, bool first) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+               (!first && ((c >= '0' && c <= '9') || c == '.'));
+    }
+
+    void advance() {
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n')) {
+            ++position;
+        }
+        std::size_t begin = position;
+        token = {Kind::End, {}, begin, begin, 0.0};
+        if (position >= text.size()) return;
+
+        char c = text[position];
+        if ((c >= '0' && c <= '9') || c == '.') {
+            const char* first = text.data() + position;
+            auto result = std::from_chars(first, text.data() + text.size(), token.number);
+            if (result.ec != std::errc()) fail("bad number");
+            position += static_cast<std::size_t>(result.ptr - first);
+            token.kind = Kind::Number;
+        } else if (isNameChar(c, true)) {
+            while (position < text.size() && isNameChar(text[position], false)) ++position;
+            token.kind = Kind::Name;
+        } else if (c == '"') {
+            std::size_t close = text.find('"', position + 1);
+            if (close == std::string_view::npos) fail("unterminated quoted name");
+            token = {Kind::Quoted, text.substr(position + 1, close - position - 1), begin, close + 1, 0.0};
+            position = close + 1;
+            return;
+        } else {
+            static const char* const SYMBOLS[] = {
+                "<=", ">=", "==", "!=", "&&", "||", "<", ">", "!", "+", "-", "*", "/", "(", ")", "%"
+            };
+            for (const char* symbol : SYMBOLS) {
+                std::string_view s(symbol);
+                if (text.compare(position, s.size(), s) == 0) {
+                    position += s.size();
+                    token.kind = Kind::Symbol;
+                    break;
+                }
+            }
+            if (token.kind != Kind::Symbol) fail(std::string("unexpected character '") + c + "'");
+        }
+        token.end = position;
+        token.text = text.substr(begin, position - begin);
+    }
+
+    bool isKeyword(std::string_view word) const {
+        return token.kind == Kind::Name && token.text == word;
+    }
+
+    bool isSymbol(std::string_view symbol) const {
+        return token.kind == Kind::Symbol && token.text == symbol;
+    }
+
+    bool accept(std::string_view keyword, std::string_view symbol) {
+        if (isKeyword(keyword) || isSymbol(symbol)) {
+            advance();
+            return true;
+        }
+        return false;
+    }
+
+    void emit(Instruction instruction) {
+        std::vector<Instruction>& code = program.code;
+        Op op = instruction.op;
+        if (op == Op::Load || op == Op::Const) {
+            program.depth = std::max(program.depth, ++depth);
+        } else if (op == Op::Neg || op == Op::Not) {
+            if (code.back().op == Op::Const) {
+                double& value = code.back().value;
+                value = op == Op::Neg ? -value : logicalNot(value);
+                return;
+            }
+        } else {
+            --depth;
+            std::size_t n = code.size();
+            if (code[n - 1].op == Op::Const && code[n - 2].op == Op::Const) {
+                code[n - 2].value = binary(op, code[n - 2].value, code[n - 1].value);
+                code.pop_back();
+                return;
+            }
+        }
+        code.push_back(instruction);
+    }
+
+    void parseOr() {
+        parseAnd();
+        while (accept("or", "||")) {
+            parseAnd();
+            emit({Op::Or, 0, 0.0});
+        }
+    }
+
+    void parseAnd() {
+        parseNot();
+        while (accept("and", "&&")) {
+            parseNot();
+            emit({Op::And, 0, 0.0});
+        }
+    }
+
+    void parseNot() {
+        if (accept("not", "!")) {
+            parseNot();
+            emit({Op::Not, 0, 0.0});
+            return;
+        }
+        parseCompare();
+    }
+
+    void parseCompare() {
+        static const std::pair<const char*, Op> COMPARISONS[] = {
+            {"<", Op::Lt}, {"<=", Op::Le}, {">", Op::Gt}, {">=", Op::Ge}, {"==", Op::Eq}, {"!=", Op::Ne}
+        };
+        parseSum();
+        for (const auto& [symbol, op] : COMPARISONS) {
+            if (isSymbol(symbol)) {
+                advance();
+                parseSum();
+                emit({op, 0, 0.0});
+                return;
+            }
+        }
+    }
+
+    void parseSum() {
+        parseTerm();
+        while (isSymbol("+") || isSymbol("-")) {
+            Op op = token.text == "+" ? Op::Add : Op::Sub;
+            advance();
+            parseTerm();
+            emit({op, 0, 0.0});
+        }
+    }
+
+    void parseTerm() {
+        parseUnary();
+        while (isSymbol("*") || isSymbol("/")) {
+            Op op = token.text == "*" ? Op::Mul : Op::Div;
+            advance();
+            parseUnary();
+            emit({op, 0, 0.0});
+        }
+    }
+
+    void parseUnary() {
+        if (isSymbol("-")) {
+            advance();
+            parseUnary();
+            emit({Op::Neg, 0, 0.0});
+            return;
+        }
+        if (token.kind == Kind::Number) {
+            double value = token.number;
+            std::size_t end = token.end;
+            advance();
+            if (isSymbol("%")) {
+                advance();
+            } else if (token.kind == Kind::Name && token.begin == end) {
+                static const std::pair<const char*, double> UNITS[] = {
+                    {"KiB", 1024.0}, {"MiB", 1024.0 * 1024}, {"GiB", 1024.0 * 1024 * 1024},
+                    {"TiB", 1024.0 * 1024 * 1024 * 1024}
+                };
+                for (const auto& [unit, scale] : UNITS) {
+                    if (token.text == unit) {
+                        value *= scale;
+                        advance();
+                        break;
+                    }
+                }
+            }
+            emit({Op::Const, 0, value});
+            return;
+        }
+        if (isSymbol("(")) {
+            advance();
+            parseOr();
+            if (!isSymbol(")")) fail("expected ')'");
+            advance();
+            return;
+        }
+        bool keyword = isKeyword("and") || isKeyword("or") || isKeyword("not") || isKeyword("for");
+        if ((token.kind == Kind::Name && !keyword) || token.kind == Kind::Quoted) {
+            if (token.text.empty()) fail("empty metric name");
+            std::string name(token.text);
+            auto it = std::find(program.names.begin(), program.names.end(), name);
+            if (it == program.names.end()) it = program.names.insert(it, name);
+            emit({Op::Load, static_cast<uint32_t>(it - program.names.begin()), 0.0});
+            advance();
+            return;
+        }
+        fail(token.kind == Kind::End ? "unexpected end of rule" : "expected a number or metric, found '" +
+             std::string(token.text) + "'");
+    }
+
+    void parseHold() {
+        if (token.kind != Kind::Number || !(token.number > 0)) fail("expected a positive count or duration after 'for'");
+        double count = token.number;
+        advance();
+        if (isKeyword("sample") || isKeyword("samples")) {
+            if (count != std::floor(count)) fail("sample count must be a whole number");
+            program.holdSamples = static_cast<std::size_t>(count);
+        } else {
+            static const std::pair<const char*, double> UNITS[] = {
+                {"ms", 1e-3}, {"s", 1.0}, {"m", 60.0}, {"h", 3600.0}
+            };
+            const double* seconds = nullptr;
+            for (const auto& [unit, scale] : UNITS) {
+                if (isKeyword(unit)) seconds = &scale;
+            }
+            if (!seconds) fail("expected samples, ms, s, m or h");
+            program.holdTime = std::chrono::duration_cast<Rules::Clock::duration>(
+                std::chrono::duration<double>(count * *seconds));
+        }
+        advance();
+    }
+
+    std::string_view text;
+    std::size_t position = 0;
+    Token token{};
+    Program program;
+    std::size_t depth = 0;
+};
+
+// Snapshot fields by name. Index order is the switch order of the getters.
+
+const char* const MEMORY_FIELDS[] = {
+    "total", "free", "cached", "buffers", "available", "swapTotal", "swapFree",
+    "usedPercent", "availablePercent", "swapUsedPercent"
+};
+
+double memoryField(const Snapshot& snapshot, unsigned field) {
+    const Memory::Stats& memory = snapshot.memory;
+    double total = static_cast<double>(memory.total);
+    switch (field) {
+    case 0: return total;
+    case 1: return static_cast<double>(memory.free);
+    case 2: return static_cast<double>(memory.cached);
+    case 3: return static_cast<double>(memory.buffers);
+    case 4: return static_cast<double>(memory.available);
+    case 5: return static_cast<double>(memory.swapTotal);
+    case 6: return static_cast<double>(memory.swapFree);
+    case 7: return memory.total ? 100.0 * static_cast<double>(memory.total - memory.free - memory.cached - memory.buffers) / total
+                                : MISSING;
+    case 8: return memory.total ? 100.0 * static_cast<double>(memory.available) / total : MISSING;
+    default: return memory.swapTotal ? 100.0 * static_cast<double>(memory.swapTotal - memory.swapFree) /
+                                       static_cast<double>(memory.swapTotal) : 0.0;
+    }
+}
+
+double processorField(const Snapshot& snapshot, unsigned) {
+    return snapshot.processor.totalUtilization;
+}
+
+double coreField(const Snapshot& snapshot, unsigned cpu) {
+    const auto& cores = snapshot.processor.perCoreUtilization;
+    return cpu < cores.size() ? cores[cpu] : MISSING;
+}
+
+const char* const PROTOCOL_FIELDS[] = {
+    "tcp.retransSegsPerSec", "tcp.retransmitPercent", "tcp.listenOverflowsPerSec", "tcp.listenDropsPerSec",
+    "tcp.timeoutsPerSec", "tcp.inErrorsPerSec", "udp.inErrorsPerSec", "udp.rcvbufErrorsPerSec"
+};
+
+double protocolField(const Snapshot& snapshot, unsigned field) {
+    const Network::ProtocolStats& protocols = snapshot.protocols;
+    switch (field) {
+    case 0: return protocols.retransSegsPerSec;
+    case 1: return protocols.retransmitPercent;
+    case 2: return protocols.listenOverflowsPerSec;
+    case 3: return protocols.listenDropsPerSec;
+    case 4: return protocols.timeoutsPerSec;
+    case 5: return protocols.tcpInErrorsPerSec;
+    case 6: return protocols.udpInErrorsPerSec;
+    default: return protocols.rcvbufErrorsPerSec;
+    }
+}
+
+const char* const PRESSURE_RESOURCES[] = {"cpu", "memory", "io"};
+const char* const PRESSURE_KINDS[] = {"some", "full"};
+const char* const PRESSURE_FIELDS[] = {"avg10", "avg60", "avg300", "total"};
+
+// field = (resource * 2 + kind) * 4 + value
+double pressureField(const Snapshot& snapshot, unsigned field) {
+    const SystemSnapshot::Pressure& pressure = snapshot.pressure;
+    const SystemSnapshot::Pressure::Resource* resources[] = {&pressure.cpu, &pressure.memory, &pressure.io};
+    const SystemSnapshot::Pressure::Resource& resource = *resources[field / 8];
+    const SystemSnapshot::Stall& stall = field / 4 % 2 ? resource.full : resource.some;
+    switch (field % 4) {
+    case 0: return stall.avg10;
+    case 1: return stall.avg60;
+    case 2: return stall.avg300;
+    default: return static_cast<double>(stall.total);
+    }
+}
+
+const char* const DISK_FIELDS[] = {
+    "readBytesPerSec", "writeBytesPerSec", "readIops", "writeIops", "avgQueueDepth", "utilization",
+    "readAwaitMs", "writeAwaitMs", "discardIops", "flushIops"
+};
+
+double diskField(const Disk::DeviceStats& disk, unsigned field) {
+    switch (field) {
+    case 0: return disk.readBytesPerSec;
+    case 1: return disk.writeBytesPerSec;
+    case 2: return disk.readIops;
+    case 3: return disk.writeIops;
+    case 4: return disk.avgQueueDepth;
+    case 5: return disk.utilization;
+    case 6: return disk.readAwaitMs;
+    case 7: return disk.writeAwaitMs;
+    case 8: return disk.discardIops;
+    default: return disk.flushIops;
+    }
+}
+
+const char* const NET_FIELDS[] = {
+    "rxBytesPerSec", "txBytesPerSec", "rxPacketsPerSec", "txPacketsPerSec",
+    "rxDropsPerSec", "txDropsPerSec", "rxErrorsPerSec", "txErrorsPerSec"
+};
+
+double netField(const Network::InterfaceStats& interface, unsigned field) {
+    switch (field) {
+    case 0: return interface.rxBytesPerSec;
+    case 1: return interface.txBytesPerSec;
+    case 2: return interface.rxPacketsPerSec;
+    case 3: return interface.txPacketsPerSec;
+    case 4: return interface.rxDropsPerSec;
+    case 5: return interface.txDropsPerSec;
+    case 6: return interface.rxErrorsPerSec;
+    default: return interface.txErrorsPerSec;
+    }
+}
+
+const char* const CGROUP_FIELDS[] = {
+    "cpuUsage", "cpuThrottledPercent", "memoryCurrent", "memoryGrowthPerSec", "majorFaultsPerSec",
+    "ioReadBytesPerSec", "ioWriteBytesPerSec", "ioReadsPerSec", "ioWritesPerSec"
+};
+
+double cgroupField(const Cgroup::Stats& cgroup, unsigned field) {
+    switch (field) {
+    case 0: return cgroup.cpuUsage;
+    case 1: return cgroup.cpuThrottledPercent;
+    case 2: return static_cast<double>(cgroup.usage.memoryCurrent);
+    case 3: return cgroup.memoryGrowthPerSec;
+    case 4: return cgroup.majorFaultsPerSec;
+    case 5: return cgroup.ioReadBytesPerSec;
+    case 6: return cgroup.ioWriteBytesPerSec;
+    case 7: return cgroup.ioReadsPerSec;
+    default: return cgroup.ioWritesPerSec;
+    }
+}
+
+template <std::size_t N>
+int findField(const char* const (&fields)[N], std::string_view name) {
+    for (std::size_t i = 0; i < N; ++i) {
+        if (name == fields[i]) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool startsWith(std::string_view name, std::string_view prefix) {
+    return name.compare(0, prefix.size(), prefix) == 0;
+}
+
+} // namespace
+
+class Rules::Impl {
+public:
+    RuleId add(const std::string& name, const std::string& text, Callback callback) {
+        Program program = Compiler(text).compile();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        // Classify every name before binding any, so a bad rule leaves no slots behind
+        std::vector<Binding> bindings;
+        for (const std::string& metric : program.names) {
+            bindings.push_back(classify(metric));
+        }
+        std::vector<uint32_t> slots;
+        for (std::size_t i = 0; i < bindings.size(); ++i) {
+            slots.push_back(static_cast<uint32_t>(bind(program.names[i], bindings[i])));
+        }
+        for (Instruction& instruction : program.code) {
+            if (instruction.op == Op::Load) instruction.slot = slots[instruction.slot];
+        }
+
+        stack.resize(std::max(stack.size(), program.depth));
+        rules.push_back({name, std::move(program.code), program.holdSamples, program.holdTime,
+                         std::make_shared<const Callback>(std::move(callback)), {State::Inactive, {}, 0}, false});
+        return rules.size() - 1;
+    }
+
+    void remove(RuleId id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Rule& rule = at(id);
+        rule.removed = true;
+        rule.status = {State::Inactive, {}, 0};
+    }
+
+    const std::string& getName(RuleId id) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return at(id).name;
+    }
+
+    Status getStatus(RuleId id) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return at(id).status;
+    }
+
+    std::string disassemble(RuleId id) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Rule& rule = at(id);
+        std::string listing;
+        for (const Instruction& instruction : rule.code) {
+            listing += OP_NAMES[static_cast<std::size_t>(instruction.op)];
+            if (instruction.op == Op::Load) {
+                listing += " " + slotNames[instruction.slot];
+            } else if (instruction.op == Op::Const) {
+                char buffer[32];
+                auto result = std::to_chars(buffer, buffer + sizeof(buffer), instruction.value);
+                listing += " " + std::string(buffer, result.ptr);
+            }
+            listing += '\n';
+        }
+        return listing;
+    }
+
+    MetricId getMetric(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Binding binding = classify(name);
+        return bind(name, binding);
+    }
+
+    void set(MetricId metric, double value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (metric >= values.size()) {
+            throw std::out_of_range("Unknown metric: " + std::to_string(metric));
+        }
+        values[metric] = value;
+    }
+
+    void evaluate(const Snapshot& snapshot) {
+        std::lock_guard<std::mutex> evaluation(evaluateMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            extract(snapshot);
+            step(snapshot.timestamp);
+        }
+        notify();
+    }
+
+    void evaluate(Clock::time_point now) {
+        std::lock_guard<std::mutex> evaluation(evaluateMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            step(now);
+        }
+        notify();
+    }
+
+private:
+    enum class Group { Custom, Scalar, Disk, Net, Cgroup };
+
+    struct Binding {
+        Group group;
+        Source source;                              // Scalar
+        double (*get)(const Snapshot&, unsigned);   // Scalar
+        unsigned field;
+        std::string entity;                         // Disk, Net, Cgroup
+    };
+
+    struct Scalar {
+        Source source;
+        double (*get)(const Snapshot&, unsigned);
+        unsigned field;
+        std::size_t slot;
+    };
+
+    // A device, interface or cgroup some rule references
+    struct Entity {
+        std::string name;
+        std::size_t position;       // where it was in the last snapshot
+        std::vector<std::pair<unsigned, std::size_t>> fields;  // field, slot
+    };
+
+    struct Rule {
+        std::string name;
+        std::vector<Instruction> code;
+        std::size_t holdSamples;
+        Clock::duration holdTime;
+        std::shared_ptr<const Callback> callback;
+        Status status;
+        bool removed;
+    };
+
+    Rule& at(RuleId id) {
+        if (id >= rules.size() || rules[id].removed) {
+            throw std::out_of_range("Unknown rule: " + std::to_string(id));
+        }
+        return rules[id];
+    }
+
+    const Rule& at(RuleId id) const {
+        return const_cast<Impl*>(this)->at(id);
+    }
+
+    static Binding classify(const std::string& name) {
+        auto unknown = [&name]() {
+            return std::invalid_argument("Unknown metric: " + name);
+        };
+        auto scalar = [](Source source, double (*get)(const Snapshot&, unsigned), int field) {
+            return Binding{Group::Scalar, source, get, static_cast<unsigned>(field), {}};
+        };
+        auto entity = [&](Group group, std::size_t prefix, int field, std::size_t dot) {
+            if (dot <= prefix || field < 0) throw unknown();
+            return Binding{group, Source::Memory, nullptr, static_cast<unsigned>(field), name.substr(prefix, dot - prefix)};
+        };
+        std::string_view view(name);
+        std::size_t dot = name.rfind('.');
+        std::string_view last = dot == std::string::npos ? std::string_view() : view.substr(dot + 1);
+
+        if (startsWith(view, "memory.")) {
+            int field = findField(MEMORY_FIELDS, view.substr(7));
+            if (field < 0) throw unknown();
+            return scalar(Source::Memory, memoryField, field);
+        }
+        if (startsWith(view, "cpu")) {
+            if (view == "cpu.utilization") return scalar(Source::Processor, processorField, 0);
+            std::size_t digits = 3;
+            while (digits < view.size() && view[digits] >= '0' && view[digits] <= '9') ++digits;
+            if (digits > 3 && view.substr(digits) == ".utilization") {
+                int cpu = 0;
+                const char* end = view.data() + digits;
+                auto parsed = std::from_chars(view.data() + 3, end, cpu);
+                if (parsed.ec != std::errc() || parsed.ptr != end) {
+                    throw std::invalid_argument("CPU index out of range in metric: " + name);
+                }
+                return scalar(Source::Processor, coreField, cpu);
+            }
+            if (view.size() > 3 && (view[3] == '.' || digits > 3)) throw unknown();
+        }
+        if (startsWith(view, "tcp.") || startsWith(view, "udp.")) {
+            int field = findField(PROTOCOL_FIELDS, view);
+            if (field < 0) throw unknown();
+            return scalar(Source::Protocols, protocolField, field);
+        }
+        if (startsWith(view, "pressure.")) {
+            for (unsigned r = 0; r < 3; ++r) {
+                for (unsigned k = 0; k < 2; ++k) {
+                    for (unsigned f = 0; f < 4; ++f) {
+                        if (name == std::string("pressure.") + PRESSURE_RESOURCES[r] + "." + PRESSURE_KINDS[k] + "." +
+                                    PRESSURE_FIELDS[f]) {
+                            return scalar(Source::Pressure, pressureField, static_cast<int>((r * 2 + k) * 4 + f));
+                        }
+                    }
+                }
+            }
+            throw unknown();
+        }
+        if (startsWith(view, "disk.")) return entity(Group::Disk, 5, findField(DISK_FIELDS, last), dot);
+        if (startsWith(view, "net.")) return entity(Group::Net, 4, findField(NET_FIELDS, last), dot);
+        if (startsWith(view, "cgroup:")) return entity(Group::Cgroup, 7, findField(CGROUP_FIELDS, last), dot);
+        return Binding{Group::Custom, Source::Memory, nullptr, 0, {}};
+    }
+
+    std::size_t bind(const std::string& name, const Binding& binding) {
+        auto it = slotIndex.find(name);
+        if (it != slotIndex.end()) return it->second;
+
+        std::size_t slot = values.size();
+        values.push_back(MISSING);
+        slotNames.push_back(name);
+        slotIndex.emplace(name, slot);
+
+        auto addField = [&](std::vector<Entity>& entities) {
+            auto entity = std::find_if(entities.begin(), entities.end(),
+                                       [&](const Entity& e) { return e.name == binding.entity; });
+            if (entity == entities.end()) {
+                entity = entities.insert(entities.end(), Entity{binding.entity, 0, {}});
+            }
+            entity->fields.emplace_back(binding.field, slot);
+        };
+        switch (binding.group) {
+        case Group::Custom: break;
+        case Group::Scalar: scalars.push_back({binding.source, binding.get, binding.field, slot}); break;
+        case Group::Disk: addField(disks); break;
+        case Group::Net: addField(interfaces); break;
+        case Group::Cgroup: addField(cgroups); break;
+        }
+        return slot;
+    }
+
+    template <typename T, typename Name, typename Get>
+    void extract(std::vector<Entity>& entities, const std::vector<T>& items, bool sampled, Name nameOf, Get get) {
+        for (Entity& entity : entities) {
+            const T* item = nullptr;
+            if (sampled) {
+                if (entity.position < items.size() && nameOf(items[entity.position]) == entity.name) {
+                    item = &items[entity.position];
+                } else {
+                    for (std::size_t i = 0; i < items.size(); ++i) {
+                        if (nameOf(items[i]) == entity.name) {
+                            entity.position = i;
+                            item = &items[i];
+                            break;
+                        }
+                    }
+                }
+            }
+            for (const auto& [field, slot] : entity.fields) {
+                values[slot] = item ? get(*item, field) : MISSING;
+            }
+        }
+    }
+
+    void extract(const Snapshot& snapshot) {
+        for (const Scalar& scalar : scalars) {
+            values[scalar.slot] = snapshot.timing(scalar.source).sampled ? scalar.get(snapshot, scalar.field) : MISSING;
+        }
+        extract(disks, snapshot.disks, snapshot.timing(Source::Disk).sampled,
+                [](const Disk::DeviceStats& disk) -> const std::string& { return disk.name; }, diskField);
+        extract(interfaces, snapshot.interfaces, snapshot.timing(Source::Network).sampled,
+                [](const Network::InterfaceStats& interface) -> const std::string& { return interface.name; }, netField);
+        extract(cgroups, snapshot.cgroups, snapshot.timing(Source::Cgroups).sampled,
+                [](const Cgroup::Stats& cgroup) -> const std::string& { return cgroup.path; }, cgroupField);
+    }
+
+    double run(const std::vector<Instruction>& code) {
+        double* top = stack.data() - 1;
+        for (const Instruction& instruction : code) {
+            switch (instruction.op) {
+            case Op::Load: *++top = values[instruction.slot]; break;
+            case Op::Const: *++top = instruction.value; break;
+            case Op::Neg: *top = -*top; break;
+            case Op::Not: *top = logicalNot(*top); break;
+            default:
+                --top;
+                *top = binary(instruction.op, top[0], top[1]);
+                break;
+            }
+        }
+        return *top;
+    }
+
+    // Advance every rule's state. Caller holds mutex.
+    void step(Clock::time_point now) {
+        events.clear();
+        for (RuleId id = 0; id < rules.size(); ++id) {
+            Rule& rule = rules[id];
+            if (rule.removed) continue;
+            Status& status = rule.status;
+            if (truth(run(rule.code))) {
+                if (status.state == State::Inactive) status = {State::Pending, now, 0};
+                ++status.samples;
+                if (status.state == State::Pending && status.samples >= rule.holdSamples &&
+                    now - status.since >= rule.holdTime) {
+                    status.state = State::Firing;
+                    events.push_back({rule.callback, {id, true, now, status}});
+                }
+            } else if (status.state != State::Inactive) {
+                if (status.state == State::Firing) {
+                    events.push_back({rule.callback, {id, false, now, status}});
+                }
+                status = {State::Inactive, now, 0};
+            }
+        }
+    }
+
+    // Outside mutex, so callbacks may query or change the rules
+    void notify() {
+        for (const auto& [callback, event] : events) {
+            if (*callback) (*callback)(event);
+        }
+    }
+
+    std::deque<Rule> rules;
+    std::vector<double> values;                 // by slot
+    std::vector<std::string> slotNames;
+    std::unordered_map<std::string, std::size_t> slotIndex;
+    std::vector<Scalar> scalars;
+    std::vector<Entity> disks;
+    std::vector<Entity> interfaces;
+    std::vector<Entity> cgroups;
+    std::vector<double> stack;
+    mutable std::mutex mutex;
+
+    std::mutex evaluateMutex;                   // one evaluation at a time, guards events
+    std::vector<std::pair<std::shared_ptr<const Callback>, Event>> events;
+};
+
+Rules::Rules() : pImpl(std::make_unique<Impl>()) {}
+
+Rules::~Rules() = default;
+
+Rules::RuleId Rules::add(const std::string& name, const std::string& rule, Callback callback) {
+    return pImpl->add(name, rule, std::move(callback));
+}
+
+void Rules::remove(RuleId rule) {
+    pImpl->remove(rule);
+}
+
+const std::string& Rules::getName(RuleId rule) const {
+    return pImpl->getName(rule);
+}
+
+Rules::Status Rules::getStatus(RuleId rule) const {
+    return pImpl->getStatus(rule);
+}
+
+std::string Rules::disassemble(RuleId rule) const {
+    return pImpl->disassemble(rule);
+}
+
+Rules::MetricId Rules::getMetric(const std::string& name) {
+    return pImpl->getMetric(name);
+}
+
+void Rules::set(MetricId metric, double value) {
+    pImpl->set(metric, value);
+}
+
+void Rules::evaluate(const SystemSnapshot::Snapshot& snapshot) {
+    pImpl->evaluate(snapshot);
+}
+
+void Rules::evaluate(Clock::time_point now) {
+    pImpl->evaluate(now);
+}
+
+} // namespace kuserspace
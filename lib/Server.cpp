@@ -0,0 +1,261 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Server.h"
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <limits>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+
+namespace kuserspace {
+
+namespace {
+
+// epoll tags of the two descriptors that are not connections
+constexpr uint64_t LISTEN_TAG = std::numeric_limits<uint64_t>::max();
+constexpr uint64_t WAKE_TAG = LISTEN_TAG - 1;
+
+} // namespace
+
+class Server::Impl {
+public:
+    Impl(std::size_t maxConnections, int backlog, Handlers handlers)
+        : maxConnections(maxConnections), backlog(backlog), handlers(std::move(handlers)) {}
+
+    ~Impl() {
+        stop();
+    }
+
+    void listen(const std::string& host, uint16_t port) {
+        stop();
+        std::string where = host + ":" + std::to_string(port);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+            throw std::runtime_error("Invalid address: " + host);
+        }
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1) fail(where, fd);
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 || ::listen(fd, backlog) == -1) {
+            fail(where, fd);
+        }
+        socklen_t length = sizeof(address);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+        boundPort = ntohs(address.sin_port);
+        start(fd);
+    }
+
+    void listen(const std::string& path) {
+        stop();
+        sockaddr_un address{};
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Invalid socket path: " + path);
+        }
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1) fail(path, fd);
+
+        struct stat status;
+        if (lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+            ::unlink(path.c_str());
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 || ::listen(fd, backlog) == -1) {
+            fail(path, fd);
+        }
+        socketPath = path;
+        boundPort = 0;
+        start(fd);
+    }
+
+    void stop() {
+        if (!serverThread.joinable()) return;
+        running = false;
+        uint64_t one = 1;
+        ssize_t written = ::write(wakeFd, &one, sizeof(one));
+        (void)written;
+        serverThread.join();
+
+        ::close(listenFd);
+        ::close(epollFd);
+        ::close(wakeFd);
+        listenFd = epollFd = wakeFd = -1;
+        if (!socketPath.empty()) {
+            ::unlink(socketPath.c_str());
+            socketPath.clear();
+        }
+        boundPort = 0;
+    }
+
+    bool isRunning() const {
+        return running;
+    }
+
+    uint16_t getPort() const {
+        return boundPort;
+    }
+
+    int getFd(std::size_t slot) const {
+        return fds[slot];
+    }
+
+    void close(std::size_t slot) {
+        ::close(fds[slot]);     // also leaves the epoll set
+        fds[slot] = -1;
+        closed.push_back(slot);
+        if (handlers.closed) handlers.closed(slot);
+    }
+
+    void watch(std::size_t slot, uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = slot;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fds[slot], &event);
+    }
+
+private:
+    [[noreturn]] static void fail(const std::string& where, int fd) {
+        int error = errno;
+        if (fd != -1) ::close(fd);
+        throw std::runtime_error("Could not listen on " + where + ": " + std::strerror(error));
+    }
+
+    void start(int fd) {
+        listenFd = fd;
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = LISTEN_TAG;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+        event.data.u64 = WAKE_TAG;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+        running = true;
+        serverThread = std::thread([this]() { serve(); });
+    }
+
+    void serve() {
+        epoll_event events[64];
+        while (running) {
+            int ready = epoll_wait(epollFd, events, 64, -1);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                running = false;    // isRunning() reports the server gone; stop() still joins
+                break;
+            }
+            for (int i = 0; i < ready && running; ++i) {
+                uint64_t tag = events[i].data.u64;
+                if (tag == WAKE_TAG) {
+                    running = false;
+                } else if (tag == LISTEN_TAG) {
+                    acceptAll();
+                } else if (fds[tag] != -1) {    // not closed earlier in this batch
+                    handlers.ready(tag, events[i].events);
+                }
+            }
+            // Only now may this batch's closed slots take new sockets
+            idle.insert(idle.end(), closed.begin(), closed.end());
+            closed.clear();
+        }
+        for (std::size_t slot = 0; slot < fds.size(); ++slot) {
+            if (fds[slot] != -1) close(slot);
+        }
+        idle.clear();
+        closed.clear();
+        for (std::size_t slot = fds.size(); slot > 0; --slot) idle.push_back(slot - 1);
+    }
+
+    void acceptAll() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd == -1) return;
+            std::size_t slot;
+            if (!idle.empty()) {
+                slot = idle.back();
+                idle.pop_back();
+            } else if (fds.size() < maxConnections) {
+                slot = fds.size();
+                fds.push_back(-1);
+            } else {
+                ::close(fd);
+                if (handlers.refused) handlers.refused();
+                continue;
+            }
+            fds[slot] = fd;
+            handlers.accepted(slot);
+
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.u64 = slot;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        }
+    }
+
+    const std::size_t maxConnections;
+    const int backlog;
+    Handlers handlers;
+
+    // Owned by the epoll thread while it runs
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::string socketPath;
+    std::atomic<uint16_t> boundPort{0};
+    std::atomic<bool> running{false};
+    std::thread serverThread;
+    std::vector<int> fds;                   // per slot, -1 while free
+    std::vector<std::size_t> idle;
+    std::vector<std::size_t> closed;
+};
+
+Server::Server(std::size_t maxConnections, int backlog, Handlers handlers)
+    : pImpl(std::make_unique<Impl>(maxConnections, backlog, std::move(handlers))) {}
+
+Server::~Server() = default;
+
+void Server::listen(const std::string& address, uint16_t port) {
+    pImpl->listen(address, port);
+}
+
+void Server::listen(const std::string& socketPath) {
+    pImpl->listen(socketPath);
+}
+
+void Server::stop() {
+    pImpl->stop();
+}
+
+bool Server::isRunning() const {
+    return pImpl->isRunning();
+}
+
+uint16_t Server::getPort() const {
+    return pImpl->getPort();
+}
+
+int Server::getFd(std::size_t slot) const {
+    return pImpl->getFd(slot);
+}
+
+void Server::close(std::size_t slot) {
+    pImpl->close(slot);
+}
+
+void Server::watch(std::size_t slot, uint32_t events) {
+    pImpl->watch(slot, events);
+}
+
+} // namespace kuserspace
@@ -0,0 +1,351 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Smaps.h"
+#include "../include/Parser.h"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace kuserspace {
+
+namespace {
+
+constexpr size_t MIN_WINDOW_SIZE = 64 * 1024;
+
+// Mapping headers start with the hex start address; field lines start with
+// an upper-case key ("Rss:", "VmFlags:"), so one character is enough.
+inline bool isHeaderStart(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+}
+
+Smaps::Category classify(std::string_view perms, std::string_view path) {
+    bool shared = perms.size() > 3 && perms[3] == 's';
+
+    if (path.empty()) {
+        return shared ? Smaps::Category::SharedMemory : Smaps::Category::Anonymous;
+    }
+    if (path[0] == '[') {
+        if (path == "[heap]") return Smaps::Category::Heap;
+        if (path.compare(0, 6, "[stack") == 0) return Smaps::Category::Stack;
+        if (path.compare(0, 12, "[anon_shmem:") == 0) return Smaps::Category::SharedMemory;
+        if (path.compare(0, 6, "[anon:") == 0) return Smaps::Category::Anonymous;
+        return Smaps::Category::Special;
+    }
+    if (path.compare(0, 9, "/dev/shm/") == 0 ||
+        path.compare(0, 5, "/SYSV") == 0 ||
+        path.compare(0, 7, "/memfd:") == 0) {
+        return Smaps::Category::SharedMemory;
+    }
+    return Smaps::Category::File;
+}
+
+void mergeReport(Smaps::Report& into, const Smaps::Report& from) {
+    into.total += from.total;
+    for (const auto& [category, usage] : from.byCategory) {
+        into.byCategory[category] += usage;
+    }
+    for (const auto& [path, usage] : from.byFile) {
+        into.byFile[path] += usage;
+    }
+}
+
+// Aggregates one or more complete mapping blocks into a report
+class Accumulator {
+public:
+    void parse(std::string_view segment) {
+        while (!segment.empty()) {
+            std::string_view line = Parser::nextLine(segment);
+            if (line.empty()) continue;
+
+            if (isHeaderStart(line[0])) {
+                beginMapping(line);
+                continue;
+            }
+            if (!active) continue;
+
+            std::string_view key;
+            uint64_t value;
+            if (!Parser::parseKeyValue(line, key, value)) continue;
+            value *= 1024; // kB to bytes
+
+            if (key == "Size") usage.size = value;
+            else if (key == "Rss") usage.rss = value;
+            else if (key == "Pss") usage.pss = value;
+            else if (key == "Private_Dirty") usage.privateDirty = value;
+            else if (key == "AnonHugePages") usage.anonHugePages = value;
+            else if (key == "Swap") usage.swap = value;
+        }
+        // Segments always end on a mapping boundary
+        flush();
+    }
+
+    Smaps::Report report{};
+
+private:
+    void beginMapping(std::string_view header) {
+        flush();
+
+        Parser::nextToken(header);                       // address range
+        std::string_view perms = Parser::nextToken(header);
+        Parser::nextToken(header);                       // offset
+        Parser::nextToken(header);                       // device
+        Parser::nextToken(header);                       // inode
+
+        // The pathname may itself contain spaces
+        size_t start = header.find_first_not_of(" \t");
+        path = start == std::string_view::npos ? std::string_view() : header.substr(start);
+        category = classify(perms, path);
+        usage = Smaps::Usage{};
+        usage.mappings = 1;
+        active = true;
+    }
+
+    void flush() {
+        if (!active) return;
+        report.total += usage;
+        report.byCategory[category] += usage;
+        if (!path.empty() && path[0] != '[') {
+            report.byFile[std::string(path)] += usage;
+        }
+        active = false;
+    }
+
+    bool active = false;
+    Smaps::Category category = Smaps::Category::Anonymous;
+    std::string_view path;
+    Smaps::Usage usage{};
+};
+
+struct Window {
+    explicit Window(size_t size) : data(size) {}
+    std::vector<char> data;
+    size_t length = 0;
+};
+
+// Bounded hand-off between the reader and the workers. A fixed pool of
+// windows circulates between the free list and the ready queue, which is
+// what keeps memory bounded for arbitrarily large files.
+class WindowQueue {
+public:
+    WindowQueue(size_t count, size_t size) {
+        for (size_t i = 0; i < count; ++i) {
+            freeWindows.push_back(std::make_unique<Window>(size));
+        }
+    }
+
+    std::unique_ptr<Window> acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        freeCV.wait(lock, [this]() { return !freeWindows.empty(); });
+        auto window = std::move(freeWindows.back());
+        freeWindows.pop_back();
+        window->length = 0;
+        return window;
+    }
+
+    void release(std::unique_ptr<Window> window) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeWindows.push_back(std::move(window));
+        }
+        freeCV.notify_one();
+    }
+
+    void submit(std::unique_ptr<Window> window) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(std::move(window));
+        }
+        readyCV.notify_one();
+    }
+
+    // Returns nullptr once the queue is closed and drained
+    std::unique_ptr<Window> next() {
+        std::unique_lock<std::mutex> lock(mutex);
+        readyCV.wait(lock, [this]() { return !ready.empty() || closed; });
+        if (ready.empty()) return nullptr;
+        auto window = std::move(ready.front());
+        ready.pop_front();
+        return window;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        readyCV.notify_all();
+    }
+
+private:
+    std::vector<std::unique_ptr<Window>> freeWindows;
+    std::deque<std::unique_ptr<Window>> ready;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable freeCV;
+    std::condition_variable readyCV;
+};
+
+// Fill the window from fd; returns true at end of file (or on read error,
+// which procfs reports when the process exits mid-read)
+bool fillWindow(int fd, Window& window, int& error) {
+    while (window.length < window.data.size()) {
+        ssize_t n = ::read(fd, window.data.data() + window.length, window.data.size() - window.length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            error = errno;
+            return true;
+        }
+        if (n == 0) return true;
+        window.length += static_cast<size_t>(n);
+    }
+    return false;
+}
+
+// Offset of the last mapping header in the window, 0 if there is none
+size_t lastBoundary(const Window& window) {
+    for (size_t i = window.length; i > 1; --i) {
+        if (window.data[i - 2] == '\n' && isHeaderStart(window.data[i - 1])) {
+            return i - 1;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+Smaps::Usage& Smaps::Usage::operator+=(const Usage& other) {
+    mappings += other.mappings;
+    size += other.size;
+    rss += other.rss;
+    pss += other.pss;
+    privateDirty += other.privateDirty;
+    anonHugePages += other.anonHugePages;
+    swap += other.swap;
+    return *this;
+}
+
+Smaps::Smaps() {
+    config.windowSize = 1024 * 1024;  // 1MB per window
+    config.maxThreads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 4);
+}
+
+Smaps::Smaps(const Config& config) : config(config) {}
+
+Smaps::Report Smaps::analyze(pid_t pid, const Root& root) const {
+    return analyzeFile(root.procPath("/" + std::to_string(pid) + "/smaps"));
+}
+
+Smaps::Report Smaps::analyzeFile(const std::string& path) const {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    size_t windowSize = std::max<size_t>(config.windowSize, MIN_WINDOW_SIZE);
+    size_t threads = std::max<size_t>(config.maxThreads, 1);
+    WindowQueue queue(threads + 1, windowSize);
+
+    int error = 0;
+    auto current = queue.acquire();
+    bool eof = fillWindow(fd, *current, error);
+
+    if (error != 0 && current->length == 0) {
+        close(fd);
+        throw std::runtime_error("Could not read file: " + path + ": " + std::strerror(error));
+    }
+
+    // Small files (the common case) are parsed inline without spawning workers
+    if (eof) {
+        close(fd);
+        Accumulator accumulator;
+        accumulator.parse(std::string_view(current->data.data(), current->length));
+        return std::move(accumulator.report);
+    }
+
+    std::vector<Accumulator> accumulators(threads);
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&queue, &accumulator = accumulators[i]]() {
+            while (auto window = queue.next()) {
+                accumulator.parse(std::string_view(window->data.data(), window->length));
+                queue.release(std::move(window));
+            }
+        });
+    }
+
+    while (true) {
+        size_t cut = eof ? current->length : lastBoundary(*current);
+        if (cut == 0 && !eof) {
+            // A single mapping larger than the window: grow it and keep reading
+            current->data.resize(current->data.size() * 2);
+            eof = fillWindow(fd, *current, error);
+            continue;
+        }
+
+        std::unique_ptr<Window> next;
+        if (!eof) {
+            // Carry the partial mapping over to the next window
+            next = queue.acquire();
+            size_t tail = current->length - cut;
+            if (next->data.size() < current->data.size()) {
+                next->data.resize(current->data.size());
+            }
+            std::memcpy(next->data.data(), current->data.data() + cut, tail);
+            next->length = tail;
+        }
+
+        current->length = cut;
+        queue.submit(std::move(current));
+        if (eof) break;
+
+        current = std::move(next);
+        eof = fillWindow(fd, *current, error);
+    }
+
+    close(fd);
+    queue.close();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    Report report{};
+    for (const auto& accumulator : accumulators) {
+        mergeReport(report, accumulator.report);
+    }
+    return report;
+}
+
+std::future<Smaps::Report> Smaps::analyzeAsync(pid_t pid, const Root& root) const {
+    return std::async(std::launch::async, [this, pid, root]() { return analyze(pid, root); });
+}
+
+void Smaps::setWindowSize(size_t size) {
+    config.windowSize = size;
+}
+
+void Smaps::setMaxThreads(size_t threads) {
+    config.maxThreads = threads;
+}
+
+std::string Smaps::categoryToString(Category category) {
+    switch (category) {
+        case Category::Heap: return "Heap";
+        case Category::Stack: return "Stack";
+        case Category::Anonymous: return "Anonymous";
+        case Category::SharedMemory: return "Shared memory";
+        case Category::File: return "File";
+        case Category::Special: return "Special";
+        default: return "Unknown";
+    }
+}
+
+} // namespace kuserspace
@@ -0,0 +1,1229 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Stream.h"
+#include "../include/Server.h"
+#include <atomic>
+#include <mutex>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+namespace kuserspace {
+
+namespace {
+
+using Snapshot = SystemSnapshot::Snapshot;
+
+constexpr char STREAM_MAGIC[8] = {'K', 'U', 'S', 'T', 'R', 'E', 'A', 'M'};
+constexpr uint64_t STREAM_VERSION = 1;
+constexpr char HELLO = 'H';
+constexpr char SCHEMA = 'S';
+constexpr char DELTA = 'D';
+constexpr uint64_t MAX_FRAME = 64 * 1024 * 1024;
+constexpr uint64_t MAX_FIELDS = 4 * 1024 * 1024;
+constexpr std::size_t MAX_CONNECTIONS = 4096;
+constexpr std::size_t READ_CHUNK = 64 * 1024;
+// Received bytes a connection, and a receiver across all of them, may hold
+// before a frame completes; past either the connection is closed
+constexpr std::size_t MAX_PENDING = MAX_FRAME + READ_CHUNK;
+constexpr std::size_t MAX_RECEIVER_PENDING = 256 * 1024 * 1024;
+
+enum FieldType : uint8_t { INTEGER = 0, REAL = 1 };
+
+// In the order fields are flattened
+enum Section : uint8_t {
+    META,
+    MEMORY,
+    PROCESSOR,
+    CORES,
+    DISKS,
+    INTERFACES,
+    PROTOCOLS,
+    PRESSURE,
+    CGROUPS,
+    NUM_SECTIONS
+};
+
+const char* const SECTION_NAMES[NUM_SECTIONS] = {
+    "meta", "memory", "processor", "core", "disk", "interface", "protocols", "pressure", "cgroup"
+};
+
+bool isSingleton(Section section) {
+    return section != CORES && section != DISKS && section != INTERFACES && section != CGROUPS;
+}
+
+// Snapshot header as integers. readOffset is relative to the timestamp so
+// that it barely moves between samples.
+struct Meta {
+    uint64_t sequence;
+    int64_t timestamp;
+    int64_t wallTime;
+    int64_t duration;
+    struct Source {
+        bool sampled;
+        int64_t readOffset;
+        int64_t readDuration;
+    } sources[SystemSnapshot::NUM_SOURCES];
+};
+
+const char* const SOURCE_FIELDS[SystemSnapshot::NUM_SOURCES][3] = {
+    {"memory.sampled", "memory.readOffset", "memory.readDuration"},
+    {"processor.sampled", "processor.readOffset", "processor.readDuration"},
+    {"disk.sampled", "disk.readOffset", "disk.readDuration"},
+    {"network.sampled", "network.readOffset", "network.readDuration"},
+    {"protocols.sampled", "protocols.readOffset", "protocols.readDuration"},
+    {"cgroups.sampled", "cgroups.readOffset", "cgroups.readDuration"},
+    {"pressure.sampled", "pressure.readOffset", "pressure.readDuration"}
+};
+
+const char* const PRESSURE_FIELDS[3][2][4] = {
+    {{"cpu.some.avg10", "cpu.some.avg60", "cpu.some.avg300", "cpu.some.total"},
+     {"cpu.full.avg10", "cpu.full.avg60", "cpu.full.avg300", "cpu.full.total"}},
+    {{"memory.some.avg10", "memory.some.avg60", "memory.some.avg300", "memory.some.total"},
+     {"memory.full.avg10", "memory.full.avg60", "memory.full.avg300", "memory.full.total"}},
+    {{"io.some.avg10", "io.some.avg60", "io.some.avg300", "io.some.total"},
+     {"io.full.avg10", "io.full.avg60", "io.full.avg300", "io.full.total"}}
+};
+
+const char* const USAGE_FIELDS[2][16] = {
+    {"cpuUsageUsec", "cpuUserUsec", "cpuSystemUsec", "cpuPeriods", "cpuThrottledPeriods", "cpuThrottledUsec",
+     "memoryCurrent", "memoryAnon", "memoryFile", "memoryKernel", "memorySock", "memoryShmem", "pageFaults",
+     "majorPageFaults", "ioReadBytes", "ioWriteBytes"},
+    {"self.cpuUsageUsec", "self.cpuUserUsec", "self.cpuSystemUsec", "self.cpuPeriods", "self.cpuThrottledPeriods",
+     "self.cpuThrottledUsec", "self.memoryCurrent", "self.memoryAnon", "self.memoryFile", "self.memoryKernel",
+     "self.memorySock", "self.memoryShmem", "self.pageFaults", "self.majorPageFaults", "self.ioReadBytes",
+     "self.ioWriteBytes"}
+};
+
+// Field lists, one per section: field(name, value) is called for every
+// field in wire order, on const stats when encoding and mutable ones when
+// decoding.
+template <typename M, typename F>
+void metaFields(M& meta, F&& field) {
+    field("sequence", meta.sequence);
+    field("timestamp", meta.timestamp);
+    field("wallTime", meta.wallTime);
+    field("duration", meta.duration);
+    for (std::size_t i = 0; i < SystemSnapshot::NUM_SOURCES; ++i) {
+        field(SOURCE_FIELDS[i][0], meta.sources[i].sampled);
+        field(SOURCE_FIELDS[i][1], meta.sources[i].readOffset);
+        field(SOURCE_FIELDS[i][2], meta.sources[i].readDuration);
+    }
+}
+
+template <typename M, typename F>
+void memoryFields(M& m, F&& field) {
+    field("total", m.total);
+    field("free", m.free);
+    field("cached", m.cached);
+    field("buffers", m.buffers);
+    field("swapTotal", m.swapTotal);
+    field("swapFree", m.swapFree);
+    field("active", m.active);
+    field("inactive", m.inactive);
+    field("activeAnon", m.activeAnon);
+    field("inactiveAnon", m.inactiveAnon);
+    field("activeFile", m.activeFile);
+    field("inactiveFile", m.inactiveFile);
+    field("unevictable", m.unevictable);
+    field("mlocked", m.mlocked);
+    field("highTotal", m.highTotal);
+    field("highFree", m.highFree);
+    field("lowTotal", m.lowTotal);
+    field("lowFree", m.lowFree);
+    field("hugePagesTotal", m.hugePagesTotal);
+    field("hugePagesFree", m.hugePagesFree);
+    field("hugePagesRsvd", m.hugePagesRsvd);
+    field("hugePagesSurp", m.hugePagesSurp);
+    field("hugePageSize", m.hugePageSize);
+    field("directMap4k", m.directMap4k);
+    field("directMap2M", m.directMap2M);
+    field("directMap1G", m.directMap1G);
+    field("available", m.available);
+}
+
+template <typename P, typename F>
+void processorFields(P& p, F&& field) {
+    field("userTime", p.userTime);
+    field("niceTime", p.niceTime);
+    field("systemTime", p.systemTime);
+    field("idleTime", p.idleTime);
+    field("iowaitTime", p.iowaitTime);
+    field("irqTime", p.irqTime);
+    field("softirqTime", p.softirqTime);
+    field("stealTime", p.stealTime);
+    field("guestTime", p.guestTime);
+    field("guestNiceTime", p.guestNiceTime);
+    field("totalUtilization", p.totalUtilization);
+}
+
+template <typename D, typename F>
+void diskFields(D& d, F&& field) {
+    field("major", d.major);
+    field("minor", d.minor);
+    field("partition", d.partition);
+    field("readsCompleted", d.counters.readsCompleted);
+    field("readsMerged", d.counters.readsMerged);
+    field("sectorsRead", d.counters.sectorsRead);
+    field("readTimeMs", d.counters.readTimeMs);
+    field("writesCompleted", d.counters.writesCompleted);
+    field("writesMerged", d.counters.writesMerged);
+    field("sectorsWritten", d.counters.sectorsWritten);
+    field("writeTimeMs", d.counters.writeTimeMs);
+    field("ioInProgress", d.counters.ioInProgress);
+    field("ioTimeMs", d.counters.ioTimeMs);
+    field("weightedIoTimeMs", d.counters.weightedIoTimeMs);
+    field("discardsCompleted", d.counters.discardsCompleted);
+    field("discardsMerged", d.counters.discardsMerged);
+    field("sectorsDiscarded", d.counters.sectorsDiscarded);
+    field("discardTimeMs", d.counters.discardTimeMs);
+    field("flushesCompleted", d.counters.flushesCompleted);
+    field("flushTimeMs", d.counters.flushTimeMs);
+    field("readIops", d.readIops);
+    field("writeIops", d.writeIops);
+    field("discardIops", d.discardIops);
+    field("flushIops", d.flushIops);
+    field("readBytesPerSec", d.readBytesPerSec);
+    field("writeBytesPerSec", d.writeBytesPerSec);
+    field("discardBytesPerSec", d.discardBytesPerSec);
+    field("avgQueueDepth", d.avgQueueDepth);
+    field("readAwaitMs", d.readAwaitMs);
+    field("writeAwaitMs", d.writeAwaitMs);
+    field("utilization", d.utilization);
+}
+
+template <typename N, typename F>
+void interfaceFields(N& n, F&& field) {
+    field("rxBytes", n.counters.rxBytes);
+    field("rxPackets", n.counters.rxPackets);
+    field("rxErrors", n.counters.rxErrors);
+    field("rxDropped", n.counters.rxDropped);
+    field("rxFifoErrors", n.counters.rxFifoErrors);
+    field("rxFrameErrors", n.counters.rxFrameErrors);
+    field("rxCompressed", n.counters.rxCompressed);
+    field("rxMulticast", n.counters.rxMulticast);
+    field("txBytes", n.counters.txBytes);
+    field("txPackets", n.counters.txPackets);
+    field("txErrors", n.counters.txErrors);
+    field("txDropped", n.counters.txDropped);
+    field("txFifoErrors", n.counters.txFifoErrors);
+    field("collisions", n.counters.collisions);
+    field("txCarrierErrors", n.counters.txCarrierErrors);
+    field("txCompressed", n.counters.txCompressed);
+    field("rxCrcErrors", n.detail.rxCrcErrors);
+    field("rxLengthErrors", n.detail.rxLengthErrors);
+    field("rxMissedErrors", n.detail.rxMissedErrors);
+    field("rxOverErrors", n.detail.rxOverErrors);
+    field("rxNoHandler", n.detail.rxNoHandler);
+    field("txAbortedErrors", n.detail.txAbortedErrors);
+    field("txHeartbeatErrors", n.detail.txHeartbeatErrors);
+    field("txWindowErrors", n.detail.txWindowErrors);
+    field("rxBytesPerSec", n.rxBytesPerSec);
+    field("txBytesPerSec", n.txBytesPerSec);
+    field("rxPacketsPerSec", n.rxPacketsPerSec);
+    field("txPacketsPerSec", n.txPacketsPerSec);
+    field("rxDropsPerSec", n.rxDropsPerSec);
+    field("txDropsPerSec", n.txDropsPerSec);
+    field("rxErrorsPerSec", n.rxErrorsPerSec);
+    field("txErrorsPerSec", n.txErrorsPerSec);
+}
+
+template <typename P, typename F>
+void protocolFields(P& p, F&& field) {
+    field("tcpInSegs", p.counters.tcpInSegs);
+    field("tcpOutSegs", p.counters.tcpOutSegs);
+    field("tcpRetransSegs", p.counters.tcpRetransSegs);
+    field("tcpInErrors", p.counters.tcpInErrors);
+    field("tcpListenOverflows", p.counters.tcpListenOverflows);
+    field("tcpListenDrops", p.counters.tcpListenDrops);
+    field("tcpTimeouts", p.counters.tcpTimeouts);
+    field("udpInErrors", p.counters.udpInErrors);
+    field("udpRcvbufErrors", p.counters.udpRcvbufErrors);
+    field("retransSegsPerSec", p.retransSegsPerSec);
+    field("retransmitPercent", p.retransmitPercent);
+    field("listenOverflowsPerSec", p.listenOverflowsPerSec);
+    field("listenDropsPerSec", p.listenDropsPerSec);
+    field("timeoutsPerSec", p.timeoutsPerSec);
+    field("tcpInErrorsPerSec", p.tcpInErrorsPerSec);
+    field("udpInErrorsPerSec", p.udpInErrorsPerSec);
+    field("rcvbufErrorsPerSec", p.rcvbufErrorsPerSec);
+}
+
+template <typename P, typename F>
+void pressureFields(P& pressure, F&& field) {
+    decltype(&pressure.cpu) resources[] = {&pressure.cpu, &pressure.memory, &pressure.io};
+    std::size_t r = 0;
+    for (auto* resource : resources) {
+        decltype(&resource->some) stalls[] = {&resource->some, &resource->full};
+        std::size_t k = 0;
+        for (auto* stall : stalls) {
+            field(PRESSURE_FIELDS[r][k][0], stall->avg10);
+            field(PRESSURE_FIELDS[r][k][1], stall->avg60);
+            field(PRESSURE_FIELDS[r][k][2], stall->avg300);
+            field(PRESSURE_FIELDS[r][k][3], stall->total);
+            ++k;
+        }
+        ++r;
+    }
+}
+
+template <typename U, typename F>
+void usageFields(U& u, const char* const (&names)[16], F&& field) {
+    field(names[0], u.cpuUsageUsec);
+    field(names[1], u.cpuUserUsec);
+    field(names[2], u.cpuSystemUsec);
+    field(names[3], u.cpuPeriods);
+    field(names[4], u.cpuThrottledPeriods);
+    field(names[5], u.cpuThrottledUsec);
+    field(names[6], u.memoryCurrent);
+    field(names[7], u.memoryAnon);
+    field(names[8], u.memoryFile);
+    field(names[9], u.memoryKernel);
+    field(names[10], u.memorySock);
+    field(names[11], u.memoryShmem);
+    field(names[12], u.pageFaults);
+    field(names[13], u.majorPageFaults);
+    field(names[14], u.ioReadBytes);
+    field(names[15], u.ioWriteBytes);
+}
+
+template <typename C, typename F>
+void cgroupFields(C& c, F&& field) {
+    field("depth", c.depth);
+    field("children", c.children);
+    field("descendants", c.descendants);
+    usageFields(c.usage, USAGE_FIELDS[0], field);
+    usageFields(c.self, USAGE_FIELDS[1], field);
+    field("cpuUsage", c.cpuUsage);
+    field("cpuThrottledPercent", c.cpuThrottledPercent);
+    field("memoryGrowthPerSec", c.memoryGrowthPerSec);
+    field("majorFaultsPerSec", c.majorFaultsPerSec);
+    field("ioReadBytesPerSec", c.ioReadBytesPerSec);
+    field("ioWriteBytesPerSec", c.ioWriteBytesPerSec);
+    field("ioReadsPerSec", c.ioReadsPerSec);
+    field("ioWritesPerSec", c.ioWritesPerSec);
+}
+
+// Every field of a snapshot in wire order
+template <typename S, typename M, typename F>
+void snapshotFields(S& snapshot, M& meta, F&& field) {
+    metaFields(meta, field);
+    memoryFields(snapshot.memory, field);
+    processorFields(snapshot.processor, field);
+    for (auto& core : snapshot.processor.perCoreUtilization) field("utilization", core);
+    for (auto& disk : snapshot.disks) diskFields(disk, field);
+    for (auto& interface : snapshot.interfaces) interfaceFields(interface, field);
+    protocolFields(snapshot.protocols, field);
+    pressureFields(snapshot.pressure, field);
+    for (auto& cgroup : snapshot.cgroups) cgroupFields(cgroup, field);
+}
+
+struct SectionFields {
+    std::vector<std::string> names;
+    std::vector<uint8_t> types;
+
+    int find(std::string_view name) const {
+        auto it = std::find(names.begin(), names.end(), name);
+        return it == names.end() ? -1 : static_cast<int>(it - names.begin());
+    }
+};
+
+template <typename T>
+constexpr FieldType typeOf() {
+    return std::is_floating_point<T>::value ? REAL : INTEGER;
+}
+
+// The fields of one entity of every section, as this build knows them
+const std::array<SectionFields, NUM_SECTIONS>& localSections() {
+    static const std::array<SectionFields, NUM_SECTIONS> sections = [] {
+        std::array<SectionFields, NUM_SECTIONS> result;
+        auto collect = [&result](Section section) {
+            return [&result, section](const char* name, const auto& value) {
+                result[section].names.push_back(name);
+                result[section].types.push_back(typeOf<std::decay_t<decltype(value)>>());
+            };
+        };
+        Meta meta{};
+        metaFields(meta, collect(META));
+        Memory::Stats memory{};
+        memoryFields(memory, collect(MEMORY));
+        Processor::Stats processor{};
+        processorFields(processor, collect(PROCESSOR));
+        float core = 0;
+        collect(CORES)("utilization", core);
+        Disk::DeviceStats disk{};
+        diskFields(disk, collect(DISKS));
+        Network::InterfaceStats interface{};
+        interfaceFields(interface, collect(INTERFACES));
+        Network::ProtocolStats protocols{};
+        protocolFields(protocols, collect(PROTOCOLS));
+        SystemSnapshot::Pressure pressure{};
+        pressureFields(pressure, collect(PRESSURE));
+        Cgroup::Stats cgroup{};
+        cgroupFields(cgroup, collect(CGROUPS));
+        return result;
+    }();
+    return sections;
+}
+
+std::size_t entityCount(const Snapshot& snapshot, Section section) {
+    switch (section) {
+    case CORES: return snapshot.processor.perCoreUtilization.size();
+    case DISKS: return snapshot.disks.size();
+    case INTERFACES: return snapshot.interfaces.size();
+    case CGROUPS: return snapshot.cgroups.size();
+    default: return 1;
+    }
+}
+
+std::string_view entityKey(const Snapshot& snapshot, Section section, std::size_t index) {
+    switch (section) {
+    case DISKS: return snapshot.disks[index].name;
+    case INTERFACES: return snapshot.interfaces[index].name;
+    case CGROUPS: return snapshot.cgroups[index].path;
+    default: return {};
+    }
+}
+
+template <typename T>
+uint64_t toBits(T value) {
+    if constexpr (std::is_floating_point<T>::value) {
+        double real = static_cast<double>(value);
+        uint64_t bits;
+        std::memcpy(&bits, &real, sizeof(bits));
+        return bits;
+    } else {
+        return static_cast<uint64_t>(value);
+    }
+}
+
+template <typename T>
+void fromBits(uint64_t bits, T& value) {
+    if constexpr (std::is_floating_point<T>::value) {
+        double real;
+        std::memcpy(&real, &bits, sizeof(real));
+        value = static_cast<T>(real);
+    } else if constexpr (std::is_same<T, bool>::value) {
+        value = bits != 0;
+    } else {
+        value = static_cast<T>(bits);
+    }
+}
+
+int64_t toNanos(std::chrono::nanoseconds duration) {
+    return static_cast<int64_t>(duration.count());
+}
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool getVarint(std::string_view& in, uint64_t& value) {
+    value = 0;
+    for (unsigned int shift = 0; shift < 64 && !in.empty(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+void putString(std::string& out, std::string_view value) {
+    putVarint(out, value.size());
+    out.append(value.data(), value.size());
+}
+
+[[noreturn]] void malformed(const std::string& what) {
+    throw std::invalid_argument("Malformed stream: " + what);
+}
+
+uint64_t readVarint(std::string_view& in) {
+    uint64_t value;
+    if (!getVarint(in, value)) malformed("truncated varint");
+    return value;
+}
+
+std::string_view readString(std::string_view& in) {
+    uint64_t length = readVarint(in);
+    if (length > in.size()) malformed("truncated string");
+    std::string_view value = in.substr(0, length);
+    in.remove_prefix(length);
+    return value;
+}
+
+uint8_t readByte(std::string_view& in) {
+    if (in.empty()) malformed("truncated frame");
+    uint8_t byte = static_cast<uint8_t>(in.front());
+    in.remove_prefix(1);
+    return byte;
+}
+
+// Integers travel as the zigzag varint of their wrapping difference
+void putInteger(std::string& out, uint64_t current, uint64_t previous) {
+    uint64_t delta = current - previous;
+    putVarint(out, (delta << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(delta) >> 63));
+}
+
+uint64_t readInteger(std::string_view& in, uint64_t previous) {
+    uint64_t zigzag = readVarint(in);
+    return previous + ((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+}
+
+// Reals travel as their XOR with the previous value: a byte holding the
+// number of zero bytes above and below, then the bytes in between
+void putReal(std::string& out, uint64_t current, uint64_t previous) {
+    uint64_t x = current ^ previous;
+    unsigned int leading = static_cast<unsigned int>(__builtin_clzll(x)) / 8;
+    unsigned int trailing = static_cast<unsigned int>(__builtin_ctzll(x)) / 8;
+    out.push_back(static_cast<char>(leading << 4 | trailing));
+    for (int i = 7 - static_cast<int>(leading); i >= static_cast<int>(trailing); --i) {
+        out.push_back(static_cast<char>(x >> (8 * i)));
+    }
+}
+
+uint64_t readReal(std::string_view& in, uint64_t previous) {
+    uint8_t header = readByte(in);
+    unsigned int leading = header >> 4;
+    unsigned int trailing = header & 0x0f;
+    if (leading + trailing >= 8) malformed("bad real");
+    uint64_t x = 0;
+    for (int i = 7 - static_cast<int>(leading); i >= static_cast<int>(trailing); --i) {
+        x |= static_cast<uint64_t>(readByte(in)) << (8 * i);
+    }
+    return previous ^ x;
+}
+
+void putFrame(std::string& out, char type, const std::string& payload) {
+    out.push_back(type);
+    putVarint(out, payload.size());
+    out += payload;
+}
+
+} // namespace
+
+class StreamEncoder::Impl {
+public:
+    explicit Impl(const std::string& name) : source(name) {}
+
+    void encode(const Snapshot& snapshot, std::string& out) {
+        if (!greeted) {
+            payload.assign(STREAM_MAGIC, sizeof(STREAM_MAGIC));
+            putVarint(payload, STREAM_VERSION);
+            putString(payload, source);
+            putFrame(out, HELLO, payload);
+            greeted = true;
+        }
+        if (!sameShape(snapshot)) announce(snapshot, out);
+
+        Meta meta;
+        toMeta(snapshot, meta);
+        current.clear();
+        snapshotFields(snapshot, meta, [this](const char*, const auto& value) { current.push_back(toBits(value)); });
+
+        // Dirty bits per field, then a bit per non-zero byte of those
+        std::size_t fields = current.size();
+        level2.assign((fields + 7) / 8, 0);
+        level1.assign((level2.size() + 7) / 8, 0);
+        for (std::size_t i = 0; i < fields; ++i) {
+            if (current[i] != previous[i]) level2[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+        }
+        for (std::size_t j = 0; j < level2.size(); ++j) {
+            if (level2[j]) level1[j / 8] |= static_cast<uint8_t>(1u << (j % 8));
+        }
+
+        payload.clear();
+        putVarint(payload, schemaId);
+        payload.append(reinterpret_cast<const char*>(level1.data()), level1.size());
+        for (uint8_t byte : level2) {
+            if (byte) payload.push_back(static_cast<char>(byte));
+        }
+        for (std::size_t j = 0; j < level2.size(); ++j) {
+            for (uint8_t bits = level2[j]; bits; bits &= static_cast<uint8_t>(bits - 1)) {
+                std::size_t i = j * 8 + static_cast<std::size_t>(__builtin_ctz(bits));
+                if (types[i] == REAL) {
+                    putReal(payload, current[i], previous[i]);
+                } else {
+                    putInteger(payload, current[i], previous[i]);
+                }
+            }
+        }
+        putFrame(out, DELTA, payload);
+        previous.swap(current);
+    }
+
+    void reset() {
+        greeted = false;
+        shaped = false;
+    }
+
+    std::size_t getFieldCount() const {
+        return types.size();
+    }
+
+private:
+    static void toMeta(const Snapshot& snapshot, Meta& meta) {
+        meta.sequence = snapshot.sequence;
+        meta.timestamp = toNanos(snapshot.timestamp.time_since_epoch());
+        meta.wallTime = toNanos(snapshot.wallTime.time_since_epoch());
+        meta.duration = toNanos(snapshot.duration);
+        for (std::size_t i = 0; i < SystemSnapshot::NUM_SOURCES; ++i) {
+            const SystemSnapshot::SourceTiming& timing = snapshot.timings[i];
+            meta.sources[i] = {timing.sampled, timing.sampled ? toNanos(timing.readAt - snapshot.timestamp) : 0,
+                               toNanos(timing.readDuration)};
+        }
+    }
+
+    bool sameShape(const Snapshot& snapshot) const {
+        if (!shaped) return false;
+        for (std::size_t section = 0; section < NUM_SECTIONS; ++section) {
+            Section s = static_cast<Section>(section);
+            if (isSingleton(s)) continue;
+            const std::vector<std::string>& keys = shape[section];
+            std::size_t count = entityCount(snapshot, s);
+            if (keys.size() != count) return false;
+            for (std::size_t i = 0; i < count; ++i) {
+                if (keys[i] != entityKey(snapshot, s, i)) return false;
+            }
+        }
+        return true;
+    }
+
+    void announce(const Snapshot& snapshot, std::string& out) {
+        const auto& sections = localSections();
+        ++schemaId;
+        types.clear();
+        payload.clear();
+        putVarint(payload, schemaId);
+        putVarint(payload, NUM_SECTIONS);
+        for (std::size_t section = 0; section < NUM_SECTIONS; ++section) {
+            Section s = static_cast<Section>(section);
+            std::size_t count = entityCount(snapshot, s);
+            shape[section].clear();
+            putString(payload, SECTION_NAMES[section]);
+            putVarint(payload, count);
+            for (std::size_t i = 0; i < count; ++i) {
+                std::string_view key = entityKey(snapshot, s, i);
+                putString(payload, key);
+                if (!isSingleton(s)) shape[section].emplace_back(key);
+            }
+            const SectionFields& fields = sections[section];
+            putVarint(payload, fields.names.size());
+            for (std::size_t f = 0; f < fields.names.size(); ++f) {
+                payload.push_back(static_cast<char>(fields.types[f]));
+                putString(payload, fields.names[f]);
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                types.insert(types.end(), fields.types.begin(), fields.types.end());
+            }
+        }
+        putFrame(out, SCHEMA, payload);
+
+        // The first sample of a schema is a delta against zero
+        previous.assign(types.size(), 0);
+        current.reserve(types.size());
+        shaped = true;
+    }
+
+    const std::string source;
+    bool greeted = false;
+    bool shaped = false;
+    uint64_t schemaId = 0;
+    std::array<std::vector<std::string>, NUM_SECTIONS> shape;
+    std::vector<uint8_t> types;
+    std::vector<uint64_t> previous;
+    std::vector<uint64_t> current;
+    std::vector<uint8_t> level1;
+    std::vector<uint8_t> level2;
+    std::string payload;
+};
+
+class StreamDecoder::Impl {
+public:
+    Impl() : snapshot{} {}
+
+    Frame decode(std::string_view& data) {
+        if (data.empty()) return Frame::None;
+        char type = data.front();
+        std::string_view rest = data.substr(1);
+        uint64_t length;
+        if (!getVarint(rest, length)) {
+            if (data.size() > 10) malformed("bad frame length");
+            return Frame::None;
+        }
+        if (length > MAX_FRAME) malformed("frame of " + std::to_string(length) + " bytes");
+        if (rest.size() < length) return Frame::None;
+        std::string_view frame = rest.substr(0, length);
+
+        Frame result;
+        switch (type) {
+        case HELLO: hello(frame); result = Frame::Hello; break;
+        case SCHEMA: schema(frame); result = Frame::Schema; break;
+        case DELTA: sample(frame); result = Frame::Sample; break;
+        default: malformed("unknown frame type");
+        }
+        data = rest.substr(length);
+        return result;
+    }
+
+    const std::string& getSource() const {
+        return source;
+    }
+
+    const Snapshot& getSnapshot() const {
+        return snapshot;
+    }
+
+    std::size_t getFieldCount() const {
+        return types.size();
+    }
+
+private:
+    void hello(std::string_view in) {
+        if (in.size() < sizeof(STREAM_MAGIC) || std::memcmp(in.data(), STREAM_MAGIC, sizeof(STREAM_MAGIC)) != 0) {
+            malformed("bad magic");
+        }
+        in.remove_prefix(sizeof(STREAM_MAGIC));
+        uint64_t version = readVarint(in);
+        if (version != STREAM_VERSION) malformed("unsupported version " + std::to_string(version));
+        source.assign(readString(in));
+        greeted = true;
+        shaped = false;
+        schemaId = 0;
+        types.clear();
+    }
+
+    void schema(std::string_view in) {
+        if (!greeted) malformed("schema before hello");
+        const auto& sections = localSections();
+        uint64_t id = readVarint(in);
+        uint64_t sectionCount = readVarint(in);
+
+        // Remote layout first; local offsets depend on every section's count
+        struct Announced {
+            int section;                        // local section, -1 if unknown
+            std::vector<std::string_view> keys;
+            std::vector<int> fields;            // local field per remote field, -1 if unknown
+        };
+        std::vector<Announced> announced;
+        std::array<bool, NUM_SECTIONS> seen{};
+        std::array<std::size_t, NUM_SECTIONS> counts{};
+        for (std::size_t section = 0; section < NUM_SECTIONS; ++section) {
+            counts[section] = isSingleton(static_cast<Section>(section)) ? 1 : 0;
+        }
+        std::vector<uint8_t> remoteTypes;
+        uint64_t keys = 0;                      // entities of every section so far
+        for (uint64_t a = 0; a < sectionCount; ++a) {
+            Announced entry;
+            std::string_view name = readString(in);
+            auto known = std::find(std::begin(SECTION_NAMES), std::end(SECTION_NAMES), name);
+            entry.section = known == std::end(SECTION_NAMES) ? -1 : static_cast<int>(known - std::begin(SECTION_NAMES));
+            uint64_t entities = readVarint(in);
+            if (entities > in.size() || entities > MAX_FIELDS - keys) malformed("bad entity count");
+            keys += entities;
+            for (uint64_t e = 0; e < entities; ++e) entry.keys.push_back(readString(in));
+            uint64_t fieldCount = readVarint(in);
+            if (fieldCount > in.size()) malformed("bad field count");
+            if (fieldCount && entities > (MAX_FIELDS - remoteTypes.size()) / fieldCount) malformed("schema too large");
+            std::vector<uint8_t> fieldTypes;
+            for (uint64_t f = 0; f < fieldCount; ++f) {
+                uint8_t fieldType = readByte(in);
+                if (fieldType != INTEGER && fieldType != REAL) malformed("bad field type");
+                std::string_view fieldName = readString(in);
+                int local = entry.section < 0 ? -1 : sections[entry.section].find(fieldName);
+                if (local >= 0 && sections[entry.section].types[local] != fieldType) local = -1;
+                entry.fields.push_back(local);
+                fieldTypes.push_back(fieldType);
+            }
+            if (entry.section >= 0) {
+                Section s = static_cast<Section>(entry.section);
+                if (seen[s]) malformed("section announced twice");
+                if (isSingleton(s) && entities != 1) malformed("bad entity count");
+                seen[s] = true;
+                counts[s] = entities;
+            }
+            for (uint64_t e = 0; e < entities; ++e) {
+                remoteTypes.insert(remoteTypes.end(), fieldTypes.begin(), fieldTypes.end());
+            }
+            announced.push_back(std::move(entry));
+        }
+        if (!in.empty()) malformed("trailing schema bytes");
+
+        std::array<std::size_t, NUM_SECTIONS> offsets;
+        std::size_t localFields = 0;
+        for (std::size_t section = 0; section < NUM_SECTIONS; ++section) {
+            offsets[section] = localFields;
+            localFields += counts[section] * sections[section].names.size();
+        }
+        if (localFields > MAX_FIELDS) malformed("schema too large");
+        targets.clear();
+        for (const Announced& entry : announced) {
+            for (std::size_t e = 0; e < entry.keys.size(); ++e) {
+                for (int local : entry.fields) {
+                    targets.push_back(entry.section < 0 || local < 0 ? -1 : static_cast<int64_t>(
+                        offsets[entry.section] + e * sections[entry.section].names.size() + local));
+                }
+            }
+        }
+
+        // Reshape the snapshot to the announced entities
+        snapshot.processor.perCoreUtilization.assign(counts[CORES], 0.0f);
+        snapshot.disks.resize(counts[DISKS]);
+        snapshot.interfaces.resize(counts[INTERFACES]);
+        snapshot.cgroups.resize(counts[CGROUPS]);
+        for (const Announced& entry : announced) {
+            for (std::size_t e = 0; e < entry.keys.size(); ++e) {
+                if (entry.section == DISKS) snapshot.disks[e].name.assign(entry.keys[e]);
+                if (entry.section == INTERFACES) snapshot.interfaces[e].name.assign(entry.keys[e]);
+                if (entry.section == CGROUPS) snapshot.cgroups[e].path.assign(entry.keys[e]);
+            }
+        }
+
+        types.swap(remoteTypes);
+        remote.assign(types.size(), 0);
+        local.assign(localFields, 0);
+        schemaId = id;
+        shaped = true;
+    }
+
+    void sample(std::string_view in) {
+        if (!shaped || readVarint(in) != schemaId) malformed("sample without its schema");
+        std::size_t fields = types.size();
+        std::size_t level2 = (fields + 7) / 8;
+        std::size_t level1 = (level2 + 7) / 8;
+        if (in.size() < level1) malformed("truncated bitmap");
+        std::string_view bitmap = in.substr(0, level1);
+        in.remove_prefix(level1);
+
+        dirty.clear();
+        for (std::size_t j = 0; j < level2; ++j) {
+            if (!(static_cast<uint8_t>(bitmap[j / 8]) >> (j % 8) & 1)) continue;
+            uint8_t bits = readByte(in);
+            for (; bits; bits &= static_cast<uint8_t>(bits - 1)) {
+                std::size_t i = j * 8 + static_cast<std::size_t>(__builtin_ctz(bits));
+                if (i >= fields) malformed("dirty bit past the last field");
+                dirty.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        for (uint32_t i : dirty) {
+            remote[i] = types[i] == REAL ? readReal(in, remote[i]) : readInteger(in, remote[i]);
+            if (targets[i] >= 0) local[static_cast<std::size_t>(targets[i])] = remote[i];
+        }
+        if (!in.empty()) malformed("trailing sample bytes");
+
+        Meta meta;
+        std::size_t index = 0;
+        snapshotFields(snapshot, meta, [this, &index](const char*, auto& value) { fromBits(local[index++], value); });
+        fromMeta(meta);
+    }
+
+    void fromMeta(const Meta& meta) {
+        using SteadyClock = std::chrono::steady_clock;
+        using SystemClock = std::chrono::system_clock;
+        snapshot.sequence = meta.sequence;
+        snapshot.timestamp = SteadyClock::time_point(std::chrono::duration_cast<SteadyClock::duration>(
+            std::chrono::nanoseconds(meta.timestamp)));
+        snapshot.wallTime = SystemClock::time_point(std::chrono::duration_cast<SystemClock::duration>(
+            std::chrono::nanoseconds(meta.wallTime)));
+        snapshot.duration = std::chrono::nanoseconds(meta.duration);
+        for (std::size_t i = 0; i < SystemSnapshot::NUM_SOURCES; ++i) {
+            SystemSnapshot::SourceTiming& timing = snapshot.timings[i];
+            timing.sampled = meta.sources[i].sampled;
+            timing.readAt = timing.sampled ? snapshot.timestamp + std::chrono::duration_cast<SteadyClock::duration>(
+                                                 std::chrono::nanoseconds(meta.sources[i].readOffset))
+                                           : SteadyClock::time_point();
+            timing.readDuration = std::chrono::nanoseconds(meta.sources[i].readDuration);
+        }
+    }
+
+    std::string source;
+    bool greeted = false;
+    bool shaped = false;
+    uint64_t schemaId = 0;
+    std::vector<uint8_t> types;         // per remote field
+    std::vector<int64_t> targets;       // local field per remote field, -1 if unknown here
+    std::vector<uint64_t> remote;
+    std::vector<uint64_t> local;
+    std::vector<uint32_t> dirty;
+    Snapshot snapshot;
+};
+
+class StreamSender::Impl {
+public:
+    explicit Impl(const std::string& source) : encoder(source) {}
+
+    ~Impl() {
+        close();
+    }
+
+    void connect(const std::string& host, uint16_t port) {
+        std::lock_guard<std::mutex> lock(mutex);
+        closeLocked();
+        targetHost = host;
+        targetPort = port;
+        targetPath.clear();
+        open(true);
+    }
+
+    void connect(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        closeLocked();
+        sockaddr_un address{};
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Invalid socket path: " + path);
+        }
+        targetHost.clear();
+        targetPath = path;
+        open(true);
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closeLocked();
+        targetHost.clear();
+        targetPath.clear();
+    }
+
+    bool isConnected() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return fd != -1;
+    }
+
+    bool send(const Snapshot& snapshot) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fd == -1 && !open(false)) return false;
+        buffer.clear();
+        encoder.encode(snapshot, buffer);
+
+        std::size_t sent = 0;
+        while (sent < buffer.size()) {
+            ssize_t n = ::send(fd, buffer.data() + sent, buffer.size() - sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                sent += static_cast<std::size_t>(n);
+            } else if (n == -1 && errno == EINTR) {
+                continue;
+            } else {
+                closeLocked();      // a partial frame ends the stream
+                return false;
+            }
+        }
+        ++samples;
+        bytes += buffer.size();
+        return true;
+    }
+
+    Stats getStats() const {
+        return {samples.load(), bytes.load(), connects.load()};
+    }
+
+private:
+    // Caller holds mutex. Every connection starts a new stream.
+    bool open(bool throwing) {
+        std::string where;
+        int error = 0;
+        if (!targetPath.empty()) {
+            where = targetPath;
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            std::memcpy(address.sun_path, targetPath.c_str(), targetPath.size() + 1);
+            fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd != -1 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) {
+                error = errno;
+                closeLocked();
+            }
+        } else if (!targetHost.empty()) {
+            where = targetHost + ":" + std::to_string(targetPort);
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* addresses = nullptr;
+            int status = getaddrinfo(targetHost.c_str(), std::to_string(targetPort).c_str(), &hints, &addresses);
+            if (status != 0) {
+                if (throwing) throw std::runtime_error("Could not resolve " + where + ": " + gai_strerror(status));
+                return false;
+            }
+            for (addrinfo* address = addresses; address && fd == -1; address = address->ai_next) {
+                fd = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+                if (fd != -1 && ::connect(fd, address->ai_addr, address->ai_addrlen) == -1) {
+                    error = errno;
+                    closeLocked();
+                }
+            }
+            freeaddrinfo(addresses);
+            if (fd != -1) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+        } else {
+            return false;
+        }
+
+        if (fd == -1) {
+            if (throwing) {
+                throw std::runtime_error("Could not connect to " + where + ": " + std::strerror(error ? error : errno));
+            }
+            return false;
+        }
+        timeval timeout{1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        encoder.reset();
+        ++connects;
+        return true;
+    }
+
+    void closeLocked() {
+        if (fd != -1) ::close(fd);
+        fd = -1;
+    }
+
+    mutable std::mutex mutex;
+    StreamEncoder encoder;
+    std::string targetHost;
+    uint16_t targetPort = 0;
+    std::string targetPath;
+    int fd = -1;
+    std::string buffer;
+
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> connects{0};
+};
+
+class StreamReceiver::Impl {
+public:
+    explicit Impl(Callback callback)
+        : callback(std::move(callback)),
+          chunk(READ_CHUNK),
+          server(MAX_CONNECTIONS, 512, {
+              [this](std::size_t slot) { accepted(slot); },
+              [this](std::size_t slot, uint32_t) { receive(slot); },
+              [this](std::size_t slot) { closed(slot); },
+              [this]() { ++errors; }
+          }) {}
+
+    ~Impl() {
+        stop();
+    }
+
+    void listen(const std::string& host, uint16_t port) {
+        server.listen(host, port);
+    }
+
+    void listen(const std::string& path) {
+        server.listen(path);
+    }
+
+    void stop() {
+        server.stop();
+    }
+
+    bool isRunning() const {
+        return server.isRunning();
+    }
+
+    uint16_t getPort() const {
+        return server.getPort();
+    }
+
+    Stats getStats() const {
+        return {connections.load(), samples.load(), bytes.load(), errors.load()};
+    }
+
+private:
+    struct Connection {
+        std::string buffer;                     // received, not yet decoded
+        std::unique_ptr<StreamDecoder> decoder;
+    };
+
+    void accepted(std::size_t slot) {
+        if (slot == pool.size()) pool.emplace_back();
+        pool[slot].buffer.clear();
+        pool[slot].decoder = std::make_unique<StreamDecoder>();
+        ++connections;
+    }
+
+    void receive(std::size_t slot) {
+        Connection& connection = pool[slot];
+        int fd = server.getFd(slot);
+        while (true) {
+            ssize_t n = ::read(fd, chunk.data(), chunk.size());
+            if (n > 0) {
+                std::size_t size = static_cast<std::size_t>(n);
+                bytes += static_cast<uint64_t>(n);
+                if (connection.buffer.size() + size > MAX_PENDING || pending + size > MAX_RECEIVER_PENDING) {
+                    ++errors;
+                    server.close(slot);
+                    return;
+                }
+                connection.buffer.append(chunk.data(), size);
+                pending += size;
+                if (!process(slot)) return;
+                continue;
+            }
+            if (n == -1 && errno == EAGAIN) return;
+            if (n == -1 && errno == EINTR) continue;
+            server.close(slot);     // the sender went away
+            return;
+        }
+    }
+
+    // Decode every complete frame; false if the connection was closed. A
+    // malformed stream, a decoder out of memory or a throwing callback
+    // closes this connection only.
+    bool process(std::size_t slot) {
+        Connection& connection = pool[slot];
+        std::string_view data(connection.buffer);
+        try {
+            while (true) {
+                StreamDecoder::Frame frame = connection.decoder->decode(data);
+                if (frame == StreamDecoder::Frame::None) break;
+                if (frame == StreamDecoder::Frame::Sample) {
+                    ++samples;
+                    callback(connection.decoder->getSource(), connection.decoder->getSnapshot());
+                }
+            }
+        } catch (const std::exception&) {
+            ++errors;
+            server.close(slot);
+            return false;
+        }
+        std::size_t consumed = connection.buffer.size() - data.size();
+        connection.buffer.erase(0, consumed);
+        pending -= consumed;
+        return true;
+    }
+
+    void closed(std::size_t slot) {
+        Connection& connection = pool[slot];
+        pending -= connection.buffer.size();
+        std::string().swap(connection.buffer);      // a large partial frame gives its memory back
+        connection.decoder.reset();
+    }
+
+    Callback callback;
+
+    // Connection state per server slot, owned by the server thread
+    std::vector<Connection> pool;
+    std::vector<char> chunk;
+    std::size_t pending = 0;                    // bytes in every connection's buffer
+
+    std::atomic<uint64_t> connections{0};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> errors{0};
+
+    Server server;                              // last: its thread stops before the state above goes
+};
+
+StreamEncoder::StreamEncoder(const std::string& source) : pImpl(std::make_unique<Impl>(source)) {}
+
+StreamEncoder::~StreamEncoder() = default;
+
+void StreamEncoder::encode(const SystemSnapshot::Snapshot& snapshot, std::string& out) {
+    pImpl->encode(snapshot, out);
+}
+
+void StreamEncoder::reset() {
+    pImpl->reset();
+}
+
+std::size_t StreamEncoder::getFieldCount() const {
+    return pImpl->getFieldCount();
+}
+
+StreamDecoder::StreamDecoder() : pImpl(std::make_unique<Impl>()) {}
+
+StreamDecoder::~StreamDecoder() = default;
+
+StreamDecoder::Frame StreamDecoder::decode(std::string_view& data) {
+    return pImpl->decode(data);
+}
+
+const std::string& StreamDecoder::getSource() const {
+    return pImpl->getSource();
+}
+
+const SystemSnapshot::Snapshot& StreamDecoder::getSnapshot() const {
+    return pImpl->getSnapshot();
+}
+
+std::size_t StreamDecoder::getFieldCount() const {
+    return pImpl->getFieldCount();
+}
+
+StreamSender::StreamSender(const std::string& source) : pImpl(std::make_unique<Impl>(source)) {}
+
+StreamSender::~StreamSender() = default;
+
+void StreamSender::connect(const std::string& host, uint16_t port) {
+    pImpl->connect(host, port);
+}
+
+void StreamSender::connect(const std::string& socketPath) {
+    pImpl->connect(socketPath);
+}
+
+void StreamSender::close() {
+    pImpl->close();
+}
+
+bool StreamSender::isConnected() const {
+    return pImpl->isConnected();
+}
+
+bool StreamSender::send(const SystemSnapshot::Snapshot& snapshot) {
+    return pImpl->send(snapshot);
+}
+
+StreamSender::Stats StreamSender::getStats() const {
+    return pImpl->getStats();
+}
+
+StreamReceiver::StreamReceiver(Callback callback) : pImpl(std::make_unique<Impl>(std::move(callback))) {}
+
+StreamReceiver::~StreamReceiver() = default;
+
+void StreamReceiver::listen(uint16_t port) {
+    pImpl->listen("127.0.0.1", port);
+}
+
+void StreamReceiver::listen(const std::string& address, uint16_t port) {
+    pImpl->listen(address, port);
+}
+
+void StreamReceiver::listen(const std::string& socketPath) {
+    pImpl->listen(socketPath);
+}
+
+void StreamReceiver::stop() {
+    pImpl->stop();
+}
+
+bool StreamReceiver::isRunning() const {
+    return pImpl->isRunning();
+}
+
+uint16_t StreamReceiver::getPort() const {
+    return pImpl->getPort();
+}
+
+StreamReceiver::Stats StreamReceiver::getStats() const {
+    return pImpl->getStats();
+}
+
+} // namespace kuserspace
@@ -0,0 +1,278 @@
+// Malghumuy - Library: kuserspace
+#include "../include/SystemSnapshot.h"
+#include "../include/Buffer.h"
+#include "../include/Parser.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <utility>
+
+namespace kuserspace {
+
+namespace {
+
+// PSI averages are printed with two decimals
+double toDecimal(std::string_view token) {
+    std::size_t dot = token.find('.');
+    double value = static_cast<double>(Parser::toUnsigned(token.substr(0, dot)));
+    if (dot != std::string_view::npos) {
+        std::string_view fraction = token.substr(dot + 1);
+        double scale = 1.0;
+        for (std::size_t i = 0; i < fraction.size() && fraction[i] >= '0' && fraction[i] <= '9'; ++i) {
+            scale *= 10.0;
+        }
+        value += static_cast<double>(Parser::toUnsigned(fraction)) / scale;
+    }
+    return value;
+}
+
+// "some avg10=0.00 avg60=0.00 avg300=0.00 total=0", then the same for "full"
+void readPressure(PersistentFile& file, SystemSnapshot::Pressure::Resource& resource) {
+    resource = {};
+    auto content = file.read();
+    if (!content) return;
+    std::string_view input = *content;
+    while (!input.empty()) {
+        std::string_view line = Parser::nextLine(input);
+        std::string_view kind = Parser::nextToken(line);
+        SystemSnapshot::Stall* stall = kind == "some" ? &resource.some : kind == "full" ? &resource.full : nullptr;
+        if (!stall) continue;
+        for (std::string_view field = Parser::nextToken(line); !field.empty(); field = Parser::nextToken(line)) {
+            std::size_t equals = field.find('=');
+            if (equals == std::string_view::npos) continue;
+            std::string_view key = field.substr(0, equals);
+            std::string_view value = field.substr(equals + 1);
+            if (key == "avg10") stall->avg10 = toDecimal(value);
+            else if (key == "avg60") stall->avg60 = toDecimal(value);
+            else if (key == "avg300") stall->avg300 = toDecimal(value);
+            else if (key == "total") stall->total = Parser::toUnsigned(value);
+        }
+    }
+}
+
+} // namespace
+
+class SystemSnapshot::Impl {
+public:
+    explicit Impl(const Root& view) : root(view) {
+        enable(Source::Memory, true);
+        enable(Source::Processor, true);
+        enable(Source::Disk, true);
+        enable(Source::Network, true);
+    }
+
+    ~Impl() {
+        stopMonitoring();
+    }
+
+    // Creating the collector here gives the first pass a real rate interval
+    void enable(Source source, bool on) {
+        if (on) {
+            std::lock_guard<std::mutex> lock(sampleMutex);
+            switch (source) {
+            case Source::Memory:
+                if (!memory) memory = std::make_unique<Memory>(root);
+                break;
+            case Source::Processor:
+                if (!processor) {
+                    processor = std::make_unique<Processor>(root);
+                    processor->getStats(spare.processor);   // prime the utilization window
+                }
+                break;
+            case Source::Disk:
+                if (!disk) disk = std::make_unique<Disk>(root);
+                break;
+            case Source::Network:
+            case Source::Protocols:
+                if (!network) network = std::make_unique<Network>(root);
+                if (source == Source::Protocols) network->refreshProtocolStats();
+                break;
+            case Source::Cgroups:
+                if (!cgroups) {
+                    cgroups = std::make_unique<Cgroup>(Cgroup::getMountPoint(root));
+                    cgroups->refresh();
+                }
+                break;
+            case Source::Pressure:
+                if (!pressure[0].isOpen()) pressure[0].open(root.procPath("/pressure/cpu"));
+                if (!pressure[1].isOpen()) pressure[1].open(root.procPath("/pressure/memory"));
+                if (!pressure[2].isOpen()) pressure[2].open(root.procPath("/pressure/io"));
+                break;
+            }
+        }
+        enabled[index(source)] = on;
+    }
+
+    bool isEnabled(Source source) const {
+        return enabled[index(source)];
+    }
+
+    void refresh() {
+        std::lock_guard<std::mutex> lock(sampleMutex);
+        pass();
+    }
+
+    Snapshot getSnapshot() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return latest;
+    }
+
+    void getSnapshot(Snapshot& snapshot) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        snapshot = latest;
+    }
+
+    void startMonitoring(SnapshotCallback callback, std::chrono::milliseconds period) {
+        if (monitoringActive) return;
+        monitoringActive = true;
+        monitoringThread = std::thread([this, callback, period]() {
+            // Fixed cadence: a slow pass delays the next one, it does not shift the grid
+            auto next = std::chrono::steady_clock::now();
+            Snapshot current{};     // reused, so the copy stops allocating once its vectors have grown
+            while (monitoringActive) {
+                {
+                    std::lock_guard<std::mutex> lock(sampleMutex);
+                    pass();
+                    std::shared_lock<std::shared_mutex> published(mutex);
+                    current = latest;
+                }
+                // No lock held: the callback may refresh() or read snapshots itself
+                callback(current);
+
+                next += period;
+                auto now = std::chrono::steady_clock::now();
+                if (next < now) next = now;
+                std::unique_lock<std::mutex> lock(monitorMutex);
+                monitorCV.wait_until(lock, next, [this]() { return !monitoringActive; });
+            }
+        });
+    }
+
+    void stopMonitoring() {
+        monitoringActive = false;
+        monitorCV.notify_all();
+        if (monitoringThread.joinable()) {
+            monitoringThread.join();
+        }
+    }
+
+private:
+    static std::size_t index(Source source) {
+        return static_cast<std::size_t>(source);
+    }
+
+    // Reads every enabled source into spare, then publishes it. Caller holds sampleMutex.
+    void pass() {
+        Snapshot& s = spare;
+        s.sequence = ++sequence;
+        s.timestamp = std::chrono::steady_clock::now();
+        s.wallTime = std::chrono::system_clock::now();
+
+        auto sample = [&](Source source, auto&& read) {
+            SourceTiming& timing = s.timings[index(source)];
+            timing.sampled = enabled[index(source)];
+            timing.readAt = std::chrono::steady_clock::now();
+            if (timing.sampled) {
+                read();
+            }
+            timing.readDuration = std::chrono::steady_clock::now() - timing.readAt;
+        };
+
+        sample(Source::Memory, [&]() {
+            memory->refresh();
+            s.memory = memory->getStats();
+        });
+        sample(Source::Processor, [&]() {
+            processor->getStats(s.processor);
+        });
+        sample(Source::Disk, [&]() {
+            disk->refresh();
+            disk->getStats(s.disks);
+        });
+        sample(Source::Network, [&]() {
+            network->refresh();
+            network->getStats(s.interfaces);
+        });
+        sample(Source::Protocols, [&]() {
+            network->refreshProtocolStats();
+            s.protocols = network->getProtocolStats();
+        });
+        sample(Source::Cgroups, [&]() {
+            cgroups->refresh();
+            cgroups->getStats(s.cgroups);
+        });
+        sample(Source::Pressure, [&]() {
+            readPressure(pressure[0], s.pressure.cpu);
+            readPressure(pressure[1], s.pressure.memory);
+            readPressure(pressure[2], s.pressure.io);
+        });
+
+        s.duration = std::chrono::steady_clock::now() - s.timestamp;
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        std::swap(latest, spare);
+    }
+
+    Root root;
+    std::unique_ptr<Memory> memory;
+    std::unique_ptr<Processor> processor;
+    std::unique_ptr<Disk> disk;
+    std::unique_ptr<Network> network;
+    std::unique_ptr<Cgroup> cgroups;
+    std::array<PersistentFile, 3> pressure;     // cpu, memory, io
+    std::array<std::atomic<bool>, NUM_SOURCES> enabled{};
+
+    std::mutex sampleMutex;                 // one pass at a time, guards spare
+    uint64_t sequence = 0;
+    Snapshot spare{};
+    Snapshot latest{};
+    mutable std::shared_mutex mutex;        // guards latest
+
+    std::atomic<bool> monitoringActive{false};
+    std::thread monitoringThread;
+    std::mutex monitorMutex;
+    std::condition_variable monitorCV;
+};
+
+SystemSnapshot& SystemSnapshot::getInstance() {
+    static SystemSnapshot instance;
+    return instance;
+}
+
+SystemSnapshot::SystemSnapshot(const Root& root) : pImpl(std::make_unique<Impl>(root)) {}
+
+SystemSnapshot::~SystemSnapshot() {
+    pImpl->stopMonitoring();
+}
+
+void SystemSnapshot::enable(Source source, bool enabled) {
+    pImpl->enable(source, enabled);
+}
+
+bool SystemSnapshot::isEnabled(Source source) const {
+    return pImpl->isEnabled(source);
+}
+
+void SystemSnapshot::refresh() {
+    pImpl->refresh();
+}
+
+SystemSnapshot::Snapshot SystemSnapshot::getSnapshot() const {
+    return pImpl->getSnapshot();
+}
+
+void SystemSnapshot::getSnapshot(Snapshot& snapshot) const {
+    pImpl->getSnapshot(snapshot);
+}
+
+void SystemSnapshot::startContinuousMonitoring(SnapshotCallback callback, std::chrono::milliseconds interval) {
+    pImpl->startMonitoring(callback, interval);
+}
+
+void SystemSnapshot::stopContinuousMonitoring() {
+    pImpl->stopMonitoring();
+}
+
+} // namespace kuserspace
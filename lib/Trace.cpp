@@ -0,0 +1,761 @@
+// Malghumuy - Library: kuserspace
+#include "../include/Trace.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <string_view>
+#include <stdexcept>
+#include <charconv>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <cmath>
+#include <ctime>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace kuserspace {
+
+namespace {
+
+constexpr std::chrono::milliseconds DEFAULT_FLUSH_INTERVAL(100);
+constexpr std::size_t DEFAULT_EVENTS_PER_THREAD = 16384;
+constexpr std::size_t WRITE_THRESHOLD = 1 << 20;
+
+// Track of the collector slices; above any pid_max, so never a real thread
+constexpr int32_t COLLECTOR_TID = 0x7ffffffe;
+const char* const COLLECTOR_TRACK = "kuserspace collectors";
+
+const char* const SOURCE_NAMES[SystemSnapshot::NUM_SOURCES] = {
+    "memory", "processor", "disk", "network", "protocols", "cgroups", "pressure"
+};
+
+// Perfetto field numbers, from protos/perfetto/trace
+namespace proto {
+constexpr uint32_t TRACE_PACKET = 1;                    // Trace
+constexpr uint32_t PACKET_CLOCK_SNAPSHOT = 6;           // TracePacket
+constexpr uint32_t PACKET_TIMESTAMP = 8;
+constexpr uint32_t PACKET_SEQUENCE_ID = 10;
+constexpr uint32_t PACKET_TRACK_EVENT = 11;
+constexpr uint32_t PACKET_SEQUENCE_FLAGS = 13;
+constexpr uint32_t PACKET_CLOCK_ID = 58;
+constexpr uint32_t PACKET_TRACK_DESCRIPTOR = 60;
+constexpr uint32_t CLOCKS = 1;                          // ClockSnapshot
+constexpr uint32_t CLOCK_ID = 1;                        // ClockSnapshot.Clock
+constexpr uint32_t CLOCK_TIMESTAMP = 2;
+constexpr uint32_t TRACK_UUID = 1;                      // TrackDescriptor
+constexpr uint32_t TRACK_NAME = 2;
+constexpr uint32_t TRACK_PROCESS = 3;
+constexpr uint32_t TRACK_THREAD = 4;
+constexpr uint32_t TRACK_PARENT = 5;
+constexpr uint32_t TRACK_COUNTER = 8;
+constexpr uint32_t PROCESS_PID = 1;                     // ProcessDescriptor
+constexpr uint32_t THREAD_PID = 1;                      // ThreadDescriptor
+constexpr uint32_t THREAD_TID = 2;
+constexpr uint32_t THREAD_NAME = 5;
+constexpr uint32_t EVENT_TYPE = 9;                      // TrackEvent
+constexpr uint32_t EVENT_TRACK = 11;
+constexpr uint32_t EVENT_CATEGORIES = 22;
+constexpr uint32_t EVENT_NAME = 23;
+constexpr uint32_t EVENT_DOUBLE_VALUE = 44;
+
+constexpr uint64_t SLICE_BEGIN = 1;                     // TrackEvent.Type
+constexpr uint64_t SLICE_END = 2;
+constexpr uint64_t INSTANT = 3;
+constexpr uint64_t COUNTER = 4;
+constexpr uint64_t CLOCK_MONOTONIC_ID = 3;              // BuiltinClock
+constexpr uint64_t CLOCK_BOOTTIME_ID = 6;
+constexpr uint64_t INCREMENTAL_STATE_CLEARED = 1;       // SequenceFlags
+
+enum WireType : uint32_t { Varint = 0, Fixed64 = 1, Bytes = 2 };
+
+void varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+void tag(std::string& out, uint32_t field, WireType type) {
+    varint(out, static_cast<uint64_t>(field) << 3 | type);
+}
+
+void putVarint(std::string& out, uint32_t field, uint64_t value) {
+    tag(out, field, Varint);
+    varint(out, value);
+}
+
+void putDouble(std::string& out, uint32_t field, double value) {
+    tag(out, field, Fixed64);
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; ++i) out += static_cast<char>(bits >> (8 * i));
+}
+
+void putBytes(std::string& out, uint32_t field, std::string_view bytes) {
+    tag(out, field, Bytes);
+    varint(out, bytes.size());
+    out.append(bytes.data(), bytes.size());
+}
+} // namespace proto
+
+enum class Kind : uint8_t { Counter, Slice, Begin, End, Instant };
+
+struct Event {
+    const char* name;
+    int64_t time;           // steady_clock nanoseconds
+    int64_t duration;       // Slice
+    double value;           // Counter
+    int32_t tid;
+    Kind kind;
+};
+
+int64_t nanoseconds(Tracer::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+int64_t clockNanoseconds(clockid_t clock) {
+    timespec ts{};
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Single-producer, single-consumer ring of one thread's events. The owner
+// pushes without locking; the flusher drains under the tracer's write lock.
+class Ring {
+public:
+    Ring(std::size_t capacity, int32_t tid, std::string name) : tid(tid), name(std::move(name)) {
+        std::size_t size = 1;
+        while (size < capacity) size <<= 1;
+        events.resize(size);
+        mask = size - 1;
+    }
+
+    void push(const Event& event) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        events[h & mask] = event;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+    }
+
+    uint64_t pending() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    template <typename F>
+    void drain(F&& f) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        for (; t != h; ++t) f(events[t & mask]);
+        tail.store(t, std::memory_order_release);
+    }
+
+    const int32_t tid;
+    const std::string name;
+    std::atomic<uint64_t> dropped{0};
+    bool announced = false;     // flusher only
+
+private:
+    std::vector<Event> events;
+    std::size_t mask = 0;
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+};
+
+std::atomic<uint64_t> nextTracerId{1};
+
+void appendEscaped(std::string& out, const char* text) {
+    for (const char* c = text; *c; ++c) {
+        unsigned char ch = static_cast<unsigned char>(*c);
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += *c;
+        } else if (ch < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+            out += buffer;
+        } else {
+            out += *c;
+        }
+    }
+}
+
+void appendInteger(std::string& out, int64_t value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+// JSON has no NaN or infinity
+void appendReal(std::string& out, double value) {
+    if (!std::isfinite(value)) value = 0;
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+// Trace-event timestamps are microseconds; keep the nanoseconds as decimals
+void appendMicros(std::string& out, int64_t ns) {
+    appendInteger(out, ns / 1000);
+    char decimals[4] = {'.', static_cast<char>('0' + ns / 100 % 10), static_cast<char>('0' + ns / 10 % 10),
+                        static_cast<char>('0' + ns % 10)};
+    out.append(decimals, sizeof(decimals));
+}
+
+} // namespace
+
+class Tracer::Impl {
+public:
+    Impl(const std::string& path, Format format, std::chrono::milliseconds flushInterval,
+         std::size_t eventsPerThread, const Root& root)
+        : id(nextTracerId.fetch_add(1)), format(format), flushInterval(flushInterval),
+          eventsPerThread(std::max<std::size_t>(eventsPerThread, 2)), root(root), pid(getpid()) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open trace file: " + path + ": " + std::strerror(errno));
+        }
+        uuidBase = 0x6b75737000000000ull ^ static_cast<uint64_t>(pid) << 20;
+        collectorUuid = uuidBase + 1;
+        nextUuid = uuidBase + 2;
+        start();
+        writeOut();
+        open.store(true, std::memory_order_release);
+        flusher = std::thread(&Impl::run, this);
+    }
+
+    ~Impl() {
+        close();
+        for (int frequencyFd : frequencyFds) {
+            if (frequencyFd >= 0) ::close(frequencyFd);
+        }
+    }
+
+    void push(const Event& event) {
+        if (!open.load(std::memory_order_acquire)) {
+            closedDrops.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Ring* ring = local();
+        if (event.kind == Kind::Counter) {
+            ring->push(event);
+        } else {
+            Event owned = event;
+            owned.tid = ring->tid;
+            ring->push(owned);
+        }
+    }
+
+    void record(const SystemSnapshot::Snapshot& s) {
+        if (!open.load(std::memory_order_acquire)) {
+            closedDrops.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Ring* ring = local();
+        auto slice = [&](Kind kind, const char* name, int64_t time, int64_t duration) {
+            ring->push(Event{name, time, duration, 0, COLLECTOR_TID, kind});
+        };
+        auto counter = [&](const char* name, int64_t time, double value) {
+            ring->push(Event{name, time, 0, value, 0, Kind::Counter});
+        };
+
+        // Begin and end around the reads, so that they nest even on equal timestamps
+        int64_t passStart = nanoseconds(s.timestamp);
+        slice(Kind::Begin, "snapshot", passStart, 0);
+        for (std::size_t i = 0; i < SystemSnapshot::NUM_SOURCES; ++i) {
+            const SystemSnapshot::SourceTiming& timing = s.timings[i];
+            if (timing.sampled) {
+                slice(Kind::Slice, SOURCE_NAMES[i], nanoseconds(timing.readAt), timing.readDuration.count());
+            }
+        }
+        slice(Kind::End, "snapshot", passStart + s.duration.count(), 0);
+
+        auto readEnd = [&](SystemSnapshot::Source source) {
+            const SystemSnapshot::SourceTiming& timing = s.timing(source);
+            return nanoseconds(timing.readAt) + timing.readDuration.count();
+        };
+
+        if (s.timing(SystemSnapshot::Source::Memory).sampled) {
+            int64_t at = readEnd(SystemSnapshot::Source::Memory);
+            const Memory::Stats& m = s.memory;
+            counter("memory.used", at, static_cast<double>(m.total > m.available ? m.total - m.available : 0));
+            counter("memory.available", at, static_cast<double>(m.available));
+            counter("memory.cached", at, static_cast<double>(m.cached));
+            counter("memory.swapUsed", at, static_cast<double>(m.swapTotal > m.swapFree ? m.swapTotal - m.swapFree : 0));
+        }
+
+        if (s.timing(SystemSnapshot::Source::Processor).sampled) {
+            int64_t at = readEnd(SystemSnapshot::Source::Processor);
+            const std::vector<float>& cores = s.processor.perCoreUtilization;
+            std::lock_guard<std::mutex> lock(recordMutex);
+            while (utilizationNames.size() < cores.size()) {
+                std::string cpu = "cpu" + std::to_string(utilizationNames.size());
+                utilizationNames.push_back(cpu + ".utilization");
+                frequencyNames.push_back(cpu + ".frequency");
+                frequencyFds.push_back(::open(root.sysPath("/devices/system/cpu/" + cpu + "/cpufreq/scaling_cur_freq").c_str(),
+                                              O_RDONLY | O_CLOEXEC));
+            }
+            counter("cpu.utilization", at, s.processor.totalUtilization);
+            for (std::size_t core = 0; core < cores.size(); ++core) {
+                counter(utilizationNames[core].c_str(), at, cores[core]);
+            }
+            // Frequency is not part of the snapshot; read it now, next to the pass
+            int64_t now = nanoseconds(Clock::now());
+            for (std::size_t core = 0; core < cores.size(); ++core) {
+                double mhz = readFrequency(frequencyFds[core]);
+                if (mhz >= 0) counter(frequencyNames[core].c_str(), now, mhz);
+            }
+        }
+
+        if (s.timing(SystemSnapshot::Source::Pressure).sampled) {
+            int64_t at = readEnd(SystemSnapshot::Source::Pressure);
+            const SystemSnapshot::Pressure& p = s.pressure;
+            counter("pressure.cpu.some.avg10", at, p.cpu.some.avg10);
+            counter("pressure.memory.some.avg10", at, p.memory.some.avg10);
+            counter("pressure.memory.full.avg10", at, p.memory.full.avg10);
+            counter("pressure.io.some.avg10", at, p.io.some.avg10);
+            counter("pressure.io.full.avg10", at, p.io.full.avg10);
+        }
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (fd < 0) return;
+
+        std::vector<Ring*> current;
+        {
+            std::lock_guard<std::mutex> ringsLock(ringsMutex);
+            for (const auto& ring : rings) current.push_back(ring.get());
+        }
+
+        if (format == Format::Perfetto) clockSnapshot();
+        for (Ring* ring : current) {
+            if (ring->empty()) continue;
+            if (!ring->announced) {
+                announce(*ring);
+                ring->announced = true;
+            }
+            ring->drain([&](const Event& event) {
+                append(*ring, event);
+                ++unwritten;
+            });
+            if (out.size() >= WRITE_THRESHOLD) writeOut();
+        }
+        writeOut();
+        flushes.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void close() {
+        if (!open.exchange(false)) return;
+        {
+            std::lock_guard<std::mutex> lock(flusherMutex);
+            stopping = true;
+        }
+        flusherCV.notify_all();
+        if (flusher.joinable()) flusher.join();
+
+        flush();
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (format == Format::Json) {
+            out += "\n]\n";
+            writeOut();
+        }
+        ::close(fd);
+        fd = -1;
+        finished.store(true, std::memory_order_release);
+    }
+
+    bool isOpen() const {
+        return open.load(std::memory_order_acquire);
+    }
+
+    Stats getStats() const {
+        Stats stats{};
+        stats.events = events.load(std::memory_order_relaxed);
+        stats.flushes = flushes.load(std::memory_order_relaxed);
+        stats.bytes = bytes.load(std::memory_order_relaxed);
+        stats.errors = errors.load(std::memory_order_relaxed);
+        stats.dropped = closedDrops.load(std::memory_order_relaxed) + failedDrops.load(std::memory_order_relaxed);
+        // A producer that passed the open check just before close() may
+        // still push after the final drain; nothing will write those
+        bool done = finished.load(std::memory_order_acquire);
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (const auto& ring : rings) {
+            stats.dropped += ring->dropped.load(std::memory_order_relaxed);
+            if (done) stats.dropped += ring->pending();
+        }
+        stats.threads = rings.size();
+        return stats;
+    }
+
+private:
+    // The calling thread's ring, created on its first event. One cached
+    // entry per thread; tracer ids are never reused, so a stale entry of a
+    // destroyed tracer cannot match.
+    Ring* local() {
+        thread_local uint64_t cachedId = 0;
+        thread_local Ring* cachedRing = nullptr;
+        if (cachedId == id) return cachedRing;
+
+        int32_t tid = static_cast<int32_t>(syscall(SYS_gettid));
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        Ring* ring = nullptr;
+        for (const auto& r : rings) {
+            if (r->tid == tid) ring = r.get();
+        }
+        if (!ring) {
+            char name[16] = {};
+            pthread_getname_np(pthread_self(), name, sizeof(name));
+            rings.push_back(std::make_unique<Ring>(eventsPerThread, tid, name));
+            ring = rings.back().get();
+        }
+        cachedId = id;
+        cachedRing = ring;
+        return ring;
+    }
+
+    // kHz in scaling_cur_freq to MHz, -1 without cpufreq
+    static double readFrequency(int frequencyFd) {
+        if (frequencyFd < 0) return -1;
+        char buffer[32];
+        ssize_t n = ::pread(frequencyFd, buffer, sizeof(buffer), 0);
+        if (n <= 0) return -1;
+        uint64_t khz = 0;
+        auto result = std::from_chars(buffer, buffer + n, khz);
+        if (result.ec != std::errc()) return -1;
+        return static_cast<double>(khz) / 1000.0;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(flusherMutex);
+        while (!stopping) {
+            flusherCV.wait_for(lock, flushInterval, [this]() { return stopping; });
+            if (stopping) break;
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+
+    void writeOut() {
+        std::size_t done = 0;
+        while (!failed && done < out.size()) {
+            ssize_t n = ::write(fd, out.data() + done, out.size() - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                failed = true;
+                errors.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            done += static_cast<std::size_t>(n);
+        }
+        bytes.fetch_add(done, std::memory_order_relaxed);
+        // Events only count as written once their whole batch reached the file
+        (failed ? failedDrops : events).fetch_add(unwritten, std::memory_order_relaxed);
+        unwritten = 0;
+        out.clear();
+    }
+
+    // Header of the file: the process and the collector track
+    void start() {
+        if (format == Format::Json) {
+            out += "[";
+            first = true;
+            metadata("thread_name", COLLECTOR_TID, COLLECTOR_TRACK);
+            return;
+        }
+        packet.clear();
+        message.clear();
+        proto::putVarint(message, proto::PROCESS_PID, static_cast<uint64_t>(pid));
+        proto::putVarint(packet, proto::PACKET_SEQUENCE_ID, sequenceId());
+        proto::putVarint(packet, proto::PACKET_SEQUENCE_FLAGS, proto::INCREMENTAL_STATE_CLEARED);
+        descriptor.clear();
+        proto::putVarint(descriptor, proto::TRACK_UUID, uuidBase);
+        proto::putBytes(descriptor, proto::TRACK_PROCESS, message);
+        proto::putBytes(packet, proto::PACKET_TRACK_DESCRIPTOR, descriptor);
+        emitPacket();
+
+        descriptor.clear();
+        proto::putVarint(descriptor, proto::TRACK_UUID, collectorUuid);
+        proto::putBytes(descriptor, proto::TRACK_NAME, COLLECTOR_TRACK);
+        proto::putVarint(descriptor, proto::TRACK_PARENT, uuidBase);
+        describe(descriptor);
+    }
+
+    // A thread's track, before its first event
+    void announce(const Ring& ring) {
+        if (format == Format::Json) {
+            if (!ring.name.empty()) metadata("thread_name", ring.tid, ring.name.c_str());
+            return;
+        }
+        uint64_t uuid = nextUuid++;
+        threadTracks[ring.tid] = uuid;
+        message.clear();
+        proto::putVarint(message, proto::THREAD_PID, static_cast<uint64_t>(pid));
+        proto::putVarint(message, proto::THREAD_TID, static_cast<uint64_t>(ring.tid));
+        if (!ring.name.empty()) proto::putBytes(message, proto::THREAD_NAME, ring.name);
+        descriptor.clear();
+        proto::putVarint(descriptor, proto::TRACK_UUID, uuid);
+        proto::putBytes(descriptor, proto::TRACK_THREAD, message);
+        describe(descriptor);
+    }
+
+    void append(const Ring& ring, const Event& event) {
+        if (format == Format::Json) {
+            appendJson(event);
+        } else {
+            appendPacket(ring, event);
+        }
+    }
+
+    void separator() {
+        out += first ? "\n" : ",\n";
+        first = false;
+    }
+
+    void metadata(const char* what, int32_t tid, const char* name) {
+        separator();
+        out += "{\"name\":\"";
+        out += what;
+        out += "\",\"ph\":\"M\",\"pid\":";
+        appendInteger(out, pid);
+        out += ",\"tid\":";
+        appendInteger(out, tid);
+        out += ",\"args\":{\"name\":\"";
+        appendEscaped(out, name);
+        out += "\"}}";
+    }
+
+    void appendJson(const Event& event) {
+        static const char* const PHASES[] = {"C", "X", "B", "E", "i"};
+        separator();
+        out += "{\"name\":\"";
+        appendEscaped(out, event.name);
+        out += "\",\"cat\":\"kuserspace\",\"ph\":\"";
+        out += PHASES[static_cast<std::size_t>(event.kind)];
+        out += "\",\"ts\":";
+        appendMicros(out, event.time);
+        out += ",\"pid\":";
+        appendInteger(out, pid);
+        switch (event.kind) {
+        case Kind::Counter:
+            out += ",\"args\":{\"value\":";
+            appendReal(out, event.value);
+            out += "}}";
+            return;
+        case Kind::Slice:
+            out += ",\"dur\":";
+            appendMicros(out, event.duration);
+            break;
+        case Kind::Instant:
+            out += ",\"s\":\"t\"";
+            break;
+        default:
+            break;
+        }
+        out += ",\"tid\":";
+        appendInteger(out, event.tid);
+        out += '}';
+    }
+
+    void appendPacket(const Ring& ring, const Event& event) {
+        uint64_t track;
+        if (event.kind == Kind::Counter) {
+            auto found = counterTracks.find(event.name);
+            if (found == counterTracks.end()) {
+                uint64_t uuid = nextUuid++;
+                message.clear();
+                descriptor.clear();
+                proto::putVarint(descriptor, proto::TRACK_UUID, uuid);
+                proto::putBytes(descriptor, proto::TRACK_NAME, event.name);
+                proto::putVarint(descriptor, proto::TRACK_PARENT, uuidBase);
+                proto::putBytes(descriptor, proto::TRACK_COUNTER, message);
+                describe(descriptor);
+                found = counterTracks.emplace(event.name, uuid).first;
+            }
+            track = found->second;
+        } else {
+            track = event.tid == COLLECTOR_TID ? collectorUuid : threadTracks[ring.tid];
+        }
+
+        switch (event.kind) {
+        case Kind::Counter:
+            trackEvent(event.time, proto::COUNTER, track, nullptr, &event.value);
+            break;
+        case Kind::Slice:
+            trackEvent(event.time, proto::SLICE_BEGIN, track, event.name, nullptr);
+            trackEvent(event.time + event.duration, proto::SLICE_END, track, nullptr, nullptr);
+            break;
+        case Kind::Begin:
+            trackEvent(event.time, proto::SLICE_BEGIN, track, event.name, nullptr);
+            break;
+        case Kind::End:
+            trackEvent(event.time, proto::SLICE_END, track, nullptr, nullptr);
+            break;
+        case Kind::Instant:
+            trackEvent(event.time, proto::INSTANT, track, event.name, nullptr);
+            break;
+        }
+    }
+
+    void trackEvent(int64_t time, uint64_t type, uint64_t track, const char* name, const double* value) {
+        message.clear();
+        proto::putVarint(message, proto::EVENT_TYPE, type);
+        proto::putVarint(message, proto::EVENT_TRACK, track);
+        if (name) {
+            proto::putBytes(message, proto::EVENT_CATEGORIES, "kuserspace");
+            proto::putBytes(message, proto::EVENT_NAME, name);
+        }
+        if (value) proto::putDouble(message, proto::EVENT_DOUBLE_VALUE, *value);
+
+        packet.clear();
+        proto::putVarint(packet, proto::PACKET_TIMESTAMP, static_cast<uint64_t>(time));
+        proto::putVarint(packet, proto::PACKET_CLOCK_ID, proto::CLOCK_MONOTONIC_ID);
+        proto::putVarint(packet, proto::PACKET_SEQUENCE_ID, sequenceId());
+        proto::putBytes(packet, proto::PACKET_TRACK_EVENT, message);
+        emitPacket();
+    }
+
+    void describe(const std::string& track) {
+        packet.clear();
+        proto::putVarint(packet, proto::PACKET_SEQUENCE_ID, sequenceId());
+        proto::putBytes(packet, proto::PACKET_TRACK_DESCRIPTOR, track);
+        emitPacket();
+    }
+
+    // Monotonic against boot time, taken on every flush so that suspend
+    // between flushes is accounted for
+    void clockSnapshot() {
+        int64_t boottime = clockNanoseconds(CLOCK_BOOTTIME);
+        int64_t monotonic = clockNanoseconds(CLOCK_MONOTONIC);
+        packet.clear();
+        descriptor.clear();
+        for (auto [clock, time] : {std::make_pair(proto::CLOCK_BOOTTIME_ID, boottime),
+                                   std::make_pair(proto::CLOCK_MONOTONIC_ID, monotonic)}) {
+            message.clear();
+            proto::putVarint(message, proto::CLOCK_ID, clock);
+            proto::putVarint(message, proto::CLOCK_TIMESTAMP, static_cast<uint64_t>(time));
+            proto::putBytes(descriptor, proto::CLOCKS, message);
+        }
+        proto::putVarint(packet, proto::PACKET_SEQUENCE_ID, sequenceId());
+        proto::putBytes(packet, proto::PACKET_CLOCK_SNAPSHOT, descriptor);
+        emitPacket();
+    }
+
+    void emitPacket() {
+        proto::putBytes(out, proto::TRACE_PACKET, packet);
+    }
+
+    uint64_t sequenceId() const {
+        return static_cast<uint64_t>(pid) + 1;
+    }
+
+    const uint64_t id;
+    const Format format;
+    const std::chrono::milliseconds flushInterval;
+    const std::size_t eventsPerThread;
+    const Root root;
+    const int pid;
+
+    std::atomic<bool> open{false};
+    std::atomic<uint64_t> closedDrops{0};
+    std::atomic<bool> finished{false};      // final flush done, file closed
+
+    mutable std::mutex ringsMutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    // record()'s per-core names and cpufreq files; deque keeps the names in place
+    std::mutex recordMutex;
+    std::deque<std::string> utilizationNames;
+    std::deque<std::string> frequencyNames;
+    std::vector<int> frequencyFds;
+
+    // Writer state, under writeMutex
+    std::mutex writeMutex;
+    int fd = -1;
+    bool failed = false;
+    bool first = true;
+    std::string out;
+    std::string packet;
+    std::string descriptor;
+    std::string message;
+    uint64_t uuidBase = 0;
+    uint64_t collectorUuid = 0;
+    uint64_t nextUuid = 0;
+    std::unordered_map<std::string_view, uint64_t> counterTracks;
+    std::unordered_map<int32_t, uint64_t> threadTracks;
+
+    uint64_t unwritten = 0;                 // events in out
+
+    std::atomic<uint64_t> events{0};
+    std::atomic<uint64_t> failedDrops{0};
+    std::atomic<uint64_t> flushes{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> errors{0};
+
+    std::mutex flusherMutex;
+    std::condition_variable flusherCV;
+    bool stopping = false;
+    std::thread flusher;
+};
+
+Tracer::Tracer(const std::string& path, Format format, const Root& root)
+    : pImpl(std::make_unique<Impl>(path, format, DEFAULT_FLUSH_INTERVAL, DEFAULT_EVENTS_PER_THREAD, root)) {}
+
+Tracer::Tracer(const std::string& path, Format format, std::chrono::milliseconds flushInterval,
+               std::size_t eventsPerThread, const Root& root)
+    : pImpl(std::make_unique<Impl>(path, format, flushInterval, eventsPerThread, root)) {}
+
+Tracer::~Tracer() = default;
+
+void Tracer::record(const SystemSnapshot::Snapshot& snapshot) {
+    pImpl->record(snapshot);
+}
+
+void Tracer::counter(const char* track, double value) {
+    pImpl->push(Event{track, nanoseconds(Clock::now()), 0, value, 0, Kind::Counter});
+}
+
+void Tracer::counter(const char* track, double value, Clock::time_point time) {
+    pImpl->push(Event{track, nanoseconds(time), 0, value, 0, Kind::Counter});
+}
+
+void Tracer::slice(const char* name, Clock::time_point begin, Clock::time_point end) {
+    pImpl->push(Event{name, nanoseconds(begin), std::max<int64_t>((end - begin).count(), 0), 0, 0, Kind::Slice});
+}
+
+void Tracer::instant(const char* name) {
+    pImpl->push(Event{name, nanoseconds(Clock::now()), 0, 0, 0, Kind::Instant});
+}
+
+void Tracer::flush() {
+    pImpl->flush();
+}
+
+void Tracer::close() {
+    pImpl->close();
+}
+
+bool Tracer::isOpen() const {
+    return pImpl->isOpen();
+}
+
+Tracer::Stats Tracer::getStats() const {
+    return pImpl->getStats();
+}
+
+} // namespace kuserspace